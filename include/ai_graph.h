@@ -0,0 +1,131 @@
+#ifndef _AI_GRAPH_H_
+#define _AI_GRAPH_H_
+
+#include <ai_search.h>
+#include <stdint.h>
+
+/*
+ * AI - Graph.
+ *
+ * A directed graph with float edge costs, in Compressed Sparse Row (CSR)
+ * form. Nodes are numbered 0 to node_count - 1. The out edges of node v are
+ * edges edge_offset[v] to edge_offset[v + 1] - 1, in the order given to the
+ * constructor. The in edges are indexed the same way by reverse_offset.
+ *
+ * An edge cost may be INFINITY, for an edge that can not currently be used.
+ *
+ * Example:
+ * ai_graph_edge edges[] = {{0, 1, 2.0f}, {1, 2, 1.5f}};
+ * ai_graph *graph = ai_graph_constructor(3, 2, edges);
+ * for (uint32_t e = graph->edge_offset[v]; e < graph->edge_offset[v + 1]; e++)
+ *   visit(graph->edge_target[e], graph->edge_cost[e]);
+ */
+
+#define AI_GRAPH_NODE_NONE UINT32_MAX
+
+// An edge, as given to the constructor or to report a change of cost.
+typedef struct ai_graph_edge_struct {
+  uint32_t source;
+  uint32_t target;
+  float cost;
+} ai_graph_edge;
+
+// The data of an Action in a graph path, moving along one edge.
+typedef struct ai_graph_action_struct {
+  uint32_t edge;
+  uint32_t target;
+} ai_graph_action;
+
+typedef struct ai_graph_struct {
+  uint32_t node_count;
+  uint32_t edge_count;
+  // Out edges.
+  uint32_t *edge_offset; // node_count + 1 entries.
+  uint32_t *edge_target;
+  float *edge_cost;
+  // In edges.
+  uint32_t *reverse_offset; // node_count + 1 entries.
+  uint32_t *reverse_source;
+  uint32_t *reverse_edge; // Index of the out edge.
+} ai_graph;
+
+/*
+ * An estimate of the cost from one node to another, for graph searches.
+ * It must NEVER over-estimate the cost. est_cost_data is passed through
+ * unchanged, for the estimate's own tables.
+ */
+typedef float (*ai_graph_est_cost_function)(void *est_cost_data,
+                                            uint32_t from_node,
+                                            uint32_t to_node);
+
+// The Goal of a search of a graph with ai_search_astar, and its estimate.
+typedef struct ai_graph_query_struct {
+  ai_graph *graph;
+  uint32_t goal;
+  // Optional. NULL for none.
+  ai_graph_est_cost_function est_cost_function;
+  void *est_cost_data;
+} ai_graph_query;
+
+// Model State data, for ai_graph_model_state_evaluator.
+typedef struct ai_graph_state_struct {
+  ai_graph_query *query;
+  uint32_t node;
+} ai_graph_state;
+
+/*
+ * Searches a graph with ai_search_astar. The Goal estimate is the query's
+ * est_cost_function to the query's goal.
+ *
+ * Example:
+ * ai_graph_query query;
+ * ai_graph_query_init(&query, graph, goal);
+ * ai_model_state *model_state = ai_graph_model_state_constructor(&query, 0);
+ * ai_search_astar *astar =
+ *     ai_search_astar_constructor(&ai_graph_model_state_evaluator);
+ * ai_path *path = astar->find_path_to_goal(astar, model_state);
+ */
+extern ai_model_state_evaluator ai_graph_model_state_evaluator;
+
+/*
+ * Graph Constructor.
+ * The edges are copied. Returns NULL if an edge names a node out of range.
+ */
+ai_graph *ai_graph_constructor(uint32_t node_count, uint32_t edge_count,
+                               const ai_graph_edge *edges);
+
+// The index of the first edge from source to target, or AI_GRAPH_NODE_NONE.
+uint32_t ai_graph_edge_find(ai_graph *graph, uint32_t source, uint32_t target);
+
+// The source node of an out edge. A binary search of edge_offset.
+uint32_t ai_graph_edge_source(ai_graph *graph, uint32_t edge);
+
+/*
+ * The cost of the cheapest path from source to every node, by Dijkstra.
+ * dist has node_count elements, and is INFINITY where there is no path.
+ * If reverse is true, edges are followed backward, giving the cost from
+ * every node to source. Returns 0, or -1 if out of memory.
+ */
+int ai_graph_distances(ai_graph *graph, uint32_t source, int reverse,
+                       float *dist);
+
+// Build an ai_graph_action for a path. Freed with free, or
+// ai_graph_action_data_free.
+ai_graph_action *ai_graph_action_data_constructor(uint32_t edge,
+                                                  uint32_t target);
+
+void ai_graph_action_data_free(void *data);
+
+void *ai_graph_action_data_duplicator(void *data);
+
+void ai_graph_query_init(ai_graph_query *query, ai_graph *graph,
+                         uint32_t goal);
+
+ai_model_state *ai_graph_model_state_constructor(ai_graph_query *query,
+                                                 uint32_t node);
+
+void ai_graph_model_state_data_free(void *data);
+
+void ai_graph_free(ai_graph *graph);
+
+#endif // _AI_GRAPH_H_
@@ -0,0 +1,65 @@
+#ifndef _AI_GRAPH_ALT_H_
+#define _AI_GRAPH_ALT_H_
+
+#include <ai_graph.h>
+
+/*
+ * AI - ALT (A*, Landmarks, Triangle inequality) estimates.
+ *
+ * Goldberg and Harrelson, "Computing the Shortest Path: A* Search Meets
+ * Graph Theory", SODA 2005.
+ *
+ * A few landmark nodes are chosen, and the cost from each landmark to every
+ * node, and from every node to each landmark, is found once. By the triangle
+ * inequality, for any landmark L
+ *   cost(v, t) >= cost(L, t) - cost(L, v)
+ *   cost(v, t) >= cost(v, L) - cost(t, L)
+ * and the best of these bounds is an estimate that never over-estimates, for
+ * graphs that have no coordinates to estimate from.
+ *
+ * ai_graph_alt_est_cost is an ai_graph_est_cost_function, so it plugs in as
+ * the Goal estimate of ai_graph_model_state_evaluator, or of any graph
+ * search taking an estimate.
+ *
+ * The tables hold 2 * landmark_count floats per node. Edge costs may rise
+ * after preprocessing, since the bounds still hold, but must not fall.
+ */
+
+typedef enum ai_graph_alt_selection_enum {
+  // Each landmark is the node farthest from those already chosen.
+  AI_GRAPH_ALT_SELECTION_FARTHEST = 0,
+  // Each landmark is placed at the end of the branch of a shortest path
+  // tree where the current estimates are worst (Goldberg and Werneck).
+  AI_GRAPH_ALT_SELECTION_AVOID,
+} ai_graph_alt_selection;
+
+typedef struct ai_graph_alt_struct {
+  uint32_t node_count;
+  int landmark_count;
+  uint32_t *landmark_list;
+  // Per node, landmark_count costs each. INFINITY where there is no path.
+  float *cost_from; // From each landmark to the node.
+  float *cost_to;   // From the node to each landmark.
+} ai_graph_alt;
+
+/*
+ * ALT Constructor. Chooses the landmarks and fills the tables.
+ * landmark_count may be cut to the number of nodes.
+ *
+ * Example:
+ * ai_graph_alt *alt =
+ *     ai_graph_alt_constructor(graph, 8, AI_GRAPH_ALT_SELECTION_AVOID);
+ * ai_graph_query query;
+ * ai_graph_query_init(&query, graph, goal);
+ * query.est_cost_function = ai_graph_alt_est_cost;
+ * query.est_cost_data = alt;
+ */
+ai_graph_alt *ai_graph_alt_constructor(ai_graph *graph, int landmark_count,
+                                       ai_graph_alt_selection selection);
+
+// The estimated cost from one node to another. alt is an ai_graph_alt.
+float ai_graph_alt_est_cost(void *alt, uint32_t from_node, uint32_t to_node);
+
+void ai_graph_alt_free(ai_graph_alt *alt);
+
+#endif // _AI_GRAPH_ALT_H_
@@ -0,0 +1,71 @@
+#ifndef _AI_GRAPH_ARC_FLAGS_H_
+#define _AI_GRAPH_ARC_FLAGS_H_
+
+#include <ai_graph.h>
+#include <stdint.h>
+
+/*
+ * AI - Arc-Flags.
+ *
+ * Lauther, "An Extremely Fast, Exact Algorithm for Finding Shortest Paths in
+ * Static Networks with Geographical Background", 2004.
+ *
+ * The nodes are split into regions. Each edge gets one flag per region, set
+ * if the edge lies on a cheapest path to some node of that region. A search
+ * for a Goal then only needs the edges flagged for the Goal's region, and
+ * skips the rest of the graph.
+ *
+ * Preprocessing runs a backward Dijkstra from every boundary node of every
+ * region, a node with an in edge from another region, so it suits graphs
+ * that are searched many times. Edge costs may rise after preprocessing,
+ * though paths found may then not be the cheapest, but must not fall.
+ *
+ * The flags plug into ai_search_astar as a successor filter.
+ *
+ * Example:
+ * ai_graph_arc_flags *arc_flags = ai_graph_arc_flags_constructor(graph, 32,
+ *                                                                NULL);
+ * astar->successor_filter_function = ai_graph_arc_flags_successor_filter;
+ * astar->successor_filter_data = arc_flags;
+ * ai_path *path = astar->find_path_to_goal(astar, model_state);
+ */
+
+typedef struct ai_graph_arc_flags_struct {
+  uint32_t node_count;
+  uint32_t edge_count;
+  int region_count;
+  int region_words;      // Words of flags per edge.
+  uint32_t *node_region; // Region of each node.
+  uint64_t *flag_list;   // region_words words per edge.
+} ai_graph_arc_flags;
+
+/*
+ * Arc-Flags Constructor.
+ * node_region, if not NULL, gives the region of each node, from 0 to
+ * region_count - 1, and is copied. If NULL, regions of about equal size are
+ * grown by Dijkstra on edge cost, treating edges as undirected.
+ * Returns NULL if a region is out of range.
+ */
+ai_graph_arc_flags *ai_graph_arc_flags_constructor(ai_graph *graph,
+                                                   int region_count,
+                                                   const uint32_t *node_region);
+
+// True if the edge lies on a cheapest path into the region.
+static inline int ai_graph_arc_flags_get(ai_graph_arc_flags *arc_flags,
+                                         uint32_t edge, uint32_t region) {
+  return (arc_flags->flag_list[(size_t)edge * arc_flags->region_words +
+                               region / 64] >>
+          (region % 64)) &
+         1;
+}
+
+// An ai_successor_filter_function for ai_graph_model_state_evaluator
+// searches. filter_data is an ai_graph_arc_flags. Keeps the edges flagged
+// for the region of the query's goal.
+int ai_graph_arc_flags_successor_filter(void *filter_data,
+                                        ai_model_state *model_state,
+                                        ai_successor *successor);
+
+void ai_graph_arc_flags_free(ai_graph_arc_flags *arc_flags);
+
+#endif // _AI_GRAPH_ARC_FLAGS_H_
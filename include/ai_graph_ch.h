@@ -0,0 +1,94 @@
+#ifndef _AI_GRAPH_CH_H_
+#define _AI_GRAPH_CH_H_
+
+#include <ai_graph.h>
+#include <ai_search.h>
+#include <stdio.h>
+
+/*
+ * AI - Contraction Hierarchies.
+ *
+ * Geisberger, Sanders, Schultes and Delling, "Contraction Hierarchies:
+ * Faster and Simpler Hierarchical Routing in Road Networks", WEA 2008.
+ *
+ * Preprocessing contracts the nodes of an ai_graph one at a time, least
+ * important first. When a node is contracted, a shortcut edge is added
+ * between each pair of its neighbours whose shortest path ran through it.
+ * A query is then a bidirectional Dijkstra search that only moves up the
+ * order, from both ends, and settles very few nodes.
+ *
+ * Paths are exact, and shortcuts are unpacked so that the path is made of
+ * edges of the original graph. Edge costs must not change after
+ * preprocessing; for changing costs see ai_search_dstar_lite.
+ *
+ * A query uses working arrays held by the hierarchy, so a hierarchy may be
+ * queried by only one thread at a time.
+ */
+
+typedef struct ai_graph_ch_struct {
+  uint32_t node_count;
+  uint32_t *rank; // Contraction order of each node.
+  // Edges, original and shortcut. Private to the hierarchy.
+  uint32_t edge_count;
+  uint32_t edge_size;
+  uint32_t *edge_source;
+  uint32_t *edge_target;
+  float *edge_cost;
+  uint32_t *edge_original; // Edge of the graph, or AI_GRAPH_NODE_NONE.
+  uint32_t *edge_child;    // Two per shortcut. The edges it replaces.
+  uint32_t shortcut_count;
+  // Upward edges from each node, and upward edges into each node.
+  uint32_t *up_offset;
+  uint32_t *up_edge;
+  uint32_t *down_offset;
+  uint32_t *down_edge;
+  // Last query.
+  float path_cost;
+  int fringe_expansion_count;
+  ai_search_status status;
+  // Query working arrays. Private to the hierarchy.
+  float *dist[2];
+  uint32_t *parent[2];
+  uint32_t *touched[2];
+  uint32_t touched_count[2];
+} ai_graph_ch;
+
+/*
+ * Contraction Hierarchy Constructor. Orders and contracts every node of the
+ * graph. Edges of INFINITY cost are left out. Returns NULL if out of memory.
+ *
+ * Example:
+ * ai_graph_ch *ch = ai_graph_ch_constructor(graph);
+ * ai_path *path = ai_graph_ch_find_path(ch, from, to);
+ * float cost = ch->path_cost;
+ */
+ai_graph_ch *ai_graph_ch_constructor(ai_graph *graph);
+
+/*
+ * The cheapest path between two nodes. Action data are ai_graph_action,
+ * naming edges of the graph the hierarchy was built from.
+ * Returns NULL, with status NOT_FOUND, if there is no path.
+ */
+ai_path *ai_graph_ch_find_path(ai_graph_ch *ch, uint32_t source,
+                               uint32_t target);
+
+// The cost of the cheapest path, without the path. INFINITY if none.
+float ai_graph_ch_distance(ai_graph_ch *ch, uint32_t source, uint32_t target);
+
+/*
+ * Save the hierarchy, in the machine's byte order, so it can be loaded
+ * without preprocessing again. Returns 0 on success, otherwise -1.
+ *
+ * Example:
+ * ai_graph_ch_save(ch, file);
+ * ...
+ * ai_graph_ch *ch = ai_graph_ch_load(file);
+ */
+int ai_graph_ch_save(ai_graph_ch *ch, FILE *file);
+
+// Load a saved hierarchy. Returns NULL if the file is not a saved hierarchy.
+ai_graph_ch *ai_graph_ch_load(FILE *file);
+
+void ai_graph_ch_free(ai_graph_ch *ch);
+
+#endif // _AI_GRAPH_CH_H_
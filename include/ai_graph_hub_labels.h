@@ -0,0 +1,74 @@
+#ifndef _AI_GRAPH_HUB_LABELS_H_
+#define _AI_GRAPH_HUB_LABELS_H_
+
+#include <ai_graph.h>
+#include <ai_search.h>
+
+/*
+ * AI - Hub Labels.
+ *
+ * Akiba, Iwata and Yoshida, "Fast Exact Shortest-Path Distance Queries on
+ * Large Networks by Pruned Landmark Labeling", SIGMOD 2013.
+ *
+ * Every node gets an out label, a list of hubs with the cost from the node
+ * to each, and an in label, a list of hubs with the cost from each to the
+ * node. The labels are built so that for any two nodes, some hub on a
+ * cheapest path between them is in both the out label of the first and
+ * the in label of the second. The distance is then the least sum over the
+ * hubs the two labels share, found by merging two short sorted arrays,
+ * without searching the graph at all.
+ *
+ * Nodes are taken as hubs in order of degree. A pruned Dijkstra from each,
+ * forward and backward, labels only the nodes whose distance the labels so
+ * far do not already give.
+ *
+ * Distance queries only read the labels, so any number of threads may run
+ * them at once. Edge costs must not change after preprocessing.
+ */
+
+typedef struct ai_graph_hub_labels_struct {
+  // The graph, for path recovery. Not owned, and must outlive the labels.
+  ai_graph *graph;
+  uint32_t node_count;
+  uint32_t *hub_node; // Node of each hub, by hub rank.
+  // Labels, sorted by hub rank. Those of node v are entries offset[v] to
+  // offset[v + 1] - 1.
+  uint32_t *out_offset; // node_count + 1 entries.
+  uint32_t *out_hub;
+  float *out_cost; // From the node to the hub.
+  uint32_t *in_offset; // node_count + 1 entries.
+  uint32_t *in_hub;
+  float *in_cost; // From the hub to the node.
+  // Last path query.
+  float path_cost;
+  ai_search_status status;
+} ai_graph_hub_labels;
+
+/*
+ * Hub Labels Constructor. Edges of INFINITY cost are left out.
+ *
+ * Example:
+ * ai_graph_hub_labels *labels = ai_graph_hub_labels_constructor(graph);
+ * float cost = ai_graph_hub_labels_distance(labels, from, to);
+ */
+ai_graph_hub_labels *ai_graph_hub_labels_constructor(ai_graph *graph);
+
+// The cost of the cheapest path between two nodes. INFINITY if none.
+float ai_graph_hub_labels_distance(ai_graph_hub_labels *labels,
+                                   uint32_t source, uint32_t target);
+
+/*
+ * The cheapest path between two nodes, found one edge at a time by taking
+ * the edge whose cost plus the distance on to the target is least. Action
+ * data are ai_graph_action. Returns NULL, with status NOT_FOUND, if there
+ * is no path.
+ */
+ai_path *ai_graph_hub_labels_find_path(ai_graph_hub_labels *labels,
+                                       uint32_t source, uint32_t target);
+
+// Total number of label entries, in and out.
+size_t ai_graph_hub_labels_size(ai_graph_hub_labels *labels);
+
+void ai_graph_hub_labels_free(ai_graph_hub_labels *labels);
+
+#endif // _AI_GRAPH_HUB_LABELS_H_
@@ -0,0 +1,130 @@
+#ifndef _AI_GRID_H_
+#define _AI_GRID_H_
+
+#include <ai_search.h>
+#include <stdint.h>
+
+/*
+ * AI - Grid.
+ *
+ * A width x height occupancy grid, one bit per cell, for the common case of
+ * searching a tile map. Cells are 8 connected. A straight move costs 1 and a
+ * diagonal move costs sqrt(2). A diagonal move may not cut the corner of a
+ * blocked cell.
+ *
+ * ai_grid_model_state_evaluator searches a grid with ai_search_astar. The
+ * Model State data is an ai_grid_state, whose query holds the Goal and the
+ * rectangle of cells that may be searched. Successors are found from a mask
+ * of the moves allowed, read from the three rows of bits around the cell,
+ * and estimated together by a vector kernel.
+ *
+ * Example:
+ * ai_grid *grid = ai_grid_constructor(64, 64);
+ * ai_grid_blocked_set(grid, 10, 10, 1);
+ * ai_grid_query query;
+ * ai_grid_query_init(&query, grid, 63, 63);
+ * ai_model_state *model_state = ai_grid_model_state_constructor(&query, 0, 0);
+ * ai_search_astar *astar =
+ *     ai_search_astar_constructor(&ai_grid_model_state_evaluator);
+ * ai_path *path = astar->find_path_to_goal(astar, model_state);
+ */
+
+#define AI_GRID_DIAGONAL_COST 1.41421356f
+
+typedef struct ai_grid_struct {
+  int width;
+  int height;
+  int row_words;     // 64 bit words per row.
+  uint64_t *blocked; // One bit per cell, row by row.
+} ai_grid;
+
+// The cells a search may use, and its Goal.
+typedef struct ai_grid_query_struct {
+  ai_grid *grid;
+  int goal_x;
+  int goal_y;
+  // Cells searched are min <= x < max, likewise y.
+  int min_x;
+  int min_y;
+  int max_x;
+  int max_y;
+} ai_grid_query;
+
+// Model State data.
+typedef struct ai_grid_state_struct {
+  ai_grid_query *query;
+  int x;
+  int y;
+} ai_grid_state;
+
+// Action data. The cell moved to.
+typedef struct ai_grid_action_struct {
+  int x;
+  int y;
+} ai_grid_action;
+
+extern ai_model_state_evaluator ai_grid_model_state_evaluator;
+
+// Grid Constructor. All cells start free.
+ai_grid *ai_grid_constructor(int width, int height);
+
+// True if the cell is blocked. Cells off the grid are blocked.
+static inline int ai_grid_blocked(ai_grid *grid, int x, int y) {
+  if ((x < 0) || (y < 0) || (x >= grid->width) || (y >= grid->height)) {
+    return 1;
+  }
+  return (grid->blocked[y * grid->row_words + (x >> 6)] >> (x & 63)) & 1;
+}
+
+void ai_grid_blocked_set(ai_grid *grid, int x, int y, int blocked);
+
+// Least cost between two cells of an empty grid.
+float ai_grid_octile_distance(int x0, int y0, int x1, int y1);
+
+/*
+ * Kernels for octile distances, from the best the CPU runs: AVX2, 8 cells at
+ * a time, SSE2, 4 at a time, or scalar. Each returns exactly what
+ * ai_grid_octile_distance does.
+ */
+typedef enum ai_grid_simd_enum {
+  AI_GRID_SIMD_SCALAR = 0,
+  AI_GRID_SIMD_SSE2,
+  AI_GRID_SIMD_AVX2,
+} ai_grid_simd;
+
+// The best kernels the CPU runs.
+ai_grid_simd ai_grid_simd_supported(void);
+
+// Use simd, or the best the CPU runs if it can not run simd. Returns the
+// kernels now used. The best are used until set otherwise.
+ai_grid_simd ai_grid_simd_set(ai_grid_simd simd);
+
+// The kernels in use.
+ai_grid_simd ai_grid_simd_get(void);
+
+// Octile distances from count cells, (x[i], y[i]), to the Goal, into costs.
+void ai_grid_octile_distance_batch(const int *x, const int *y, int count,
+                                   int goal_x, int goal_y, float *costs);
+
+// A bit for each move from (x, y) the query allows, bit i for the move by
+// (dx, dy) of (1, 0), (0, 1), (-1, 0), (0, -1), (1, 1), (-1, 1), (-1, -1) and
+// (1, -1) in turn. A move is allowed to a free cell inside the rectangle,
+// and on a diagonal only if both cells beside it are allowed too.
+unsigned ai_grid_move_mask(ai_grid_query *query, int x, int y);
+
+// Cost of a single move between neighbouring cells.
+float ai_grid_move_cost(int x0, int y0, int x1, int y1);
+
+// Search the whole grid for the Goal.
+void ai_grid_query_init(ai_grid_query *query, ai_grid *grid, int goal_x,
+                        int goal_y);
+
+ai_model_state *ai_grid_model_state_constructor(ai_grid_query *query, int x,
+                                                int y);
+
+// Free Model State or Action data.
+void ai_grid_data_free(void *data);
+
+void ai_grid_free(ai_grid *grid);
+
+#endif // _AI_GRID_H_
@@ -0,0 +1,112 @@
+#ifndef _AI_GRID_CPD_H_
+#define _AI_GRID_CPD_H_
+
+#include <ai_grid.h>
+#include <ai_search.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * AI - Compressed Path Database for grids.
+ *
+ * Botea, "Ultra-Fast Optimal Pathfinding without Runtime Search",
+ * AIIDE 2011.
+ *
+ * For every free cell, the first move of a cheapest path to every other
+ * cell is found offline. A query then needs no search: look up the first
+ * move from the start to the goal, take it, and look up again from there.
+ *
+ * Cells are numbered in Z-order, so that cells near each other have nearby
+ * numbers and mostly share a first move. Each cell's row of first moves is
+ * then run-length encoded, and a lookup is a binary search of the runs.
+ * Moves to cells that can not be reached, or to the cell itself, may be
+ * anything, and so extend whichever run is open.
+ *
+ * The database is one block of memory laid out as it is saved, so a saved
+ * database is mapped into memory when loaded rather than read.
+ *
+ * The grid may change after the database is built. Cells changed through
+ * ai_grid_cpd_cell_set mark their region invalid, and a query that would
+ * step into an invalid region, or take a move that is no longer open,
+ * finishes with an ai_search_astar search from that cell instead. Such
+ * paths are valid but may not be the cheapest. Rebuild once much has
+ * changed.
+ *
+ * A query keeps its results in the database, so a database may be queried
+ * by only one thread at a time.
+ */
+
+// Width and height, in cells, of a region that is invalidated as one.
+#define AI_GRID_CPD_REGION_SIZE 16
+
+#define AI_GRID_CPD_NODE_NONE UINT32_MAX
+
+typedef struct ai_grid_cpd_struct {
+  ai_grid *grid; // Not owned, and must outlive the database.
+  int width;
+  int height;
+  uint32_t node_count; // Free cells when built.
+  uint32_t run_count;
+  // Within the block. Private to the database.
+  const uint32_t *cell_node; // Node of each cell, row by row, or NONE.
+  const uint32_t *node_cell; // Cell of each node, y * width + x.
+  const uint32_t *node_component;
+  const uint32_t *row_offset; // Runs of node v are row_offset[v] onwards.
+  const uint32_t *run_list;   // First node of the run << 3 | move.
+  // Invalid regions.
+  int region_width;
+  int region_height;
+  unsigned char *region_invalid;
+  int region_invalid_count;
+  // Last query.
+  float path_cost;
+  int lookup_count;           // First moves looked up.
+  int fringe_expansion_count; // Expansions of the A* fallback.
+  ai_search_status status;
+  // The block, allocated or mapped.
+  void *block;
+  size_t block_size;
+  int block_mapped;
+} ai_grid_cpd;
+
+/*
+ * Compressed Path Database Constructor. Runs a Dijkstra search from every
+ * free cell, so it is meant for offline builds of grids of modest size.
+ * Grids of 2^29 free cells or more are refused.
+ *
+ * Example:
+ * ai_grid_cpd *cpd = ai_grid_cpd_constructor(grid);
+ * ai_path *path = ai_grid_cpd_find_path(cpd, x, y, goal_x, goal_y);
+ * float cost = cpd->path_cost;
+ */
+ai_grid_cpd *ai_grid_cpd_constructor(ai_grid *grid);
+
+/*
+ * A cheapest path between two cells. Action data are ai_grid_action.
+ * Returns NULL, with status NOT_FOUND, if there is no path. An empty path
+ * (also NULL) has status FOUND.
+ */
+ai_path *ai_grid_cpd_find_path(ai_grid_cpd *cpd, int x, int y, int goal_x,
+                               int goal_y);
+
+// Change a cell of the grid, and invalidate its region of the database.
+void ai_grid_cpd_cell_set(ai_grid_cpd *cpd, int x, int y, int blocked);
+
+/*
+ * Save the database, in the machine's byte order. Returns 0 on success,
+ * otherwise -1.
+ *
+ * Example:
+ * ai_grid_cpd_save(cpd, file);
+ * ...
+ * ai_grid_cpd *cpd = ai_grid_cpd_load("map.cpd", grid);
+ */
+int ai_grid_cpd_save(ai_grid_cpd *cpd, FILE *file);
+
+// Map a saved database into memory. grid must be the size it was built
+// for. Returns NULL if the file is not a saved database of that size.
+ai_grid_cpd *ai_grid_cpd_load(const char *file_name, ai_grid *grid);
+
+void ai_grid_cpd_free(ai_grid_cpd *cpd);
+
+#endif // _AI_GRID_CPD_H_
@@ -0,0 +1,113 @@
+#ifndef _AI_PDB_H_
+#define _AI_PDB_H_
+
+#include <ai_search.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * AI - Pattern Database.
+ *
+ * Culberson and Schaeffer, "Pattern Databases", Computational Intelligence
+ * 14(3), 1998. Felner, Korf and Hanan, "Additive Pattern Database
+ * Heuristics", JAIR 22, 2004.
+ *
+ * An abstraction of a puzzle keeps only part of its state, say where a few
+ * of the tiles are. The abstract space is small enough to search
+ * completely, backward from the Goal, and the distance from every abstract
+ * state to the Goal is kept in a table. The distance of a state's
+ * abstraction never over-estimates the distance of the state itself.
+ *
+ * The builder is generic. The abstraction is given as an evaluator over the
+ * abstract states, with hash and equal functions, and a rank function that
+ * numbers them from 0 to state_count - 1. States with the same rank share an
+ * entry, which holds the least of their distances. The same rank function
+ * must give the rank of a concrete state's abstraction, so the table can be
+ * looked up from a concrete state.
+ *
+ * The search is breadth-first from the Goal states, by bucket of distance,
+ * along successors. This is only a backward search if every action can be
+ * undone at the same cost, as in sliding tile and rearrangement puzzles.
+ * Costs must be whole numbers. For additive databases, over disjoint sets of
+ * tiles, moves of tiles outside the pattern cost 0, and the values of the
+ * databases may be added.
+ *
+ * Entries are packed 4 or 8 bits each. A distance beyond the largest value
+ * (15 or 255), or no path, is stored as the largest value, which still never
+ * over-estimates, and the search stops once it is reached. A database is one
+ * block, laid out as it is saved, and a saved database is mapped into
+ * memory when loaded.
+ *
+ * Example:
+ * ai_pdb *pdb = ai_pdb_constructor(&abstract_evaluator, goal_list, 1,
+ *                                  state_count, 4, rank_function, NULL);
+ * ...
+ * float my_goal_est_cost_function(ai_model_state *model_state) {
+ *   return ai_pdb_additive_est_cost(my_pdb_list, 2, model_state);
+ * }
+ */
+
+// The rank of a state's abstraction, from 0 to state_count - 1.
+// rank_data is passed through unchanged.
+typedef uint64_t (*ai_pdb_rank_function)(void *rank_data,
+                                         ai_model_state *model_state);
+
+typedef struct ai_pdb_struct {
+  uint64_t state_count;
+  int bits;            // 4 or 8.
+  unsigned value_max;  // 15 or 255.
+  const uint8_t *table; // Within the block.
+  ai_pdb_rank_function rank_function;
+  void *rank_data;
+  // The block, allocated or mapped.
+  void *block;
+  size_t block_size;
+  int block_mapped;
+} ai_pdb;
+
+/*
+ * Pattern Database Constructor. Searches the abstract space from the Goal
+ * states. The evaluator's is_goal_state_function and
+ * goal_est_cost_function are not used.
+ * Returns NULL if a cost is not a whole number, or a rank is out of range.
+ */
+ai_pdb *ai_pdb_constructor(ai_model_state_evaluator *abstract_evaluator,
+                           ai_model_state **goal_model_states, int goal_count,
+                           uint64_t state_count, int bits,
+                           ai_pdb_rank_function rank_function,
+                           void *rank_data);
+
+// The table entry of a rank.
+static inline unsigned ai_pdb_value(ai_pdb *pdb, uint64_t rank) {
+  if (pdb->bits == 8) {
+    return pdb->table[rank];
+  }
+  return (pdb->table[rank >> 1] >> ((rank & 1) * 4)) & 15;
+}
+
+// The estimated cost to the Goal of a state, by its rank.
+float ai_pdb_est_cost(ai_pdb *pdb, ai_model_state *model_state);
+
+// The sum of the estimates of additive databases.
+float ai_pdb_additive_est_cost(ai_pdb **pdb_list, int pdb_count,
+                               ai_model_state *model_state);
+
+/*
+ * Save the database, in the machine's byte order. Returns 0 on success,
+ * otherwise -1.
+ *
+ * Example:
+ * ai_pdb_save(pdb, file);
+ * ...
+ * ai_pdb *pdb = ai_pdb_load("tiles.pdb", rank_function, NULL);
+ */
+int ai_pdb_save(ai_pdb *pdb, FILE *file);
+
+// Map a saved database into memory. Returns NULL if the file is not a
+// saved database.
+ai_pdb *ai_pdb_load(const char *file_name, ai_pdb_rank_function rank_function,
+                    void *rank_data);
+
+void ai_pdb_free(ai_pdb *pdb);
+
+#endif // _AI_PDB_H_
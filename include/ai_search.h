@@ -2,6 +2,9 @@
 #define _AI_ASTAR_SEARCH_H_
 
 #include <float.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
 /*
  * AI - Computational Search Using A* Search Algorithm.
@@ -94,6 +97,12 @@ typedef int (*ai_is_goal_state_function)(ai_model_state *model_state);
 // the cost.
 typedef float (*ai_goal_est_cost_function)(ai_model_state *model_state);
 
+// Optional. The Estimated Cost Function between two Model States. Used when
+// searching for several Goals at once. Like the Goal Estimated Cost Function
+// it must NEVER over-estimate the cost.
+typedef float (*ai_state_est_cost_function)(ai_model_state *model_state,
+                                            ai_model_state *goal_model_state);
+
 // A function that knows how to duplicate the implementation specific data of a
 // Model State.
 typedef void *(*ai_model_state_data_duplicator)(void *data);
@@ -110,8 +119,82 @@ typedef void *(*ai_action_data_duplicator)(void *data);
 // Action.
 typedef void (*ai_action_data_free)(void *data);
 
+// Optional. A function that returns the number of bytes held by the
+// implementation specific data of a Model State or an Action.
+// Used to account memory against a search's memory_budget.
+typedef size_t (*ai_data_size_function)(void *data);
+
+// Optional. A function that returns a hash of a Model State. Model States
+// that are equal must have the same hash.
+typedef size_t (*ai_model_state_hash_function)(ai_model_state *model_state);
+
+// Optional. Returns the hash of the successor reached by taking action from
+// model_state, given the hash of model_state, such as a Zobrist hash updated
+// for just the parts the action changes. Must return what
+// model_state_hash_function returns for the successor. Searches that keep
+// the hash of each state use it in place of hashing every successor.
+typedef size_t (*ai_model_state_hash_update_function)(
+    size_t hash, ai_model_state *model_state, ai_action *action);
+
+// Optional. A function that returns true if, and only if, two Model States
+// are the same state.
+typedef int (*ai_model_state_equal_function)(ai_model_state *model_state_a,
+                                             ai_model_state *model_state_b);
+
+// Optional. Packs a Model State into the evaluator's model_state_packed_size
+// bytes, for searches that keep states on disk. Equal states must pack to
+// the same bytes, padding included, and states that are not equal to
+// different bytes.
+typedef void (*ai_model_state_pack_function)(ai_model_state *model_state,
+                                             void *bytes);
+
+// Optional. Returns new Model State data unpacked from bytes.
+typedef void *(*ai_model_state_unpack_function)(const void *bytes);
+
+// Optional. Packs an Action's data into the evaluator's action_packed_size
+// bytes, for search checkpoints.
+typedef void (*ai_action_pack_function)(ai_action *action, void *bytes);
+
+// Optional. Returns new Action data unpacked from bytes.
+typedef void *(*ai_action_unpack_function)(const void *bytes);
+
+// Optional. Writes the goal_est_cost of each of count Model States into
+// goal_est_costs, as goal_est_cost_function would, so that a domain can
+// estimate every successor of an expansion in one call, with vector
+// instructions. ai_search_astar uses it in place of goal_est_cost_function
+// for successors.
+typedef void (*ai_goal_est_cost_batch_function)(ai_model_state **model_states,
+                                                int count,
+                                                float *goal_est_costs);
+
+// Optional. Writes the index-th Action that can be taken from model_state
+// into action_data, action_packed_size bytes laid out as the Action's data,
+// and returns true, or returns false once index is past the last. Used with
+// the apply and undo functions by searches that keep one working state.
+typedef int (*ai_action_next_function)(ai_model_state *model_state, int index,
+                                       void *action_data);
+
+// Optional. Takes an Action from model_state by changing it in place, and
+// returns the cost of the Action, as the successor_function would.
+typedef float (*ai_apply_action_function)(ai_model_state *model_state,
+                                          ai_action *action);
+
+// Optional. Undoes an Action just applied to model_state, in place.
+typedef void (*ai_undo_action_function)(ai_model_state *model_state,
+                                        ai_action *action);
+
+// Optional, set on a search rather than the evaluator. Returns false if the
+// successor of model_state is to be dropped before it reaches the fringe.
+// filter_data is passed through unchanged. A filter that drops a successor
+// on every cheapest path loses optimality.
+typedef int (*ai_successor_filter_function)(void *filter_data,
+                                            ai_model_state *model_state,
+                                            ai_successor *successor);
+
 // The ai_model_state_evaluator holds the implementation specifics of the
 // Model State and Action.
+// When both the hash and equal functions are provided, each state is
+// expanded at most once, and the search keeps a table of the states expanded.
 typedef struct ai_model_state_evaluator_struct {
   ai_successor_function successor_function;
   ai_transition_function transition_function;
@@ -121,17 +204,183 @@ typedef struct ai_model_state_evaluator_struct {
   ai_model_state_data_free model_state_data_free;
   ai_action_data_duplicator action_data_duplicator;
   ai_action_data_free action_data_free;
+  // Optional.
+  ai_data_size_function model_state_data_size;
+  ai_data_size_function action_data_size;
+  ai_model_state_hash_function model_state_hash_function;
+  ai_model_state_equal_function model_state_equal_function;
+  ai_state_est_cost_function state_est_cost_function;
+  size_t model_state_packed_size;
+  ai_model_state_pack_function model_state_pack_function;
+  ai_model_state_unpack_function model_state_unpack_function;
+  size_t action_packed_size;
+  ai_action_pack_function action_pack_function;
+  ai_action_unpack_function action_unpack_function;
+  ai_model_state_hash_update_function model_state_hash_update_function;
+  ai_action_next_function action_next_function;
+  ai_apply_action_function apply_action_function;
+  ai_undo_action_function undo_action_function;
+  ai_goal_est_cost_batch_function goal_est_cost_batch_function;
 } ai_model_state_evaluator;
 
 // ai_model_state *model_state = ai_model_state_constructor(data);
 ai_model_state *ai_model_state_constructor(void *data);
 
+// Fringe Element - Used when searching
+typedef struct ai_fringe_element_struct {
+  ai_model_state *model_state;
+  ai_path *path_so_far;
+  float cost_so_far;
+  float est_total_cost;
+  float tie_break_key; // Lower first among equal est_total_cost.
+  size_t hash; // Of the Model State, while the search keeps a closed table.
+  size_t memory_size; // Bytes accounted against the search's memory_budget.
+  // Cheat - Allow a linked list of successors
+  struct ai_fringe_element_struct *next;
+} ai_fringe_element;
+
+/*
+ * Fringe Element Constructor.
+ *
+ * Used when searching to hold Actions that are yet to be evaluated.
+ * Example:
+ * ai_fringe_element *fe = ai_fringe_element_constructor(model_state,
+ * path_so_far, 0.0f, 0.0f);
+ */
+ai_fringe_element *ai_fringe_element_constructor(ai_model_state *model_state,
+                                                 ai_path *path_so_far,
+                                                 float cost_so_far,
+                                                 float est_total_cost);
+
+/*
+ * The state of a search. A search is started with ai_search_astar_begin and
+ * then stepped until it is no longer AI_SEARCH_STATUS_RUNNING.
+ */
+typedef enum ai_search_status_enum {
+  AI_SEARCH_STATUS_IDLE = 0,        // No search has been started.
+  AI_SEARCH_STATUS_RUNNING,         // Fringe still holds elements to expand.
+  AI_SEARCH_STATUS_FOUND,           // A Goal was reached. Path is available.
+  AI_SEARCH_STATUS_NOT_FOUND,       // Fringe exhausted without a Goal.
+  AI_SEARCH_STATUS_EXPANSION_LIMIT, // fringe_expansion_max was reached.
+  AI_SEARCH_STATUS_CANCELLED,       // Search was abandoned by the caller.
+  AI_SEARCH_STATUS_MEMORY_EXCEEDED, // memory_budget was exceeded.
+  AI_SEARCH_STATUS_IO_ERROR,        // A file could not be read or written.
+} ai_search_status;
+
+/*
+ * What a search does when the memory held by its fringe exceeds its
+ * memory_budget.
+ */
+typedef enum ai_search_memory_policy_enum {
+  // Stop with AI_SEARCH_STATUS_MEMORY_EXCEEDED.
+  AI_SEARCH_MEMORY_POLICY_ABORT = 0,
+  // Discard the fringe elements with the highest est_total_cost until back
+  // within budget, and carry on. The path found may no longer be optimal, and
+  // a path may not be found where one exists.
+  AI_SEARCH_MEMORY_POLICY_PRUNE,
+} ai_search_memory_policy;
+
+/*
+ * The order the fringe is expanded in. Only the priority key of a fringe
+ * element, its est_total_cost, differs between the modes.
+ */
+typedef enum ai_search_mode_enum {
+  // A*. Key is cost_so_far + goal_est_cost. Optimal.
+  AI_SEARCH_MODE_ASTAR = 0,
+  // Greedy Best-First. Key is goal_est_cost. Fast, but not optimal.
+  AI_SEARCH_MODE_GREEDY,
+  // Uniform-Cost (Dijkstra). Key is cost_so_far. Optimal.
+  // goal_est_cost_function is never called.
+  AI_SEARCH_MODE_DIJKSTRA,
+} ai_search_mode;
+
+/*
+ * The order among fringe elements of equal est_total_cost. Each element has
+ * a tie_break_key, lower first, set as it is added to the fringe, so the
+ * policy costs no more than the sorted insert already does.
+ */
+typedef enum ai_search_tie_break_enum {
+  // First added, first expanded. Key is 0.
+  AI_SEARCH_TIE_BREAK_FIFO = 0,
+  // Last added, first expanded. Key is 0, and an element is added before
+  // those equal to it.
+  AI_SEARCH_TIE_BREAK_LIFO,
+  // Greatest cost_so_far first, which in A* is the least estimate left.
+  // Key is -cost_so_far, then first added first. On open maps this expands
+  // along one cheapest path, rather than every state of equal f.
+  AI_SEARCH_TIE_BREAK_HIGH_G,
+  // Random. Key is drawn from a generator seeded with tie_break_seed.
+  AI_SEARCH_TIE_BREAK_RANDOM,
+} ai_search_tie_break;
+
+struct ai_state_table_struct;
+
+// One of the Goals of a multi-goal search. Private to the search.
+typedef struct ai_search_goal_struct {
+  ai_model_state *model_state;
+  size_t hash;
+  int reached;
+  float cost;
+  ai_path *path;
+} ai_search_goal;
+
 typedef struct ai_search_astar_struct {
   ai_model_state_evaluator *model_state_evaluator;
   ai_path *(*find_path_to_goal)(struct ai_search_astar_struct *astar,
                                 ai_model_state *model_state);
   int fringe_expansion_count;
   int fringe_expansion_max;
+  // Bytes the fringe may hold. 0 is unlimited.
+  size_t memory_budget;
+  ai_search_memory_policy memory_policy;
+  size_t memory_used; // Bytes held by the fringe now.
+  size_t memory_peak; // Most bytes held by the fringe during the search.
+  int fringe_pruned_count;
+  ai_search_mode search_mode;
+  ai_search_tie_break tie_break;
+  unsigned int tie_break_seed; // Set before the search is begun.
+  // When true, the search carries on past the first Goal until the fringe
+  // is exhausted, so that closed holds every state that can be reached.
+  // The path to the first Goal is still returned. Requires the evaluator's
+  // hash and equal functions; without them the search is not begun and the
+  // status is left AI_SEARCH_STATUS_IDLE.
+  int continue_past_goal;
+  // Optional. Successors the filter drops are never added to the fringe.
+  ai_successor_filter_function successor_filter_function;
+  void *successor_filter_data;
+  int successor_filtered_count; // Successors dropped by the filter.
+  // Optional. When both are set, the search is saved to
+  // checkpoint_file_name every checkpoint_interval expansions.
+  const char *checkpoint_file_name;
+  int checkpoint_interval;
+  int checkpoint_count; // Checkpoints written.
+  // When more than 0, the fringe is kept in buckets of this width of
+  // est_total_cost. See "Bucket fringe." below.
+  float fringe_bucket_width;
+  // States expanded, each with its cost_so_far. With AI_SEARCH_MODE_DIJKSTRA
+  // this is the exact distance to each state. NULL unless the evaluator has
+  // hash and equal functions. Kept until the next search is begun.
+  struct ai_state_table_struct *closed;
+  // Stepwise search state. Private to the search.
+  ai_search_status status;
+  ai_fringe_element *fringe_list;
+  unsigned int tie_break_random;
+  // With fringe_bucket_width, the fringe is in these buckets, and
+  // fringe_list is NULL.
+  ai_fringe_element **fringe_bucket_first; // First element of each bucket.
+  ai_fringe_element **fringe_bucket_last;  // Last element of each bucket.
+  uint64_t *fringe_bucket_used;            // A bit for each bucket in use.
+  size_t fringe_bucket_count;
+  size_t fringe_bucket_low; // The lowest bucket in use.
+  ai_model_state **est_batch_model_state_list; // Successors being estimated.
+  float *est_batch_cost_list;
+  int est_batch_size;
+  ai_path *result_path;
+  int goal_reached;
+  size_t closed_memory_used;
+  ai_search_goal *goal_list; // NULL unless a multi-goal search.
+  int goal_count;
+  int goal_remaining_count;
 } ai_search_astar;
 
 /*
@@ -144,27 +393,156 @@ typedef struct ai_search_astar_struct {
 ai_search_astar *
 ai_search_astar_constructor(ai_model_state_evaluator *model_state_evaluator);
 
-// Fringe Element - Used when searching
-typedef struct ai_fringe_element_struct {
-  ai_model_state *model_state;
-  ai_path *path_so_far;
-  float cost_so_far;
-  float est_total_cost;
-  // Cheat - Allow a linked list of successors
-  struct ai_fringe_element_struct *next;
-} ai_fringe_element;
+/*
+ * Resumable (stepwise) search.
+ *
+ * find_path_to_goal runs a search to completion. The same search may instead
+ * be run a few fringe expansions at a time, so that many searches can share
+ * a thread, or a search can be abandoned part way.
+ *
+ * Example:
+ * ai_search_astar_begin(astar, model_state);
+ * while (ai_search_astar_step(astar, 100) == AI_SEARCH_STATUS_RUNNING) {
+ *   // do other work
+ * }
+ * ai_path *path = ai_search_astar_end(astar);
+ */
+
+// Start a new search from a copy of model_state. Any search already in
+// progress is ended first and its path freed.
+void ai_search_astar_begin(ai_search_astar *astar,
+                           ai_model_state *model_state);
+
+// Expand up to expansion_quantum fringe elements, or until the search
+// finishes if expansion_quantum is 0. Returns the resulting status.
+ai_search_status ai_search_astar_step(ai_search_astar *astar,
+                                      int expansion_quantum);
+
+// Finish the search, freeing the remaining fringe. Returns the path found,
+// owned by the caller, or NULL. The status is left for the caller to inspect.
+ai_path *ai_search_astar_end(ai_search_astar *astar);
 
 /*
- * Fringe Element Constructor.
+ * Multi-goal search.
+ *
+ * Finds the cheapest path to each of a set of Goal Model States in a single
+ * pass, rather than a search per Goal. The search carries on after each Goal
+ * is reached, until all are reached or the fringe is exhausted.
+ * is_goal_state_function and goal_est_cost_function are not used. The
+ * heuristic is the least state_est_cost_function to any Goal not yet reached,
+ * or none if state_est_cost_function is NULL.
+ * Requires the evaluator's hash and equal functions.
  *
- * Used when searching to hold Actions that are yet to be evaluated.
  * Example:
- * ai_fringe_element *fe = ai_fringe_element_constructor(model_state,
- * path_so_far, 0.0f, 0.0f);
+ * ai_path *paths[3];
+ * float costs[3];
+ * int reached = ai_search_astar_find_paths_to_goals(astar, model_state,
+ *                                                   goals, 3, paths, costs);
  */
-ai_fringe_element *ai_fringe_element_constructor(ai_model_state *model_state,
-                                                 ai_path *path_so_far,
-                                                 float cost_so_far,
-                                                 float est_total_cost);
+
+// Start a multi-goal search. Copies are taken of the Model States.
+// Step and end the search as usual. AI_SEARCH_STATUS_FOUND means every Goal
+// was reached.
+void ai_search_astar_begin_multi_goal(ai_search_astar *astar,
+                                      ai_model_state *model_state,
+                                      ai_model_state **goal_model_states,
+                                      int goal_count);
+
+// The path to a Goal of the last multi-goal search, owned by the caller.
+// Returns -1 if the Goal was not reached, otherwise 0, with the path and its
+// cost set. An empty path (NULL) means the Goal is the initial state.
+int ai_search_astar_take_goal_path(ai_search_astar *astar, int goal_index,
+                                   ai_path **path, float *cost);
+
+// Run a multi-goal search to completion. paths and costs have goal_count
+// elements. A Goal not reached has a NULL path and a cost of FLT_MAX.
+// Returns the number of Goals reached.
+int ai_search_astar_find_paths_to_goals(ai_search_astar *astar,
+                                        ai_model_state *model_state,
+                                        ai_model_state **goal_model_states,
+                                        int goal_count, ai_path **paths,
+                                        float *costs);
+
+/*
+ * Bucket fringe.
+ *
+ * The fringe is a list sorted by est_total_cost, and each successor is
+ * added by walking the list to its place, which is slow once the fringe is
+ * large. With fringe_bucket_width set, the fringe is instead kept in
+ * buckets of that width of est_total_cost, a list for each. The bucket of
+ * a successor is found in constant time, and the next element is popped
+ * from the lowest bucket in use, found by scanning a bit for each bucket 64
+ * at a time upward from the last. As est_total_cost seldom falls, that scan
+ * is short.
+ *
+ * Within a bucket elements are expanded in order of tie_break_key, and
+ * those equal in the order added, or with AI_SEARCH_TIE_BREAK_LIFO the
+ * reverse. An element that goes first or last in its bucket, as always
+ * with AI_SEARCH_TIE_BREAK_FIFO and LIFO and mostly with
+ * AI_SEARCH_TIE_BREAK_HIGH_G, is added in constant time. Otherwise, as
+ * with AI_SEARCH_TIE_BREAK_RANDOM, it is placed by walking its bucket.
+ * Walking, pruning or saving a checkpoint of the fringe first joins the
+ * buckets back into one list, in time linear in the fringe.
+ *
+ * Where every est_total_cost is a multiple of the width, as with whole
+ * costs and estimates and a width of 1, that is the order of the sorted
+ * list, and the search is unchanged. Otherwise, as for a grid with diagonal
+ * moves, costs are in effect rounded down to the width, and the path found
+ * may cost a little more than the least.
+ *
+ * Set fringe_bucket_width before a search is begun. The buckets hold two
+ * pointers for each bucket up to the highest est_total_cost, divided by the
+ * width, up to AI_SEARCH_FRINGE_BUCKET_MAX. Elements above that share the
+ * last bucket.
+ *
+ * Example:
+ * astar->fringe_bucket_width = 1;
+ * ai_path *path = astar->find_path_to_goal(astar, model_state);
+ */
+
+#define AI_SEARCH_FRINGE_BUCKET_MAX (1 << 22)
+
+/*
+ * Checkpoints.
+ *
+ * A stepwise search may be saved part way, and resumed later, perhaps by
+ * another process, from where it was. A checkpoint holds the fringe, with
+ * the path of each element, the closed table, the Goals of a multi-goal
+ * search, and the counts. Model States and Actions are saved with the
+ * evaluator's pack functions, which are required. The settings of the
+ * search, such as fringe_expansion_max, memory_budget and the successor
+ * filter, are not saved; those of the resuming search apply.
+ *
+ * A checkpoint that can not be written during a search is logged, and the
+ * search carries on.
+ *
+ * Example:
+ * astar->checkpoint_file_name = "plan.checkpoint";
+ * astar->checkpoint_interval = 100000;
+ * ai_search_astar_begin(astar, model_state);
+ * ai_search_astar_step(astar, 0);
+ * ...
+ * // After a restart.
+ * if (ai_search_resume(astar, "plan.checkpoint") == 0) {
+ *   ai_search_astar_step(astar, 0);
+ *   ai_path *path = ai_search_astar_end(astar);
+ * }
+ */
+
+// Save the search, in the machine's byte order. Returns 0 on success,
+// otherwise -1.
+int ai_search_astar_checkpoint_save(ai_search_astar *astar, FILE *file);
+
+// Save the search to a file, which is only replaced once the checkpoint is
+// written in full. Returns 0 on success, otherwise -1.
+int ai_search_astar_checkpoint(ai_search_astar *astar, const char *file_name);
+
+// Replace any search in progress with the one saved in a checkpoint, saved
+// with the same evaluator. Step and end the search as usual.
+// Returns 0 on success, otherwise -1, with no search in progress.
+int ai_search_resume(ai_search_astar *astar, const char *file_name);
+
+// Free the search, ending any search still in progress.
+void ai_search_astar_free(ai_search_astar *astar);
 
 #endif // _AI_ASTAR_SEARCH_H_
@@ -0,0 +1,66 @@
+#ifndef _AI_SEARCH_BEAM_H_
+#define _AI_SEARCH_BEAM_H_
+
+#include <ai_search.h>
+
+/*
+ * AI - Beam Search.
+ *
+ * http://en.wikipedia.org/wiki/Beam_search
+ *
+ * A breadth first search that keeps only the best beam_width nodes of each
+ * depth, scored by est_total_cost (cost_so_far + goal_est_cost) as for A*.
+ * Memory held is at most beam_width nodes per depth, and the work per depth is
+ * at most beam_width expansions, whatever the size of the state space.
+ * The path found is not necessarily the cheapest, and a path may not be found
+ * where one exists.
+ *
+ * Only the nodes of the current depth hold a Model State. Earlier depths
+ * keep just the Action and parent needed to build the path.
+ * When the evaluator has hash and equal functions, a state is kept at most
+ * once over all depths.
+ */
+
+// Search node. Private to the search.
+typedef struct ai_beam_node_struct {
+  ai_model_state *model_state; // NULL once the node's depth is expanded.
+  ai_action *action;           // Action from the parent. NULL at the root.
+  struct ai_beam_node_struct *parent;
+  float cost_so_far;
+  float est_total_cost;
+} ai_beam_node;
+
+struct ai_state_table_struct;
+
+typedef struct ai_search_beam_struct {
+  ai_model_state_evaluator *model_state_evaluator;
+  ai_path *(*find_path_to_goal)(struct ai_search_beam_struct *beam,
+                                ai_model_state *model_state);
+  int beam_width;
+  int depth_max; // Deepest path searched. 0 is unlimited.
+  int fringe_expansion_count;
+  int fringe_expansion_max;
+  int depth;           // Depth reached by the last search.
+  int node_held_count; // Nodes held at the end of the last search.
+  ai_search_status status;
+  // Private to the search.
+  ai_beam_node **node_list;
+  int node_count;
+  int node_list_size;
+  struct ai_state_table_struct *closed;
+} ai_search_beam;
+
+/*
+ * Beam Search Constructor.
+ *
+ * Example:
+ * ai_search_beam *beam = ai_search_beam_constructor(model_state_evaluator, 16);
+ * ai_path *path = beam->find_path_to_goal(beam, model_state);
+ */
+ai_search_beam *
+ai_search_beam_constructor(ai_model_state_evaluator *model_state_evaluator,
+                           int beam_width);
+
+void ai_search_beam_free(ai_search_beam *beam);
+
+#endif // _AI_SEARCH_BEAM_H_
@@ -0,0 +1,88 @@
+#ifndef _AI_SEARCH_COMPACT_H_
+#define _AI_SEARCH_COMPACT_H_
+
+#include <ai_search.h>
+#include <ai_state_intern.h>
+#include <stdint.h>
+
+/*
+ * AI - Compact A* Search.
+ *
+ * The same search as ai_search_astar, with a closed table, laid out for
+ * large searches. Model States are held packed, once each, in an
+ * ai_state_intern table, and a search node is the state's id there. Nodes
+ * are held in one array, indexed by id, and refer to each other by id: each
+ * is its parent's id, its g and f, and its place in the open list, 16 bytes
+ * in all. The open list is a binary heap of (f, id) pairs.
+ *
+ * No node holds its path, or the action from its parent. The path is
+ * rebuilt at the end, by regenerating the successors of each parent on it
+ * and matching the child's packed state.
+ *
+ * Requires the evaluator's model_state_packed_size,
+ * model_state_pack_function and model_state_unpack_function. The equal
+ * function is not used; states are compared packed. They are hashed packed
+ * too, unless the evaluator has both model_state_hash_function and
+ * model_state_hash_update_function, when only the initial state is hashed
+ * whole and each successor's hash is updated from its parent's.
+ * The path is optimal for an estimate that never over-estimates. A state
+ * found again at a lower cost after it was expanded is expanded again.
+ *
+ * The arrays are kept from one search to the next, so repeated searches
+ * allocate little.
+ */
+
+#define AI_SEARCH_COMPACT_NONE AI_STATE_INTERN_NONE
+
+// A search node. Private to the search.
+typedef struct ai_search_compact_node_struct {
+  uint32_t parent;     // AI_SEARCH_COMPACT_NONE at the initial state.
+  uint32_t open_index; // AI_SEARCH_COMPACT_NONE once expanded.
+  float cost_so_far;
+  float est_total_cost;
+} ai_search_compact_node;
+
+// An entry of the open list. Private to the search.
+typedef struct ai_search_compact_open_struct {
+  float est_total_cost;
+  uint32_t node;
+} ai_search_compact_open;
+
+typedef struct ai_search_compact_struct {
+  ai_model_state_evaluator *model_state_evaluator;
+  ai_path *(*find_path_to_goal)(struct ai_search_compact_struct *compact,
+                                ai_model_state *model_state);
+  int fringe_expansion_count; // Of the last search.
+  int fringe_expansion_max;
+  // Last search.
+  float path_cost;
+  uint32_t node_count; // States found, each held once.
+  size_t memory_used;  // Bytes of the arrays at the end of the search.
+  ai_search_status status;
+  // Private to the search.
+  ai_state_intern *intern;
+  ai_search_compact_node *node_list; // Indexed by state id.
+  uint32_t node_size;
+  ai_search_compact_open *open_list;
+  uint32_t open_count;
+  uint32_t open_size;
+} ai_search_compact;
+
+/*
+ * Compact A* Search Constructor. Returns NULL if the evaluator can not pack
+ * states.
+ *
+ * Example:
+ * ai_search_compact *compact =
+ *     ai_search_compact_constructor(model_state_evaluator);
+ * ai_path *path = compact->find_path_to_goal(compact, model_state);
+ * if (compact->status == AI_SEARCH_STATUS_FOUND) {
+ *   float cost = compact->path_cost;
+ * }
+ */
+ai_search_compact *
+ai_search_compact_constructor(ai_model_state_evaluator *model_state_evaluator);
+
+void ai_search_compact_free(ai_search_compact *compact);
+
+#endif // _AI_SEARCH_COMPACT_H_
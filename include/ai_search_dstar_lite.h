@@ -0,0 +1,84 @@
+#ifndef _AI_SEARCH_DSTAR_LITE_H_
+#define _AI_SEARCH_DSTAR_LITE_H_
+
+#include <ai_graph.h>
+#include <ai_search.h>
+
+/*
+ * AI - D* Lite Search.
+ *
+ * http://en.wikipedia.org/wiki/D*
+ *
+ * An incremental planner on an ai_graph. The search runs backward from the
+ * goal, and keeps its cost (g) and one step look-ahead cost (rhs) of every
+ * node between calls. After a batch of edge costs change, only the nodes
+ * whose cost is affected are searched again, so replanning after a small
+ * change touches a small region.
+ *
+ * The start may also move along the path between calls, as an agent
+ * following the plan does.
+ *
+ * The graph is changed only by ai_search_notify_edge_changes, and must not
+ * be freed before the planner.
+ */
+
+typedef struct ai_search_dstar_lite_struct {
+  ai_graph *graph;
+  uint32_t start;
+  uint32_t goal;
+  // Optional. NULL for none, which is as Dijkstra.
+  ai_graph_est_cost_function est_cost_function;
+  void *est_cost_data;
+  float path_cost;               // Cost of the last path found.
+  int fringe_expansion_count;    // Expansions over all searches.
+  int fringe_expansion_last;     // Expansions by the last search.
+  ai_search_status status;
+  // Private to the search.
+  float *g;
+  float *rhs;
+  float key_modifier; // Sum of the estimates over the start's moves.
+  uint32_t *heap;       // Node of each heap entry.
+  uint32_t *heap_index; // Heap entry of each node. AI_GRAPH_NODE_NONE if not.
+  float *heap_key;      // Two per node.
+  uint32_t heap_count;
+} ai_search_dstar_lite;
+
+/*
+ * D* Lite Search Constructor.
+ *
+ * Example:
+ * ai_search_dstar_lite *dstar = ai_search_dstar_lite_constructor(graph, s, g);
+ * ai_path *path = ai_search_dstar_lite_find_path(dstar);
+ * ... edges change ...
+ * ai_search_notify_edge_changes(dstar, changes, change_count);
+ * ai_search_dstar_lite_move_start(dstar, next);
+ * path = ai_search_dstar_lite_find_path(dstar);
+ */
+ai_search_dstar_lite *ai_search_dstar_lite_constructor(ai_graph *graph,
+                                                       uint32_t start,
+                                                       uint32_t goal);
+
+/*
+ * Find the cheapest path from the start to the goal, reusing the work of
+ * earlier calls. Action data are ai_graph_action.
+ * Returns NULL, with status NOT_FOUND, if there is no path.
+ */
+ai_path *ai_search_dstar_lite_find_path(ai_search_dstar_lite *dstar);
+
+// The start has moved, e.g. the agent took the first steps of the path.
+void ai_search_dstar_lite_move_start(ai_search_dstar_lite *dstar,
+                                     uint32_t start);
+
+/*
+ * Set the new cost of a batch of edges, and mark the nodes affected.
+ * Each change names its edge by source and target. The next find_path
+ * replans from the affected region only.
+ * Returns the number of changes applied, skipping edges not in the graph.
+ */
+int ai_search_notify_edge_changes(ai_search_dstar_lite *dstar,
+                                  const ai_graph_edge *changes,
+                                  int change_count);
+
+void ai_search_dstar_lite_free(ai_search_dstar_lite *dstar);
+
+#endif // _AI_SEARCH_DSTAR_LITE_H_
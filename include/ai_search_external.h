@@ -0,0 +1,87 @@
+#ifndef _AI_SEARCH_EXTERNAL_H_
+#define _AI_SEARCH_EXTERNAL_H_
+
+#include <ai_search.h>
+#include <stdint.h>
+
+/*
+ * AI - External-memory A* Search.
+ *
+ * Edelkamp, Jabbar and Schroedl, "External A*", KI 2004. Korf, "Best-First
+ * Frontier Search with Delayed Duplicate Detection", AAAI 2004.
+ *
+ * For state spaces too big to hold in memory. The fringe is kept on disk in
+ * buckets of equal g and h, expanded in order of f = g + h, then of g.
+ * Successors are gathered in a buffer of buffer_size bytes, and written out
+ * as sorted runs whenever it fills. Duplicates are not looked for as they
+ * are generated, but just before a bucket is expanded: its runs are
+ * merged, and the states already in its earlier layers, the expanded
+ * buckets of the same h, are dropped. All of this is sequential reading and
+ * writing of files, so the search is limited by disk rather than memory.
+ *
+ * A state is kept on disk packed, with the evaluator's
+ * model_state_packed_size, model_state_pack_function and
+ * model_state_unpack_function, which are required. Each is kept with its
+ * parent, and the path is rebuilt at the end by regenerating the successors
+ * of each parent and looking the parent up in its layer.
+ *
+ * Costs must be whole numbers of at least 1. Estimates are rounded up to a
+ * whole number, within a small tolerance, which keeps them admissible. The
+ * path is optimal for a consistent estimate. An estimate that is not
+ * consistent is raised, as by pathmax, so that f never falls from parent
+ * to successor, but a state may then be expanded more than once. Another
+ * cost stops the search with AI_SEARCH_STATUS_CANCELLED, and a file that
+ * can not be read or written with AI_SEARCH_STATUS_IO_ERROR.
+ *
+ * duplicate_locality is how many earlier layers, by g, are read to drop
+ * duplicates, 0 being every layer. Only a few files are open at once, and
+ * more layers are read in further passes over the bucket. Fewer layers is
+ * less reading, but duplicates further back are then expanded again. In a
+ * space where every action can be undone at the same cost, 2 times the
+ * largest cost is enough to drop every duplicate.
+ *
+ * Each search makes a directory of its own within directory, which is
+ * removed when the search ends.
+ */
+
+// Bytes of successors held in memory before they are written out.
+#define AI_SEARCH_EXTERNAL_BUFFER_SIZE (64 << 20)
+
+typedef struct ai_search_external_struct {
+  ai_model_state_evaluator *model_state_evaluator;
+  ai_path *(*find_path_to_goal)(struct ai_search_external_struct *external,
+                                ai_model_state *model_state);
+  char *directory; // Owned copy.
+  size_t buffer_size;
+  int duplicate_locality;
+  uint64_t fringe_expansion_count;
+  uint64_t fringe_expansion_max; // 0 is unlimited.
+  // Last search.
+  float path_cost;
+  uint64_t duplicate_count; // Successors dropped as duplicates.
+  uint64_t run_count;       // Sorted runs written.
+  uint64_t bytes_read;
+  uint64_t bytes_written;
+  ai_search_status status;
+} ai_search_external;
+
+/*
+ * External-memory A* Search Constructor. Returns NULL if the evaluator can
+ * not pack states.
+ *
+ * Example:
+ * ai_search_external *external =
+ *     ai_search_external_constructor(model_state_evaluator, "/mnt/ssd");
+ * external->duplicate_locality = 2;
+ * ai_path *path = external->find_path_to_goal(external, model_state);
+ * if (external->status == AI_SEARCH_STATUS_FOUND) {
+ *   float cost = external->path_cost;
+ * }
+ */
+ai_search_external *
+ai_search_external_constructor(ai_model_state_evaluator *model_state_evaluator,
+                               const char *directory);
+
+void ai_search_external_free(ai_search_external *external);
+
+#endif // _AI_SEARCH_EXTERNAL_H_
@@ -0,0 +1,79 @@
+#ifndef _AI_SEARCH_FRONTIER_H_
+#define _AI_SEARCH_FRONTIER_H_
+
+#include <ai_search.h>
+#include <stddef.h>
+
+/*
+ * AI - Frontier A* Search.
+ *
+ * Korf, Zhang, Thayer and Hohwald, "Frontier Search", Journal of the ACM,
+ * 2005.
+ *
+ * For memory-bound searches of undirected spaces, where every action can be
+ * undone at the same cost. Only the fringe is held, as in A*, but states are
+ * forgotten once expanded, so memory is proportional to the fringe rather
+ * than to every state explored. Each state on the fringe keeps a bit for
+ * each operator that leads back to an expanded state, and never generates
+ * those successors, so forgotten states are not found again.
+ *
+ * Without the expanded states there are no parents to follow back, so the
+ * path is recovered by divide and conquer. Each state carries the action
+ * that first crossed the middle of the estimated path cost on its path, the
+ * relay. Once a Goal is reached the path is the path to the relay's first
+ * state, found by a search of its own, the relay's action, then the path on
+ * from the relay's second state, found by another. Each of those searches
+ * knows its path cost, so splits it in half, and the total time is a small
+ * multiple of one search.
+ *
+ * Requires the evaluator's hash and equal functions, and operator functions
+ * set on the search. An operator is a small number, from 0 to 31, naming
+ * each kind of action, such as a direction to move. reverse_operator_function
+ * is given the same Model State and Action, and returns the operator of the
+ * action from the successor that undoes it.
+ * The evaluator's state_est_cost_function, if set, guides the searches for
+ * the relays' states, and they are otherwise uninformed.
+ *
+ * The path is optimal for a consistent estimate. As no state is expanded
+ * twice, an estimate that is not consistent may lose optimality.
+ */
+
+// The operator of an action taken from a Model State, from 0 to 31.
+typedef int (*ai_operator_function)(ai_model_state *model_state,
+                                    ai_action *action);
+
+typedef struct ai_search_frontier_struct {
+  ai_model_state_evaluator *model_state_evaluator;
+  ai_path *(*find_path_to_goal)(struct ai_search_frontier_struct *frontier,
+                                ai_model_state *model_state);
+  ai_operator_function operator_function;
+  ai_operator_function reverse_operator_function;
+  int fringe_expansion_count; // Over every search of the last path.
+  int fringe_expansion_max;
+  // Last search.
+  float path_cost;
+  int search_count;      // The first search and those for the relays.
+  size_t node_count_max; // Most states held at once.
+  ai_search_status status;
+} ai_search_frontier;
+
+/*
+ * Frontier A* Search Constructor. Returns NULL if the evaluator has no hash
+ * or equal function.
+ *
+ * Example:
+ * ai_search_frontier *frontier = ai_search_frontier_constructor(
+ *     model_state_evaluator, my_operator, my_reverse_operator);
+ * ai_path *path = frontier->find_path_to_goal(frontier, model_state);
+ * if (frontier->status == AI_SEARCH_STATUS_FOUND) {
+ *   float cost = frontier->path_cost;
+ * }
+ */
+ai_search_frontier *
+ai_search_frontier_constructor(ai_model_state_evaluator *model_state_evaluator,
+                               ai_operator_function operator_function,
+                               ai_operator_function reverse_operator_function);
+
+void ai_search_frontier_free(ai_search_frontier *frontier);
+
+#endif // _AI_SEARCH_FRONTIER_H_
@@ -0,0 +1,101 @@
+#ifndef _AI_SEARCH_HPA_H_
+#define _AI_SEARCH_HPA_H_
+
+#include <ai_graph.h>
+#include <ai_grid.h>
+#include <ai_search.h>
+
+/*
+ * AI - Hierarchical Path-Finding A* (HPA*).
+ *
+ * Botea, Muller and Schaeffer, "Near Optimal Hierarchical Path-Finding",
+ * Journal of Game Development, 2004.
+ *
+ * The grid is cut into square clusters. Where free cells face each other
+ * across the border of two clusters, entrances are placed: one in the middle
+ * of a short opening, one at each end of a long one. The entrances are the
+ * nodes of a small abstract graph. Entrances of the same cluster are joined by
+ * the cost of the cheapest path between them inside the cluster, found once
+ * when the cluster is built.
+ *
+ * A query links the start and goal to the entrances of their clusters,
+ * searches the abstract graph with ai_search_astar, then refines each
+ * abstract edge by a search inside one cluster. Paths are near optimal, and
+ * the cells searched are a small part of the grid.
+ *
+ * When cells change, only the clusters holding them (and their neighbours,
+ * for a cell on a border) are built again.
+ */
+
+// A pair of facing free cells across a cluster border.
+typedef struct ai_hpa_transition_struct {
+  int x0, y0; // In the left or upper cluster.
+  int x1, y1; // In the right or lower cluster.
+} ai_hpa_transition;
+
+// A cluster. Private to the search.
+typedef struct ai_hpa_cluster_struct {
+  int x, y, width, height;
+  // Transitions across the right and lower borders.
+  ai_hpa_transition *transition_right;
+  int transition_right_count;
+  ai_hpa_transition *transition_down;
+  int transition_down_count;
+  // Entrance cells, and the cost between each pair inside the cluster,
+  // FLT_MAX where there is no path.
+  ai_grid_action *entrance_list;
+  int entrance_count;
+  float *entrance_cost;
+  uint32_t node_first; // Abstract node of the first entrance.
+  int dirty;
+} ai_hpa_cluster;
+
+typedef struct ai_search_hpa_struct {
+  ai_grid *grid;
+  int cluster_size;
+  int cluster_columns;
+  int cluster_rows;
+  float path_cost;            // Cost of the last path found.
+  int fringe_expansion_count; // Expansions by the last query, all searches.
+  int cluster_rebuild_count;  // Clusters built by the last rebuild.
+  ai_search_status status;
+  // Private to the search.
+  ai_hpa_cluster *cluster_list;
+  ai_graph *graph; // Abstract graph. Nodes are entrances.
+  int *node_cluster;
+  int dirty;
+} ai_search_hpa;
+
+/*
+ * HPA* Search Constructor. Builds every cluster.
+ * The grid must not be freed before the search.
+ *
+ * Example:
+ * ai_search_hpa *hpa = ai_search_hpa_constructor(grid, 16);
+ * ai_path *path = ai_search_hpa_find_path(hpa, 0, 0, 4000, 4000);
+ * ai_search_hpa_cell_set(hpa, 100, 20, 1);
+ * path = ai_search_hpa_find_path(hpa, 0, 0, 4000, 4000);
+ */
+ai_search_hpa *ai_search_hpa_constructor(ai_grid *grid, int cluster_size);
+
+/*
+ * Find a path between two cells. Action data are ai_grid_action.
+ * Returns NULL, with status NOT_FOUND, if there is no path. An empty path
+ * (also NULL) has status FOUND. Returns NULL, with status MEMORY_EXCEEDED, if
+ * the abstract graph could not be built again.
+ */
+ai_path *ai_search_hpa_find_path(ai_search_hpa *hpa, int start_x, int start_y,
+                                 int goal_x, int goal_y);
+
+// Block or free a cell of the grid. Its clusters are built again before the
+// next query.
+void ai_search_hpa_cell_set(ai_search_hpa *hpa, int x, int y, int blocked);
+
+// Build the clusters whose cells have changed, and the abstract graph.
+// Called by ai_search_hpa_find_path when needed. If out of memory, there is
+// no graph until a later query rebuilds it.
+void ai_search_hpa_rebuild(ai_search_hpa *hpa);
+
+void ai_search_hpa_free(ai_search_hpa *hpa);
+
+#endif // _AI_SEARCH_HPA_H_
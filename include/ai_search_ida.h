@@ -0,0 +1,74 @@
+#ifndef _AI_SEARCH_IDA_H_
+#define _AI_SEARCH_IDA_H_
+
+#include <ai_search.h>
+#include <stddef.h>
+
+/*
+ * AI - Iterative Deepening A* Search.
+ *
+ * Korf, "Depth-first iterative-deepening: An optimal admissible tree
+ * search", Artificial Intelligence, 1985.
+ *
+ * A series of depth-first searches, each cut off where est_total_cost
+ * (cost_so_far + goal_est_cost) passes a bound. The first bound is the
+ * estimate of the initial state, and each after is the least
+ * est_total_cost cut off by the search before. Memory is proportional to the
+ * depth of the path, whatever the size of the state space, at the cost of
+ * expanding states again in each search and on each path to them.
+ *
+ * One working Model State, a copy of the initial state, is changed in place
+ * by the evaluator's apply_action_function as the search goes down and
+ * undo_action_function as it comes back. Actions are written by
+ * action_next_function into a buffer of action_packed_size bytes for each
+ * depth. Once the buffers are as deep as the path, a search allocates
+ * nothing per state; only the path found is allocated, with the evaluator's
+ * action_data_duplicator.
+ *
+ * With the evaluator's pack function, an Action that leads straight back to
+ * the state before, such as a move undone, is not taken. No other
+ * duplicates are detected, so spaces with short cycles are searched many
+ * times over. The path is optimal for an estimate that never
+ * over-estimates. A search for a Goal that can not be reached ends only if
+ * the space has no cycles.
+ */
+
+typedef struct ai_search_ida_struct {
+  ai_model_state_evaluator *model_state_evaluator;
+  ai_path *(*find_path_to_goal)(struct ai_search_ida_struct *ida,
+                                ai_model_state *model_state);
+  int fringe_expansion_count; // Over every iteration of the last search.
+  int fringe_expansion_max;
+  // Last search.
+  float path_cost;
+  int iteration_count; // Depth-first searches, one per bound.
+  int depth_max;       // Deepest state reached.
+  ai_search_status status;
+  // Private to the search.
+  ai_model_state *model_state; // The working state.
+  float bound;
+  float bound_next;
+  int path_depth; // Actions on the path to the Goal reached.
+  unsigned char *action_list;      // action_packed_size per depth.
+  unsigned char *model_state_list; // model_state_packed_size per depth.
+  int depth_size;
+} ai_search_ida;
+
+/*
+ * Iterative Deepening A* Search Constructor. Returns NULL if the evaluator
+ * has no action_next_function, apply_action_function,
+ * undo_action_function or action_packed_size.
+ *
+ * Example:
+ * ai_search_ida *ida = ai_search_ida_constructor(model_state_evaluator);
+ * ai_path *path = ida->find_path_to_goal(ida, model_state);
+ * if (ida->status == AI_SEARCH_STATUS_FOUND) {
+ *   float cost = ida->path_cost;
+ * }
+ */
+ai_search_ida *
+ai_search_ida_constructor(ai_model_state_evaluator *model_state_evaluator);
+
+void ai_search_ida_free(ai_search_ida *ida);
+
+#endif // _AI_SEARCH_IDA_H_
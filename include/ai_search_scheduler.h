@@ -0,0 +1,139 @@
+#ifndef _AI_SEARCH_SCHEDULER_H_
+#define _AI_SEARCH_SCHEDULER_H_
+
+#include <ai_search.h>
+#include <pthread.h>
+
+/*
+ * AI - Cooperative scheduler for many concurrent stepwise searches.
+ *
+ * The scheduler owns a set of in-flight queries. Each query is an A* search
+ * that is run a quantum of fringe expansions at a time, using
+ * ai_search_astar_step. The query with the Earliest Deadline First (EDF) is
+ * always given the next quantum, so a long search can not hold up many short
+ * ones that are due sooner.
+ *
+ * Queries are run by a configurable number of worker threads. With zero
+ * workers the caller drives the scheduler with ai_search_scheduler_run_slice.
+ *
+ * Example:
+ * ai_search_scheduler *scheduler = ai_search_scheduler_constructor(4, 100);
+ * ai_search_scheduler_submit(scheduler, astar, model_state,
+ *                            ai_search_scheduler_now() + 0.005, 0,
+ *                            my_on_complete, my_user_data);
+ * ai_search_scheduler_drain(scheduler);
+ * ai_search_scheduler_free(scheduler);
+ */
+
+/*
+ * Called once per query when its search is no longer running.
+ * Ownership of the path passes to the callback.
+ * Called from a worker thread, unless the scheduler has no workers.
+ */
+typedef void (*ai_search_query_complete_function)(ai_search_astar *astar,
+                                                  ai_search_status status,
+                                                  ai_path *path,
+                                                  void *user_data);
+
+// An in-flight query. Private to the scheduler.
+typedef struct ai_search_query_struct {
+  ai_search_astar *astar;
+  double deadline; // Absolute time, see ai_search_scheduler_now. 0 is none.
+  int priority;    // Higher runs first among equal deadlines, and gets a
+                   // proportionally larger quantum.
+  long sequence;   // Submission order, breaks remaining ties.
+  double submit_time;
+  double first_run_time;
+  ai_search_query_complete_function on_complete;
+  void *user_data;
+  // Cheat - Allow a linked list of queries
+  struct ai_search_query_struct *next;
+} ai_search_query;
+
+// Summary of a set of latency samples, in seconds.
+typedef struct ai_search_latency_struct {
+  long count;
+  double mean;
+  double p50;
+  double p99;
+  double max;
+} ai_search_latency;
+
+/*
+ * Scheduler metrics.
+ * queue_latency is the time from submission until a query first runs.
+ * completion_time is the time from submission until a query completes.
+ * Percentiles are over the most recent AI_SEARCH_SCHEDULER_SAMPLE_MAX queries.
+ */
+typedef struct ai_search_scheduler_metrics_struct {
+  long submitted_count;
+  long completed_count;
+  long deadline_miss_count;
+  int in_flight_count;
+  ai_search_latency queue_latency;
+  ai_search_latency completion_time;
+} ai_search_scheduler_metrics;
+
+#define AI_SEARCH_SCHEDULER_SAMPLE_MAX 1024
+
+typedef struct ai_search_scheduler_struct {
+  int worker_count;
+  int expansion_quantum;
+  // Private to the scheduler.
+  pthread_t *workers;
+  pthread_mutex_t mutex;
+  pthread_cond_t work_available;
+  pthread_cond_t all_complete;
+  int stopping;
+  int running_count; // Queries currently held by a worker.
+  long sequence;
+  ai_search_query *query_list; // Sorted, Earliest Deadline First.
+  long submitted_count;
+  long completed_count;
+  long deadline_miss_count;
+  long sample_count;
+  double queue_latency_samples[AI_SEARCH_SCHEDULER_SAMPLE_MAX];
+  double completion_time_samples[AI_SEARCH_SCHEDULER_SAMPLE_MAX];
+} ai_search_scheduler;
+
+/*
+ * Scheduler Constructor.
+ *
+ * worker_count threads are started. With 0 workers no threads are started
+ * and ai_search_scheduler_run_slice must be called to make progress.
+ * expansion_quantum is the number of fringe expansions per slice for a
+ * priority 0 query.
+ */
+ai_search_scheduler *ai_search_scheduler_constructor(int worker_count,
+                                                     int expansion_quantum);
+
+// Current monotonic time in seconds, the clock used for deadlines.
+double ai_search_scheduler_now(void);
+
+/*
+ * Submit a query. The search is begun from a copy of model_state.
+ * The astar must not be used by the caller until on_complete is called.
+ * Returns 0 on success, -1 on failure.
+ */
+int ai_search_scheduler_submit(ai_search_scheduler *scheduler,
+                               ai_search_astar *astar,
+                               ai_model_state *model_state, double deadline,
+                               int priority,
+                               ai_search_query_complete_function on_complete,
+                               void *user_data);
+
+// Run one quantum of the most urgent query on the calling thread.
+// Returns 0 if there was nothing to run, otherwise 1.
+int ai_search_scheduler_run_slice(ai_search_scheduler *scheduler);
+
+// Block until every submitted query has completed.
+void ai_search_scheduler_drain(ai_search_scheduler *scheduler);
+
+// Take a snapshot of the scheduler metrics.
+void ai_search_scheduler_metrics_get(ai_search_scheduler *scheduler,
+                                     ai_search_scheduler_metrics *metrics);
+
+// Stop the workers, cancel any queries still in flight, and free.
+void ai_search_scheduler_free(ai_search_scheduler *scheduler);
+
+#endif // _AI_SEARCH_SCHEDULER_H_
@@ -0,0 +1,79 @@
+#ifndef _AI_SEARCH_SMA_H_
+#define _AI_SEARCH_SMA_H_
+
+#include <ai_search.h>
+
+/*
+ * AI - Simplified Memory-bounded A* (SMA*) Search.
+ *
+ * http://en.wikipedia.org/wiki/SMA*
+ *
+ * Behaves as A* until node_max search nodes are held. Then the worst leaf
+ * (highest f, shallowest) is forgotten, and its f value backed up to its
+ * parent, so that the parent is regenerated later if that branch becomes
+ * the most promising again.
+ *
+ * The path found is optimal whenever the optimal path fits in memory, that
+ * is it has fewer than node_max actions. Otherwise the best path that fits
+ * is found.
+ *
+ * The same ai_model_state_evaluator is used as for ai_search_astar.
+ * The successor_function must return successors in the same order each time
+ * it is called on equivalent Model States, so forgotten successors can be
+ * regenerated.
+ */
+
+// Search node. Private to the search.
+typedef struct ai_sma_node_struct {
+  ai_model_state *model_state;
+  ai_action *action; // Action from the parent. NULL at the root.
+  struct ai_sma_node_struct *parent;
+  int parent_slot; // Index of this node in the parent's children.
+  int depth;
+  float cost_so_far;
+  float est_total_cost; // f, backed up from the children once expanded.
+  float forgotten_est_total_cost; // Least f of forgotten children.
+  // Children, one slot per successor. Forgotten children are NULL.
+  // NULL until the node is expanded.
+  struct ai_sma_node_struct **children;
+  int children_size;
+  int children_count;  // Children held in memory.
+  int node_list_index; // Index in the search's node list.
+  int heap_index[2];   // Index in the open and leaf heaps, or -1.
+} ai_sma_node;
+
+typedef struct ai_search_sma_struct {
+  ai_model_state_evaluator *model_state_evaluator;
+  ai_path *(*find_path_to_goal)(struct ai_search_sma_struct *sma,
+                                ai_model_state *model_state);
+  int node_max;
+  int fringe_expansion_count;
+  int fringe_expansion_max;
+  int node_forgotten_count;
+  int node_peak_count; // Most nodes held at once during the search.
+  ai_search_status status;
+  // Private to the search.
+  ai_sma_node **node_list;
+  int node_list_size;
+  int node_count;
+  // Open nodes, least f first, and leaves, greatest f first. Each is
+  // node_list_size long.
+  ai_sma_node **heap_list[2];
+  int heap_count[2];
+} ai_search_sma;
+
+/*
+ * SMA* Search Constructor.
+ * node_max is the most search nodes that may be held at once.
+ *
+ * Example:
+ * ai_search_sma *sma = ai_search_sma_constructor(model_state_evaluator, 1000);
+ * ai_path *path = sma->find_path_to_goal(sma, model_state);
+ */
+ai_search_sma *
+ai_search_sma_constructor(ai_model_state_evaluator *model_state_evaluator,
+                          int node_max);
+
+void ai_search_sma_free(ai_search_sma *sma);
+
+#endif // _AI_SEARCH_SMA_H_
@@ -0,0 +1,97 @@
+#ifndef _AI_STATE_INTERN_H_
+#define _AI_STATE_INTERN_H_
+
+#include <ai_search.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * AI - State Intern Table.
+ *
+ * Each distinct Model State is stored once, packed with the evaluator's
+ * model_state_pack_function, and named by a 32-bit id, its order of
+ * arrival from 0. A search keeps ids rather than Model States, so a state
+ * reached again costs a hash lookup, with no Model State to duplicate or
+ * free, and per-state data can be held in arrays indexed by id.
+ *
+ * States are held one after another in a single array, so the packed bytes
+ * of a state stay where they are only until the next state is added. The
+ * hash of each state is kept, so the table grows without hashing again.
+ *
+ * Requires the evaluator's model_state_packed_size,
+ * model_state_pack_function and model_state_unpack_function. The evaluator's
+ * hash and equal functions are not used; states are hashed and compared
+ * packed.
+ *
+ * Example:
+ * int added = 0;
+ * uint32_t id = ai_state_intern_add_model_state(intern, model_state, &added);
+ * if (id != AI_STATE_INTERN_NONE && added) {
+ *   ... a state not seen before ...
+ * }
+ */
+
+#define AI_STATE_INTERN_NONE UINT32_MAX
+
+typedef struct ai_state_intern_struct {
+  ai_model_state_evaluator *model_state_evaluator;
+  uint32_t count; // States held, with ids 0 to count - 1.
+  // Private to the table.
+  uint8_t *model_state_list; // Packed states, in id order.
+  size_t *hash_list;         // Hash of each state, in id order.
+  uint32_t size;             // States there is room for.
+  uint32_t *table;           // Ids, AI_STATE_INTERN_NONE where empty.
+  size_t table_size;         // Always a power of 2.
+  uint8_t *scratch;          // A state being packed.
+} ai_state_intern;
+
+// ai_state_intern *intern = ai_state_intern_constructor(evaluator);
+// Returns NULL if the evaluator can not pack states.
+ai_state_intern *
+ai_state_intern_constructor(ai_model_state_evaluator *model_state_evaluator);
+
+// The hash of packed state bytes.
+size_t ai_state_intern_hash(ai_state_intern *intern, const void *bytes);
+
+// The id of a packed state, or AI_STATE_INTERN_NONE if it is not held.
+uint32_t ai_state_intern_find(ai_state_intern *intern, const void *bytes);
+
+// The id of a packed state, added if it is not held, when added is set to
+// true. Returns AI_STATE_INTERN_NONE if out of memory.
+uint32_t ai_state_intern_add(ai_state_intern *intern, const void *bytes,
+                             int *added);
+
+// As ai_state_intern_add, given the hash of the state in place of
+// ai_state_intern_hash, such as one from the evaluator's
+// model_state_hash_update_function. A table must be given every hash, or
+// none.
+uint32_t ai_state_intern_add_hashed(ai_state_intern *intern,
+                                    const void *bytes, size_t hash,
+                                    int *added);
+
+// As ai_state_intern_add, packing the Model State first. The caller keeps
+// the Model State.
+uint32_t ai_state_intern_add_model_state(ai_state_intern *intern,
+                                         ai_model_state *model_state,
+                                         int *added);
+
+// The packed bytes of a state, valid until the next state is added.
+const void *ai_state_intern_bytes(ai_state_intern *intern, uint32_t id);
+
+// The hash kept for a state.
+size_t ai_state_intern_state_hash(ai_state_intern *intern, uint32_t id);
+
+// A new Model State unpacked from a state, for the caller to free, or NULL
+// if out of memory.
+ai_model_state *ai_state_intern_model_state(ai_state_intern *intern,
+                                            uint32_t id);
+
+// Bytes held by the table.
+size_t ai_state_intern_memory_used(ai_state_intern *intern);
+
+// Forget every state, keeping the memory for the states to come.
+void ai_state_intern_clear(ai_state_intern *intern);
+
+void ai_state_intern_free(ai_state_intern *intern);
+
+#endif // _AI_STATE_INTERN_H_
@@ -0,0 +1,69 @@
+#ifndef _AI_STATE_TABLE_H_
+#define _AI_STATE_TABLE_H_
+
+#include <ai_search.h>
+
+/*
+ * AI - State Table.
+ *
+ * A hash table of Model States, each with a cost. Used by the searches as a
+ * closed set of the states already expanded, with their cost_so_far, which
+ * is also a table of the distance from the initial state to every state
+ * reached.
+ *
+ * Requires the evaluator's model_state_hash_function and
+ * model_state_equal_function.
+ *
+ * Example:
+ * ai_state_table_entry *entry = ai_state_table_find(table, model_state);
+ * if (entry) {
+ *   printf("distance %f\n", entry->cost);
+ * }
+ *
+ * Every entry may be visited with:
+ * for (size_t i = 0; i < table->size; i++) {
+ *   if (table->entries[i].model_state) { ... }
+ * }
+ */
+
+typedef struct ai_state_table_entry_struct {
+  ai_model_state *model_state; // NULL for an empty slot.
+  size_t hash;
+  float cost;
+} ai_state_table_entry;
+
+typedef struct ai_state_table_struct {
+  ai_model_state_evaluator *model_state_evaluator;
+  ai_state_table_entry *entries;
+  size_t size;  // Slots. Always a power of 2.
+  size_t count; // Slots in use.
+} ai_state_table;
+
+// ai_state_table *table = ai_state_table_constructor(model_state_evaluator);
+ai_state_table *
+ai_state_table_constructor(ai_model_state_evaluator *model_state_evaluator);
+
+// The entry for the Model State, or NULL if it is not in the table.
+ai_state_table_entry *ai_state_table_find(ai_state_table *table,
+                                          ai_model_state *model_state);
+
+// As ai_state_table_find, given the hash of the Model State.
+ai_state_table_entry *ai_state_table_find_hashed(ai_state_table *table,
+                                                 ai_model_state *model_state,
+                                                 size_t hash);
+
+// Add a Model State not already in the table. The table takes ownership of
+// the Model State. Returns the new entry, or NULL on failure.
+ai_state_table_entry *ai_state_table_insert(ai_state_table *table,
+                                            ai_model_state *model_state,
+                                            float cost);
+
+// As ai_state_table_insert, given the hash of the Model State.
+ai_state_table_entry *ai_state_table_insert_hashed(ai_state_table *table,
+                                                   ai_model_state *model_state,
+                                                   size_t hash, float cost);
+
+// Free the table and every Model State in it.
+void ai_state_table_free(ai_state_table *table);
+
+#endif // _AI_STATE_TABLE_H_
@@ -0,0 +1,369 @@
+/*
+ * AI - Graph.
+ *
+ * The CSR arrays are built with a counting sort on the source (and, for the
+ * reverse index, the target) of each edge, so edges keep their given order
+ * within a node.
+ *
+ * Also Dijkstra over the graph, and a Model State evaluator for searching it
+ * with ai_search_astar.
+ */
+#include "ai_search_internal.h"
+#include <ai_graph.h>
+#include <logging.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ai_graph *graph = ai_graph_constructor(node_count, edge_count, edges);
+ai_graph *ai_graph_constructor(uint32_t node_count, uint32_t edge_count,
+                               const ai_graph_edge *edges) {
+  ai_graph *graph = (ai_graph *)calloc(1, sizeof(ai_graph));
+  check(graph, "ai_graph_constructor malloc failed");
+  graph->node_count = node_count;
+  graph->edge_count = edge_count;
+  graph->edge_offset = (uint32_t *)calloc(node_count + 1, sizeof(uint32_t));
+  graph->edge_target = (uint32_t *)malloc(sizeof(uint32_t) * (edge_count + 1));
+  graph->edge_cost = (float *)malloc(sizeof(float) * (edge_count + 1));
+  graph->reverse_offset = (uint32_t *)calloc(node_count + 1, sizeof(uint32_t));
+  graph->reverse_source =
+      (uint32_t *)malloc(sizeof(uint32_t) * (edge_count + 1));
+  graph->reverse_edge = (uint32_t *)malloc(sizeof(uint32_t) * (edge_count + 1));
+  check(graph->edge_offset && graph->edge_target && graph->edge_cost &&
+            graph->reverse_offset && graph->reverse_source &&
+            graph->reverse_edge,
+        "ai_graph_constructor malloc failed");
+
+  // Count the edges of each node, then turn counts into offsets.
+  for (uint32_t i = 0; i < edge_count; i++) {
+    check((edges[i].source < node_count) && (edges[i].target < node_count),
+          "ai_graph_constructor edge %u node out of range", i);
+    graph->edge_offset[edges[i].source + 1]++;
+    graph->reverse_offset[edges[i].target + 1]++;
+  }
+  for (uint32_t v = 0; v < node_count; v++) {
+    graph->edge_offset[v + 1] += graph->edge_offset[v];
+    graph->reverse_offset[v + 1] += graph->reverse_offset[v];
+  }
+
+  // Place each edge, using the offsets of the next node as cursors.
+  for (uint32_t i = 0; i < edge_count; i++) {
+    uint32_t e = graph->edge_offset[edges[i].source]++;
+    graph->edge_target[e] = edges[i].target;
+    graph->edge_cost[e] = edges[i].cost;
+  }
+  for (uint32_t v = node_count; v > 0; v--) {
+    graph->edge_offset[v] = graph->edge_offset[v - 1];
+  }
+  graph->edge_offset[0] = 0;
+
+  for (uint32_t v = 0; v < node_count; v++) {
+    for (uint32_t e = graph->edge_offset[v]; e < graph->edge_offset[v + 1];
+         e++) {
+      uint32_t r = graph->reverse_offset[graph->edge_target[e]]++;
+      graph->reverse_source[r] = v;
+      graph->reverse_edge[r] = e;
+    }
+  }
+  for (uint32_t v = node_count; v > 0; v--) {
+    graph->reverse_offset[v] = graph->reverse_offset[v - 1];
+  }
+  graph->reverse_offset[0] = 0;
+  return graph;
+error:
+  ai_graph_free(graph);
+  return NULL;
+}
+
+uint32_t ai_graph_edge_find(ai_graph *graph, uint32_t source, uint32_t target) {
+  if (source >= graph->node_count) {
+    return AI_GRAPH_NODE_NONE;
+  }
+  for (uint32_t e = graph->edge_offset[source];
+       e < graph->edge_offset[source + 1]; e++) {
+    if (graph->edge_target[e] == target) {
+      return e;
+    }
+  }
+  return AI_GRAPH_NODE_NONE;
+}
+
+uint32_t ai_graph_edge_source(ai_graph *graph, uint32_t edge) {
+  // The last node whose first edge is at or before edge. Nodes with no out
+  // edges share their offset with the next node, so take the last.
+  uint32_t low = 0;
+  uint32_t high = graph->node_count;
+  while (high - low > 1) {
+    uint32_t mid = low + (high - low) / 2;
+    if (graph->edge_offset[mid] <= edge) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+// Heap
+
+int _ai_graph_heap_push(_ai_graph_heap *heap, float key, uint32_t node) {
+  if (heap->count == heap->size) {
+    uint32_t new_size = heap->size ? heap->size * 2 : 64;
+    _ai_graph_heap_entry *new_list = (_ai_graph_heap_entry *)realloc(
+        heap->entry_list, sizeof(_ai_graph_heap_entry) * new_size);
+    check(new_list, "_ai_graph_heap_push realloc failed");
+    heap->entry_list = new_list;
+    heap->size = new_size;
+  }
+  _ai_graph_heap_entry *list = heap->entry_list;
+  uint32_t i = heap->count++;
+  while ((i > 0) && (key < list[(i - 1) / 2].key)) {
+    list[i] = list[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  list[i].key = key;
+  list[i].node = node;
+  return 0;
+error:
+  return -1;
+}
+
+_ai_graph_heap_entry _ai_graph_heap_pop(_ai_graph_heap *heap) {
+  _ai_graph_heap_entry *list = heap->entry_list;
+  _ai_graph_heap_entry top = list[0];
+  _ai_graph_heap_entry last = list[--heap->count];
+  uint32_t i = 0;
+  for (;;) {
+    uint32_t child = 2 * i + 1;
+    if (child >= heap->count) {
+      break;
+    }
+    if ((child + 1 < heap->count) && (list[child + 1].key < list[child].key)) {
+      child++;
+    }
+    if (!(list[child].key < last.key)) {
+      break;
+    }
+    list[i] = list[child];
+    i = child;
+  }
+  list[i] = last;
+  return top;
+}
+
+void _ai_graph_heap_free(_ai_graph_heap *heap) {
+  free(heap->entry_list);
+  heap->entry_list = NULL;
+  heap->count = 0;
+  heap->size = 0;
+}
+
+// Dijkstra, with the shortest path tree.
+int _ai_graph_shortest_path_tree(ai_graph *graph, uint32_t source, int reverse,
+                                 float *dist, uint32_t *parent,
+                                 uint32_t *order, uint32_t *order_count) {
+  _ai_graph_heap heap = {NULL, 0, 0};
+  uint32_t *offset = reverse ? graph->reverse_offset : graph->edge_offset;
+  uint32_t settled_count = 0;
+  for (uint32_t v = 0; v < graph->node_count; v++) {
+    dist[v] = INFINITY;
+    if (parent) {
+      parent[v] = AI_GRAPH_NODE_NONE;
+    }
+  }
+  dist[source] = 0;
+  check(_ai_graph_heap_push(&heap, 0, source) == 0,
+        "_ai_graph_shortest_path_tree out of memory");
+  while (heap.count) {
+    _ai_graph_heap_entry top = _ai_graph_heap_pop(&heap);
+    if (top.key > dist[top.node]) {
+      continue;
+    }
+    if (order) {
+      order[settled_count] = top.node;
+    }
+    settled_count++;
+    for (uint32_t i = offset[top.node]; i < offset[top.node + 1]; i++) {
+      uint32_t e = reverse ? graph->reverse_edge[i] : i;
+      uint32_t next = reverse ? graph->reverse_source[i] : graph->edge_target[e];
+      float cost = top.key + graph->edge_cost[e];
+      if (cost < dist[next]) {
+        dist[next] = cost;
+        if (parent) {
+          parent[next] = e;
+        }
+        check(_ai_graph_heap_push(&heap, cost, next) == 0,
+              "_ai_graph_shortest_path_tree out of memory");
+      }
+    }
+  }
+  if (order_count) {
+    *order_count = settled_count;
+  }
+  _ai_graph_heap_free(&heap);
+  return 0;
+error:
+  _ai_graph_heap_free(&heap);
+  return -1;
+}
+
+// int rc = ai_graph_distances(graph, source, 0, dist);
+int ai_graph_distances(ai_graph *graph, uint32_t source, int reverse,
+                       float *dist) {
+  return _ai_graph_shortest_path_tree(graph, source, reverse, dist, NULL, NULL,
+                                      NULL);
+}
+
+ai_graph_action *ai_graph_action_data_constructor(uint32_t edge,
+                                                  uint32_t target) {
+  ai_graph_action *action_data =
+      (ai_graph_action *)malloc(sizeof(ai_graph_action));
+  check(action_data, "ai_graph_action_data_constructor malloc failed");
+  action_data->edge = edge;
+  action_data->target = target;
+  return action_data;
+error:
+  return NULL;
+}
+
+void ai_graph_action_data_free(void *data) { free(data); }
+
+void *ai_graph_action_data_duplicator(void *data) {
+  ai_graph_action *old = (ai_graph_action *)data;
+  return ai_graph_action_data_constructor(old->edge, old->target);
+}
+
+void ai_graph_query_init(ai_graph_query *query, ai_graph *graph,
+                         uint32_t goal) {
+  query->graph = graph;
+  query->goal = goal;
+  query->est_cost_function = NULL;
+  query->est_cost_data = NULL;
+}
+
+// ai_model_state *model_state = ai_graph_model_state_constructor(&query, 0);
+ai_model_state *ai_graph_model_state_constructor(ai_graph_query *query,
+                                                 uint32_t node) {
+  ai_graph_state *data = (ai_graph_state *)malloc(sizeof(ai_graph_state));
+  check(data, "ai_graph_model_state_constructor malloc failed");
+  data->query = query;
+  data->node = node;
+  return ai_model_state_constructor(data);
+error:
+  return NULL;
+}
+
+void ai_graph_model_state_data_free(void *data) { free(data); }
+
+void ai_graph_free(ai_graph *graph) {
+  if (graph) {
+    free(graph->edge_offset);
+    free(graph->edge_target);
+    free(graph->edge_cost);
+    free(graph->reverse_offset);
+    free(graph->reverse_source);
+    free(graph->reverse_edge);
+    free(graph);
+  }
+}
+
+// Evaluator
+
+ai_successor *
+_ai_graph_successor_function(ai_model_state *model_state,
+                             ai_transition_function transition_function) {
+  ai_graph_state *state = (ai_graph_state *)model_state->data;
+  ai_graph *graph = state->query->graph;
+  ai_successor *head = NULL;
+  for (uint32_t e = graph->edge_offset[state->node + 1];
+       e > graph->edge_offset[state->node]; e--) {
+    if (graph->edge_cost[e - 1] == INFINITY) {
+      continue;
+    }
+    ai_action *action = ai_action_constructor(
+        ai_graph_action_data_constructor(e - 1, graph->edge_target[e - 1]));
+    ai_successor *successor = ai_successor_constructor(
+        transition_function(model_state, action), action,
+        graph->edge_cost[e - 1]);
+    successor->next = head;
+    head = successor;
+  }
+  return head;
+}
+
+ai_model_state *_ai_graph_transition_function(ai_model_state *model_state,
+                                              ai_action *action) {
+  ai_graph_state *state = (ai_graph_state *)model_state->data;
+  ai_graph_action *action_data = (ai_graph_action *)action->data;
+  return ai_graph_model_state_constructor(state->query, action_data->target);
+}
+
+int _ai_graph_is_goal_state_function(ai_model_state *model_state) {
+  ai_graph_state *state = (ai_graph_state *)model_state->data;
+  return state->node == state->query->goal;
+}
+
+float _ai_graph_goal_est_cost_function(ai_model_state *model_state) {
+  ai_graph_state *state = (ai_graph_state *)model_state->data;
+  ai_graph_query *query = state->query;
+  if (query->est_cost_function == NULL) {
+    return 0;
+  }
+  return query->est_cost_function(query->est_cost_data, state->node,
+                                  query->goal);
+}
+
+float _ai_graph_state_est_cost_function(ai_model_state *model_state,
+                                        ai_model_state *goal_model_state) {
+  ai_graph_state *state = (ai_graph_state *)model_state->data;
+  ai_graph_state *goal = (ai_graph_state *)goal_model_state->data;
+  ai_graph_query *query = state->query;
+  if (query->est_cost_function == NULL) {
+    return 0;
+  }
+  return query->est_cost_function(query->est_cost_data, state->node,
+                                  goal->node);
+}
+
+void *_ai_graph_model_state_data_duplicator(void *data) {
+  ai_graph_state *new_data = (ai_graph_state *)malloc(sizeof(ai_graph_state));
+  check(new_data, "_ai_graph_model_state_data_duplicator malloc failed");
+  memcpy(new_data, data, sizeof(ai_graph_state));
+error:
+  return new_data;
+}
+
+size_t _ai_graph_model_state_data_size(void *data) {
+  return sizeof(ai_graph_state);
+}
+
+size_t _ai_graph_action_data_size(void *data) {
+  return sizeof(ai_graph_action);
+}
+
+size_t _ai_graph_model_state_hash_function(ai_model_state *model_state) {
+  return ((ai_graph_state *)model_state->data)->node;
+}
+
+int _ai_graph_model_state_equal_function(ai_model_state *model_state_a,
+                                         ai_model_state *model_state_b) {
+  return ((ai_graph_state *)model_state_a->data)->node ==
+         ((ai_graph_state *)model_state_b->data)->node;
+}
+
+ai_model_state_evaluator ai_graph_model_state_evaluator = {
+    .successor_function = _ai_graph_successor_function,
+    .transition_function = _ai_graph_transition_function,
+    .is_goal_state_function = _ai_graph_is_goal_state_function,
+    .goal_est_cost_function = _ai_graph_goal_est_cost_function,
+    .model_state_data_duplicator = _ai_graph_model_state_data_duplicator,
+    .model_state_data_free = ai_graph_model_state_data_free,
+    .action_data_duplicator = ai_graph_action_data_duplicator,
+    .action_data_free = ai_graph_action_data_free,
+    .model_state_data_size = _ai_graph_model_state_data_size,
+    .action_data_size = _ai_graph_action_data_size,
+    .model_state_hash_function = _ai_graph_model_state_hash_function,
+    .model_state_equal_function = _ai_graph_model_state_equal_function,
+    .state_est_cost_function = _ai_graph_state_est_cost_function,
+};
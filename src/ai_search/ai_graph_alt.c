@@ -0,0 +1,239 @@
+/*
+ * AI - ALT (A*, Landmarks, Triangle inequality) estimates.
+ *
+ * The tables are laid out node by node, so that the landmark costs of a node
+ * are read together when it is estimated.
+ *
+ * Landmarks are chosen one at a time, each with the tables of those already
+ * chosen filled in, since both strategies look at the current estimates.
+ */
+#include "ai_search_internal.h"
+#include <ai_graph_alt.h>
+#include <logging.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The estimate from the landmarks chosen so far. stride is the number of
+// landmarks the tables have room for.
+float _ai_graph_alt_est_cost(ai_graph_alt *alt, int stride, uint32_t from_node,
+                             uint32_t to_node) {
+  const float *from_v = &alt->cost_from[(size_t)from_node * stride];
+  const float *from_t = &alt->cost_from[(size_t)to_node * stride];
+  const float *to_v = &alt->cost_to[(size_t)from_node * stride];
+  const float *to_t = &alt->cost_to[(size_t)to_node * stride];
+  float best = 0;
+  for (int i = 0; i < alt->landmark_count; i++) {
+    // A bound with an unreachable term says nothing useful, so skip it.
+    if ((from_t[i] < INFINITY) && (from_v[i] < INFINITY) &&
+        (from_t[i] - from_v[i] > best)) {
+      best = from_t[i] - from_v[i];
+    }
+    if ((to_v[i] < INFINITY) && (to_t[i] < INFINITY) &&
+        (to_v[i] - to_t[i] > best)) {
+      best = to_v[i] - to_t[i];
+    }
+  }
+  return best;
+}
+
+// float h = ai_graph_alt_est_cost(alt, node, goal);
+float ai_graph_alt_est_cost(void *data, uint32_t from_node, uint32_t to_node) {
+  ai_graph_alt *alt = (ai_graph_alt *)data;
+  return _ai_graph_alt_est_cost(alt, alt->landmark_count, from_node, to_node);
+}
+
+int _ai_graph_alt_is_landmark(ai_graph_alt *alt, uint32_t node) {
+  for (int i = 0; i < alt->landmark_count; i++) {
+    if (alt->landmark_list[i] == node) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Add a landmark, and fill its column of the tables.
+int _ai_graph_alt_landmark_add(ai_graph_alt *alt, ai_graph *graph,
+                               uint32_t landmark, int capacity, float *dist) {
+  uint32_t n = alt->node_count;
+  int i = alt->landmark_count;
+  check(ai_graph_distances(graph, landmark, 0, dist) == 0,
+        "_ai_graph_alt_landmark_add out of memory");
+  for (uint32_t v = 0; v < n; v++) {
+    alt->cost_from[(size_t)v * capacity + i] = dist[v];
+  }
+  check(ai_graph_distances(graph, landmark, 1, dist) == 0,
+        "_ai_graph_alt_landmark_add out of memory");
+  for (uint32_t v = 0; v < n; v++) {
+    alt->cost_to[(size_t)v * capacity + i] = dist[v];
+  }
+  alt->landmark_list[alt->landmark_count++] = landmark;
+  return 0;
+error:
+  return -1;
+}
+
+// The node farthest from the landmarks chosen, or from node 0 if none.
+// Nodes no landmark reaches are chosen only when no other is left.
+uint32_t _ai_graph_alt_farthest(ai_graph_alt *alt, ai_graph *graph,
+                                int capacity, float *dist) {
+  uint32_t n = alt->node_count;
+  if (alt->landmark_count == 0) {
+    check(ai_graph_distances(graph, 0, 0, dist) == 0,
+          "_ai_graph_alt_farthest out of memory");
+  } else {
+    for (uint32_t v = 0; v < n; v++) {
+      dist[v] = INFINITY;
+      for (int i = 0; i < alt->landmark_count; i++) {
+        float cost = alt->cost_from[(size_t)v * capacity + i];
+        if (cost < dist[v]) {
+          dist[v] = cost;
+        }
+      }
+    }
+  }
+  uint32_t farthest = AI_GRAPH_NODE_NONE;
+  uint32_t unreached = AI_GRAPH_NODE_NONE;
+  for (uint32_t v = 0; v < n; v++) {
+    if (_ai_graph_alt_is_landmark(alt, v)) {
+      continue;
+    }
+    if (dist[v] == INFINITY) {
+      if (unreached == AI_GRAPH_NODE_NONE) {
+        unreached = v;
+      }
+    } else if ((farthest == AI_GRAPH_NODE_NONE) || (dist[v] > dist[farthest])) {
+      farthest = v;
+    }
+  }
+  return farthest != AI_GRAPH_NODE_NONE ? farthest : unreached;
+error:
+  return AI_GRAPH_NODE_NONE;
+}
+
+/*
+ * Avoid. Grow a shortest path tree from a root, and weigh each node by how
+ * far the current estimate from the root falls short of its true cost. Sum
+ * the weights up the tree, leaving out branches that already hold a
+ * landmark. Then walk down from the root along the heaviest branch, and
+ * place the landmark at the leaf.
+ */
+uint32_t _ai_graph_alt_avoid(ai_graph_alt *alt, ai_graph *graph, int capacity,
+                             float *dist) {
+  uint32_t n = alt->node_count;
+  uint32_t landmark = AI_GRAPH_NODE_NONE;
+  uint32_t *parent = (uint32_t *)malloc(sizeof(uint32_t) * n);
+  uint32_t *order = (uint32_t *)malloc(sizeof(uint32_t) * n);
+  float *size = (float *)calloc(n, sizeof(float));
+  char *has_landmark = (char *)calloc(n, sizeof(char));
+  check(parent && order && size && has_landmark,
+        "_ai_graph_alt_avoid malloc failed");
+
+  uint32_t root = _ai_graph_alt_farthest(alt, graph, capacity, dist);
+  check(root != AI_GRAPH_NODE_NONE, "_ai_graph_alt_avoid no root");
+  uint32_t order_count = 0;
+  check(_ai_graph_shortest_path_tree(graph, root, 0, dist, parent, order,
+                                     &order_count) == 0,
+        "_ai_graph_alt_avoid out of memory");
+  for (int i = 0; i < alt->landmark_count; i++) {
+    has_landmark[alt->landmark_list[i]] = 1;
+  }
+  for (uint32_t j = order_count; j > 0; j--) {
+    uint32_t v = order[j - 1];
+    if (has_landmark[v]) {
+      size[v] = 0;
+    } else {
+      size[v] += dist[v] - _ai_graph_alt_est_cost(alt, capacity, root, v);
+    }
+    if (parent[v] != AI_GRAPH_NODE_NONE) {
+      uint32_t u = ai_graph_edge_source(graph, parent[v]);
+      size[u] += size[v];
+      has_landmark[u] |= has_landmark[v];
+    }
+  }
+  if (size[root] <= 0) {
+    landmark = root;
+    goto done;
+  }
+  landmark = root;
+  for (;;) {
+    uint32_t next = AI_GRAPH_NODE_NONE;
+    for (uint32_t e = graph->edge_offset[landmark];
+         e < graph->edge_offset[landmark + 1]; e++) {
+      uint32_t child = graph->edge_target[e];
+      if ((parent[child] == e) && (size[child] > 0) &&
+          ((next == AI_GRAPH_NODE_NONE) || (size[child] > size[next]))) {
+        next = child;
+      }
+    }
+    if (next == AI_GRAPH_NODE_NONE) {
+      break;
+    }
+    landmark = next;
+  }
+  goto done;
+error:
+  landmark = AI_GRAPH_NODE_NONE;
+done:
+  free(parent);
+  free(order);
+  free(size);
+  free(has_landmark);
+  return landmark;
+}
+
+// ai_graph_alt *alt = ai_graph_alt_constructor(graph, 8, selection);
+ai_graph_alt *ai_graph_alt_constructor(ai_graph *graph, int landmark_count,
+                                       ai_graph_alt_selection selection) {
+  ai_graph_alt *alt = NULL;
+  float *dist = NULL;
+  check(graph && (graph->node_count > 0) && (landmark_count >= 1),
+        "ai_graph_alt_constructor no landmarks");
+  uint32_t n = graph->node_count;
+  if ((uint32_t)landmark_count > n) {
+    landmark_count = (int)n;
+  }
+  alt = (ai_graph_alt *)calloc(1, sizeof(ai_graph_alt));
+  check(alt, "ai_graph_alt_constructor malloc failed");
+  alt->node_count = n;
+  alt->landmark_list = (uint32_t *)malloc(sizeof(uint32_t) * landmark_count);
+  alt->cost_from =
+      (float *)malloc(sizeof(float) * (size_t)n * (size_t)landmark_count);
+  alt->cost_to =
+      (float *)malloc(sizeof(float) * (size_t)n * (size_t)landmark_count);
+  dist = (float *)malloc(sizeof(float) * n);
+  check(alt->landmark_list && alt->cost_from && alt->cost_to && dist,
+        "ai_graph_alt_constructor malloc failed");
+
+  while (alt->landmark_count < landmark_count) {
+    uint32_t landmark =
+        ((selection == AI_GRAPH_ALT_SELECTION_AVOID) && alt->landmark_count)
+            ? _ai_graph_alt_avoid(alt, graph, landmark_count, dist)
+            : _ai_graph_alt_farthest(alt, graph, landmark_count, dist);
+    if ((landmark == AI_GRAPH_NODE_NONE) ||
+        _ai_graph_alt_is_landmark(alt, landmark)) {
+      landmark = _ai_graph_alt_farthest(alt, graph, landmark_count, dist);
+    }
+    check(landmark != AI_GRAPH_NODE_NONE,
+          "ai_graph_alt_constructor no landmark");
+    check(_ai_graph_alt_landmark_add(alt, graph, landmark, landmark_count,
+                                     dist) == 0,
+          "ai_graph_alt_constructor out of memory");
+  }
+  free(dist);
+  return alt;
+error:
+  free(dist);
+  ai_graph_alt_free(alt);
+  return NULL;
+}
+
+void ai_graph_alt_free(ai_graph_alt *alt) {
+  if (alt) {
+    free(alt->landmark_list);
+    free(alt->cost_from);
+    free(alt->cost_to);
+    free(alt);
+  }
+}
@@ -0,0 +1,195 @@
+/*
+ * AI - Arc-Flags.
+ *
+ * An edge within a region is always flagged for it. Any cheapest path into
+ * a region enters it for the last time at a boundary node, and the part
+ * before that is a cheapest path to the boundary node, so it is enough to
+ * flag the edges on cheapest paths to each boundary node. Ties are all
+ * flagged, with a little room for rounding, which only ever adds flags.
+ */
+#include "ai_search_internal.h"
+#include <ai_graph_arc_flags.h>
+#include <logging.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Relative slack when testing an edge is on a cheapest path.
+#define AI_GRAPH_ARC_FLAGS_TOLERANCE 1e-5f
+
+void _ai_graph_arc_flags_set(ai_graph_arc_flags *arc_flags, uint32_t edge,
+                             uint32_t region) {
+  arc_flags->flag_list[(size_t)edge * arc_flags->region_words + region / 64] |=
+      (uint64_t)1 << (region % 64);
+}
+
+/*
+ * Grow regions by Dijkstra from a seed, following edges either way, so
+ * that each takes the nodes nearest to it. A region is full at its share of
+ * the nodes, and the next is then seeded from the lowest numbered node
+ * left, as is a region that runs out of neighbours. The last region takes
+ * whatever is left.
+ */
+int _ai_graph_arc_flags_partition(ai_graph *graph, int region_count,
+                                  uint32_t *node_region) {
+  uint32_t n = graph->node_count;
+  uint32_t region_size_max = (n + region_count - 1) / region_count;
+  _ai_graph_heap heap = {NULL, 0, 0};
+  for (uint32_t v = 0; v < n; v++) {
+    node_region[v] = AI_GRAPH_NODE_NONE;
+  }
+  uint32_t region = 0;
+  uint32_t region_size = 0;
+  uint32_t seed = 0;
+  for (uint32_t assigned = 0; assigned < n;) {
+    if (heap.count == 0) {
+      while (node_region[seed] != AI_GRAPH_NODE_NONE) {
+        seed++;
+      }
+      check(_ai_graph_heap_push(&heap, 0, seed) == 0,
+            "_ai_graph_arc_flags_partition out of memory");
+    }
+    _ai_graph_heap_entry top = _ai_graph_heap_pop(&heap);
+    if (node_region[top.node] != AI_GRAPH_NODE_NONE) {
+      continue;
+    }
+    node_region[top.node] = region;
+    assigned++;
+    if ((++region_size >= region_size_max) &&
+        (region < (uint32_t)region_count - 1)) {
+      region++;
+      region_size = 0;
+      heap.count = 0;
+      continue;
+    }
+    for (int reverse = 0; reverse < 2; reverse++) {
+      uint32_t *offset = reverse ? graph->reverse_offset : graph->edge_offset;
+      for (uint32_t i = offset[top.node]; i < offset[top.node + 1]; i++) {
+        uint32_t e = reverse ? graph->reverse_edge[i] : i;
+        uint32_t next =
+            reverse ? graph->reverse_source[i] : graph->edge_target[e];
+        if ((node_region[next] == AI_GRAPH_NODE_NONE) &&
+            (graph->edge_cost[e] < INFINITY)) {
+          check(_ai_graph_heap_push(&heap, top.key + graph->edge_cost[e],
+                                    next) == 0,
+                "_ai_graph_arc_flags_partition out of memory");
+        }
+      }
+    }
+  }
+  _ai_graph_heap_free(&heap);
+  return 0;
+error:
+  _ai_graph_heap_free(&heap);
+  return -1;
+}
+
+// Flag the edges on cheapest paths to a boundary node, with dist the cost
+// from every node to it.
+void _ai_graph_arc_flags_boundary(ai_graph_arc_flags *arc_flags,
+                                  ai_graph *graph, uint32_t region,
+                                  const float *dist) {
+  for (uint32_t u = 0; u < graph->node_count; u++) {
+    if (dist[u] == INFINITY) {
+      continue;
+    }
+    float slack = AI_GRAPH_ARC_FLAGS_TOLERANCE * dist[u];
+    for (uint32_t e = graph->edge_offset[u]; e < graph->edge_offset[u + 1];
+         e++) {
+      float via = graph->edge_cost[e] + dist[graph->edge_target[e]];
+      if (via <= dist[u] + slack) {
+        _ai_graph_arc_flags_set(arc_flags, e, region);
+      }
+    }
+  }
+}
+
+// ai_graph_arc_flags *arc_flags = ai_graph_arc_flags_constructor(graph, 32,
+// NULL);
+ai_graph_arc_flags *ai_graph_arc_flags_constructor(ai_graph *graph,
+                                                   int region_count,
+                                                   const uint32_t *node_region) {
+  ai_graph_arc_flags *arc_flags = NULL;
+  float *dist = NULL;
+  check(graph && (region_count >= 1),
+        "ai_graph_arc_flags_constructor no regions");
+  uint32_t n = graph->node_count;
+  arc_flags = (ai_graph_arc_flags *)calloc(1, sizeof(ai_graph_arc_flags));
+  check(arc_flags, "ai_graph_arc_flags_constructor malloc failed");
+  arc_flags->node_count = n;
+  arc_flags->edge_count = graph->edge_count;
+  arc_flags->region_count = region_count;
+  arc_flags->region_words = (region_count + 63) / 64;
+  arc_flags->node_region = (uint32_t *)malloc(sizeof(uint32_t) * (n ? n : 1));
+  arc_flags->flag_list = (uint64_t *)calloc(
+      (size_t)graph->edge_count * arc_flags->region_words + 1,
+      sizeof(uint64_t));
+  dist = (float *)malloc(sizeof(float) * (n ? n : 1));
+  check(arc_flags->node_region && arc_flags->flag_list && dist,
+        "ai_graph_arc_flags_constructor malloc failed");
+  if (node_region) {
+    for (uint32_t v = 0; v < n; v++) {
+      check(node_region[v] < (uint32_t)region_count,
+            "ai_graph_arc_flags_constructor region out of range");
+      arc_flags->node_region[v] = node_region[v];
+    }
+  } else {
+    check(_ai_graph_arc_flags_partition(graph, region_count,
+                                        arc_flags->node_region) == 0,
+          "ai_graph_arc_flags_constructor out of memory");
+  }
+
+  for (uint32_t u = 0; u < n; u++) {
+    uint32_t region = arc_flags->node_region[u];
+    for (uint32_t e = graph->edge_offset[u]; e < graph->edge_offset[u + 1];
+         e++) {
+      if (arc_flags->node_region[graph->edge_target[e]] == region) {
+        _ai_graph_arc_flags_set(arc_flags, e, region);
+      }
+    }
+  }
+  for (uint32_t b = 0; b < n; b++) {
+    uint32_t region = arc_flags->node_region[b];
+    int boundary = 0;
+    for (uint32_t i = graph->reverse_offset[b];
+         i < graph->reverse_offset[b + 1]; i++) {
+      if ((arc_flags->node_region[graph->reverse_source[i]] != region) &&
+          (graph->edge_cost[graph->reverse_edge[i]] < INFINITY)) {
+        boundary = 1;
+        break;
+      }
+    }
+    if (boundary) {
+      check(ai_graph_distances(graph, b, 1, dist) == 0,
+            "ai_graph_arc_flags_constructor out of memory");
+      _ai_graph_arc_flags_boundary(arc_flags, graph, region, dist);
+    }
+  }
+  free(dist);
+  return arc_flags;
+error:
+  free(dist);
+  ai_graph_arc_flags_free(arc_flags);
+  return NULL;
+}
+
+int ai_graph_arc_flags_successor_filter(void *filter_data,
+                                        ai_model_state *model_state,
+                                        ai_successor *successor) {
+  ai_graph_arc_flags *arc_flags = (ai_graph_arc_flags *)filter_data;
+  uint32_t goal = ((ai_graph_state *)model_state->data)->query->goal;
+  ai_graph_action *action_data = (ai_graph_action *)successor->action->data;
+  if (goal >= arc_flags->node_count) {
+    return 1;
+  }
+  return ai_graph_arc_flags_get(arc_flags, action_data->edge,
+                                arc_flags->node_region[goal]);
+}
+
+void ai_graph_arc_flags_free(ai_graph_arc_flags *arc_flags) {
+  if (arc_flags) {
+    free(arc_flags->node_region);
+    free(arc_flags->flag_list);
+    free(arc_flags);
+  }
+}
@@ -0,0 +1,600 @@
+/*
+ * AI - Contraction Hierarchies.
+ *
+ * Node order is chosen lazily. Nodes are held in a heap by priority, the
+ * edge difference (shortcuts added less edges removed) plus the number of
+ * neighbours already contracted. The least is popped, its priority found
+ * again, and it is contracted only if it is still no more than the next.
+ *
+ * A shortcut u->w through v is needed unless a witness path from u to w,
+ * avoiding v, is no dearer. Witness searches are limited in the nodes they
+ * settle, which may add a shortcut that is not needed but never leaves one
+ * out.
+ */
+#include "ai_search_internal.h"
+#include <ai_graph_ch.h>
+#include <logging.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AI_GRAPH_CH_MAGIC "AICH"
+#define AI_GRAPH_CH_VERSION 1
+
+// Most nodes a witness search settles.
+#define AI_GRAPH_CH_WITNESS_SETTLE_MAX 500
+
+// Edges of a node while contracting.
+typedef struct _ai_graph_ch_adjacency_struct {
+  uint32_t *edge_list;
+  uint32_t count;
+  uint32_t size;
+} _ai_graph_ch_adjacency;
+
+// Working state of preprocessing.
+typedef struct _ai_graph_ch_builder_struct {
+  ai_graph_ch *ch;
+  _ai_graph_ch_adjacency *out;
+  _ai_graph_ch_adjacency *in;
+  char *contracted;
+  uint32_t *deleted_neighbours;
+  // Witness search.
+  float *dist;
+  uint32_t *touched;
+  uint32_t touched_count;
+  _ai_graph_heap heap;
+} _ai_graph_ch_builder;
+
+int _ai_graph_ch_adjacency_add(_ai_graph_ch_adjacency *adjacency,
+                               uint32_t edge) {
+  if (adjacency->count == adjacency->size) {
+    uint32_t new_size = adjacency->size ? adjacency->size * 2 : 4;
+    uint32_t *new_list = (uint32_t *)realloc(adjacency->edge_list,
+                                             sizeof(uint32_t) * new_size);
+    check(new_list, "_ai_graph_ch_adjacency_add realloc failed");
+    adjacency->edge_list = new_list;
+    adjacency->size = new_size;
+  }
+  adjacency->edge_list[adjacency->count++] = edge;
+  return 0;
+error:
+  return -1;
+}
+
+// Add an edge. Returns its index, or AI_GRAPH_NODE_NONE if out of memory.
+uint32_t _ai_graph_ch_edge_add(ai_graph_ch *ch, uint32_t source,
+                               uint32_t target, float cost, uint32_t original,
+                               uint32_t child_first, uint32_t child_second) {
+  if (ch->edge_count == ch->edge_size) {
+    uint32_t new_size = ch->edge_size ? ch->edge_size * 2 : 64;
+    uint32_t *new_source = (uint32_t *)realloc(ch->edge_source,
+                                               sizeof(uint32_t) * new_size);
+    check(new_source, "_ai_graph_ch_edge_add realloc failed");
+    ch->edge_source = new_source;
+    uint32_t *new_target = (uint32_t *)realloc(ch->edge_target,
+                                               sizeof(uint32_t) * new_size);
+    check(new_target, "_ai_graph_ch_edge_add realloc failed");
+    ch->edge_target = new_target;
+    float *new_cost = (float *)realloc(ch->edge_cost, sizeof(float) * new_size);
+    check(new_cost, "_ai_graph_ch_edge_add realloc failed");
+    ch->edge_cost = new_cost;
+    uint32_t *new_original = (uint32_t *)realloc(ch->edge_original,
+                                                 sizeof(uint32_t) * new_size);
+    check(new_original, "_ai_graph_ch_edge_add realloc failed");
+    ch->edge_original = new_original;
+    uint32_t *new_child = (uint32_t *)realloc(ch->edge_child,
+                                              sizeof(uint32_t) * 2 * new_size);
+    check(new_child, "_ai_graph_ch_edge_add realloc failed");
+    ch->edge_child = new_child;
+    ch->edge_size = new_size;
+  }
+  uint32_t e = ch->edge_count++;
+  ch->edge_source[e] = source;
+  ch->edge_target[e] = target;
+  ch->edge_cost[e] = cost;
+  ch->edge_original[e] = original;
+  ch->edge_child[2 * e] = child_first;
+  ch->edge_child[2 * e + 1] = child_second;
+  return e;
+error:
+  return AI_GRAPH_NODE_NONE;
+}
+
+// Dijkstra from source over the nodes not yet contracted, avoiding the
+// node being contracted, until cost_max is passed.
+void _ai_graph_ch_witness_search(_ai_graph_ch_builder *builder,
+                                 uint32_t source, uint32_t avoid,
+                                 float cost_max) {
+  ai_graph_ch *ch = builder->ch;
+  for (uint32_t i = 0; i < builder->touched_count; i++) {
+    builder->dist[builder->touched[i]] = INFINITY;
+  }
+  builder->touched_count = 0;
+  builder->heap.count = 0;
+  builder->dist[source] = 0;
+  builder->touched[builder->touched_count++] = source;
+  _ai_graph_heap_push(&builder->heap, 0, source);
+  int settled = 0;
+  while (builder->heap.count && (settled < AI_GRAPH_CH_WITNESS_SETTLE_MAX)) {
+    _ai_graph_heap_entry top = _ai_graph_heap_pop(&builder->heap);
+    if (top.key > builder->dist[top.node]) {
+      continue;
+    }
+    if (top.key > cost_max) {
+      break;
+    }
+    settled++;
+    _ai_graph_ch_adjacency *out = &builder->out[top.node];
+    for (uint32_t i = 0; i < out->count; i++) {
+      uint32_t e = out->edge_list[i];
+      uint32_t next = ch->edge_target[e];
+      if ((next == avoid) || builder->contracted[next]) {
+        continue;
+      }
+      float cost = top.key + ch->edge_cost[e];
+      if (cost < builder->dist[next]) {
+        if (builder->dist[next] == INFINITY) {
+          builder->touched[builder->touched_count++] = next;
+        }
+        builder->dist[next] = cost;
+        _ai_graph_heap_push(&builder->heap, cost, next);
+      }
+    }
+  }
+}
+
+// Find, and if add is true add, the shortcuts needed to contract the node.
+// Returns the number of shortcuts, or -1 if one could not be added.
+int _ai_graph_ch_contract(_ai_graph_ch_builder *builder, uint32_t node,
+                          int add) {
+  ai_graph_ch *ch = builder->ch;
+  _ai_graph_ch_adjacency *in = &builder->in[node];
+  _ai_graph_ch_adjacency *out = &builder->out[node];
+  int shortcut_count = 0;
+  float out_cost_max = 0;
+  for (uint32_t j = 0; j < out->count; j++) {
+    uint32_t e = out->edge_list[j];
+    if (!builder->contracted[ch->edge_target[e]] &&
+        (ch->edge_cost[e] > out_cost_max)) {
+      out_cost_max = ch->edge_cost[e];
+    }
+  }
+  for (uint32_t i = 0; i < in->count; i++) {
+    uint32_t e_in = in->edge_list[i];
+    uint32_t u = ch->edge_source[e_in];
+    if (builder->contracted[u]) {
+      continue;
+    }
+    float cost_in = ch->edge_cost[e_in];
+    _ai_graph_ch_witness_search(builder, u, node, cost_in + out_cost_max);
+    for (uint32_t j = 0; j < out->count; j++) {
+      uint32_t e_out = out->edge_list[j];
+      uint32_t w = ch->edge_target[e_out];
+      if ((w == u) || builder->contracted[w]) {
+        continue;
+      }
+      float cost = cost_in + ch->edge_cost[e_out];
+      if (builder->dist[w] <= cost) {
+        continue;
+      }
+      shortcut_count++;
+      if (add) {
+        uint32_t e = _ai_graph_ch_edge_add(ch, u, w, cost, AI_GRAPH_NODE_NONE,
+                                           e_in, e_out);
+        check((e != AI_GRAPH_NODE_NONE) &&
+                  (_ai_graph_ch_adjacency_add(&builder->out[u], e) == 0) &&
+                  (_ai_graph_ch_adjacency_add(&builder->in[w], e) == 0),
+              "_ai_graph_ch_contract out of memory");
+        ch->shortcut_count++;
+      }
+    }
+  }
+  return shortcut_count;
+error:
+  return -1;
+}
+
+int _ai_graph_ch_live_edge_count(_ai_graph_ch_builder *builder,
+                                 _ai_graph_ch_adjacency *adjacency,
+                                 uint32_t *end) {
+  int count = 0;
+  for (uint32_t i = 0; i < adjacency->count; i++) {
+    if (!builder->contracted[end[adjacency->edge_list[i]]]) {
+      count++;
+    }
+  }
+  return count;
+}
+
+float _ai_graph_ch_priority(_ai_graph_ch_builder *builder, uint32_t node) {
+  ai_graph_ch *ch = builder->ch;
+  int removed = _ai_graph_ch_live_edge_count(builder, &builder->in[node],
+                                             ch->edge_source) +
+                _ai_graph_ch_live_edge_count(builder, &builder->out[node],
+                                             ch->edge_target);
+  return (float)(_ai_graph_ch_contract(builder, node, 0) - removed +
+                 (int)builder->deleted_neighbours[node]);
+}
+
+// Build the upward and downward edge indexes, and the query arrays.
+int _ai_graph_ch_index(ai_graph_ch *ch) {
+  uint32_t n = ch->node_count;
+  ch->up_offset = (uint32_t *)calloc(n + 1, sizeof(uint32_t));
+  ch->down_offset = (uint32_t *)calloc(n + 1, sizeof(uint32_t));
+  ch->up_edge = (uint32_t *)malloc(sizeof(uint32_t) * (ch->edge_count + 1));
+  ch->down_edge = (uint32_t *)malloc(sizeof(uint32_t) * (ch->edge_count + 1));
+  check(ch->up_offset && ch->down_offset && ch->up_edge && ch->down_edge,
+        "_ai_graph_ch_index malloc failed");
+  for (uint32_t e = 0; e < ch->edge_count; e++) {
+    uint32_t source = ch->edge_source[e];
+    uint32_t target = ch->edge_target[e];
+    if (ch->rank[source] < ch->rank[target]) {
+      ch->up_offset[source + 1]++;
+    } else {
+      ch->down_offset[target + 1]++;
+    }
+  }
+  for (uint32_t v = 0; v < n; v++) {
+    ch->up_offset[v + 1] += ch->up_offset[v];
+    ch->down_offset[v + 1] += ch->down_offset[v];
+  }
+  for (uint32_t e = 0; e < ch->edge_count; e++) {
+    uint32_t source = ch->edge_source[e];
+    uint32_t target = ch->edge_target[e];
+    if (ch->rank[source] < ch->rank[target]) {
+      ch->up_edge[ch->up_offset[source]++] = e;
+    } else {
+      ch->down_edge[ch->down_offset[target]++] = e;
+    }
+  }
+  for (uint32_t v = n; v > 0; v--) {
+    ch->up_offset[v] = ch->up_offset[v - 1];
+    ch->down_offset[v] = ch->down_offset[v - 1];
+  }
+  ch->up_offset[0] = 0;
+  ch->down_offset[0] = 0;
+
+  for (int d = 0; d < 2; d++) {
+    ch->dist[d] = (float *)malloc(sizeof(float) * (n + 1));
+    ch->parent[d] = (uint32_t *)malloc(sizeof(uint32_t) * (n + 1));
+    ch->touched[d] = (uint32_t *)malloc(sizeof(uint32_t) * (n + 1));
+    check(ch->dist[d] && ch->parent[d] && ch->touched[d],
+          "_ai_graph_ch_index malloc failed");
+    for (uint32_t v = 0; v < n; v++) {
+      ch->dist[d][v] = INFINITY;
+    }
+    ch->touched_count[d] = 0;
+  }
+  return 0;
+error:
+  return -1;
+}
+
+ai_graph_ch *_ai_graph_ch_alloc(uint32_t node_count) {
+  ai_graph_ch *ch = (ai_graph_ch *)calloc(1, sizeof(ai_graph_ch));
+  check(ch, "_ai_graph_ch_alloc malloc failed");
+  ch->node_count = node_count;
+  ch->path_cost = INFINITY;
+  ch->status = AI_SEARCH_STATUS_IDLE;
+  ch->rank = (uint32_t *)malloc(sizeof(uint32_t) * (node_count + 1));
+  check(ch->rank, "_ai_graph_ch_alloc malloc failed");
+  return ch;
+error:
+  ai_graph_ch_free(ch);
+  return NULL;
+}
+
+// ai_graph_ch *ch = ai_graph_ch_constructor(graph);
+ai_graph_ch *ai_graph_ch_constructor(ai_graph *graph) {
+  uint32_t n = graph->node_count;
+  _ai_graph_ch_builder builder;
+  memset(&builder, 0, sizeof(builder));
+  _ai_graph_heap order = {NULL, 0, 0};
+  ai_graph_ch *ch = _ai_graph_ch_alloc(n);
+  check(ch, "ai_graph_ch_constructor malloc failed");
+  builder.ch = ch;
+  builder.out = (_ai_graph_ch_adjacency *)calloc(n + 1,
+                                                 sizeof(_ai_graph_ch_adjacency));
+  builder.in = (_ai_graph_ch_adjacency *)calloc(n + 1,
+                                                sizeof(_ai_graph_ch_adjacency));
+  builder.contracted = (char *)calloc(n + 1, sizeof(char));
+  builder.deleted_neighbours = (uint32_t *)calloc(n + 1, sizeof(uint32_t));
+  builder.dist = (float *)malloc(sizeof(float) * (n + 1));
+  builder.touched = (uint32_t *)malloc(sizeof(uint32_t) * (n + 1));
+  check(builder.out && builder.in && builder.contracted &&
+            builder.deleted_neighbours && builder.dist && builder.touched,
+        "ai_graph_ch_constructor malloc failed");
+  for (uint32_t v = 0; v < n; v++) {
+    builder.dist[v] = INFINITY;
+  }
+
+  for (uint32_t u = 0; u < n; u++) {
+    for (uint32_t e = graph->edge_offset[u]; e < graph->edge_offset[u + 1];
+         e++) {
+      uint32_t w = graph->edge_target[e];
+      if ((w == u) || (graph->edge_cost[e] == INFINITY)) {
+        continue;
+      }
+      uint32_t ch_e = _ai_graph_ch_edge_add(ch, u, w, graph->edge_cost[e], e,
+                                            AI_GRAPH_NODE_NONE,
+                                            AI_GRAPH_NODE_NONE);
+      check((ch_e != AI_GRAPH_NODE_NONE) &&
+                (_ai_graph_ch_adjacency_add(&builder.out[u], ch_e) == 0) &&
+                (_ai_graph_ch_adjacency_add(&builder.in[w], ch_e) == 0),
+            "ai_graph_ch_constructor out of memory");
+    }
+  }
+
+  // Contract in order of priority, found again lazily.
+  for (uint32_t v = 0; v < n; v++) {
+    _ai_graph_heap_push(&order, _ai_graph_ch_priority(&builder, v), v);
+  }
+  uint32_t rank = 0;
+  while (order.count) {
+    _ai_graph_heap_entry top = _ai_graph_heap_pop(&order);
+    float priority = _ai_graph_ch_priority(&builder, top.node);
+    if (order.count && (priority > order.entry_list[0].key)) {
+      _ai_graph_heap_push(&order, priority, top.node);
+      continue;
+    }
+    check(_ai_graph_ch_contract(&builder, top.node, 1) >= 0,
+          "ai_graph_ch_constructor shortcut failed");
+    builder.contracted[top.node] = 1;
+    ch->rank[top.node] = rank++;
+    _ai_graph_ch_adjacency *in = &builder.in[top.node];
+    _ai_graph_ch_adjacency *out = &builder.out[top.node];
+    for (uint32_t i = 0; i < in->count; i++) {
+      builder.deleted_neighbours[ch->edge_source[in->edge_list[i]]]++;
+    }
+    for (uint32_t i = 0; i < out->count; i++) {
+      builder.deleted_neighbours[ch->edge_target[out->edge_list[i]]]++;
+    }
+  }
+  check(_ai_graph_ch_index(ch) == 0, "ai_graph_ch_constructor index failed");
+  goto done;
+error:
+  ai_graph_ch_free(ch);
+  ch = NULL;
+done:
+  for (uint32_t v = 0; builder.out && builder.in && (v < n); v++) {
+    free(builder.out[v].edge_list);
+    free(builder.in[v].edge_list);
+  }
+  free(builder.out);
+  free(builder.in);
+  free(builder.contracted);
+  free(builder.deleted_neighbours);
+  free(builder.dist);
+  free(builder.touched);
+  _ai_graph_heap_free(&builder.heap);
+  _ai_graph_heap_free(&order);
+  return ch;
+}
+
+// Queries.
+
+// Bidirectional upward search. Returns the node where the cheapest path
+// meets, or AI_GRAPH_NODE_NONE.
+uint32_t _ai_graph_ch_search(ai_graph_ch *ch, uint32_t source,
+                             uint32_t target) {
+  _ai_graph_heap heap[2] = {{NULL, 0, 0}, {NULL, 0, 0}};
+  uint32_t meet = AI_GRAPH_NODE_NONE;
+  float best = INFINITY;
+  ch->fringe_expansion_count = 0;
+  for (int d = 0; d < 2; d++) {
+    for (uint32_t i = 0; i < ch->touched_count[d]; i++) {
+      ch->dist[d][ch->touched[d][i]] = INFINITY;
+    }
+    ch->touched_count[d] = 0;
+    uint32_t node = d ? target : source;
+    ch->dist[d][node] = 0;
+    ch->parent[d][node] = AI_GRAPH_NODE_NONE;
+    ch->touched[d][ch->touched_count[d]++] = node;
+    check(_ai_graph_heap_push(&heap[d], 0, node) == 0,
+          "_ai_graph_ch_search out of memory");
+  }
+  for (;;) {
+    // Step the direction with the lesser key, while it can still improve.
+    int d = -1;
+    for (int i = 0; i < 2; i++) {
+      if (heap[i].count && (heap[i].entry_list[0].key < best) &&
+          ((d < 0) ||
+           (heap[i].entry_list[0].key < heap[d].entry_list[0].key))) {
+        d = i;
+      }
+    }
+    if (d < 0) {
+      break;
+    }
+    _ai_graph_heap_entry top = _ai_graph_heap_pop(&heap[d]);
+    float *dist = ch->dist[d];
+    if (top.key > dist[top.node]) {
+      continue;
+    }
+    ch->fringe_expansion_count++;
+    float through = top.key + ch->dist[!d][top.node];
+    if (through < best) {
+      best = through;
+      meet = top.node;
+    }
+    uint32_t *offset = d ? ch->down_offset : ch->up_offset;
+    uint32_t *edge = d ? ch->down_edge : ch->up_edge;
+    for (uint32_t i = offset[top.node]; i < offset[top.node + 1]; i++) {
+      uint32_t e = edge[i];
+      uint32_t next = d ? ch->edge_source[e] : ch->edge_target[e];
+      float cost = top.key + ch->edge_cost[e];
+      if (cost < dist[next]) {
+        if (dist[next] == INFINITY) {
+          ch->touched[d][ch->touched_count[d]++] = next;
+        }
+        dist[next] = cost;
+        ch->parent[d][next] = e;
+        check(_ai_graph_heap_push(&heap[d], cost, next) == 0,
+              "_ai_graph_ch_search out of memory");
+      }
+    }
+  }
+  ch->path_cost = best;
+  _ai_graph_heap_free(&heap[0]);
+  _ai_graph_heap_free(&heap[1]);
+  return meet;
+error:
+  ch->path_cost = INFINITY;
+  _ai_graph_heap_free(&heap[0]);
+  _ai_graph_heap_free(&heap[1]);
+  return AI_GRAPH_NODE_NONE;
+}
+
+// Append the original edges of an edge, unpacking shortcuts.
+void _ai_graph_ch_unpack(ai_graph_ch *ch, uint32_t e, ai_path **path,
+                         ai_action **last) {
+  if (ch->edge_original[e] == AI_GRAPH_NODE_NONE) {
+    _ai_graph_ch_unpack(ch, ch->edge_child[2 * e], path, last);
+    _ai_graph_ch_unpack(ch, ch->edge_child[2 * e + 1], path, last);
+    return;
+  }
+  ai_action *action = ai_action_constructor(ai_graph_action_data_constructor(
+      ch->edge_original[e], ch->edge_target[e]));
+  if (*last) {
+    (*last)->next = action;
+  } else {
+    *path = action;
+  }
+  *last = action;
+}
+
+// float cost = ai_graph_ch_distance(ch, from, to);
+float ai_graph_ch_distance(ai_graph_ch *ch, uint32_t source, uint32_t target) {
+  uint32_t meet = _ai_graph_ch_search(ch, source, target);
+  ch->status = (meet == AI_GRAPH_NODE_NONE) ? AI_SEARCH_STATUS_NOT_FOUND
+                                            : AI_SEARCH_STATUS_FOUND;
+  return ch->path_cost;
+}
+
+// ai_path *path = ai_graph_ch_find_path(ch, from, to);
+ai_path *ai_graph_ch_find_path(ai_graph_ch *ch, uint32_t source,
+                               uint32_t target) {
+  ai_path *path = NULL;
+  ai_action *last = NULL;
+  uint32_t meet = _ai_graph_ch_search(ch, source, target);
+  if (meet == AI_GRAPH_NODE_NONE) {
+    ch->status = AI_SEARCH_STATUS_NOT_FOUND;
+    return NULL;
+  }
+  // The upward edges from the source to the meeting node, in order.
+  uint32_t depth = 0;
+  for (uint32_t v = meet; ch->parent[0][v] != AI_GRAPH_NODE_NONE;
+       v = ch->edge_source[ch->parent[0][v]]) {
+    depth++;
+  }
+  uint32_t *up_list = (uint32_t *)malloc(sizeof(uint32_t) * (depth + 1));
+  check(up_list, "ai_graph_ch_find_path malloc failed");
+  uint32_t i = depth;
+  for (uint32_t v = meet; ch->parent[0][v] != AI_GRAPH_NODE_NONE;
+       v = ch->edge_source[ch->parent[0][v]]) {
+    up_list[--i] = ch->parent[0][v];
+  }
+  for (i = 0; i < depth; i++) {
+    _ai_graph_ch_unpack(ch, up_list[i], &path, &last);
+  }
+  free(up_list);
+  // Then down from the meeting node to the target.
+  for (uint32_t v = meet; ch->parent[1][v] != AI_GRAPH_NODE_NONE;
+       v = ch->edge_target[ch->parent[1][v]]) {
+    _ai_graph_ch_unpack(ch, ch->parent[1][v], &path, &last);
+  }
+  ch->status = AI_SEARCH_STATUS_FOUND;
+  return path;
+error:
+  ch->status = AI_SEARCH_STATUS_NOT_FOUND;
+  return NULL;
+}
+
+// Saving and loading.
+
+// ai_graph_ch_save(ch, file);
+int ai_graph_ch_save(ai_graph_ch *ch, FILE *file) {
+  uint32_t header[4] = {AI_GRAPH_CH_VERSION, ch->node_count, ch->edge_count,
+                        ch->shortcut_count};
+  size_t n = ch->node_count;
+  size_t m = ch->edge_count;
+  check((fwrite(AI_GRAPH_CH_MAGIC, 1, 4, file) == 4) &&
+            (fwrite(header, sizeof(uint32_t), 4, file) == 4) &&
+            (fwrite(ch->rank, sizeof(uint32_t), n, file) == n) &&
+            (fwrite(ch->edge_source, sizeof(uint32_t), m, file) == m) &&
+            (fwrite(ch->edge_target, sizeof(uint32_t), m, file) == m) &&
+            (fwrite(ch->edge_cost, sizeof(float), m, file) == m) &&
+            (fwrite(ch->edge_original, sizeof(uint32_t), m, file) == m) &&
+            (fwrite(ch->edge_child, sizeof(uint32_t), 2 * m, file) == 2 * m),
+        "ai_graph_ch_save write failed");
+  return 0;
+error:
+  return -1;
+}
+
+// ai_graph_ch *ch = ai_graph_ch_load(file);
+ai_graph_ch *ai_graph_ch_load(FILE *file) {
+  ai_graph_ch *ch = NULL;
+  char magic[4];
+  uint32_t header[4];
+  check((fread(magic, 1, 4, file) == 4) &&
+            (memcmp(magic, AI_GRAPH_CH_MAGIC, 4) == 0) &&
+            (fread(header, sizeof(uint32_t), 4, file) == 4) &&
+            (header[0] == AI_GRAPH_CH_VERSION),
+        "ai_graph_ch_load not a saved hierarchy");
+  size_t n = header[1];
+  size_t m = header[2];
+  ch = _ai_graph_ch_alloc(header[1]);
+  check(ch, "ai_graph_ch_load malloc failed");
+  ch->edge_count = header[2];
+  ch->edge_size = header[2];
+  ch->shortcut_count = header[3];
+  ch->edge_source = (uint32_t *)malloc(sizeof(uint32_t) * (m + 1));
+  ch->edge_target = (uint32_t *)malloc(sizeof(uint32_t) * (m + 1));
+  ch->edge_cost = (float *)malloc(sizeof(float) * (m + 1));
+  ch->edge_original = (uint32_t *)malloc(sizeof(uint32_t) * (m + 1));
+  ch->edge_child = (uint32_t *)malloc(sizeof(uint32_t) * 2 * (m + 1));
+  check(ch->edge_source && ch->edge_target && ch->edge_cost &&
+            ch->edge_original && ch->edge_child,
+        "ai_graph_ch_load malloc failed");
+  check((fread(ch->rank, sizeof(uint32_t), n, file) == n) &&
+            (fread(ch->edge_source, sizeof(uint32_t), m, file) == m) &&
+            (fread(ch->edge_target, sizeof(uint32_t), m, file) == m) &&
+            (fread(ch->edge_cost, sizeof(float), m, file) == m) &&
+            (fread(ch->edge_original, sizeof(uint32_t), m, file) == m) &&
+            (fread(ch->edge_child, sizeof(uint32_t), 2 * m, file) == 2 * m),
+        "ai_graph_ch_load file truncated");
+  // A shortcut is always added after the edges it replaces.
+  for (size_t e = 0; e < m; e++) {
+    check((ch->edge_source[e] < n) && (ch->edge_target[e] < n) &&
+              ((ch->edge_original[e] != AI_GRAPH_NODE_NONE) ||
+               ((ch->edge_child[2 * e] < e) && (ch->edge_child[2 * e + 1] < e))),
+          "ai_graph_ch_load edge out of range");
+  }
+  check(_ai_graph_ch_index(ch) == 0, "ai_graph_ch_load index failed");
+  return ch;
+error:
+  ai_graph_ch_free(ch);
+  return NULL;
+}
+
+void ai_graph_ch_free(ai_graph_ch *ch) {
+  if (ch) {
+    free(ch->rank);
+    free(ch->edge_source);
+    free(ch->edge_target);
+    free(ch->edge_cost);
+    free(ch->edge_original);
+    free(ch->edge_child);
+    free(ch->up_offset);
+    free(ch->up_edge);
+    free(ch->down_offset);
+    free(ch->down_edge);
+    for (int d = 0; d < 2; d++) {
+      free(ch->dist[d]);
+      free(ch->parent[d]);
+      free(ch->touched[d]);
+    }
+    free(ch);
+  }
+}
@@ -0,0 +1,332 @@
+/*
+ * AI - Hub Labels, by Pruned Landmark Labeling.
+ *
+ * Labels grow in hub order while preprocessing, so each stays sorted by hub
+ * rank without sorting. The search from a hub stops at any node whose
+ * distance the earlier, more central hubs already give, which is what
+ * keeps labels short: most nodes are reached through the first few hubs.
+ */
+#include "ai_search_internal.h"
+#include <ai_graph_hub_labels.h>
+#include <logging.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A label while preprocessing.
+typedef struct _ai_graph_hub_label_struct {
+  uint32_t *hub_list;
+  float *cost_list;
+  uint32_t count;
+  uint32_t size;
+} _ai_graph_hub_label;
+
+typedef struct _ai_graph_hub_order_struct {
+  uint32_t degree;
+  uint32_t node;
+} _ai_graph_hub_order;
+
+int _ai_graph_hub_order_compare(const void *a, const void *b) {
+  const _ai_graph_hub_order *order_a = (const _ai_graph_hub_order *)a;
+  const _ai_graph_hub_order *order_b = (const _ai_graph_hub_order *)b;
+  if (order_a->degree != order_b->degree) {
+    return order_a->degree > order_b->degree ? -1 : 1;
+  }
+  return order_a->node < order_b->node ? -1 : (order_a->node > order_b->node);
+}
+
+int _ai_graph_hub_label_add(_ai_graph_hub_label *label, uint32_t hub,
+                            float cost) {
+  if (label->count == label->size) {
+    uint32_t size = label->size ? label->size * 2 : 4;
+    uint32_t *hub_list =
+        (uint32_t *)realloc(label->hub_list, sizeof(uint32_t) * size);
+    check(hub_list, "_ai_graph_hub_label_add malloc failed");
+    label->hub_list = hub_list;
+    float *cost_list = (float *)realloc(label->cost_list, sizeof(float) * size);
+    check(cost_list, "_ai_graph_hub_label_add malloc failed");
+    label->cost_list = cost_list;
+    label->size = size;
+  }
+  label->hub_list[label->count] = hub;
+  label->cost_list[label->count] = cost;
+  label->count++;
+  return 0;
+error:
+  return -1;
+}
+
+/*
+ * Pruned Dijkstra from the node of hub rank, forward to fill in labels,
+ * or backward to fill out labels. root_cost, by hub rank, and dist, by
+ * node, are INFINITY throughout on entry and are left so.
+ */
+int _ai_graph_hub_labels_search(ai_graph *graph, uint32_t rank, uint32_t root,
+                                int reverse, _ai_graph_hub_label *in_label,
+                                _ai_graph_hub_label *out_label,
+                                float *root_cost, float *dist,
+                                uint32_t *touched) {
+  _ai_graph_heap heap = {NULL, 0, 0};
+  _ai_graph_hub_label *root_label = reverse ? &in_label[root] : &out_label[root];
+  _ai_graph_hub_label *node_label = reverse ? out_label : in_label;
+  uint32_t *offset = reverse ? graph->reverse_offset : graph->edge_offset;
+  uint32_t touched_count = 0;
+  int rc = -1;
+  for (uint32_t i = 0; i < root_label->count; i++) {
+    root_cost[root_label->hub_list[i]] = root_label->cost_list[i];
+  }
+  dist[root] = 0;
+  touched[touched_count++] = root;
+  check(_ai_graph_heap_push(&heap, 0, root) == 0,
+        "_ai_graph_hub_labels_search out of memory");
+  while (heap.count) {
+    _ai_graph_heap_entry top = _ai_graph_heap_pop(&heap);
+    if (top.key > dist[top.node]) {
+      continue;
+    }
+    _ai_graph_hub_label *label = &node_label[top.node];
+    int pruned = 0;
+    for (uint32_t i = 0; i < label->count; i++) {
+      if (root_cost[label->hub_list[i]] + label->cost_list[i] <= top.key) {
+        pruned = 1;
+        break;
+      }
+    }
+    if (pruned) {
+      continue;
+    }
+    check(_ai_graph_hub_label_add(label, rank, top.key) == 0,
+          "_ai_graph_hub_labels_search out of memory");
+    for (uint32_t i = offset[top.node]; i < offset[top.node + 1]; i++) {
+      uint32_t e = reverse ? graph->reverse_edge[i] : i;
+      uint32_t next = reverse ? graph->reverse_source[i] : graph->edge_target[e];
+      float cost = top.key + graph->edge_cost[e];
+      if (cost < dist[next]) {
+        if (dist[next] == INFINITY) {
+          touched[touched_count++] = next;
+        }
+        dist[next] = cost;
+        check(_ai_graph_heap_push(&heap, cost, next) == 0,
+              "_ai_graph_hub_labels_search out of memory");
+      }
+    }
+  }
+  rc = 0;
+error:
+  for (uint32_t i = 0; i < touched_count; i++) {
+    dist[touched[i]] = INFINITY;
+  }
+  for (uint32_t i = 0; i < root_label->count; i++) {
+    root_cost[root_label->hub_list[i]] = INFINITY;
+  }
+  _ai_graph_heap_free(&heap);
+  return rc;
+}
+
+// Copy the labels into the compact arrays.
+int _ai_graph_hub_labels_compact(uint32_t node_count,
+                                 _ai_graph_hub_label *label_list,
+                                 uint32_t **offset, uint32_t **hub_list,
+                                 float **cost_list) {
+  size_t total = 0;
+  for (uint32_t v = 0; v < node_count; v++) {
+    total += label_list[v].count;
+  }
+  *offset = (uint32_t *)malloc(sizeof(uint32_t) * (node_count + 1));
+  *hub_list = (uint32_t *)malloc(sizeof(uint32_t) * (total ? total : 1));
+  *cost_list = (float *)malloc(sizeof(float) * (total ? total : 1));
+  check(*offset && *hub_list && *cost_list,
+        "_ai_graph_hub_labels_compact malloc failed");
+  uint32_t at = 0;
+  for (uint32_t v = 0; v < node_count; v++) {
+    (*offset)[v] = at;
+    memcpy(&(*hub_list)[at], label_list[v].hub_list,
+           sizeof(uint32_t) * label_list[v].count);
+    memcpy(&(*cost_list)[at], label_list[v].cost_list,
+           sizeof(float) * label_list[v].count);
+    at += label_list[v].count;
+  }
+  (*offset)[node_count] = at;
+  return 0;
+error:
+  return -1;
+}
+
+// ai_graph_hub_labels *labels = ai_graph_hub_labels_constructor(graph);
+ai_graph_hub_labels *ai_graph_hub_labels_constructor(ai_graph *graph) {
+  ai_graph_hub_labels *labels = NULL;
+  _ai_graph_hub_label *in_label = NULL;
+  _ai_graph_hub_label *out_label = NULL;
+  _ai_graph_hub_order *order = NULL;
+  float *root_cost = NULL;
+  float *dist = NULL;
+  uint32_t *touched = NULL;
+  uint32_t n = 0;
+  check(graph, "ai_graph_hub_labels_constructor no graph");
+  n = graph->node_count;
+  labels = (ai_graph_hub_labels *)calloc(1, sizeof(ai_graph_hub_labels));
+  check(labels, "ai_graph_hub_labels_constructor malloc failed");
+  labels->graph = graph;
+  labels->node_count = n;
+  labels->status = AI_SEARCH_STATUS_IDLE;
+  size_t size = n ? n : 1;
+  labels->hub_node = (uint32_t *)malloc(sizeof(uint32_t) * size);
+  in_label = (_ai_graph_hub_label *)calloc(size, sizeof(_ai_graph_hub_label));
+  out_label = (_ai_graph_hub_label *)calloc(size, sizeof(_ai_graph_hub_label));
+  order = (_ai_graph_hub_order *)malloc(sizeof(_ai_graph_hub_order) * size);
+  root_cost = (float *)malloc(sizeof(float) * size);
+  dist = (float *)malloc(sizeof(float) * size);
+  touched = (uint32_t *)malloc(sizeof(uint32_t) * size);
+  check(labels->hub_node && in_label && out_label && order && root_cost &&
+            dist && touched,
+        "ai_graph_hub_labels_constructor malloc failed");
+
+  for (uint32_t v = 0; v < n; v++) {
+    order[v].node = v;
+    order[v].degree = 0;
+    root_cost[v] = INFINITY;
+    dist[v] = INFINITY;
+  }
+  for (uint32_t u = 0; u < n; u++) {
+    for (uint32_t e = graph->edge_offset[u]; e < graph->edge_offset[u + 1];
+         e++) {
+      if (graph->edge_cost[e] < INFINITY) {
+        order[u].degree++;
+        order[graph->edge_target[e]].degree++;
+      }
+    }
+  }
+  qsort(order, n, sizeof(_ai_graph_hub_order), _ai_graph_hub_order_compare);
+  for (uint32_t rank = 0; rank < n; rank++) {
+    uint32_t root = order[rank].node;
+    labels->hub_node[rank] = root;
+    for (int reverse = 0; reverse < 2; reverse++) {
+      check(_ai_graph_hub_labels_search(graph, rank, root, reverse, in_label,
+                                        out_label, root_cost, dist,
+                                        touched) == 0,
+            "ai_graph_hub_labels_constructor out of memory");
+    }
+  }
+  check(_ai_graph_hub_labels_compact(n, out_label, &labels->out_offset,
+                                     &labels->out_hub,
+                                     &labels->out_cost) == 0 &&
+            _ai_graph_hub_labels_compact(n, in_label, &labels->in_offset,
+                                         &labels->in_hub,
+                                         &labels->in_cost) == 0,
+        "ai_graph_hub_labels_constructor out of memory");
+  goto done;
+error:
+  ai_graph_hub_labels_free(labels);
+  labels = NULL;
+done:
+  for (uint32_t v = 0; in_label && out_label && (v < n); v++) {
+    free(in_label[v].hub_list);
+    free(in_label[v].cost_list);
+    free(out_label[v].hub_list);
+    free(out_label[v].cost_list);
+  }
+  free(in_label);
+  free(out_label);
+  free(order);
+  free(root_cost);
+  free(dist);
+  free(touched);
+  return labels;
+}
+
+// float cost = ai_graph_hub_labels_distance(labels, from, to);
+float ai_graph_hub_labels_distance(ai_graph_hub_labels *labels,
+                                   uint32_t source, uint32_t target) {
+  uint32_t i = labels->out_offset[source];
+  uint32_t i_end = labels->out_offset[source + 1];
+  uint32_t j = labels->in_offset[target];
+  uint32_t j_end = labels->in_offset[target + 1];
+  float best = INFINITY;
+  while ((i < i_end) && (j < j_end)) {
+    uint32_t hub_i = labels->out_hub[i];
+    uint32_t hub_j = labels->in_hub[j];
+    if (hub_i == hub_j) {
+      float cost = labels->out_cost[i] + labels->in_cost[j];
+      if (cost < best) {
+        best = cost;
+      }
+      i++;
+      j++;
+    } else if (hub_i < hub_j) {
+      i++;
+    } else {
+      j++;
+    }
+  }
+  return best;
+}
+
+// ai_path *path = ai_graph_hub_labels_find_path(labels, from, to);
+ai_path *ai_graph_hub_labels_find_path(ai_graph_hub_labels *labels,
+                                       uint32_t source, uint32_t target) {
+  ai_graph *graph = labels->graph;
+  ai_path *path = NULL;
+  ai_action *last = NULL;
+  labels->path_cost = ai_graph_hub_labels_distance(labels, source, target);
+  if (labels->path_cost == INFINITY) {
+    labels->status = AI_SEARCH_STATUS_NOT_FOUND;
+    return NULL;
+  }
+  // Each step is one edge of a cheapest path, so there are fewer steps than
+  // nodes. The bound only guards a graph with zero cost cycles.
+  uint32_t step_count = 0;
+  for (uint32_t node = source; node != target; step_count++) {
+    check(step_count < labels->node_count,
+          "ai_graph_hub_labels_find_path no progress");
+    uint32_t best_edge = AI_GRAPH_NODE_NONE;
+    float best = INFINITY;
+    for (uint32_t e = graph->edge_offset[node]; e < graph->edge_offset[node + 1];
+         e++) {
+      if (graph->edge_cost[e] == INFINITY) {
+        continue;
+      }
+      float cost = graph->edge_cost[e] +
+                   ai_graph_hub_labels_distance(labels, graph->edge_target[e],
+                                                target);
+      if (cost < best) {
+        best = cost;
+        best_edge = e;
+      }
+    }
+    check(best_edge != AI_GRAPH_NODE_NONE,
+          "ai_graph_hub_labels_find_path no edge");
+    node = graph->edge_target[best_edge];
+    ai_action *action =
+        ai_action_constructor(ai_graph_action_data_constructor(best_edge, node));
+    if (last) {
+      last->next = action;
+    } else {
+      path = action;
+    }
+    last = action;
+  }
+  labels->status = AI_SEARCH_STATUS_FOUND;
+  return path;
+error:
+  _ai_path_free(path, ai_graph_action_data_free);
+  labels->status = AI_SEARCH_STATUS_NOT_FOUND;
+  return NULL;
+}
+
+size_t ai_graph_hub_labels_size(ai_graph_hub_labels *labels) {
+  return (size_t)labels->out_offset[labels->node_count] +
+         labels->in_offset[labels->node_count];
+}
+
+void ai_graph_hub_labels_free(ai_graph_hub_labels *labels) {
+  if (labels) {
+    free(labels->hub_node);
+    free(labels->out_offset);
+    free(labels->out_hub);
+    free(labels->out_cost);
+    free(labels->in_offset);
+    free(labels->in_hub);
+    free(labels->in_cost);
+    free(labels);
+  }
+}
@@ -0,0 +1,222 @@
+/*
+ * AI - Grid.
+ *
+ * The occupancy grid, and a Model State evaluator for searching it.
+ */
+#include <ai_grid.h>
+#include <logging.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ai_grid *grid = ai_grid_constructor(width, height);
+ai_grid *ai_grid_constructor(int width, int height) {
+  ai_grid *grid = NULL;
+  check((width > 0) && (height > 0), "ai_grid_constructor empty grid");
+  grid = (ai_grid *)malloc(sizeof(ai_grid));
+  check(grid, "ai_grid_constructor malloc failed");
+  grid->width = width;
+  grid->height = height;
+  grid->row_words = (width + 63) / 64;
+  grid->blocked =
+      (uint64_t *)calloc((size_t)grid->row_words * height, sizeof(uint64_t));
+  check(grid->blocked, "ai_grid_constructor malloc failed");
+  return grid;
+error:
+  ai_grid_free(grid);
+  return NULL;
+}
+
+void ai_grid_blocked_set(ai_grid *grid, int x, int y, int blocked) {
+  if ((x < 0) || (y < 0) || (x >= grid->width) || (y >= grid->height)) {
+    return;
+  }
+  uint64_t *word = &grid->blocked[y * grid->row_words + (x >> 6)];
+  uint64_t bit = (uint64_t)1 << (x & 63);
+  if (blocked) {
+    *word |= bit;
+  } else {
+    *word &= ~bit;
+  }
+}
+
+float ai_grid_octile_distance(int x0, int y0, int x1, int y1) {
+  int dx = abs(x1 - x0);
+  int dy = abs(y1 - y0);
+  int diagonal = dx < dy ? dx : dy;
+  int straight = (dx > dy ? dx : dy) - diagonal;
+  return straight + diagonal * AI_GRID_DIAGONAL_COST;
+}
+
+float ai_grid_move_cost(int x0, int y0, int x1, int y1) {
+  return ((x0 != x1) && (y0 != y1)) ? AI_GRID_DIAGONAL_COST : 1.f;
+}
+
+void ai_grid_query_init(ai_grid_query *query, ai_grid *grid, int goal_x,
+                        int goal_y) {
+  query->grid = grid;
+  query->goal_x = goal_x;
+  query->goal_y = goal_y;
+  query->min_x = 0;
+  query->min_y = 0;
+  query->max_x = grid->width;
+  query->max_y = grid->height;
+}
+
+// ai_model_state *model_state = ai_grid_model_state_constructor(&query, x, y);
+ai_model_state *ai_grid_model_state_constructor(ai_grid_query *query, int x,
+                                                int y) {
+  ai_grid_state *data = (ai_grid_state *)malloc(sizeof(ai_grid_state));
+  check(data, "ai_grid_model_state_constructor malloc failed");
+  data->query = query;
+  data->x = x;
+  data->y = y;
+  return ai_model_state_constructor(data);
+error:
+  return NULL;
+}
+
+void ai_grid_data_free(void *data) { free(data); }
+
+void ai_grid_free(ai_grid *grid) {
+  if (grid) {
+    free(grid->blocked);
+    free(grid);
+  }
+}
+
+// Evaluator
+
+ai_successor *
+_ai_grid_successor_function(ai_model_state *model_state,
+                            ai_transition_function transition_function) {
+  static const int dx[8] = {1, 0, -1, 0, 1, -1, -1, 1};
+  static const int dy[8] = {0, 1, 0, -1, 1, 1, -1, -1};
+  ai_grid_state *state = (ai_grid_state *)model_state->data;
+  unsigned move_mask = ai_grid_move_mask(state->query, state->x, state->y);
+  ai_successor *head = NULL;
+  for (int i = 7; i >= 0; i--) {
+    if (!((move_mask >> i) & 1)) {
+      continue;
+    }
+    int x = state->x + dx[i];
+    int y = state->y + dy[i];
+    ai_grid_action *action_data =
+        (ai_grid_action *)malloc(sizeof(ai_grid_action));
+    check(action_data, "_ai_grid_successor_function malloc failed");
+    action_data->x = x;
+    action_data->y = y;
+    ai_action *action = ai_action_constructor(action_data);
+    ai_successor *successor = ai_successor_constructor(
+        transition_function(model_state, action), action,
+        (dx[i] && dy[i]) ? AI_GRID_DIAGONAL_COST : 1.f);
+    successor->next = head;
+    head = successor;
+  }
+error:
+  return head;
+}
+
+ai_model_state *_ai_grid_transition_function(ai_model_state *model_state,
+                                             ai_action *action) {
+  ai_grid_state *state = (ai_grid_state *)model_state->data;
+  ai_grid_action *action_data = (ai_grid_action *)action->data;
+  return ai_grid_model_state_constructor(state->query, action_data->x,
+                                         action_data->y);
+}
+
+int _ai_grid_is_goal_state_function(ai_model_state *model_state) {
+  ai_grid_state *state = (ai_grid_state *)model_state->data;
+  return (state->x == state->query->goal_x) &&
+         (state->y == state->query->goal_y);
+}
+
+float _ai_grid_goal_est_cost_function(ai_model_state *model_state) {
+  ai_grid_state *state = (ai_grid_state *)model_state->data;
+  return ai_grid_octile_distance(state->x, state->y, state->query->goal_x,
+                                 state->query->goal_y);
+}
+
+// Successors of one cell share its query, so each run of states with the
+// same query is estimated by the kernel together.
+void _ai_grid_goal_est_cost_batch_function(ai_model_state **model_states,
+                                           int count, float *goal_est_costs) {
+  int x[64];
+  int y[64];
+  int i = 0;
+  while (i < count) {
+    ai_grid_query *query = ((ai_grid_state *)model_states[i]->data)->query;
+    int n = 0;
+    while ((i + n < count) && (n < 64)) {
+      ai_grid_state *state = (ai_grid_state *)model_states[i + n]->data;
+      if (state->query != query) {
+        break;
+      }
+      x[n] = state->x;
+      y[n] = state->y;
+      n++;
+    }
+    ai_grid_octile_distance_batch(x, y, n, query->goal_x, query->goal_y,
+                                  goal_est_costs + i);
+    i += n;
+  }
+}
+
+float _ai_grid_state_est_cost_function(ai_model_state *model_state,
+                                       ai_model_state *goal_model_state) {
+  ai_grid_state *state = (ai_grid_state *)model_state->data;
+  ai_grid_state *goal = (ai_grid_state *)goal_model_state->data;
+  return ai_grid_octile_distance(state->x, state->y, goal->x, goal->y);
+}
+
+void *_ai_grid_model_state_data_duplicator(void *data) {
+  ai_grid_state *new_data = (ai_grid_state *)malloc(sizeof(ai_grid_state));
+  check(new_data, "_ai_grid_model_state_data_duplicator malloc failed");
+  memcpy(new_data, data, sizeof(ai_grid_state));
+error:
+  return new_data;
+}
+
+void *_ai_grid_action_data_duplicator(void *data) {
+  ai_grid_action *new_data = (ai_grid_action *)malloc(sizeof(ai_grid_action));
+  check(new_data, "_ai_grid_action_data_duplicator malloc failed");
+  memcpy(new_data, data, sizeof(ai_grid_action));
+error:
+  return new_data;
+}
+
+size_t _ai_grid_model_state_data_size(void *data) {
+  return sizeof(ai_grid_state);
+}
+
+size_t _ai_grid_action_data_size(void *data) { return sizeof(ai_grid_action); }
+
+size_t _ai_grid_model_state_hash_function(ai_model_state *model_state) {
+  ai_grid_state *state = (ai_grid_state *)model_state->data;
+  return ((size_t)state->y * 73856093u) ^ ((size_t)state->x * 19349663u);
+}
+
+int _ai_grid_model_state_equal_function(ai_model_state *model_state_a,
+                                        ai_model_state *model_state_b) {
+  ai_grid_state *a = (ai_grid_state *)model_state_a->data;
+  ai_grid_state *b = (ai_grid_state *)model_state_b->data;
+  return (a->x == b->x) && (a->y == b->y);
+}
+
+ai_model_state_evaluator ai_grid_model_state_evaluator = {
+    .successor_function = _ai_grid_successor_function,
+    .transition_function = _ai_grid_transition_function,
+    .is_goal_state_function = _ai_grid_is_goal_state_function,
+    .goal_est_cost_function = _ai_grid_goal_est_cost_function,
+    .model_state_data_duplicator = _ai_grid_model_state_data_duplicator,
+    .model_state_data_free = ai_grid_data_free,
+    .action_data_duplicator = _ai_grid_action_data_duplicator,
+    .action_data_free = ai_grid_data_free,
+    .model_state_data_size = _ai_grid_model_state_data_size,
+    .action_data_size = _ai_grid_action_data_size,
+    .model_state_hash_function = _ai_grid_model_state_hash_function,
+    .model_state_equal_function = _ai_grid_model_state_equal_function,
+    .state_est_cost_function = _ai_grid_state_est_cost_function,
+    .goal_est_cost_batch_function = _ai_grid_goal_est_cost_batch_function,
+};
@@ -0,0 +1,533 @@
+/*
+ * AI - Compressed Path Database for grids.
+ *
+ * The block is a header followed by arrays of uint32_t, all in the order
+ * of ai_grid_cpd: cell_node, node_cell, node_component, row_offset and
+ * run_list. Every field is 4 byte aligned, so the arrays are used in place
+ * whether the block was built or mapped.
+ */
+#include "ai_search_internal.h"
+#include <ai_grid_cpd.h>
+#include <fcntl.h>
+#include <logging.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define AI_GRID_CPD_MAGIC "AICP"
+#define AI_GRID_CPD_VERSION 1
+
+// The moves, in the order of ai_grid_model_state_evaluator. A move is
+// stored in the low 3 bits of a run.
+static const int _ai_grid_cpd_dx[8] = {1, 0, -1, 0, 1, -1, -1, 1};
+static const int _ai_grid_cpd_dy[8] = {0, 1, 0, -1, 1, 1, -1, -1};
+#define AI_GRID_CPD_MOVE_NONE 8
+
+typedef struct _ai_grid_cpd_header_struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t node_count;
+  uint32_t run_count;
+} _ai_grid_cpd_header;
+
+typedef struct _ai_grid_cpd_order_struct {
+  uint64_t key;
+  uint32_t cell;
+} _ai_grid_cpd_order;
+
+// Z-order key. The bits of x and y interleaved.
+uint64_t _ai_grid_cpd_morton(uint32_t x, uint32_t y) {
+  uint64_t key = 0;
+  for (int bit = 0; bit < 32; bit++) {
+    key |= (uint64_t)((x >> bit) & 1) << (2 * bit);
+    key |= (uint64_t)((y >> bit) & 1) << (2 * bit + 1);
+  }
+  return key;
+}
+
+int _ai_grid_cpd_order_compare(const void *a, const void *b) {
+  const _ai_grid_cpd_order *order_a = (const _ai_grid_cpd_order *)a;
+  const _ai_grid_cpd_order *order_b = (const _ai_grid_cpd_order *)b;
+  return order_a->key < order_b->key ? -1 : (order_a->key > order_b->key);
+}
+
+// True if the move from the cell is open on the grid as it is now.
+int _ai_grid_cpd_move_open(ai_grid *grid, int x, int y, int move) {
+  int next_x = x + _ai_grid_cpd_dx[move];
+  int next_y = y + _ai_grid_cpd_dy[move];
+  if (ai_grid_blocked(grid, next_x, next_y)) {
+    return 0;
+  }
+  // Diagonal moves may not cut a corner.
+  return !(_ai_grid_cpd_dx[move] && _ai_grid_cpd_dy[move] &&
+           (ai_grid_blocked(grid, x, next_y) ||
+            ai_grid_blocked(grid, next_x, y)));
+}
+
+size_t _ai_grid_cpd_block_size(uint32_t width, uint32_t height,
+                               uint32_t node_count, uint32_t run_count) {
+  return sizeof(_ai_grid_cpd_header) +
+         sizeof(uint32_t) * ((size_t)width * height + 3 * (size_t)node_count +
+                             1 + run_count);
+}
+
+// Point the arrays into the block.
+void _ai_grid_cpd_block_attach(ai_grid_cpd *cpd) {
+  _ai_grid_cpd_header *header = (_ai_grid_cpd_header *)cpd->block;
+  cpd->node_count = header->node_count;
+  cpd->run_count = header->run_count;
+  cpd->cell_node = (const uint32_t *)(header + 1);
+  cpd->node_cell = cpd->cell_node + (size_t)cpd->width * cpd->height;
+  cpd->node_component = cpd->node_cell + cpd->node_count;
+  cpd->row_offset = cpd->node_component + cpd->node_count;
+  cpd->run_list = cpd->row_offset + cpd->node_count + 1;
+}
+
+// The database without its block.
+ai_grid_cpd *_ai_grid_cpd_alloc(ai_grid *grid) {
+  ai_grid_cpd *cpd = (ai_grid_cpd *)calloc(1, sizeof(ai_grid_cpd));
+  check(cpd, "_ai_grid_cpd_alloc malloc failed");
+  cpd->grid = grid;
+  cpd->width = grid->width;
+  cpd->height = grid->height;
+  cpd->region_width =
+      (grid->width + AI_GRID_CPD_REGION_SIZE - 1) / AI_GRID_CPD_REGION_SIZE;
+  cpd->region_height =
+      (grid->height + AI_GRID_CPD_REGION_SIZE - 1) / AI_GRID_CPD_REGION_SIZE;
+  cpd->region_invalid = (unsigned char *)calloc(
+      (size_t)cpd->region_width * cpd->region_height, 1);
+  check(cpd->region_invalid, "_ai_grid_cpd_alloc malloc failed");
+  cpd->status = AI_SEARCH_STATUS_IDLE;
+  return cpd;
+error:
+  ai_grid_cpd_free(cpd);
+  return NULL;
+}
+
+// Label each node with the lowest node of its connected cells.
+void _ai_grid_cpd_components(ai_grid *grid, uint32_t node_count,
+                             const uint32_t *cell_node,
+                             const uint32_t *node_cell, uint32_t *component,
+                             uint32_t *queue) {
+  for (uint32_t v = 0; v < node_count; v++) {
+    component[v] = AI_GRID_CPD_NODE_NONE;
+  }
+  for (uint32_t seed = 0; seed < node_count; seed++) {
+    if (component[seed] != AI_GRID_CPD_NODE_NONE) {
+      continue;
+    }
+    uint32_t head = 0;
+    uint32_t tail = 0;
+    component[seed] = seed;
+    queue[tail++] = seed;
+    while (head < tail) {
+      uint32_t v = queue[head++];
+      int x = node_cell[v] % grid->width;
+      int y = node_cell[v] / grid->width;
+      for (int move = 0; move < 8; move++) {
+        if (!_ai_grid_cpd_move_open(grid, x, y, move)) {
+          continue;
+        }
+        uint32_t next = cell_node[(y + _ai_grid_cpd_dy[move]) * grid->width +
+                                  x + _ai_grid_cpd_dx[move]];
+        if (component[next] == AI_GRID_CPD_NODE_NONE) {
+          component[next] = seed;
+          queue[tail++] = next;
+        }
+      }
+    }
+  }
+}
+
+// Dijkstra from source, setting the first move toward every node.
+int _ai_grid_cpd_first_moves(ai_grid *grid, uint32_t node_count,
+                             const uint32_t *cell_node,
+                             const uint32_t *node_cell, uint32_t source,
+                             float *dist, unsigned char *first_move) {
+  _ai_graph_heap heap = {NULL, 0, 0};
+  for (uint32_t v = 0; v < node_count; v++) {
+    dist[v] = INFINITY;
+    first_move[v] = AI_GRID_CPD_MOVE_NONE;
+  }
+  dist[source] = 0;
+  check(_ai_graph_heap_push(&heap, 0, source) == 0,
+        "_ai_grid_cpd_first_moves out of memory");
+  while (heap.count) {
+    _ai_graph_heap_entry top = _ai_graph_heap_pop(&heap);
+    if (top.key > dist[top.node]) {
+      continue;
+    }
+    int x = node_cell[top.node] % grid->width;
+    int y = node_cell[top.node] / grid->width;
+    for (int move = 0; move < 8; move++) {
+      if (!_ai_grid_cpd_move_open(grid, x, y, move)) {
+        continue;
+      }
+      int next_x = x + _ai_grid_cpd_dx[move];
+      int next_y = y + _ai_grid_cpd_dy[move];
+      uint32_t next = cell_node[next_y * grid->width + next_x];
+      float cost = top.key + ai_grid_move_cost(x, y, next_x, next_y);
+      if (cost < dist[next]) {
+        dist[next] = cost;
+        first_move[next] =
+            (top.node == source) ? move : first_move[top.node];
+        check(_ai_graph_heap_push(&heap, cost, next) == 0,
+              "_ai_grid_cpd_first_moves out of memory");
+      }
+    }
+  }
+  _ai_graph_heap_free(&heap);
+  return 0;
+error:
+  _ai_graph_heap_free(&heap);
+  return -1;
+}
+
+// ai_grid_cpd *cpd = ai_grid_cpd_constructor(grid);
+ai_grid_cpd *ai_grid_cpd_constructor(ai_grid *grid) {
+  ai_grid_cpd *cpd = NULL;
+  _ai_grid_cpd_order *order = NULL;
+  uint32_t *cell_node = NULL;
+  uint32_t *node_cell = NULL;
+  uint32_t *component = NULL;
+  uint32_t *row_offset = NULL;
+  uint32_t *run_list = NULL;
+  uint32_t run_count = 0;
+  uint32_t run_size = 0;
+  float *dist = NULL;
+  unsigned char *first_move = NULL;
+  check(grid, "ai_grid_cpd_constructor no grid");
+  cpd = _ai_grid_cpd_alloc(grid);
+  check(cpd, "ai_grid_cpd_constructor malloc failed");
+  size_t cell_count = (size_t)grid->width * grid->height;
+  order = (_ai_grid_cpd_order *)malloc(sizeof(_ai_grid_cpd_order) * cell_count);
+  cell_node = (uint32_t *)malloc(sizeof(uint32_t) * cell_count);
+  check(order && cell_node, "ai_grid_cpd_constructor malloc failed");
+
+  // Number the free cells in Z-order.
+  uint32_t n = 0;
+  for (int y = 0; y < grid->height; y++) {
+    for (int x = 0; x < grid->width; x++) {
+      cell_node[y * grid->width + x] = AI_GRID_CPD_NODE_NONE;
+      if (!ai_grid_blocked(grid, x, y)) {
+        order[n].key = _ai_grid_cpd_morton(x, y);
+        order[n].cell = y * grid->width + x;
+        n++;
+      }
+    }
+  }
+  check(n < ((uint32_t)1 << 29), "ai_grid_cpd_constructor too many cells");
+  qsort(order, n, sizeof(_ai_grid_cpd_order), _ai_grid_cpd_order_compare);
+  size_t size = n ? n : 1;
+  node_cell = (uint32_t *)malloc(sizeof(uint32_t) * size);
+  component = (uint32_t *)malloc(sizeof(uint32_t) * size);
+  row_offset = (uint32_t *)malloc(sizeof(uint32_t) * (n + 1));
+  dist = (float *)malloc(sizeof(float) * size);
+  first_move = (unsigned char *)malloc(size);
+  check(node_cell && component && row_offset && dist && first_move,
+        "ai_grid_cpd_constructor malloc failed");
+  for (uint32_t v = 0; v < n; v++) {
+    node_cell[v] = order[v].cell;
+    cell_node[order[v].cell] = v;
+  }
+  // The order keys are no longer needed. Reuse them as the queue.
+  _ai_grid_cpd_components(grid, n, cell_node, node_cell, component,
+                          (uint32_t *)order);
+
+  for (uint32_t source = 0; source < n; source++) {
+    check(_ai_grid_cpd_first_moves(grid, n, cell_node, node_cell, source, dist,
+                                   first_move) == 0,
+          "ai_grid_cpd_constructor out of memory");
+    row_offset[source] = run_count;
+    int open_move = AI_GRID_CPD_MOVE_NONE;
+    for (uint32_t target = 0; target < n; target++) {
+      int move = first_move[target];
+      if ((move == AI_GRID_CPD_MOVE_NONE) || (move == open_move)) {
+        continue;
+      }
+      if (run_count == run_size) {
+        run_size = run_size ? run_size * 2 : 1024;
+        uint32_t *list =
+            (uint32_t *)realloc(run_list, sizeof(uint32_t) * run_size);
+        check(list, "ai_grid_cpd_constructor malloc failed");
+        run_list = list;
+      }
+      // The first run of a row starts at node 0, whatever comes before.
+      uint32_t start = (open_move == AI_GRID_CPD_MOVE_NONE) ? 0 : target;
+      run_list[run_count++] = (start << 3) | (uint32_t)move;
+      open_move = move;
+    }
+  }
+  row_offset[n] = run_count;
+
+  cpd->block_size =
+      _ai_grid_cpd_block_size(grid->width, grid->height, n, run_count);
+  cpd->block = malloc(cpd->block_size);
+  check(cpd->block, "ai_grid_cpd_constructor malloc failed");
+  _ai_grid_cpd_header *header = (_ai_grid_cpd_header *)cpd->block;
+  memcpy(header->magic, AI_GRID_CPD_MAGIC, 4);
+  header->version = AI_GRID_CPD_VERSION;
+  header->width = grid->width;
+  header->height = grid->height;
+  header->node_count = n;
+  header->run_count = run_count;
+  _ai_grid_cpd_block_attach(cpd);
+  memcpy((uint32_t *)cpd->cell_node, cell_node, sizeof(uint32_t) * cell_count);
+  memcpy((uint32_t *)cpd->node_cell, node_cell, sizeof(uint32_t) * n);
+  memcpy((uint32_t *)cpd->node_component, component, sizeof(uint32_t) * n);
+  memcpy((uint32_t *)cpd->row_offset, row_offset, sizeof(uint32_t) * (n + 1));
+  if (run_count) {
+    memcpy((uint32_t *)cpd->run_list, run_list, sizeof(uint32_t) * run_count);
+  }
+  goto done;
+error:
+  ai_grid_cpd_free(cpd);
+  cpd = NULL;
+done:
+  free(order);
+  free(cell_node);
+  free(node_cell);
+  free(component);
+  free(row_offset);
+  free(run_list);
+  free(dist);
+  free(first_move);
+  return cpd;
+}
+
+// The first move from source toward target, or -1 if none is stored.
+int _ai_grid_cpd_first_move(ai_grid_cpd *cpd, uint32_t source,
+                            uint32_t target) {
+  uint32_t low = cpd->row_offset[source];
+  uint32_t high = cpd->row_offset[source + 1];
+  if (low == high) {
+    return -1;
+  }
+  // The last run starting at or before target.
+  while (high - low > 1) {
+    uint32_t mid = low + (high - low) / 2;
+    if ((cpd->run_list[mid] >> 3) <= target) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+  return cpd->run_list[low] & 7;
+}
+
+int _ai_grid_cpd_region_invalid(ai_grid_cpd *cpd, int x, int y) {
+  return cpd->region_invalid[(y / AI_GRID_CPD_REGION_SIZE) * cpd->region_width +
+                             x / AI_GRID_CPD_REGION_SIZE];
+}
+
+// Finish the path from a cell by A*. Returns -1 if there is no path.
+int _ai_grid_cpd_fallback(ai_grid_cpd *cpd, int x, int y, int goal_x,
+                          int goal_y, ai_path **path, ai_action **last) {
+  ai_grid_query query;
+  ai_grid_query_init(&query, cpd->grid, goal_x, goal_y);
+  ai_model_state *model_state = ai_grid_model_state_constructor(&query, x, y);
+  ai_search_astar *astar =
+      ai_search_astar_constructor(&ai_grid_model_state_evaluator);
+  int rc = -1;
+  check(model_state && astar, "_ai_grid_cpd_fallback malloc failed");
+  ai_path *rest = astar->find_path_to_goal(astar, model_state);
+  cpd->fringe_expansion_count += astar->fringe_expansion_count;
+  if (astar->status == AI_SEARCH_STATUS_FOUND) {
+    if (*last) {
+      (*last)->next = rest;
+    } else {
+      *path = rest;
+    }
+    for (ai_action *action = rest; action; action = action->next) {
+      ai_grid_action *action_data = (ai_grid_action *)action->data;
+      cpd->path_cost += ai_grid_move_cost(x, y, action_data->x, action_data->y);
+      x = action_data->x;
+      y = action_data->y;
+      *last = action;
+    }
+    rc = 0;
+  }
+error:
+  ai_search_astar_free(astar);
+  if (model_state) {
+    ai_grid_data_free(model_state->data);
+    free(model_state);
+  }
+  return rc;
+}
+
+// ai_path *path = ai_grid_cpd_find_path(cpd, x, y, goal_x, goal_y);
+ai_path *ai_grid_cpd_find_path(ai_grid_cpd *cpd, int x, int y, int goal_x,
+                               int goal_y) {
+  ai_grid *grid = cpd->grid;
+  ai_path *path = NULL;
+  ai_action *last = NULL;
+  cpd->path_cost = 0;
+  cpd->lookup_count = 0;
+  cpd->fringe_expansion_count = 0;
+  if (ai_grid_blocked(grid, x, y) || ai_grid_blocked(grid, goal_x, goal_y)) {
+    cpd->status = AI_SEARCH_STATUS_NOT_FOUND;
+    return NULL;
+  }
+  uint32_t target = cpd->cell_node[goal_y * cpd->width + goal_x];
+  // Each move is along a cheapest path, so there are fewer moves than
+  // nodes unless the grid has changed.
+  for (uint32_t step_count = 0; (x != goal_x) || (y != goal_y); step_count++) {
+    uint32_t source = cpd->cell_node[y * cpd->width + x];
+    if ((source == AI_GRID_CPD_NODE_NONE) || (target == AI_GRID_CPD_NODE_NONE)) {
+      break;
+    }
+    if (cpd->node_component[source] != cpd->node_component[target]) {
+      if (cpd->region_invalid_count == 0) {
+        cpd->status = AI_SEARCH_STATUS_NOT_FOUND;
+        _ai_path_free(path, ai_grid_data_free);
+        return NULL;
+      }
+      break;
+    }
+    int move = _ai_grid_cpd_first_move(cpd, source, target);
+    cpd->lookup_count++;
+    if ((move < 0) || (step_count >= cpd->node_count) ||
+        !_ai_grid_cpd_move_open(grid, x, y, move)) {
+      break;
+    }
+    int next_x = x + _ai_grid_cpd_dx[move];
+    int next_y = y + _ai_grid_cpd_dy[move];
+    if (_ai_grid_cpd_region_invalid(cpd, next_x, next_y)) {
+      break;
+    }
+    ai_grid_action *action_data =
+        (ai_grid_action *)malloc(sizeof(ai_grid_action));
+    check(action_data, "ai_grid_cpd_find_path malloc failed");
+    action_data->x = next_x;
+    action_data->y = next_y;
+    ai_action *action = ai_action_constructor(action_data);
+    if (last) {
+      last->next = action;
+    } else {
+      path = action;
+    }
+    last = action;
+    cpd->path_cost += ai_grid_move_cost(x, y, next_x, next_y);
+    x = next_x;
+    y = next_y;
+  }
+  if (((x != goal_x) || (y != goal_y)) &&
+      (_ai_grid_cpd_fallback(cpd, x, y, goal_x, goal_y, &path, &last) != 0)) {
+    goto error;
+  }
+  cpd->status = AI_SEARCH_STATUS_FOUND;
+  return path;
+error:
+  _ai_path_free(path, ai_grid_data_free);
+  cpd->status = AI_SEARCH_STATUS_NOT_FOUND;
+  return NULL;
+}
+
+void ai_grid_cpd_cell_set(ai_grid_cpd *cpd, int x, int y, int blocked) {
+  if ((x < 0) || (y < 0) || (x >= cpd->width) || (y >= cpd->height)) {
+    return;
+  }
+  ai_grid_blocked_set(cpd->grid, x, y, blocked);
+  unsigned char *invalid =
+      &cpd->region_invalid[(y / AI_GRID_CPD_REGION_SIZE) * cpd->region_width +
+                           x / AI_GRID_CPD_REGION_SIZE];
+  if (!*invalid) {
+    *invalid = 1;
+    cpd->region_invalid_count++;
+  }
+}
+
+// ai_grid_cpd_save(cpd, file);
+int ai_grid_cpd_save(ai_grid_cpd *cpd, FILE *file) {
+  check(fwrite(cpd->block, 1, cpd->block_size, file) == cpd->block_size,
+        "ai_grid_cpd_save write failed");
+  return 0;
+error:
+  return -1;
+}
+
+// Check that the mapped arrays can not be read out of bounds.
+int _ai_grid_cpd_valid(ai_grid_cpd *cpd) {
+  size_t cell_count = (size_t)cpd->width * cpd->height;
+  for (size_t cell = 0; cell < cell_count; cell++) {
+    if ((cpd->cell_node[cell] != AI_GRID_CPD_NODE_NONE) &&
+        (cpd->cell_node[cell] >= cpd->node_count)) {
+      return 0;
+    }
+  }
+  if (cpd->row_offset[0] != 0) {
+    return 0;
+  }
+  for (uint32_t v = 0; v < cpd->node_count; v++) {
+    if ((cpd->node_cell[v] >= cell_count) ||
+        (cpd->row_offset[v + 1] < cpd->row_offset[v])) {
+      return 0;
+    }
+  }
+  return cpd->row_offset[cpd->node_count] == cpd->run_count;
+}
+
+// ai_grid_cpd *cpd = ai_grid_cpd_load("map.cpd", grid);
+ai_grid_cpd *ai_grid_cpd_load(const char *file_name, ai_grid *grid) {
+  ai_grid_cpd *cpd = NULL;
+  int fd = -1;
+  check(grid, "ai_grid_cpd_load no grid");
+  cpd = _ai_grid_cpd_alloc(grid);
+  check(cpd, "ai_grid_cpd_load malloc failed");
+  fd = open(file_name, O_RDONLY);
+  check(fd >= 0, "ai_grid_cpd_load can not open %s", file_name);
+  struct stat file_stat;
+  check(fstat(fd, &file_stat) == 0, "ai_grid_cpd_load can not stat %s",
+        file_name);
+  check((size_t)file_stat.st_size >= sizeof(_ai_grid_cpd_header),
+        "ai_grid_cpd_load file too short");
+  void *block =
+      mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  check(block != MAP_FAILED, "ai_grid_cpd_load can not map %s", file_name);
+  cpd->block = block;
+  cpd->block_size = (size_t)file_stat.st_size;
+  cpd->block_mapped = 1;
+  close(fd);
+  fd = -1;
+
+  _ai_grid_cpd_header *header = (_ai_grid_cpd_header *)cpd->block;
+  check(memcmp(header->magic, AI_GRID_CPD_MAGIC, 4) == 0,
+        "ai_grid_cpd_load not a path database");
+  check(header->version == AI_GRID_CPD_VERSION,
+        "ai_grid_cpd_load unknown version");
+  check((header->width == (uint32_t)grid->width) &&
+            (header->height == (uint32_t)grid->height),
+        "ai_grid_cpd_load built for another size of grid");
+  check(cpd->block_size == _ai_grid_cpd_block_size(header->width,
+                                                   header->height,
+                                                   header->node_count,
+                                                   header->run_count),
+        "ai_grid_cpd_load bad file size");
+  _ai_grid_cpd_block_attach(cpd);
+  check(_ai_grid_cpd_valid(cpd), "ai_grid_cpd_load bad tables");
+  return cpd;
+error:
+  if (fd >= 0) {
+    close(fd);
+  }
+  ai_grid_cpd_free(cpd);
+  return NULL;
+}
+
+void ai_grid_cpd_free(ai_grid_cpd *cpd) {
+  if (cpd) {
+    if (cpd->block_mapped) {
+      munmap(cpd->block, cpd->block_size);
+    } else {
+      free(cpd->block);
+    }
+    free(cpd->region_invalid);
+    free(cpd);
+  }
+}
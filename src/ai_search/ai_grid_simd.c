@@ -0,0 +1,184 @@
+/*
+ * AI - Grid kernels.
+ *
+ * The octile distance kernels work in single precision floats throughout,
+ * with the same operations in the same order as ai_grid_octile_distance, so
+ * every kernel returns exactly what it does. The SSE2 and AVX2 kernels are
+ * compiled with target attributes, and chosen on first use by what the CPU
+ * reports, so the library runs on any x86 CPU without special build flags.
+ * Other compilers and CPUs have the scalar kernel only.
+ */
+#include <ai_grid.h>
+#include <stdlib.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) &&                               \
+    (defined(__x86_64__) || defined(__i386__))
+#define _AI_GRID_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+void _ai_grid_octile_distance_batch_scalar(const int *x, const int *y,
+                                           int count, int goal_x, int goal_y,
+                                           float *costs) {
+  for (int i = 0; i < count; i++) {
+    costs[i] = ai_grid_octile_distance(x[i], y[i], goal_x, goal_y);
+  }
+}
+
+#ifdef _AI_GRID_SIMD_X86
+
+__attribute__((target("sse2"))) void
+_ai_grid_octile_distance_batch_sse2(const int *x, const int *y, int count,
+                                    int goal_x, int goal_y, float *costs) {
+  const __m128 sign = _mm_set1_ps(-0.f);
+  const __m128 diagonal_cost = _mm_set1_ps(AI_GRID_DIAGONAL_COST);
+  const __m128 gx = _mm_set1_ps((float)goal_x);
+  const __m128 gy = _mm_set1_ps((float)goal_y);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 fx = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(x + i)));
+    __m128 fy = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(y + i)));
+    __m128 dx = _mm_andnot_ps(sign, _mm_sub_ps(gx, fx));
+    __m128 dy = _mm_andnot_ps(sign, _mm_sub_ps(gy, fy));
+    __m128 diagonal = _mm_min_ps(dx, dy);
+    __m128 straight = _mm_sub_ps(_mm_max_ps(dx, dy), diagonal);
+    _mm_storeu_ps(costs + i,
+                  _mm_add_ps(straight, _mm_mul_ps(diagonal, diagonal_cost)));
+  }
+  _ai_grid_octile_distance_batch_scalar(x + i, y + i, count - i, goal_x,
+                                        goal_y, costs + i);
+}
+
+__attribute__((target("avx2"))) void
+_ai_grid_octile_distance_batch_avx2(const int *x, const int *y, int count,
+                                    int goal_x, int goal_y, float *costs) {
+  const __m256 sign = _mm256_set1_ps(-0.f);
+  const __m256 diagonal_cost = _mm256_set1_ps(AI_GRID_DIAGONAL_COST);
+  const __m256 gx = _mm256_set1_ps((float)goal_x);
+  const __m256 gy = _mm256_set1_ps((float)goal_y);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 fx =
+        _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(x + i)));
+    __m256 fy =
+        _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(y + i)));
+    __m256 dx = _mm256_andnot_ps(sign, _mm256_sub_ps(gx, fx));
+    __m256 dy = _mm256_andnot_ps(sign, _mm256_sub_ps(gy, fy));
+    __m256 diagonal = _mm256_min_ps(dx, dy);
+    __m256 straight = _mm256_sub_ps(_mm256_max_ps(dx, dy), diagonal);
+    _mm256_storeu_ps(costs + i, _mm256_add_ps(straight, _mm256_mul_ps(
+                                                            diagonal,
+                                                            diagonal_cost)));
+  }
+  _ai_grid_octile_distance_batch_sse2(x + i, y + i, count - i, goal_x, goal_y,
+                                      costs + i);
+}
+
+#endif // _AI_GRID_SIMD_X86
+
+typedef void (*_ai_grid_octile_distance_batch_function)(const int *x,
+                                                        const int *y,
+                                                        int count, int goal_x,
+                                                        int goal_y,
+                                                        float *costs);
+
+// The kernels in use, chosen on first use. Choosing twice from two threads
+// chooses the same.
+static ai_grid_simd _ai_grid_simd = AI_GRID_SIMD_SCALAR;
+static _ai_grid_octile_distance_batch_function
+    _ai_grid_octile_distance_batch = NULL;
+
+ai_grid_simd ai_grid_simd_supported(void) {
+#ifdef _AI_GRID_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return AI_GRID_SIMD_AVX2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return AI_GRID_SIMD_SSE2;
+  }
+#endif
+  return AI_GRID_SIMD_SCALAR;
+}
+
+ai_grid_simd ai_grid_simd_set(ai_grid_simd simd) {
+  ai_grid_simd supported = ai_grid_simd_supported();
+  if (simd > supported) {
+    simd = supported;
+  }
+  _ai_grid_octile_distance_batch_function batch =
+      _ai_grid_octile_distance_batch_scalar;
+#ifdef _AI_GRID_SIMD_X86
+  if (simd == AI_GRID_SIMD_AVX2) {
+    batch = _ai_grid_octile_distance_batch_avx2;
+  } else if (simd == AI_GRID_SIMD_SSE2) {
+    batch = _ai_grid_octile_distance_batch_sse2;
+  }
+#endif
+  _ai_grid_simd = simd;
+  _ai_grid_octile_distance_batch = batch;
+  return simd;
+}
+
+ai_grid_simd ai_grid_simd_get(void) {
+  if (!_ai_grid_octile_distance_batch) {
+    ai_grid_simd_set(ai_grid_simd_supported());
+  }
+  return _ai_grid_simd;
+}
+
+void ai_grid_octile_distance_batch(const int *x, const int *y, int count,
+                                   int goal_x, int goal_y, float *costs) {
+  if (!_ai_grid_octile_distance_batch) {
+    ai_grid_simd_set(ai_grid_simd_supported());
+  }
+  _ai_grid_octile_distance_batch(x, y, count, goal_x, goal_y, costs);
+}
+
+// Three bits for cells x - 1 to x + 1 of row y, set where the cell is free
+// and inside both the grid and the query's rectangle.
+unsigned _ai_grid_row_open(ai_grid_query *query, int x, int y) {
+  ai_grid *grid = query->grid;
+  if ((y < query->min_y) || (y >= query->max_y) || (y < 0) ||
+      (y >= grid->height)) {
+    return 0;
+  }
+  const uint64_t *row = grid->blocked + (size_t)y * grid->row_words;
+  uint64_t blocked = 0;
+  if ((x <= 0) || (x > grid->width)) {
+    // Off an edge of the grid, a cell at a time.
+    for (int i = 0; i < 3; i++) {
+      blocked |= (uint64_t)ai_grid_blocked(grid, x - 1 + i, y) << i;
+    }
+  } else {
+    int word = (x - 1) >> 6;
+    int shift = (x - 1) & 63;
+    blocked = row[word] >> shift;
+    if ((shift > 61) && (word + 1 < grid->row_words)) {
+      blocked |= row[word + 1] << (64 - shift);
+    }
+  }
+  // Cells of the rectangle and the grid, from lo to hi - 1 of the three.
+  int max_x = query->max_x < grid->width ? query->max_x : grid->width;
+  int lo = query->min_x - (x - 1);
+  int hi = max_x - (x - 1);
+  lo = lo < 0 ? 0 : lo;
+  hi = hi > 3 ? 3 : hi;
+  unsigned inside = hi > lo ? ((1u << hi) - 1) & ~((1u << lo) - 1) : 0;
+  return ~(unsigned)blocked & inside;
+}
+
+unsigned ai_grid_move_mask(ai_grid_query *query, int x, int y) {
+  unsigned up = _ai_grid_row_open(query, x, y - 1);
+  unsigned row = _ai_grid_row_open(query, x, y);
+  unsigned down = _ai_grid_row_open(query, x, y + 1);
+  // Bit 0 of a row is x - 1, bit 1 is x and bit 2 is x + 1.
+  unsigned right = (row >> 2) & 1;
+  unsigned left = row & 1;
+  unsigned below = (down >> 1) & 1;
+  unsigned above = (up >> 1) & 1;
+  return right | (below << 1) | (left << 2) | (above << 3) |
+         ((((down >> 2) & 1) & below & right) << 4) |
+         ((down & 1 & below & left) << 5) | ((up & 1 & above & left) << 6) |
+         ((((up >> 2) & 1) & above & right) << 7);
+}
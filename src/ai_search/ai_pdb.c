@@ -0,0 +1,301 @@
+/*
+ * AI - Pattern Database.
+ *
+ * The search is Dial's algorithm: a bucket of states per whole distance,
+ * taken in order, so that 0 cost moves are handled as they arise. Every
+ * state seen is kept in an ai_state_table with its best distance so far. A
+ * bucket holds the table's Model States, which do not move when the table
+ * grows, and a state is stale in a bucket past its distance.
+ *
+ * The block is a header followed by the table.
+ */
+#include "ai_search_internal.h"
+#include <ai_pdb.h>
+#include <ai_state_table.h>
+#include <fcntl.h>
+#include <logging.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define AI_PDB_MAGIC "AIPD"
+#define AI_PDB_VERSION 1
+
+typedef struct _ai_pdb_header_struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t bits;
+  uint32_t reserved;
+  uint64_t state_count;
+} _ai_pdb_header;
+
+typedef struct _ai_pdb_bucket_struct {
+  ai_model_state **model_state_list;
+  size_t count;
+  size_t size;
+} _ai_pdb_bucket;
+
+size_t _ai_pdb_table_size(uint64_t state_count, int bits) {
+  return bits == 8 ? state_count : (state_count + 1) / 2;
+}
+
+void _ai_pdb_value_set(ai_pdb *pdb, uint64_t rank, unsigned value) {
+  uint8_t *table = (uint8_t *)pdb->table;
+  if (pdb->bits == 8) {
+    table[rank] = value;
+  } else {
+    int shift = (rank & 1) * 4;
+    table[rank >> 1] = (table[rank >> 1] & ~(15 << shift)) | (value << shift);
+  }
+}
+
+// The database without its block.
+ai_pdb *_ai_pdb_alloc(int bits, ai_pdb_rank_function rank_function,
+                      void *rank_data) {
+  ai_pdb *pdb = (ai_pdb *)calloc(1, sizeof(ai_pdb));
+  check(pdb, "_ai_pdb_alloc malloc failed");
+  pdb->bits = bits;
+  pdb->value_max = (1u << bits) - 1;
+  pdb->rank_function = rank_function;
+  pdb->rank_data = rank_data;
+  return pdb;
+error:
+  return NULL;
+}
+
+int _ai_pdb_bucket_push(_ai_pdb_bucket **bucket_list, size_t *bucket_count,
+                        size_t distance, ai_model_state *model_state) {
+  if (distance >= *bucket_count) {
+    size_t count = distance + 1;
+    _ai_pdb_bucket *list = (_ai_pdb_bucket *)realloc(
+        *bucket_list, sizeof(_ai_pdb_bucket) * count);
+    check(list, "_ai_pdb_bucket_push malloc failed");
+    memset(&list[*bucket_count], 0,
+           sizeof(_ai_pdb_bucket) * (count - *bucket_count));
+    *bucket_list = list;
+    *bucket_count = count;
+  }
+  _ai_pdb_bucket *bucket = &(*bucket_list)[distance];
+  if (bucket->count == bucket->size) {
+    size_t size = bucket->size ? bucket->size * 2 : 64;
+    ai_model_state **list = (ai_model_state **)realloc(
+        bucket->model_state_list, sizeof(ai_model_state *) * size);
+    check(list, "_ai_pdb_bucket_push malloc failed");
+    bucket->model_state_list = list;
+    bucket->size = size;
+  }
+  bucket->model_state_list[bucket->count++] = model_state;
+  return 0;
+error:
+  return -1;
+}
+
+// Record a state at a distance, if it is new or nearer than before. The
+// state is taken over, or freed.
+int _ai_pdb_reach(ai_state_table *seen, _ai_pdb_bucket **bucket_list,
+                  size_t *bucket_count, ai_model_state *model_state,
+                  size_t distance,
+                  ai_model_state_data_free model_state_data_free) {
+  ai_state_table_entry *entry = ai_state_table_find(seen, model_state);
+  if (entry) {
+    ai_model_state *seen_model_state = entry->model_state;
+    int nearer = distance < entry->cost;
+    if (nearer) {
+      entry->cost = distance;
+    }
+    _ai_model_state_free(model_state, model_state_data_free);
+    return nearer ? _ai_pdb_bucket_push(bucket_list, bucket_count, distance,
+                                        seen_model_state)
+                  : 0;
+  }
+  entry = ai_state_table_insert(seen, model_state, distance);
+  check(entry, "_ai_pdb_reach out of memory");
+  return _ai_pdb_bucket_push(bucket_list, bucket_count, distance,
+                             model_state);
+error:
+  _ai_model_state_free(model_state, model_state_data_free);
+  return -1;
+}
+
+// ai_pdb *pdb = ai_pdb_constructor(&evaluator, goals, 1, count, 4, rank, NULL);
+ai_pdb *ai_pdb_constructor(ai_model_state_evaluator *abstract_evaluator,
+                           ai_model_state **goal_model_states, int goal_count,
+                           uint64_t state_count, int bits,
+                           ai_pdb_rank_function rank_function,
+                           void *rank_data) {
+  ai_pdb *pdb = NULL;
+  ai_state_table *seen = NULL;
+  _ai_pdb_bucket *bucket_list = NULL;
+  size_t bucket_count = 0;
+  check((bits == 4) || (bits == 8), "ai_pdb_constructor bits not 4 or 8");
+  check(rank_function && (state_count > 0),
+        "ai_pdb_constructor no states to rank");
+  check(state_count < SIZE_MAX - sizeof(_ai_pdb_header),
+        "ai_pdb_constructor state_count too large");
+  pdb = _ai_pdb_alloc(bits, rank_function, rank_data);
+  check(pdb, "ai_pdb_constructor malloc failed");
+  pdb->state_count = state_count;
+  pdb->block_size =
+      sizeof(_ai_pdb_header) + _ai_pdb_table_size(state_count, bits);
+  pdb->block = malloc(pdb->block_size);
+  check(pdb->block, "ai_pdb_constructor malloc failed");
+  _ai_pdb_header *header = (_ai_pdb_header *)pdb->block;
+  memcpy(header->magic, AI_PDB_MAGIC, 4);
+  header->version = AI_PDB_VERSION;
+  header->bits = bits;
+  header->reserved = 0;
+  header->state_count = state_count;
+  pdb->table = (const uint8_t *)(header + 1);
+  // Not reached, or too far, until found otherwise.
+  memset((uint8_t *)pdb->table, 0xff, _ai_pdb_table_size(state_count, bits));
+
+  seen = ai_state_table_constructor(abstract_evaluator);
+  check(seen, "ai_pdb_constructor evaluator has no hash or equal function");
+  ai_model_state_data_free model_state_data_free =
+      abstract_evaluator->model_state_data_free;
+  for (int i = 0; i < goal_count; i++) {
+    ai_model_state *goal = _ai_model_state_duplicate(
+        goal_model_states[i], abstract_evaluator->model_state_data_duplicator);
+    check(goal && (_ai_pdb_reach(seen, &bucket_list, &bucket_count, goal, 0,
+                                 model_state_data_free) == 0),
+          "ai_pdb_constructor out of memory");
+  }
+
+  // Past value_max every entry left is value_max, so stop there.
+  for (size_t distance = 0;
+       (distance < bucket_count) && (distance < pdb->value_max); distance++) {
+    // The bucket may grow, and move, while it is taken.
+    for (size_t i = 0; i < bucket_list[distance].count; i++) {
+      ai_model_state *model_state = bucket_list[distance].model_state_list[i];
+      if (ai_state_table_find(seen, model_state)->cost < distance) {
+        continue;
+      }
+      uint64_t rank = rank_function(rank_data, model_state);
+      check(rank < state_count, "ai_pdb_constructor rank out of range");
+      if (distance < ai_pdb_value(pdb, rank)) {
+        _ai_pdb_value_set(pdb, rank, distance);
+      }
+      ai_successor *successor_list = abstract_evaluator->successor_function(
+          model_state, abstract_evaluator->transition_function);
+      int rc = 0;
+      for (ai_successor *successor = successor_list; successor;) {
+        ai_successor *successor_next = successor->next;
+        successor->action->next = NULL;
+        _ai_path_free(successor->action, abstract_evaluator->action_data_free);
+        if ((rc == 0) && ((successor->cost < 0) ||
+                          (successor->cost != floorf(successor->cost)))) {
+          log_error("ai_pdb_constructor cost not a whole number");
+          rc = -1;
+        }
+        // A state value_max or further away is left at value_max, and is
+        // not kept.
+        if ((rc == 0) && (distance + successor->cost < pdb->value_max)) {
+          rc = _ai_pdb_reach(seen, &bucket_list, &bucket_count,
+                             successor->model_state,
+                             distance + (size_t)successor->cost,
+                             model_state_data_free);
+        } else {
+          _ai_model_state_free(successor->model_state, model_state_data_free);
+        }
+        free(successor);
+        successor = successor_next;
+      }
+      check(rc == 0, "ai_pdb_constructor search failed");
+    }
+  }
+  goto done;
+error:
+  ai_pdb_free(pdb);
+  pdb = NULL;
+done:
+  for (size_t i = 0; i < bucket_count; i++) {
+    free(bucket_list[i].model_state_list);
+  }
+  free(bucket_list);
+  ai_state_table_free(seen);
+  return pdb;
+}
+
+// float h = ai_pdb_est_cost(pdb, model_state);
+float ai_pdb_est_cost(ai_pdb *pdb, ai_model_state *model_state) {
+  return ai_pdb_value(pdb, pdb->rank_function(pdb->rank_data, model_state));
+}
+
+// float h = ai_pdb_additive_est_cost(pdb_list, 2, model_state);
+float ai_pdb_additive_est_cost(ai_pdb **pdb_list, int pdb_count,
+                               ai_model_state *model_state) {
+  float cost = 0;
+  for (int i = 0; i < pdb_count; i++) {
+    cost += ai_pdb_est_cost(pdb_list[i], model_state);
+  }
+  return cost;
+}
+
+// ai_pdb_save(pdb, file);
+int ai_pdb_save(ai_pdb *pdb, FILE *file) {
+  check(fwrite(pdb->block, 1, pdb->block_size, file) == pdb->block_size,
+        "ai_pdb_save write failed");
+  return 0;
+error:
+  return -1;
+}
+
+// ai_pdb *pdb = ai_pdb_load("tiles.pdb", rank_function, NULL);
+ai_pdb *ai_pdb_load(const char *file_name, ai_pdb_rank_function rank_function,
+                    void *rank_data) {
+  ai_pdb *pdb = NULL;
+  int fd = open(file_name, O_RDONLY);
+  check(fd >= 0, "ai_pdb_load can not open %s", file_name);
+  struct stat file_stat;
+  check(fstat(fd, &file_stat) == 0, "ai_pdb_load can not stat %s", file_name);
+  check((size_t)file_stat.st_size >= sizeof(_ai_pdb_header),
+        "ai_pdb_load file too short");
+  void *block =
+      mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  check(block != MAP_FAILED, "ai_pdb_load can not map %s", file_name);
+  close(fd);
+  fd = -1;
+  _ai_pdb_header *header = (_ai_pdb_header *)block;
+  int bits = header->bits;
+  pdb = _ai_pdb_alloc((bits == 8) ? 8 : 4, rank_function, rank_data);
+  if (!pdb) {
+    munmap(block, (size_t)file_stat.st_size);
+  }
+  check(pdb, "ai_pdb_load malloc failed");
+  pdb->block = block;
+  pdb->block_size = (size_t)file_stat.st_size;
+  pdb->block_mapped = 1;
+  check(memcmp(header->magic, AI_PDB_MAGIC, 4) == 0,
+        "ai_pdb_load not a pattern database");
+  check(header->version == AI_PDB_VERSION, "ai_pdb_load unknown version");
+  check((bits == 4) || (bits == 8), "ai_pdb_load bits not 4 or 8");
+  // The table is no larger than the file.
+  check(header->state_count / (bits == 8 ? 1 : 2) <= pdb->block_size,
+        "ai_pdb_load state_count too large");
+  check(pdb->block_size == sizeof(_ai_pdb_header) +
+                               _ai_pdb_table_size(header->state_count, bits),
+        "ai_pdb_load bad file size");
+  pdb->state_count = header->state_count;
+  pdb->table = (const uint8_t *)(header + 1);
+  return pdb;
+error:
+  if (fd >= 0) {
+    close(fd);
+  }
+  ai_pdb_free(pdb);
+  return NULL;
+}
+
+void ai_pdb_free(ai_pdb *pdb) {
+  if (pdb) {
+    if (pdb->block_mapped) {
+      munmap(pdb->block, pdb->block_size);
+    } else {
+      free(pdb->block);
+    }
+    free(pdb);
+  }
+}
@@ -15,12 +15,17 @@
  *  Created on: 6 Jan 2015
  *      Author: xenomorpheus
  */
+#include "ai_search_internal.h"
 #include <ai_search.h>
+#include <ai_state_table.h>
 #include <logging.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Float error allowed for when an est_total_cost is put in its bucket.
+#define _AI_FRINGE_BUCKET_TOLERANCE 1e-4f
+
 // Constructor for an Action.
 ai_action *ai_action_constructor(void *data) {
   ai_action *action = (ai_action *)malloc(sizeof(ai_action));
@@ -113,6 +118,9 @@ ai_fringe_element *ai_fringe_element_constructor(ai_model_state *model_state,
   fe->path_so_far = path_so_far;
   fe->cost_so_far = cost_so_far;
   fe->est_total_cost = est_total_cost;
+  fe->tie_break_key = 0;
+  fe->hash = 0;
+  fe->memory_size = 0;
   fe->next = NULL;
   return fe;
 error:
@@ -128,35 +136,280 @@ _ai_fringe_element_list_pop(ai_fringe_element **fringe_element_list) {
   return head;
 }
 
+// True if node goes after fe in the fringe. Nodes equal to fe go after it,
+// unless before_equal.
+int _ai_fringe_element_after(ai_fringe_element *fe, ai_fringe_element *node,
+                             int before_equal) {
+  if (fe->est_total_cost != node->est_total_cost) {
+    return fe->est_total_cost < node->est_total_cost;
+  }
+  if (fe->tie_break_key != node->tie_break_key) {
+    return fe->tie_break_key < node->tie_break_key;
+  }
+  return !before_equal;
+}
+
+// Add Fringe Element to the list, sorted by est_total_cost then
+// tie_break_key, low first.
+void _ai_fringe_element_list_add(ai_fringe_element **fringe_element_list,
+                                 ai_fringe_element *node, int before_equal) {
+  ai_fringe_element *prev = NULL;
+  ai_fringe_element *current = *fringe_element_list;
+  while (current && _ai_fringe_element_after(current, node, before_equal)) {
+    prev = current;
+    current = current->next;
+  }
+  node->next = current;
+  if (prev) {
+    prev->next = node;
+  } else {
+    *fringe_element_list = node;
+  }
+}
+
 // Add Fringe Element to the list.
 // The list is sorted by est_total_cost, low first.
 void _ai_fringe_element_list_add_by_total_cost(
     ai_fringe_element **fringe_element_list, ai_fringe_element *node) {
-  ai_fringe_element *prev, *current;
-  float est_total_cost = node->est_total_cost;
-  // Remove this if we need to add lists to lists.
-  node->next = NULL;
-  if (!*fringe_element_list) {
-    *fringe_element_list = node;
+  _ai_fringe_element_list_add(fringe_element_list, node, 0);
+}
+
+// The tie_break_key of a Fringe Element, for the search's tie_break.
+float _ai_search_astar_tie_break_key(ai_search_astar *astar,
+                                     ai_fringe_element *fe) {
+  switch (astar->tie_break) {
+  case AI_SEARCH_TIE_BREAK_HIGH_G:
+    return -fe->cost_so_far;
+  case AI_SEARCH_TIE_BREAK_RANDOM:
+    astar->tie_break_random = astar->tie_break_random * 1103515245u + 12345u;
+    // 24 bits, so every key is a distinct float.
+    return (float)(astar->tie_break_random >> 8);
+  default:
+    return 0;
+  }
+}
+
+// The bucket of an est_total_cost, for a search with fringe_bucket_width.
+size_t _ai_search_astar_fringe_bucket(ai_search_astar *astar,
+                                      float est_total_cost) {
+  float bucket = est_total_cost / astar->fringe_bucket_width +
+                 _AI_FRINGE_BUCKET_TOLERANCE;
+  if (!(bucket > 0)) {
+    return 0;
+  }
+  if (bucket >= AI_SEARCH_FRINGE_BUCKET_MAX - 1) {
+    return AI_SEARCH_FRINGE_BUCKET_MAX - 1;
+  }
+  return (size_t)bucket;
+}
+
+// Make room in the bucket index for bucket. Returns 0, or -1 if out of
+// memory.
+int _ai_search_astar_fringe_bucket_reserve(ai_search_astar *astar,
+                                           size_t bucket) {
+  size_t old_count = astar->fringe_bucket_count;
+  if (bucket < old_count) {
+    return 0;
+  }
+  size_t count = old_count ? old_count * 2 : 1024;
+  while (count <= bucket) {
+    count *= 2;
+  }
+  ai_fringe_element **first = (ai_fringe_element **)realloc(
+      astar->fringe_bucket_first, sizeof(ai_fringe_element *) * count);
+  check(first, "_ai_search_astar_fringe_bucket_reserve malloc failed");
+  astar->fringe_bucket_first = first;
+  ai_fringe_element **last = (ai_fringe_element **)realloc(
+      astar->fringe_bucket_last, sizeof(ai_fringe_element *) * count);
+  check(last, "_ai_search_astar_fringe_bucket_reserve malloc failed");
+  astar->fringe_bucket_last = last;
+  uint64_t *used = (uint64_t *)realloc(astar->fringe_bucket_used,
+                                       sizeof(uint64_t) * (count / 64));
+  check(used, "_ai_search_astar_fringe_bucket_reserve malloc failed");
+  astar->fringe_bucket_used = used;
+  memset(used + old_count / 64, 0, sizeof(uint64_t) * (count - old_count) / 64);
+  astar->fringe_bucket_count = count;
+  return 0;
+error:
+  return -1;
+}
+
+// True if the fringe is kept in buckets rather than as a sorted list.
+int _ai_search_astar_fringe_bucketed(ai_search_astar *astar) {
+  return (astar->fringe_bucket_width > 0) && astar->fringe_bucket_count;
+}
+
+int _ai_search_astar_fringe_bucket_used(ai_search_astar *astar,
+                                        size_t bucket) {
+  return (astar->fringe_bucket_used[bucket >> 6] >> (bucket & 63)) & 1;
+}
+
+// The bucket an est_total_cost goes in. If the index can not grow to hold
+// it, the highest bucket held, so the element is expanded late but never
+// lost.
+size_t _ai_search_astar_fringe_bucket_place(ai_search_astar *astar,
+                                            float est_total_cost) {
+  size_t bucket = _ai_search_astar_fringe_bucket(astar, est_total_cost);
+  if (_ai_search_astar_fringe_bucket_reserve(astar, bucket) != 0) {
+    bucket = astar->fringe_bucket_count - 1;
+  }
+  return bucket;
+}
+
+// Add a Fringe Element to the end of its bucket.
+void _ai_search_astar_fringe_bucket_append(ai_search_astar *astar,
+                                           size_t bucket,
+                                           ai_fringe_element *fe) {
+  fe->next = NULL;
+  if (_ai_search_astar_fringe_bucket_used(astar, bucket)) {
+    astar->fringe_bucket_last[bucket]->next = fe;
   } else {
-    prev = NULL;
-    current = *fringe_element_list;
-    while (current && current->est_total_cost <= est_total_cost) {
-      prev = current;
-      current = current->next;
+    if (!_ai_search_astar_fringe_bucket_used(astar, astar->fringe_bucket_low) ||
+        (bucket < astar->fringe_bucket_low)) {
+      astar->fringe_bucket_low = bucket;
     }
-    if (!current) {
-      prev->next = node;
-    } else {
-      if (prev) {
-        node->next = prev->next;
-        prev->next = node;
+    astar->fringe_bucket_first[bucket] = fe;
+    astar->fringe_bucket_used[bucket >> 6] |= (uint64_t)1 << (bucket & 63);
+  }
+  astar->fringe_bucket_last[bucket] = fe;
+}
+
+// The lowest bucket in use from bucket up, or 0 if there is none.
+size_t _ai_search_astar_fringe_bucket_next(ai_search_astar *astar,
+                                           size_t bucket) {
+  size_t word = bucket >> 6;
+  uint64_t bits = astar->fringe_bucket_used[word] & (~(uint64_t)0
+                                                     << (bucket & 63));
+  while (!bits) {
+    if (++word >= astar->fringe_bucket_count / 64) {
+      return 0;
+    }
+    bits = astar->fringe_bucket_used[word];
+  }
+  return word * 64 + __builtin_ctzll(bits);
+}
+
+// Move the fringe out of its buckets into its list, in order, so it can be
+// changed or walked as a list. Index it again afterwards.
+void _ai_search_astar_fringe_unindex(ai_search_astar *astar) {
+  if (!_ai_search_astar_fringe_bucketed(astar)) {
+    return;
+  }
+  ai_fringe_element *head = NULL;
+  ai_fringe_element *tail = NULL;
+  for (size_t word = astar->fringe_bucket_low >> 6;
+       word < astar->fringe_bucket_count / 64; word++) {
+    uint64_t bits = astar->fringe_bucket_used[word];
+    for (; bits; bits &= bits - 1) {
+      size_t bucket = word * 64 + __builtin_ctzll(bits);
+      if (tail) {
+        tail->next = astar->fringe_bucket_first[bucket];
       } else {
-        node->next = *fringe_element_list;
-        *fringe_element_list = node;
+        head = astar->fringe_bucket_first[bucket];
       }
+      tail = astar->fringe_bucket_last[bucket];
     }
+    astar->fringe_bucket_used[word] = 0;
+  }
+  // Anything already in the list follows the buckets.
+  if (tail) {
+    tail->next = astar->fringe_list;
+    astar->fringe_list = head;
+  }
+  astar->fringe_bucket_low = 0;
+}
+
+// Move the fringe from its list into its buckets, for a search with
+// fringe_bucket_width, after it was changed as a list. Without memory for
+// the index it stays a sorted list.
+void _ai_search_astar_fringe_index(ai_search_astar *astar) {
+  _ai_search_astar_fringe_unindex(astar);
+  if (astar->fringe_bucket_count) {
+    memset(astar->fringe_bucket_used, 0,
+           sizeof(uint64_t) * astar->fringe_bucket_count / 64);
+  }
+  astar->fringe_bucket_low = 0;
+  if ((astar->fringe_bucket_width <= 0) ||
+      (_ai_search_astar_fringe_bucket_reserve(astar, 0) != 0)) {
+    return;
+  }
+  ai_fringe_element *fe = astar->fringe_list;
+  astar->fringe_list = NULL;
+  while (fe) {
+    ai_fringe_element *next = fe->next;
+    _ai_search_astar_fringe_bucket_append(
+        astar, _ai_search_astar_fringe_bucket_place(astar, fe->est_total_cost),
+        fe);
+    fe = next;
+  }
+}
+
+// True if the fringe holds no Fringe Elements.
+int _ai_search_astar_fringe_is_empty(ai_search_astar *astar) {
+  if (!_ai_search_astar_fringe_bucketed(astar)) {
+    return astar->fringe_list == NULL;
+  }
+  return !_ai_search_astar_fringe_bucket_used(astar, astar->fringe_bucket_low);
+}
+
+// Add a Fringe Element to the search's fringe, in its place by
+// est_total_cost, then tie_break_key.
+void _ai_search_astar_fringe_add(ai_search_astar *astar,
+                                 ai_fringe_element *fe) {
+  fe->tie_break_key = _ai_search_astar_tie_break_key(astar, fe);
+  int before_equal = astar->tie_break == AI_SEARCH_TIE_BREAK_LIFO;
+  if (!_ai_search_astar_fringe_bucketed(astar)) {
+    _ai_fringe_element_list_add(&astar->fringe_list, fe, before_equal);
+    return;
+  }
+  size_t bucket =
+      _ai_search_astar_fringe_bucket_place(astar, fe->est_total_cost);
+  if (!_ai_search_astar_fringe_bucket_used(astar, bucket)) {
+    _ai_search_astar_fringe_bucket_append(astar, bucket, fe);
+    return;
+  }
+  // At either end of the bucket without a walk, when the key allows.
+  ai_fringe_element *first = astar->fringe_bucket_first[bucket];
+  ai_fringe_element *last = astar->fringe_bucket_last[bucket];
+  if ((last->tie_break_key < fe->tie_break_key) ||
+      (!before_equal && (last->tie_break_key == fe->tie_break_key))) {
+    _ai_search_astar_fringe_bucket_append(astar, bucket, fe);
+    return;
+  }
+  if ((first->tie_break_key > fe->tie_break_key) ||
+      (before_equal && (first->tie_break_key == fe->tie_break_key))) {
+    fe->next = first;
+    astar->fringe_bucket_first[bucket] = fe;
+    return;
   }
+  // Along the bucket to the element's place, which is before last.
+  ai_fringe_element *prev = first;
+  while ((prev->next->tie_break_key < fe->tie_break_key) ||
+         (!before_equal && (prev->next->tie_break_key == fe->tie_break_key))) {
+    prev = prev->next;
+  }
+  fe->next = prev->next;
+  prev->next = fe;
+}
+
+// Pop the first Fringe Element of the search's fringe.
+ai_fringe_element *_ai_search_astar_fringe_pop(ai_search_astar *astar) {
+  if (!_ai_search_astar_fringe_bucketed(astar)) {
+    return _ai_fringe_element_list_pop(&astar->fringe_list);
+  }
+  size_t bucket = astar->fringe_bucket_low;
+  if (!_ai_search_astar_fringe_bucket_used(astar, bucket)) {
+    return NULL;
+  }
+  ai_fringe_element *fe = astar->fringe_bucket_first[bucket];
+  astar->fringe_bucket_first[bucket] = fe->next;
+  fe->next = NULL;
+  if (fe == astar->fringe_bucket_last[bucket]) {
+    astar->fringe_bucket_used[bucket >> 6] &= ~((uint64_t)1 << (bucket & 63));
+    astar->fringe_bucket_low =
+        _ai_search_astar_fringe_bucket_next(astar, bucket);
+  }
+  return fe;
 }
 
 // Free the path and any implementation specific data
@@ -194,10 +447,341 @@ void _ai_model_state_free(ai_model_state *model_state,
   }
 }
 
-// private - AStar search algorithm
-ai_path *
-_ai_search_astar_find_path_to_goal(ai_search_astar *astar,
-                                   ai_model_state *initial_model_state) {
+// Bytes held by a Fringe Element, its Model State and its Path.
+size_t
+_ai_fringe_element_memory_size(ai_model_state_evaluator *model_state_evaluator,
+                               ai_fringe_element *fe) {
+  size_t size = sizeof(ai_fringe_element) + sizeof(ai_model_state);
+  if (model_state_evaluator->model_state_data_size && fe->model_state->data) {
+    size += model_state_evaluator->model_state_data_size(fe->model_state->data);
+  }
+  for (ai_path *ptr = fe->path_so_far; ptr; ptr = ptr->next) {
+    size += sizeof(ai_action);
+    if (model_state_evaluator->action_data_size && ptr->data) {
+      size += model_state_evaluator->action_data_size(ptr->data);
+    }
+  }
+  return size;
+}
+
+// Account a new Fringe Element against the search's memory.
+void _ai_search_astar_memory_charge(ai_search_astar *astar,
+                                    ai_fringe_element *fe) {
+  fe->memory_size =
+      _ai_fringe_element_memory_size(astar->model_state_evaluator, fe);
+  astar->memory_used += fe->memory_size;
+  if (astar->memory_used > astar->memory_peak) {
+    astar->memory_peak = astar->memory_used;
+  }
+}
+
+// Account a Model State moved into the closed table against the search's
+// memory. The table keeps at least two slots per state.
+void _ai_search_astar_memory_charge_closed(ai_search_astar *astar,
+                                           ai_model_state *model_state) {
+  ai_model_state_evaluator *model_state_evaluator =
+      astar->model_state_evaluator;
+  size_t size = 2 * sizeof(ai_state_table_entry) + sizeof(ai_model_state);
+  if (model_state_evaluator->model_state_data_size && model_state->data) {
+    size += model_state_evaluator->model_state_data_size(model_state->data);
+  }
+  astar->closed_memory_used += size;
+  astar->memory_used += size;
+  if (astar->memory_used > astar->memory_peak) {
+    astar->memory_peak = astar->memory_used;
+  }
+}
+
+// The estimated cost to the nearest Goal not yet reached, for a multi-goal
+// search.
+float _ai_search_astar_goal_list_est_cost(ai_search_astar *astar,
+                                          ai_model_state *model_state) {
+  ai_state_est_cost_function state_est_cost_function =
+      astar->model_state_evaluator->state_est_cost_function;
+  if (state_est_cost_function == NULL) {
+    return 0;
+  }
+  float cost_to_goal_est = FLT_MAX;
+  for (int i = 0; i < astar->goal_count; i++) {
+    ai_search_goal *goal = &astar->goal_list[i];
+    if (!goal->reached) {
+      float cost = state_est_cost_function(model_state, goal->model_state);
+      if (cost < cost_to_goal_est) {
+        cost_to_goal_est = cost;
+      }
+    }
+  }
+  return cost_to_goal_est == FLT_MAX ? 0 : cost_to_goal_est;
+}
+
+// The priority key of a fringe element, for the search mode.
+// The heuristic is only called if the mode needs it.
+float _ai_search_astar_est_total_cost(ai_search_astar *astar,
+                                      ai_model_state *model_state,
+                                      float cost_so_far) {
+  ai_search_mode search_mode = astar->search_mode;
+  ai_goal_est_cost_function goal_est_cost_function =
+      astar->model_state_evaluator->goal_est_cost_function;
+  if ((search_mode == AI_SEARCH_MODE_DIJKSTRA) ||
+      (!astar->goal_list && (goal_est_cost_function == NULL))) {
+    return search_mode == AI_SEARCH_MODE_GREEDY ? 0 : cost_so_far;
+  }
+  float cost_to_goal_est =
+      astar->goal_list
+          ? _ai_search_astar_goal_list_est_cost(astar, model_state)
+          : goal_est_cost_function(model_state);
+  if (search_mode == AI_SEARCH_MODE_GREEDY) {
+    return cost_to_goal_est;
+  }
+  return cost_so_far + cost_to_goal_est;
+}
+
+// True if the successors of an expansion are estimated together, with the
+// evaluator's goal_est_cost_batch_function.
+int _ai_search_astar_est_batch(ai_search_astar *astar) {
+  return astar->model_state_evaluator->goal_est_cost_batch_function &&
+         !astar->goal_list && (astar->search_mode != AI_SEARCH_MODE_DIJKSTRA);
+}
+
+// Estimate a list of new fringe elements, linked by next, together, and add
+// each to the fringe in order. Returns 0, or -1 if out of memory, when the
+// elements are estimated one at a time instead.
+int _ai_search_astar_est_batch_add(ai_search_astar *astar,
+                                   ai_fringe_element *fe_list) {
+  int count = 0;
+  for (ai_fringe_element *fe = fe_list; fe; fe = fe->next) {
+    count++;
+  }
+  int result = 0;
+  if (count > astar->est_batch_size) {
+    ai_model_state **model_state_list = (ai_model_state **)realloc(
+        astar->est_batch_model_state_list, sizeof(ai_model_state *) * count);
+    if (model_state_list) {
+      astar->est_batch_model_state_list = model_state_list;
+    }
+    float *cost_list =
+        (float *)realloc(astar->est_batch_cost_list, sizeof(float) * count);
+    if (cost_list) {
+      astar->est_batch_cost_list = cost_list;
+    }
+    if (model_state_list && cost_list) {
+      astar->est_batch_size = count;
+    } else {
+      log_error("_ai_search_astar_est_batch_add malloc failed");
+      result = -1;
+    }
+  }
+  if (result == 0) {
+    int i = 0;
+    for (ai_fringe_element *fe = fe_list; fe; fe = fe->next) {
+      astar->est_batch_model_state_list[i++] = fe->model_state;
+    }
+    astar->model_state_evaluator->goal_est_cost_batch_function(
+        astar->est_batch_model_state_list, count, astar->est_batch_cost_list);
+  }
+  ai_fringe_element *fe_next = NULL;
+  int i = 0;
+  for (ai_fringe_element *fe = fe_list; fe; fe = fe_next) {
+    fe_next = fe->next;
+    fe->next = NULL;
+    if (result != 0) {
+      fe->est_total_cost = _ai_search_astar_est_total_cost(
+          astar, fe->model_state, fe->cost_so_far);
+    } else if (astar->search_mode == AI_SEARCH_MODE_GREEDY) {
+      fe->est_total_cost = astar->est_batch_cost_list[i];
+    } else {
+      fe->est_total_cost = fe->cost_so_far + astar->est_batch_cost_list[i];
+    }
+    i++;
+    _ai_search_astar_fringe_add(astar, fe);
+  }
+  return result;
+}
+
+// The index, from goal_index on, of the next Goal not yet reached that is
+// the Model State, or -1.
+int _ai_search_astar_goal_list_find(ai_search_astar *astar,
+                                    ai_model_state *model_state, size_t hash,
+                                    int goal_index) {
+  ai_model_state_evaluator *model_state_evaluator =
+      astar->model_state_evaluator;
+  for (int i = goal_index; i < astar->goal_count; i++) {
+    ai_search_goal *goal = &astar->goal_list[i];
+    if (!goal->reached && (goal->hash == hash) &&
+        model_state_evaluator->model_state_equal_function(goal->model_state,
+                                                          model_state)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Free the Goals of a multi-goal search, and any paths not yet taken.
+void _ai_search_astar_goal_list_free(ai_search_astar *astar) {
+  ai_model_state_evaluator *model_state_evaluator =
+      astar->model_state_evaluator;
+  for (int i = 0; i < astar->goal_count; i++) {
+    _ai_model_state_free(astar->goal_list[i].model_state,
+                         model_state_evaluator->model_state_data_free);
+    _ai_path_free(astar->goal_list[i].path,
+                  model_state_evaluator->action_data_free);
+  }
+  free(astar->goal_list);
+  astar->goal_list = NULL;
+  astar->goal_count = 0;
+  astar->goal_remaining_count = 0;
+}
+
+// A Fringe Element and its position in the fringe, for sorting.
+typedef struct _ai_fringe_element_order_struct {
+  ai_fringe_element *fe;
+  int order;
+} _ai_fringe_element_order;
+
+int _ai_fringe_element_compare_by_total_cost(const void *a, const void *b) {
+  const _ai_fringe_element_order *oa = (const _ai_fringe_element_order *)a;
+  const _ai_fringe_element_order *ob = (const _ai_fringe_element_order *)b;
+  if (oa->fe->est_total_cost != ob->fe->est_total_cost) {
+    return oa->fe->est_total_cost < ob->fe->est_total_cost ? -1 : 1;
+  }
+  if (oa->fe->tie_break_key != ob->fe->tie_break_key) {
+    return oa->fe->tie_break_key < ob->fe->tie_break_key ? -1 : 1;
+  }
+  // Keep the existing order among equals.
+  return oa->order - ob->order;
+}
+
+// Recalculate the key of every Fringe Element, and sort the fringe again.
+// Used when the heuristic changes part way through a search.
+void _ai_search_astar_fringe_rekey(ai_search_astar *astar) {
+  _ai_search_astar_fringe_unindex(astar);
+  int count = 0;
+  for (ai_fringe_element *fe = astar->fringe_list; fe; fe = fe->next) {
+    count++;
+  }
+  if (count == 0) {
+    _ai_search_astar_fringe_index(astar);
+    return;
+  }
+  _ai_fringe_element_order *fringe_array = (_ai_fringe_element_order *)malloc(
+      sizeof(_ai_fringe_element_order) * count);
+  check(fringe_array, "_ai_search_astar_fringe_rekey malloc failed");
+  ai_fringe_element *fe = astar->fringe_list;
+  for (int i = 0; i < count; i++, fe = fe->next) {
+    fe->est_total_cost =
+        _ai_search_astar_est_total_cost(astar, fe->model_state, fe->cost_so_far);
+    fringe_array[i].fe = fe;
+    fringe_array[i].order = i;
+  }
+  qsort(fringe_array, count, sizeof(_ai_fringe_element_order),
+        _ai_fringe_element_compare_by_total_cost);
+  for (int i = 0; i < count; i++) {
+    fringe_array[i].fe->next = (i + 1 < count) ? fringe_array[i + 1].fe : NULL;
+  }
+  astar->fringe_list = fringe_array[0].fe;
+  free(fringe_array);
+error:
+  _ai_search_astar_fringe_index(astar);
+}
+
+// Keep the cheapest Fringe Elements that fit within memory_budget, and free
+// the rest. The first element is always kept.
+// Returns the number of elements freed. memory_kept is set to the bytes kept.
+int _ai_fringe_element_list_prune(ai_fringe_element **fringe_element_list,
+                                  size_t memory_budget, size_t *memory_kept,
+                                  ai_model_state_data_free model_state_data_free,
+                                  ai_action_data_free action_data_free) {
+  int pruned_count = 0;
+  size_t kept = 0;
+  ai_fringe_element *prev = NULL;
+  ai_fringe_element *current = *fringe_element_list;
+  while (current && (!prev || kept + current->memory_size <= memory_budget)) {
+    kept += current->memory_size;
+    prev = current;
+    current = current->next;
+  }
+  if (prev) {
+    prev->next = NULL;
+  }
+  while (current) {
+    ai_fringe_element *next = current->next;
+    _ai_model_state_free(current->model_state, model_state_data_free);
+    _ai_path_free(current->path_so_far, action_data_free);
+    free(current);
+    current = next;
+    pruned_count++;
+  }
+  *memory_kept = kept;
+  return pruned_count;
+}
+
+// Free every element left in the fringe.
+void _ai_fringe_element_list_free(ai_fringe_element **fringe_element_list,
+                                  ai_model_state_data_free model_state_data_free,
+                                  ai_action_data_free action_data_free) {
+  ai_fringe_element *current_fe = NULL;
+  while ((current_fe = _ai_fringe_element_list_pop(fringe_element_list)) !=
+         NULL) {
+    _ai_model_state_free(current_fe->model_state, model_state_data_free);
+    _ai_path_free(current_fe->path_so_far, action_data_free);
+    free(current_fe);
+  }
+}
+
+// Start a new search from a copy of the initial Model State.
+void ai_search_astar_begin(ai_search_astar *astar,
+                           ai_model_state *initial_model_state) {
+  check(astar, "ai_search_astar_begin astar was NULL");
+  ai_model_state_evaluator *model_state_evaluator =
+      astar->model_state_evaluator;
+
+  // Discard anything left from a previous search.
+  _ai_path_free(ai_search_astar_end(astar),
+                model_state_evaluator->action_data_free);
+  _ai_search_astar_goal_list_free(astar);
+
+  ai_model_state *dup_initial_model_state = _ai_model_state_duplicate(
+      initial_model_state, model_state_evaluator->model_state_data_duplicator);
+  // Technically the cost should be remaining distance to goal, but
+  // it is the only item in the fringe so will be popped regardless.
+  ai_fringe_element *fe =
+      ai_fringe_element_constructor(dup_initial_model_state, NULL, 0, 0);
+  astar->fringe_list = fe;
+  astar->result_path = NULL;
+  astar->goal_reached = 0;
+  astar->memory_used = 0;
+  astar->memory_peak = 0;
+  astar->closed_memory_used = 0;
+  astar->fringe_pruned_count = 0;
+  astar->successor_filtered_count = 0;
+  _ai_search_astar_memory_charge(astar, fe);
+  astar->tie_break_random = astar->tie_break_seed;
+  _ai_search_astar_fringe_index(astar);
+  ai_state_table_free(astar->closed);
+  astar->closed = NULL;
+  if (model_state_evaluator->model_state_hash_function &&
+      model_state_evaluator->model_state_equal_function) {
+    astar->closed = ai_state_table_constructor(model_state_evaluator);
+    fe->hash = model_state_evaluator->model_state_hash_function(
+        dup_initial_model_state);
+  }
+  // Without a closed table a cycle keeps the fringe from ever emptying.
+  check(astar->closed || !astar->continue_past_goal,
+        "ai_search_astar_begin continue_past_goal needs the evaluator's hash "
+        "and equal functions");
+  astar->status = AI_SEARCH_STATUS_RUNNING;
+  return;
+error:
+  if (astar) {
+    ai_search_astar_end(astar);
+    astar->status = AI_SEARCH_STATUS_IDLE;
+  }
+  return;
+}
+
+// AStar search algorithm. Expand up to expansion_quantum fringe elements.
+ai_search_status ai_search_astar_step(ai_search_astar *astar,
+                                      int expansion_quantum) {
 
   // Aliases for functions that are Model State and Action specific.
   ai_model_state_evaluator *model_state_evaluator =
@@ -208,84 +792,296 @@ _ai_search_astar_find_path_to_goal(ai_search_astar *astar,
       model_state_evaluator->transition_function;
   ai_is_goal_state_function is_goal_state_function =
       model_state_evaluator->is_goal_state_function;
-  ai_goal_est_cost_function goal_est_cost_function =
-      model_state_evaluator->goal_est_cost_function;
-  ai_model_state_data_duplicator model_state_data_duplicator =
-      model_state_evaluator->model_state_data_duplicator;
   ai_model_state_data_free model_state_data_free =
       model_state_evaluator->model_state_data_free;
   ai_action_data_duplicator action_data_duplicator =
       model_state_evaluator->action_data_duplicator;
   ai_action_data_free action_data_free =
       model_state_evaluator->action_data_free;
+  ai_model_state_hash_function model_state_hash_function =
+      model_state_evaluator->model_state_hash_function;
+  ai_model_state_hash_update_function model_state_hash_update_function =
+      model_state_evaluator->model_state_hash_update_function;
 
-  // Init
-  ai_model_state *dup_initial_model_state = _ai_model_state_duplicate(
-      initial_model_state, model_state_data_duplicator);
-  // Technically the cost should be remaining distance to goal, but
-  // it is the only item in the fringe so will be popped regardless.
-  ai_fringe_element *fringe_list =
-      ai_fringe_element_constructor(dup_initial_model_state, NULL, 0, 0);
-  ai_path *result_path = NULL;
+  ai_state_table *closed = astar->closed;
+  int est_batch = _ai_search_astar_est_batch(astar);
+  int quantum_count = 0;
 
   // Begin of fringe expansion loop.
-  while ((fringe_list != NULL) &&
-         ((astar->fringe_expansion_max == 0) ||
-          (astar->fringe_expansion_count < astar->fringe_expansion_max))) {
-    astar->fringe_expansion_count++;
+  while (astar->status == AI_SEARCH_STATUS_RUNNING) {
+    if (_ai_search_astar_fringe_is_empty(astar)) {
+      // A multi-goal search is FOUND only once every Goal is reached.
+      astar->status = (astar->goal_reached && !astar->goal_list)
+                          ? AI_SEARCH_STATUS_FOUND
+                          : AI_SEARCH_STATUS_NOT_FOUND;
+      break;
+    }
+    if ((astar->fringe_expansion_max != 0) &&
+        (astar->fringe_expansion_count >= astar->fringe_expansion_max)) {
+      astar->status = AI_SEARCH_STATUS_EXPANSION_LIMIT;
+      break;
+    }
+    if ((expansion_quantum != 0) && (quantum_count >= expansion_quantum)) {
+      break;
+    }
 
-    ai_fringe_element *fringe = _ai_fringe_element_list_pop(&fringe_list);
+    ai_fringe_element *fringe = _ai_search_astar_fringe_pop(astar);
     ai_model_state *current_model_state = fringe->model_state;
     ai_path *current_path_so_far = fringe->path_so_far;
     float cost_so_far = fringe->cost_so_far;
+    size_t hash = fringe->hash;
+    astar->memory_used -= fringe->memory_size;
     free(fringe);
 
-    if (is_goal_state_function(current_model_state)) {
-      result_path = current_path_so_far;
-      break;
+    // A state is expanded once, when first popped at its lowest cost.
+    // The closed table then owns the Model State.
+    if (closed) {
+      if (ai_state_table_find_hashed(closed, current_model_state, hash)) {
+        _ai_path_free(current_path_so_far, action_data_free);
+        _ai_model_state_free(current_model_state, model_state_data_free);
+        continue;
+      }
+      if (!ai_state_table_insert_hashed(closed, current_model_state, hash,
+                                        cost_so_far)) {
+        _ai_path_free(current_path_so_far, action_data_free);
+        _ai_model_state_free(current_model_state, model_state_data_free);
+        astar->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+        break;
+      }
+      _ai_search_astar_memory_charge_closed(astar, current_model_state);
+    }
+    quantum_count++;
+    astar->fringe_expansion_count++;
+
+    int keep_path = 0;
+    int goal_index = -1;
+    if (astar->goal_list) {
+      goal_index =
+          _ai_search_astar_goal_list_find(astar, current_model_state, hash, 0);
+    }
+    if (goal_index >= 0) {
+      astar->goal_reached = 1;
+      // The same state may be given as more than one Goal.
+      for (; goal_index >= 0;
+           goal_index = _ai_search_astar_goal_list_find(
+               astar, current_model_state, hash, goal_index + 1)) {
+        ai_search_goal *goal = &astar->goal_list[goal_index];
+        goal->reached = 1;
+        goal->cost = cost_so_far;
+        if (--astar->goal_remaining_count == 0) {
+          goal->path = current_path_so_far;
+          astar->status = AI_SEARCH_STATUS_FOUND;
+          break;
+        }
+        goal->path =
+            _ai_path_duplicate(action_data_duplicator, current_path_so_far);
+      }
+      if (astar->status == AI_SEARCH_STATUS_FOUND) {
+        break;
+      }
+      // The nearest Goal not yet reached may now be further away.
+      _ai_search_astar_fringe_rekey(astar);
+    } else if (!astar->goal_list && !astar->goal_reached &&
+               is_goal_state_function(current_model_state)) {
+      astar->result_path = current_path_so_far;
+      astar->goal_reached = 1;
+      if (!astar->continue_past_goal) {
+        astar->status = AI_SEARCH_STATUS_FOUND;
+        if (!closed) {
+          _ai_model_state_free(current_model_state, model_state_data_free);
+        }
+        break;
+      }
+      keep_path = 1;
     }
     ai_successor *successor_list =
         successor_function(current_model_state, transition_function);
     ai_successor *successor_next = NULL;
+    // Successors to estimate together, in order.
+    ai_fringe_element *est_batch_list = NULL;
+    ai_fringe_element *est_batch_last = NULL;
     for (ai_successor *successor = successor_list; successor != NULL;
          successor = successor_next) {
       ai_model_state *successor_model_state = successor->model_state;
-      // TODO check if we have seen this state before
-      // TODO add this model state to states we have seen.
+      successor_next = successor->next;
+      int filtered = astar->successor_filter_function &&
+                     !astar->successor_filter_function(
+                         astar->successor_filter_data, current_model_state,
+                         successor);
+      if (filtered) {
+        astar->successor_filtered_count++;
+      }
+      size_t successor_hash = 0;
+      if (closed && !filtered) {
+        successor_hash =
+            model_state_hash_update_function
+                ? model_state_hash_update_function(hash, current_model_state,
+                                                   successor->action)
+                : model_state_hash_function(successor_model_state);
+      }
+      if (filtered || (closed && ai_state_table_find_hashed(
+                                     closed, successor_model_state,
+                                     successor_hash))) {
+        successor->action->next = NULL;
+        _ai_path_free(successor->action, action_data_free);
+        _ai_model_state_free(successor_model_state, model_state_data_free);
+        free(successor);
+        continue;
+      }
       ai_path *new_path_so_far =
           _ai_path_duplicate(action_data_duplicator, current_path_so_far);
       _ai_path_append_action(&new_path_so_far, successor->action);
       float new_cost_so_far = cost_so_far + successor->cost;
-      successor_next = successor->next;
       free(successor);
       successor = NULL;
 
-      float cost_to_goal_est = 0;
-      if (goal_est_cost_function != NULL) {
-        cost_to_goal_est = goal_est_cost_function(successor_model_state);
-      }
       ai_fringe_element *fringe_element_new = ai_fringe_element_constructor(
           successor_model_state, new_path_so_far, new_cost_so_far,
-          new_cost_so_far + cost_to_goal_est);
-      _ai_fringe_element_list_add_by_total_cost(&fringe_list,
-                                                fringe_element_new);
+          est_batch ? 0
+                    : _ai_search_astar_est_total_cost(
+                          astar, successor_model_state, new_cost_so_far));
+      fringe_element_new->hash = successor_hash;
+      _ai_search_astar_memory_charge(astar, fringe_element_new);
+      if (!est_batch) {
+        _ai_search_astar_fringe_add(astar, fringe_element_new);
+      } else if (est_batch_last) {
+        est_batch_last->next = fringe_element_new;
+        est_batch_last = fringe_element_new;
+      } else {
+        est_batch_list = est_batch_last = fringe_element_new;
+      }
+    }
+    if (est_batch_list) {
+      _ai_search_astar_est_batch_add(astar, est_batch_list);
     }
     // TODO free as much mem as possible
-    _ai_path_free(current_path_so_far, action_data_free);
-
+    if (!keep_path) {
+      _ai_path_free(current_path_so_far, action_data_free);
+    }
     current_path_so_far = NULL;
-    _ai_model_state_free(current_model_state, model_state_data_free);
+    if (!closed) {
+      _ai_model_state_free(current_model_state, model_state_data_free);
+    }
     current_model_state = NULL;
+
+    if (astar->memory_budget && (astar->memory_used > astar->memory_budget)) {
+      if ((astar->memory_policy == AI_SEARCH_MEMORY_POLICY_PRUNE) &&
+          (astar->closed_memory_used < astar->memory_budget)) {
+        size_t fringe_memory_used = 0;
+        _ai_search_astar_fringe_unindex(astar);
+        astar->fringe_pruned_count += _ai_fringe_element_list_prune(
+            &astar->fringe_list,
+            astar->memory_budget - astar->closed_memory_used,
+            &fringe_memory_used, model_state_data_free, action_data_free);
+        astar->memory_used = astar->closed_memory_used + fringe_memory_used;
+        _ai_search_astar_fringe_index(astar);
+      } else {
+        astar->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+      }
+    }
+    if (astar->checkpoint_interval && astar->checkpoint_file_name &&
+        (astar->fringe_expansion_count % astar->checkpoint_interval == 0)) {
+      ai_search_astar_checkpoint(astar, astar->checkpoint_file_name);
+    }
   }
-  // Free the fringe
-  ai_fringe_element *current_fe = NULL;
-  while ((current_fe = _ai_fringe_element_list_pop(&fringe_list)) != NULL) {
-    _ai_model_state_free(current_fe->model_state, model_state_data_free);
-    _ai_path_free(current_fe->path_so_far, action_data_free);
-    free(current_fe);
+  return astar->status;
+}
+
+// Finish the search. Free the fringe and hand the path to the caller.
+ai_path *ai_search_astar_end(ai_search_astar *astar) {
+  ai_model_state_evaluator *model_state_evaluator =
+      astar->model_state_evaluator;
+  _ai_search_astar_fringe_unindex(astar);
+  _ai_fringe_element_list_free(&astar->fringe_list,
+                               model_state_evaluator->model_state_data_free,
+                               model_state_evaluator->action_data_free);
+  _ai_search_astar_fringe_index(astar);
+  // The closed table is kept for the caller.
+  astar->memory_used = astar->closed_memory_used;
+  if (astar->status == AI_SEARCH_STATUS_RUNNING) {
+    astar->status = AI_SEARCH_STATUS_CANCELLED;
   }
+  ai_path *result_path = astar->result_path;
+  astar->result_path = NULL;
   return result_path;
 }
+
+// Start a search for paths to each of the Goal Model States.
+void ai_search_astar_begin_multi_goal(ai_search_astar *astar,
+                                      ai_model_state *initial_model_state,
+                                      ai_model_state **goal_model_states,
+                                      int goal_count) {
+  ai_model_state_evaluator *model_state_evaluator =
+      astar->model_state_evaluator;
+  ai_search_astar_begin(astar, initial_model_state);
+  check(astar->closed,
+        "ai_search_astar_begin_multi_goal evaluator has no hash or equal "
+        "function");
+  astar->goal_list =
+      (ai_search_goal *)calloc(goal_count ? goal_count : 1, sizeof(ai_search_goal));
+  check(astar->goal_list, "ai_search_astar_begin_multi_goal malloc failed");
+  for (int i = 0; i < goal_count; i++) {
+    ai_search_goal *goal = &astar->goal_list[i];
+    goal->model_state = _ai_model_state_duplicate(
+        goal_model_states[i],
+        model_state_evaluator->model_state_data_duplicator);
+    goal->hash =
+        model_state_evaluator->model_state_hash_function(goal->model_state);
+    goal->cost = FLT_MAX;
+  }
+  astar->goal_count = goal_count;
+  astar->goal_remaining_count = goal_count;
+  if (goal_count == 0) {
+    astar->status = AI_SEARCH_STATUS_FOUND;
+  }
+  return;
+error:
+  ai_search_astar_end(astar);
+  astar->status = AI_SEARCH_STATUS_IDLE;
+}
+
+int ai_search_astar_take_goal_path(ai_search_astar *astar, int goal_index,
+                                   ai_path **path, float *cost) {
+  check((goal_index >= 0) && (goal_index < astar->goal_count),
+        "ai_search_astar_take_goal_path goal_index out of range");
+  ai_search_goal *goal = &astar->goal_list[goal_index];
+  *path = goal->path;
+  *cost = goal->cost;
+  goal->path = NULL;
+  return goal->reached ? 0 : -1;
+error:
+  *path = NULL;
+  *cost = FLT_MAX;
+  return -1;
+}
+
+int ai_search_astar_find_paths_to_goals(ai_search_astar *astar,
+                                        ai_model_state *initial_model_state,
+                                        ai_model_state **goal_model_states,
+                                        int goal_count, ai_path **paths,
+                                        float *costs) {
+  ai_search_astar_begin_multi_goal(astar, initial_model_state,
+                                   goal_model_states, goal_count);
+  ai_search_astar_step(astar, 0);
+  ai_search_astar_end(astar);
+  int reached_count = 0;
+  for (int i = 0; i < goal_count; i++) {
+    if (ai_search_astar_take_goal_path(astar, i, &paths[i], &costs[i]) == 0) {
+      reached_count++;
+    }
+  }
+  return reached_count;
+}
+
+// private - AStar search algorithm, run to completion.
+ai_path *
+_ai_search_astar_find_path_to_goal(ai_search_astar *astar,
+                                   ai_model_state *initial_model_state) {
+  ai_search_astar_begin(astar, initial_model_state);
+  ai_search_astar_step(astar, 0);
+  return ai_search_astar_end(astar);
+}
+
 // ai_search_astar *astar = ai_search_astar_constructor(model_state_evaluator);
 // ai_path *path = astar->find_path_to_goal(astar, model_state );
 ai_search_astar *
@@ -296,7 +1092,57 @@ ai_search_astar_constructor(ai_model_state_evaluator *model_state_evaluator) {
   astar->model_state_evaluator = model_state_evaluator;
   astar->fringe_expansion_count = 0;
   astar->fringe_expansion_max = 0;
+  astar->memory_budget = 0;
+  astar->memory_policy = AI_SEARCH_MEMORY_POLICY_ABORT;
+  astar->memory_used = 0;
+  astar->memory_peak = 0;
+  astar->fringe_pruned_count = 0;
+  astar->search_mode = AI_SEARCH_MODE_ASTAR;
+  astar->tie_break = AI_SEARCH_TIE_BREAK_FIFO;
+  astar->tie_break_seed = 1;
+  astar->tie_break_random = 1;
+  astar->continue_past_goal = 0;
+  astar->successor_filter_function = NULL;
+  astar->successor_filter_data = NULL;
+  astar->successor_filtered_count = 0;
+  astar->checkpoint_file_name = NULL;
+  astar->checkpoint_interval = 0;
+  astar->checkpoint_count = 0;
+  astar->closed = NULL;
+  astar->goal_reached = 0;
+  astar->closed_memory_used = 0;
+  astar->goal_list = NULL;
+  astar->goal_count = 0;
+  astar->goal_remaining_count = 0;
+  astar->status = AI_SEARCH_STATUS_IDLE;
+  astar->fringe_bucket_width = 0;
+  astar->fringe_list = NULL;
+  astar->fringe_bucket_first = NULL;
+  astar->fringe_bucket_last = NULL;
+  astar->fringe_bucket_used = NULL;
+  astar->fringe_bucket_count = 0;
+  astar->fringe_bucket_low = 0;
+  astar->est_batch_model_state_list = NULL;
+  astar->est_batch_cost_list = NULL;
+  astar->est_batch_size = 0;
+  astar->result_path = NULL;
   return astar;
 error:
   return NULL;
 }
+
+// Free the search, and anything left from a search in progress.
+void ai_search_astar_free(ai_search_astar *astar) {
+  if (astar) {
+    _ai_path_free(ai_search_astar_end(astar),
+                  astar->model_state_evaluator->action_data_free);
+    _ai_search_astar_goal_list_free(astar);
+    ai_state_table_free(astar->closed);
+    free(astar->fringe_bucket_first);
+    free(astar->fringe_bucket_last);
+    free(astar->fringe_bucket_used);
+    free(astar->est_batch_model_state_list);
+    free(astar->est_batch_cost_list);
+    free(astar);
+  }
+}
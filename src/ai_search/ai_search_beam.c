@@ -0,0 +1,334 @@
+/*
+ * AI - Beam Search.
+ *
+ * http://en.wikipedia.org/wiki/Beam_search
+ *
+ * Each depth (layer) is expanded in full. The successors of the whole layer
+ * are gathered as candidates, sorted by est_total_cost, and the best
+ * beam_width become the next layer. Every node kept is also held in a flat
+ * node list so the search can be freed in one pass.
+ */
+#include "ai_search_internal.h"
+#include <ai_search_beam.h>
+#include <ai_state_table.h>
+#include <logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A successor that may become a node of the next layer.
+typedef struct _ai_beam_candidate_struct {
+  ai_model_state *model_state;
+  ai_action *action;
+  ai_beam_node *parent;
+  float cost_so_far;
+  float est_total_cost;
+  int order; // Generation order, breaks ties.
+} _ai_beam_candidate;
+
+// Add a new node to the search.
+ai_beam_node *_ai_beam_node_constructor(ai_search_beam *beam,
+                                        ai_model_state *model_state,
+                                        ai_action *action, ai_beam_node *parent,
+                                        float cost_so_far,
+                                        float est_total_cost) {
+  ai_beam_node *node = (ai_beam_node *)malloc(sizeof(ai_beam_node));
+  check(node, "_ai_beam_node_constructor malloc failed");
+  if (beam->node_count == beam->node_list_size) {
+    int new_size = beam->node_list_size ? beam->node_list_size * 2 : 64;
+    ai_beam_node **new_list = (ai_beam_node **)realloc(
+        beam->node_list, sizeof(ai_beam_node *) * new_size);
+    check(new_list, "_ai_beam_node_constructor realloc failed");
+    beam->node_list = new_list;
+    beam->node_list_size = new_size;
+  }
+  node->model_state = model_state;
+  node->action = action;
+  node->parent = parent;
+  node->cost_so_far = cost_so_far;
+  node->est_total_cost = est_total_cost;
+  beam->node_list[beam->node_count++] = node;
+  return node;
+error:
+  free(node);
+  return NULL;
+}
+
+// Drop the Model State of a node whose layer has been expanded.
+// Model States in the closed table are owned by the table.
+void _ai_beam_node_release_model_state(ai_search_beam *beam,
+                                       ai_beam_node *node) {
+  if (!beam->closed) {
+    _ai_model_state_free(node->model_state,
+                         beam->model_state_evaluator->model_state_data_free);
+  }
+  node->model_state = NULL;
+}
+
+// Free every node held.
+void _ai_beam_node_list_free(ai_search_beam *beam) {
+  for (int i = 0; i < beam->node_count; i++) {
+    ai_beam_node *node = beam->node_list[i];
+    _ai_beam_node_release_model_state(beam, node);
+    _ai_path_free(node->action, beam->model_state_evaluator->action_data_free);
+    free(node);
+  }
+  beam->node_count = 0;
+}
+
+void _ai_beam_candidate_free(ai_search_beam *beam,
+                             _ai_beam_candidate *candidate) {
+  ai_model_state_evaluator *model_state_evaluator =
+      beam->model_state_evaluator;
+  _ai_model_state_free(candidate->model_state,
+                       model_state_evaluator->model_state_data_free);
+  _ai_path_free(candidate->action, model_state_evaluator->action_data_free);
+}
+
+int _ai_beam_candidate_compare(const void *a, const void *b) {
+  const _ai_beam_candidate *ca = (const _ai_beam_candidate *)a;
+  const _ai_beam_candidate *cb = (const _ai_beam_candidate *)b;
+  if (ca->est_total_cost != cb->est_total_cost) {
+    return ca->est_total_cost < cb->est_total_cost ? -1 : 1;
+  }
+  return ca->order - cb->order;
+}
+
+// Build the path to the node from the actions of its ancestors.
+ai_path *_ai_beam_path(ai_search_beam *beam, ai_beam_node *node) {
+  ai_action_data_duplicator action_data_duplicator =
+      beam->model_state_evaluator->action_data_duplicator;
+  ai_path *path = NULL;
+  for (; node->parent; node = node->parent) {
+    ai_action *action =
+        ai_action_constructor(action_data_duplicator(node->action->data));
+    action->next = path;
+    path = action;
+  }
+  return path;
+}
+
+// private - Beam search algorithm
+ai_path *
+_ai_search_beam_find_path_to_goal(ai_search_beam *beam,
+                                  ai_model_state *initial_model_state) {
+  ai_model_state_evaluator *model_state_evaluator =
+      beam->model_state_evaluator;
+  ai_goal_est_cost_function goal_est_cost_function =
+      model_state_evaluator->goal_est_cost_function;
+  ai_path *result_path = NULL;
+  int beam_width = beam->beam_width;
+  ai_beam_node **layer =
+      (ai_beam_node **)malloc(sizeof(ai_beam_node *) * beam_width);
+  ai_beam_node **next_layer =
+      (ai_beam_node **)malloc(sizeof(ai_beam_node *) * beam_width);
+  _ai_beam_candidate *candidate_list = NULL;
+  int candidate_list_size = 0;
+  beam->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+  check(layer && next_layer,
+        "_ai_search_beam_find_path_to_goal malloc failed");
+
+  if (model_state_evaluator->model_state_hash_function &&
+      model_state_evaluator->model_state_equal_function) {
+    beam->closed = ai_state_table_constructor(model_state_evaluator);
+  }
+  ai_model_state *dup_initial_model_state = _ai_model_state_duplicate(
+      initial_model_state, model_state_evaluator->model_state_data_duplicator);
+  if (beam->closed &&
+      !ai_state_table_insert(beam->closed, dup_initial_model_state, 0)) {
+    _ai_model_state_free(dup_initial_model_state,
+                         model_state_evaluator->model_state_data_free);
+    beam->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+    goto error;
+  }
+  layer[0] = _ai_beam_node_constructor(beam, dup_initial_model_state, NULL,
+                                       NULL, 0, 0);
+  int layer_count = 1;
+  beam->depth = 0;
+  beam->status = AI_SEARCH_STATUS_RUNNING;
+
+  while (beam->status == AI_SEARCH_STATUS_RUNNING) {
+    // The cheapest Goal in this layer, if any.
+    ai_beam_node *goal_node = NULL;
+    for (int i = 0; i < layer_count; i++) {
+      ai_beam_node *node = layer[i];
+      if ((!goal_node || (node->cost_so_far < goal_node->cost_so_far)) &&
+          model_state_evaluator->is_goal_state_function(node->model_state)) {
+        goal_node = node;
+      }
+    }
+    if (goal_node) {
+      result_path = _ai_beam_path(beam, goal_node);
+      beam->status = AI_SEARCH_STATUS_FOUND;
+      break;
+    }
+    if (beam->depth_max && (beam->depth >= beam->depth_max)) {
+      beam->status = AI_SEARCH_STATUS_NOT_FOUND;
+      break;
+    }
+
+    // Gather the successors of the whole layer.
+    int candidate_count = 0;
+    for (int i = 0;
+         (i < layer_count) && (beam->status == AI_SEARCH_STATUS_RUNNING);
+         i++) {
+      if ((beam->fringe_expansion_max != 0) &&
+          (beam->fringe_expansion_count >= beam->fringe_expansion_max)) {
+        beam->status = AI_SEARCH_STATUS_EXPANSION_LIMIT;
+        break;
+      }
+      beam->fringe_expansion_count++;
+      ai_beam_node *node = layer[i];
+      ai_successor *successor_list = model_state_evaluator->successor_function(
+          node->model_state, model_state_evaluator->transition_function);
+      ai_successor *successor_next = NULL;
+      for (ai_successor *successor = successor_list; successor != NULL;
+           successor = successor_next) {
+        successor_next = successor->next;
+        if (candidate_count == candidate_list_size) {
+          int new_size = candidate_list_size ? candidate_list_size * 2
+                                             : beam_width * 8;
+          _ai_beam_candidate *new_list = (_ai_beam_candidate *)realloc(
+              candidate_list, sizeof(_ai_beam_candidate) * new_size);
+          if (!new_list) {
+            // Drop this and the remaining successors; those gathered are
+            // freed below.
+            for (; successor != NULL; successor = successor_next) {
+              successor_next = successor->next;
+              successor->action->next = NULL;
+              _ai_model_state_free(
+                  successor->model_state,
+                  model_state_evaluator->model_state_data_free);
+              _ai_path_free(successor->action,
+                            model_state_evaluator->action_data_free);
+              free(successor);
+            }
+            beam->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+            break;
+          }
+          candidate_list = new_list;
+          candidate_list_size = new_size;
+        }
+        _ai_beam_candidate *candidate = &candidate_list[candidate_count];
+        candidate->model_state = successor->model_state;
+        candidate->action = successor->action;
+        candidate->action->next = NULL;
+        candidate->parent = node;
+        candidate->cost_so_far = node->cost_so_far + successor->cost;
+        candidate->est_total_cost = candidate->cost_so_far;
+        if (goal_est_cost_function != NULL) {
+          candidate->est_total_cost +=
+              goal_est_cost_function(candidate->model_state);
+        }
+        candidate->order = candidate_count++;
+        free(successor);
+      }
+    }
+    for (int i = 0; i < layer_count; i++) {
+      _ai_beam_node_release_model_state(beam, layer[i]);
+    }
+    if (beam->status != AI_SEARCH_STATUS_RUNNING) {
+      for (int i = 0; i < candidate_count; i++) {
+        _ai_beam_candidate_free(beam, &candidate_list[i]);
+      }
+      break;
+    }
+
+    // Keep the best beam_width as the next layer.
+    qsort(candidate_list, candidate_count, sizeof(_ai_beam_candidate),
+          _ai_beam_candidate_compare);
+    int next_layer_count = 0;
+    for (int i = 0; i < candidate_count; i++) {
+      _ai_beam_candidate *candidate = &candidate_list[i];
+      if ((next_layer_count == beam_width) ||
+          (beam->closed &&
+           ai_state_table_find(beam->closed, candidate->model_state))) {
+        _ai_beam_candidate_free(beam, candidate);
+        continue;
+      }
+      if (beam->closed &&
+          !ai_state_table_insert(beam->closed, candidate->model_state,
+                                 candidate->cost_so_far)) {
+        for (; i < candidate_count; i++) {
+          _ai_beam_candidate_free(beam, &candidate_list[i]);
+        }
+        beam->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+        break;
+      }
+      ai_beam_node *next_node = _ai_beam_node_constructor(
+          beam, candidate->model_state, candidate->action, candidate->parent,
+          candidate->cost_so_far, candidate->est_total_cost);
+      if (!next_node) {
+        // The closed table now owns this candidate's Model State.
+        if (beam->closed) {
+          candidate->model_state = NULL;
+        }
+        for (; i < candidate_count; i++) {
+          _ai_beam_candidate_free(beam, &candidate_list[i]);
+        }
+        beam->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+        break;
+      }
+      next_layer[next_layer_count++] = next_node;
+    }
+    if (beam->status != AI_SEARCH_STATUS_RUNNING) {
+      break;
+    }
+    if (next_layer_count == 0) {
+      beam->status = AI_SEARCH_STATUS_NOT_FOUND;
+      break;
+    }
+    ai_beam_node **swap = layer;
+    layer = next_layer;
+    next_layer = swap;
+    layer_count = next_layer_count;
+    beam->depth++;
+  }
+
+error:
+  if (beam->status == AI_SEARCH_STATUS_RUNNING) {
+    beam->status = AI_SEARCH_STATUS_CANCELLED;
+  }
+  beam->node_held_count = beam->node_count;
+  _ai_beam_node_list_free(beam);
+  ai_state_table_free(beam->closed);
+  beam->closed = NULL;
+  free(candidate_list);
+  free(layer);
+  free(next_layer);
+  return result_path;
+}
+
+// ai_search_beam *beam = ai_search_beam_constructor(model_state_evaluator, 16);
+// ai_path *path = beam->find_path_to_goal(beam, model_state);
+ai_search_beam *
+ai_search_beam_constructor(ai_model_state_evaluator *model_state_evaluator,
+                           int beam_width) {
+  ai_search_beam *beam = NULL;
+  check(beam_width >= 1, "ai_search_beam_constructor beam_width less than 1");
+  beam = (ai_search_beam *)malloc(sizeof(ai_search_beam));
+  check(beam, "ai_search_beam_constructor malloc failed");
+  beam->model_state_evaluator = model_state_evaluator;
+  beam->find_path_to_goal = _ai_search_beam_find_path_to_goal;
+  beam->beam_width = beam_width;
+  beam->depth_max = 0;
+  beam->fringe_expansion_count = 0;
+  beam->fringe_expansion_max = 0;
+  beam->depth = 0;
+  beam->node_held_count = 0;
+  beam->status = AI_SEARCH_STATUS_IDLE;
+  beam->node_count = 0;
+  beam->node_list = NULL;
+  beam->node_list_size = 0;
+  beam->closed = NULL;
+  return beam;
+error:
+  return NULL;
+}
+
+void ai_search_beam_free(ai_search_beam *beam) {
+  if (beam) {
+    free(beam->node_list);
+    free(beam);
+  }
+}
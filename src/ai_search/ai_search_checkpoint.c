@@ -0,0 +1,408 @@
+/*
+ * AI - Checkpoints of an A* Search.
+ *
+ * A checkpoint is a header, then the closed table, as a packed Model State
+ * and a cost per entry, then the path found so far, then each Goal of a
+ * multi-goal search, and last the fringe in order. A path is its length,
+ * then its packed Actions.
+ *
+ * The fringe is saved in order, so a resumed search expands the same states
+ * in the same order as the search saved would have. Tie-break keys are not
+ * saved, but worked out again for the resuming search's tie_break, random
+ * keys being drawn afresh from its tie_break_seed.
+ */
+#include "ai_search_internal.h"
+#include <ai_search.h>
+#include <ai_state_table.h>
+#include <logging.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define AI_SEARCH_CHECKPOINT_MAGIC "AICK"
+#define AI_SEARCH_CHECKPOINT_VERSION 1
+
+typedef struct _ai_checkpoint_header_struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t model_state_packed_size;
+  uint32_t action_packed_size;
+  int32_t status;
+  int32_t search_mode;
+  int32_t continue_past_goal;
+  int32_t goal_reached;
+  int32_t has_closed;
+  int32_t goal_count;
+  int32_t goal_remaining_count;
+  int32_t fringe_expansion_count;
+  int32_t fringe_pruned_count;
+  int32_t successor_filtered_count;
+  uint64_t memory_peak;
+  uint64_t closed_count;
+  uint64_t fringe_count;
+} _ai_checkpoint_header;
+
+// Scratch space for packing, and the evaluator.
+typedef struct _ai_checkpoint_struct {
+  ai_model_state_evaluator *model_state_evaluator;
+  FILE *file;
+  uint8_t *bytes;
+} _ai_checkpoint;
+
+int _ai_checkpoint_write(_ai_checkpoint *checkpoint, const void *data,
+                         size_t size) {
+  return fwrite(data, 1, size, checkpoint->file) == size ? 0 : -1;
+}
+
+int _ai_checkpoint_read(_ai_checkpoint *checkpoint, void *data, size_t size) {
+  return fread(data, 1, size, checkpoint->file) == size ? 0 : -1;
+}
+
+int _ai_checkpoint_write_model_state(_ai_checkpoint *checkpoint,
+                                     ai_model_state *model_state) {
+  ai_model_state_evaluator *model_state_evaluator =
+      checkpoint->model_state_evaluator;
+  model_state_evaluator->model_state_pack_function(model_state,
+                                                   checkpoint->bytes);
+  return _ai_checkpoint_write(checkpoint, checkpoint->bytes,
+                              model_state_evaluator->model_state_packed_size);
+}
+
+ai_model_state *_ai_checkpoint_read_model_state(_ai_checkpoint *checkpoint) {
+  ai_model_state_evaluator *model_state_evaluator =
+      checkpoint->model_state_evaluator;
+  if (_ai_checkpoint_read(checkpoint, checkpoint->bytes,
+                          model_state_evaluator->model_state_packed_size) !=
+      0) {
+    return NULL;
+  }
+  return ai_model_state_constructor(
+      model_state_evaluator->model_state_unpack_function(checkpoint->bytes));
+}
+
+int _ai_checkpoint_write_path(_ai_checkpoint *checkpoint, ai_path *path) {
+  ai_model_state_evaluator *model_state_evaluator =
+      checkpoint->model_state_evaluator;
+  uint32_t length = 0;
+  for (ai_path *action = path; action; action = action->next) {
+    length++;
+  }
+  check(_ai_checkpoint_write(checkpoint, &length, sizeof(length)) == 0,
+        "_ai_checkpoint_write_path write failed");
+  for (ai_path *action = path; action; action = action->next) {
+    model_state_evaluator->action_pack_function(action, checkpoint->bytes);
+    check(_ai_checkpoint_write(checkpoint, checkpoint->bytes,
+                               model_state_evaluator->action_packed_size) == 0,
+          "_ai_checkpoint_write_path write failed");
+  }
+  return 0;
+error:
+  return -1;
+}
+
+// Returns 0, with the path set, or -1.
+int _ai_checkpoint_read_path(_ai_checkpoint *checkpoint, ai_path **path) {
+  ai_model_state_evaluator *model_state_evaluator =
+      checkpoint->model_state_evaluator;
+  uint32_t length = 0;
+  ai_path *last = NULL;
+  *path = NULL;
+  check(_ai_checkpoint_read(checkpoint, &length, sizeof(length)) == 0,
+        "_ai_checkpoint_read_path read failed");
+  for (uint32_t i = 0; i < length; i++) {
+    check(_ai_checkpoint_read(checkpoint, checkpoint->bytes,
+                              model_state_evaluator->action_packed_size) == 0,
+          "_ai_checkpoint_read_path read failed");
+    ai_action *action = ai_action_constructor(
+        model_state_evaluator->action_unpack_function(checkpoint->bytes));
+    check(action, "_ai_checkpoint_read_path out of memory");
+    if (last) {
+      last->next = action;
+    } else {
+      *path = action;
+    }
+    last = action;
+  }
+  return 0;
+error:
+  _ai_path_free(*path, model_state_evaluator->action_data_free);
+  *path = NULL;
+  return -1;
+}
+
+// Whether the evaluator can pack what a checkpoint holds.
+int _ai_checkpoint_evaluator_valid(
+    ai_model_state_evaluator *model_state_evaluator) {
+  return model_state_evaluator->model_state_packed_size &&
+         model_state_evaluator->model_state_pack_function &&
+         model_state_evaluator->model_state_unpack_function &&
+         model_state_evaluator->action_packed_size &&
+         model_state_evaluator->action_pack_function &&
+         model_state_evaluator->action_unpack_function;
+}
+
+// Scratch space for the larger of a packed Model State and Action.
+uint8_t *
+_ai_checkpoint_bytes(ai_model_state_evaluator *model_state_evaluator) {
+  size_t size = model_state_evaluator->model_state_packed_size;
+  if (model_state_evaluator->action_packed_size > size) {
+    size = model_state_evaluator->action_packed_size;
+  }
+  return (uint8_t *)malloc(size);
+}
+
+// ai_search_astar_checkpoint_save(astar, file);
+int ai_search_astar_checkpoint_save(ai_search_astar *astar, FILE *file) {
+  ai_model_state_evaluator *model_state_evaluator =
+      astar->model_state_evaluator;
+  _ai_checkpoint checkpoint = {model_state_evaluator, file, NULL};
+  check(_ai_checkpoint_evaluator_valid(model_state_evaluator),
+        "ai_search_astar_checkpoint_save evaluator can not pack states and "
+        "actions");
+  checkpoint.bytes = _ai_checkpoint_bytes(model_state_evaluator);
+  check(checkpoint.bytes, "ai_search_astar_checkpoint_save malloc failed");
+  // The fringe is walked in order as a list.
+  _ai_search_astar_fringe_unindex(astar);
+
+  _ai_checkpoint_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, AI_SEARCH_CHECKPOINT_MAGIC, 4);
+  header.version = AI_SEARCH_CHECKPOINT_VERSION;
+  header.model_state_packed_size =
+      model_state_evaluator->model_state_packed_size;
+  header.action_packed_size = model_state_evaluator->action_packed_size;
+  header.status = astar->status;
+  header.search_mode = astar->search_mode;
+  header.continue_past_goal = astar->continue_past_goal;
+  header.goal_reached = astar->goal_reached;
+  header.has_closed = astar->closed != NULL;
+  header.goal_count = astar->goal_list ? astar->goal_count : -1;
+  header.goal_remaining_count = astar->goal_remaining_count;
+  header.fringe_expansion_count = astar->fringe_expansion_count;
+  header.fringe_pruned_count = astar->fringe_pruned_count;
+  header.successor_filtered_count = astar->successor_filtered_count;
+  header.memory_peak = astar->memory_peak;
+  header.closed_count = astar->closed ? astar->closed->count : 0;
+  for (ai_fringe_element *fe = astar->fringe_list; fe; fe = fe->next) {
+    header.fringe_count++;
+  }
+  check(_ai_checkpoint_write(&checkpoint, &header, sizeof(header)) == 0,
+        "ai_search_astar_checkpoint_save write failed");
+
+  for (size_t i = 0; astar->closed && (i < astar->closed->size); i++) {
+    ai_state_table_entry *entry = &astar->closed->entries[i];
+    if (entry->model_state) {
+      check(_ai_checkpoint_write_model_state(&checkpoint,
+                                             entry->model_state) == 0 &&
+                _ai_checkpoint_write(&checkpoint, &entry->cost,
+                                     sizeof(float)) == 0,
+            "ai_search_astar_checkpoint_save write failed");
+    }
+  }
+  check(_ai_checkpoint_write_path(&checkpoint, astar->result_path) == 0,
+        "ai_search_astar_checkpoint_save write failed");
+  for (int i = 0; astar->goal_list && (i < astar->goal_count); i++) {
+    ai_search_goal *goal = &astar->goal_list[i];
+    int32_t reached = goal->reached;
+    check(_ai_checkpoint_write_model_state(&checkpoint, goal->model_state) ==
+                  0 &&
+              _ai_checkpoint_write(&checkpoint, &reached, sizeof(reached)) ==
+                  0 &&
+              _ai_checkpoint_write(&checkpoint, &goal->cost, sizeof(float)) ==
+                  0 &&
+              _ai_checkpoint_write_path(&checkpoint, goal->path) == 0,
+          "ai_search_astar_checkpoint_save write failed");
+  }
+  for (ai_fringe_element *fe = astar->fringe_list; fe; fe = fe->next) {
+    check(_ai_checkpoint_write_model_state(&checkpoint, fe->model_state) == 0 &&
+              _ai_checkpoint_write(&checkpoint, &fe->cost_so_far,
+                                   sizeof(float)) == 0 &&
+              _ai_checkpoint_write(&checkpoint, &fe->est_total_cost,
+                                   sizeof(float)) == 0 &&
+              _ai_checkpoint_write_path(&checkpoint, fe->path_so_far) == 0,
+          "ai_search_astar_checkpoint_save write failed");
+  }
+  _ai_search_astar_fringe_index(astar);
+  free(checkpoint.bytes);
+  return 0;
+error:
+  _ai_search_astar_fringe_index(astar);
+  free(checkpoint.bytes);
+  return -1;
+}
+
+// ai_search_astar_checkpoint(astar, "plan.checkpoint");
+int ai_search_astar_checkpoint(ai_search_astar *astar, const char *file_name) {
+  FILE *file = NULL;
+  size_t size = strlen(file_name) + 5;
+  char *part_file_name = (char *)malloc(size);
+  check(part_file_name, "ai_search_astar_checkpoint malloc failed");
+  snprintf(part_file_name, size, "%s.tmp", file_name);
+  file = fopen(part_file_name, "wb");
+  check(file, "ai_search_astar_checkpoint can not write %s", part_file_name);
+  int rc = ai_search_astar_checkpoint_save(astar, file);
+  // On disk before the rename, so a crash leaves the old or the new one.
+  if ((rc == 0) && ((fflush(file) != 0) || (fsync(fileno(file)) != 0))) {
+    rc = -1;
+  }
+  rc = (fclose(file) == 0) ? rc : -1;
+  file = NULL;
+  check(rc == 0, "ai_search_astar_checkpoint write failed");
+  check(rename(part_file_name, file_name) == 0,
+        "ai_search_astar_checkpoint can not replace %s", file_name);
+  free(part_file_name);
+  astar->checkpoint_count++;
+  return 0;
+error:
+  if (file) {
+    fclose(file);
+  }
+  if (part_file_name) {
+    remove(part_file_name);
+  }
+  free(part_file_name);
+  return -1;
+}
+
+// ai_search_resume(astar, "plan.checkpoint");
+int ai_search_resume(ai_search_astar *astar, const char *file_name) {
+  ai_model_state_evaluator *model_state_evaluator =
+      astar->model_state_evaluator;
+  _ai_checkpoint checkpoint = {model_state_evaluator, NULL, NULL};
+  ai_model_state *model_state = NULL;
+  ai_path *path = NULL;
+  ai_fringe_element *fringe_last = NULL;
+
+  // Discard anything left from a previous search.
+  _ai_path_free(ai_search_astar_end(astar),
+                model_state_evaluator->action_data_free);
+  _ai_search_astar_goal_list_free(astar);
+  ai_state_table_free(astar->closed);
+  astar->closed = NULL;
+  astar->goal_reached = 0;
+  astar->memory_used = 0;
+  astar->closed_memory_used = 0;
+
+  check(_ai_checkpoint_evaluator_valid(model_state_evaluator),
+        "ai_search_resume evaluator can not unpack states and actions");
+  checkpoint.bytes = _ai_checkpoint_bytes(model_state_evaluator);
+  check(checkpoint.bytes, "ai_search_resume malloc failed");
+  checkpoint.file = fopen(file_name, "rb");
+  check(checkpoint.file, "ai_search_resume can not open %s", file_name);
+  _ai_checkpoint_header header;
+  check(_ai_checkpoint_read(&checkpoint, &header, sizeof(header)) == 0 &&
+            memcmp(header.magic, AI_SEARCH_CHECKPOINT_MAGIC, 4) == 0,
+        "ai_search_resume not a checkpoint");
+  check(header.version == AI_SEARCH_CHECKPOINT_VERSION,
+        "ai_search_resume unknown version");
+  int has_closed = model_state_evaluator->model_state_hash_function &&
+                   model_state_evaluator->model_state_equal_function;
+  check((header.model_state_packed_size ==
+         model_state_evaluator->model_state_packed_size) &&
+            (header.action_packed_size ==
+             model_state_evaluator->action_packed_size) &&
+            (header.has_closed == has_closed) &&
+            (has_closed || (header.closed_count == 0)),
+        "ai_search_resume checkpoint of another evaluator");
+  astar->search_mode = (ai_search_mode)header.search_mode;
+  astar->continue_past_goal = header.continue_past_goal;
+  astar->goal_reached = header.goal_reached;
+  astar->fringe_expansion_count = header.fringe_expansion_count;
+  astar->fringe_pruned_count = header.fringe_pruned_count;
+  astar->successor_filtered_count = header.successor_filtered_count;
+  astar->memory_peak = header.memory_peak;
+
+  if (has_closed) {
+    astar->closed = ai_state_table_constructor(model_state_evaluator);
+    check(astar->closed, "ai_search_resume out of memory");
+  }
+  for (uint64_t i = 0; i < header.closed_count; i++) {
+    float cost;
+    model_state = _ai_checkpoint_read_model_state(&checkpoint);
+    check(model_state &&
+              _ai_checkpoint_read(&checkpoint, &cost, sizeof(float)) == 0,
+          "ai_search_resume read failed");
+    check(ai_state_table_insert(astar->closed, model_state, cost),
+          "ai_search_resume out of memory");
+    _ai_search_astar_memory_charge_closed(astar, model_state);
+    model_state = NULL;
+  }
+  check(_ai_checkpoint_read_path(&checkpoint, &astar->result_path) == 0,
+        "ai_search_resume read failed");
+  if (header.goal_count >= 0) {
+    astar->goal_list = (ai_search_goal *)calloc(
+        header.goal_count ? header.goal_count : 1, sizeof(ai_search_goal));
+    check(astar->goal_list, "ai_search_resume malloc failed");
+    for (int i = 0; i < header.goal_count; i++) {
+      ai_search_goal *goal = &astar->goal_list[i];
+      int32_t reached;
+      goal->model_state = _ai_checkpoint_read_model_state(&checkpoint);
+      astar->goal_count = i + 1;
+      check(goal->model_state &&
+                _ai_checkpoint_read(&checkpoint, &reached, sizeof(reached)) ==
+                    0 &&
+                _ai_checkpoint_read(&checkpoint, &goal->cost, sizeof(float)) ==
+                    0 &&
+                _ai_checkpoint_read_path(&checkpoint, &goal->path) == 0,
+            "ai_search_resume read failed");
+      goal->reached = reached;
+      goal->hash =
+          model_state_evaluator->model_state_hash_function(goal->model_state);
+    }
+    astar->goal_remaining_count = header.goal_remaining_count;
+  }
+  astar->tie_break_random = astar->tie_break_seed;
+  for (uint64_t i = 0; i < header.fringe_count; i++) {
+    float cost_so_far;
+    float est_total_cost;
+    model_state = _ai_checkpoint_read_model_state(&checkpoint);
+    check(model_state &&
+              _ai_checkpoint_read(&checkpoint, &cost_so_far, sizeof(float)) ==
+                  0 &&
+              _ai_checkpoint_read(&checkpoint, &est_total_cost,
+                                  sizeof(float)) == 0 &&
+              _ai_checkpoint_read_path(&checkpoint, &path) == 0,
+          "ai_search_resume read failed");
+    ai_fringe_element *fe = ai_fringe_element_constructor(
+        model_state, path, cost_so_far, est_total_cost);
+    check(fe, "ai_search_resume out of memory");
+    fe->tie_break_key = _ai_search_astar_tie_break_key(astar, fe);
+    if (astar->closed) {
+      fe->hash =
+          astar->model_state_evaluator->model_state_hash_function(model_state);
+    }
+    model_state = NULL;
+    path = NULL;
+    _ai_search_astar_memory_charge(astar, fe);
+    if (fringe_last) {
+      fringe_last->next = fe;
+    } else {
+      astar->fringe_list = fe;
+    }
+    fringe_last = fe;
+  }
+  _ai_search_astar_fringe_index(astar);
+  astar->status = (ai_search_status)header.status;
+  fclose(checkpoint.file);
+  free(checkpoint.bytes);
+  return 0;
+error:
+  _ai_model_state_free(model_state,
+                       model_state_evaluator->model_state_data_free);
+  _ai_path_free(path, model_state_evaluator->action_data_free);
+  if (checkpoint.file) {
+    fclose(checkpoint.file);
+  }
+  free(checkpoint.bytes);
+  _ai_path_free(ai_search_astar_end(astar),
+                model_state_evaluator->action_data_free);
+  _ai_search_astar_goal_list_free(astar);
+  ai_state_table_free(astar->closed);
+  astar->closed = NULL;
+  astar->memory_used = 0;
+  astar->closed_memory_used = 0;
+  astar->status = AI_SEARCH_STATUS_IDLE;
+  return -1;
+}
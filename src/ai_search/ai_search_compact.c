@@ -0,0 +1,367 @@
+/*
+ * AI - Compact A* Search.
+ *
+ * Node i is the search node of state i of the intern table, and the node
+ * array grows with the table. With the evaluator's hash update function the
+ * table is given the evaluator's hashes, each successor's worked out from
+ * the hash the table keeps for its parent.
+ */
+#include "ai_search_internal.h"
+#include <ai_search_compact.h>
+#include <logging.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _AI_COMPACT_SIZE_MIN 1024
+
+// Make room in the node array for every state of the intern table.
+// Returns 0, or -1 if out of memory.
+int _ai_compact_node_reserve(ai_search_compact *compact) {
+  uint32_t node_size = compact->intern->size;
+  if (compact->node_size < node_size) {
+    ai_search_compact_node *node_list = (ai_search_compact_node *)realloc(
+        compact->node_list, sizeof(ai_search_compact_node) * node_size);
+    check(node_list, "_ai_compact_node_reserve malloc failed");
+    compact->node_list = node_list;
+    compact->node_size = node_size;
+  }
+  return 0;
+error:
+  return -1;
+}
+
+// True if open entry a is expanded before b.
+int _ai_compact_open_before(ai_search_compact *compact,
+                            ai_search_compact_open *a,
+                            ai_search_compact_open *b) {
+  return a->est_total_cost < b->est_total_cost;
+}
+
+void _ai_compact_open_set(ai_search_compact *compact, uint32_t index,
+                          ai_search_compact_open entry) {
+  compact->open_list[index] = entry;
+  compact->node_list[entry.node].open_index = index;
+}
+
+void _ai_compact_open_up(ai_search_compact *compact, uint32_t index) {
+  ai_search_compact_open entry = compact->open_list[index];
+  while (index > 0) {
+    uint32_t parent = (index - 1) / 2;
+    if (!_ai_compact_open_before(compact, &entry,
+                                 &compact->open_list[parent])) {
+      break;
+    }
+    _ai_compact_open_set(compact, index, compact->open_list[parent]);
+    index = parent;
+  }
+  _ai_compact_open_set(compact, index, entry);
+}
+
+void _ai_compact_open_down(ai_search_compact *compact, uint32_t index) {
+  ai_search_compact_open entry = compact->open_list[index];
+  for (;;) {
+    uint32_t child = index * 2 + 1;
+    if (child >= compact->open_count) {
+      break;
+    }
+    if ((child + 1 < compact->open_count) &&
+        _ai_compact_open_before(compact, &compact->open_list[child + 1],
+                                &compact->open_list[child])) {
+      child++;
+    }
+    if (!_ai_compact_open_before(compact, &compact->open_list[child],
+                                 &entry)) {
+      break;
+    }
+    _ai_compact_open_set(compact, index, compact->open_list[child]);
+    index = child;
+  }
+  _ai_compact_open_set(compact, index, entry);
+}
+
+// Add a node to the open list, or move it up if it is there already.
+// Returns 0, or -1 if out of memory.
+int _ai_compact_open_push(ai_search_compact *compact, uint32_t node) {
+  ai_search_compact_open entry = {
+      compact->node_list[node].est_total_cost, node};
+  uint32_t index = compact->node_list[node].open_index;
+  if (index != AI_SEARCH_COMPACT_NONE) {
+    compact->open_list[index] = entry;
+    _ai_compact_open_up(compact, index);
+    return 0;
+  }
+  if (compact->open_count == compact->open_size) {
+    uint32_t open_size = compact->open_size * 2;
+    ai_search_compact_open *open_list = (ai_search_compact_open *)realloc(
+        compact->open_list, sizeof(ai_search_compact_open) * open_size);
+    check(open_list, "_ai_compact_open_push malloc failed");
+    compact->open_list = open_list;
+    compact->open_size = open_size;
+  }
+  _ai_compact_open_set(compact, compact->open_count++, entry);
+  _ai_compact_open_up(compact, compact->open_count - 1);
+  return 0;
+error:
+  return -1;
+}
+
+uint32_t _ai_compact_open_pop(ai_search_compact *compact) {
+  uint32_t node = compact->open_list[0].node;
+  compact->node_list[node].open_index = AI_SEARCH_COMPACT_NONE;
+  if (--compact->open_count > 0) {
+    _ai_compact_open_set(compact, 0, compact->open_list[compact->open_count]);
+    _ai_compact_open_down(compact, 0);
+  }
+  return node;
+}
+
+float _ai_compact_est_cost(ai_search_compact *compact,
+                           ai_model_state *model_state) {
+  ai_goal_est_cost_function goal_est_cost_function =
+      compact->model_state_evaluator->goal_est_cost_function;
+  return goal_est_cost_function ? goal_est_cost_function(model_state) : 0;
+}
+
+// True if states are hashed by the evaluator rather than by the table.
+int _ai_compact_hashed(ai_search_compact *compact) {
+  ai_model_state_evaluator *evaluator = compact->model_state_evaluator;
+  return evaluator->model_state_hash_update_function &&
+         evaluator->model_state_hash_function;
+}
+
+// Reach the state of model_state, with the evaluator's hash if hashed, from
+// node parent at cost_so_far. A new state is added as a node. Returns 0, or
+// -1 if out of memory.
+int _ai_compact_reach(ai_search_compact *compact, uint32_t parent,
+                      ai_model_state *model_state, size_t hash,
+                      float cost_so_far, uint8_t *bytes) {
+  int added = 0;
+  uint32_t node = AI_SEARCH_COMPACT_NONE;
+  if (_ai_compact_hashed(compact)) {
+    compact->model_state_evaluator->model_state_pack_function(model_state,
+                                                              bytes);
+    node = ai_state_intern_add_hashed(compact->intern, bytes, hash, &added);
+  } else {
+    node = ai_state_intern_add_model_state(compact->intern, model_state,
+                                           &added);
+  }
+  check(node != AI_SEARCH_COMPACT_NONE, "_ai_compact_reach out of memory");
+  if (!added) {
+    ai_search_compact_node *old = &compact->node_list[node];
+    if (old->cost_so_far <= cost_so_far) {
+      return 0;
+    }
+    old->est_total_cost += cost_so_far - old->cost_so_far;
+    old->cost_so_far = cost_so_far;
+    old->parent = parent;
+    return _ai_compact_open_push(compact, node);
+  }
+  check(_ai_compact_node_reserve(compact) == 0,
+        "_ai_compact_reach out of memory");
+  ai_search_compact_node *new_node = &compact->node_list[node];
+  new_node->parent = parent;
+  new_node->open_index = AI_SEARCH_COMPACT_NONE;
+  new_node->cost_so_far = cost_so_far;
+  new_node->est_total_cost =
+      cost_so_far + _ai_compact_est_cost(compact, model_state);
+  return _ai_compact_open_push(compact, node);
+error:
+  return -1;
+}
+
+// Expand a node. Returns 0, or -1 if out of memory.
+int _ai_compact_expand(ai_search_compact *compact, uint32_t node,
+                       ai_model_state *model_state, uint8_t *bytes) {
+  ai_model_state_evaluator *evaluator = compact->model_state_evaluator;
+  float cost_so_far = compact->node_list[node].cost_so_far;
+  int hashed = _ai_compact_hashed(compact);
+  size_t hash = ai_state_intern_state_hash(compact->intern, node);
+  int result = 0;
+  ai_successor *successor_list = evaluator->successor_function(
+      model_state, evaluator->transition_function);
+  ai_successor *successor_next = NULL;
+  for (ai_successor *successor = successor_list; successor;
+       successor = successor_next) {
+    successor_next = successor->next;
+    if (result == 0) {
+      size_t successor_hash =
+          hashed ? evaluator->model_state_hash_update_function(
+                       hash, model_state, successor->action)
+                 : 0;
+      result = _ai_compact_reach(compact, node, successor->model_state,
+                                 successor_hash, cost_so_far + successor->cost,
+                                 bytes);
+    }
+    successor->action->next = NULL;
+    _ai_path_free(successor->action, evaluator->action_data_free);
+    _ai_model_state_free(successor->model_state,
+                         evaluator->model_state_data_free);
+    free(successor);
+  }
+  return result;
+}
+
+// The action from node parent to node, taken from the parent's successors,
+// or NULL.
+ai_action *_ai_compact_action(ai_search_compact *compact, uint32_t parent,
+                              uint32_t node, uint8_t *bytes) {
+  ai_model_state_evaluator *evaluator = compact->model_state_evaluator;
+  ai_action *action = NULL;
+  float best_error = 0;
+  float cost = compact->node_list[node].cost_so_far -
+               compact->node_list[parent].cost_so_far;
+  ai_model_state *model_state =
+      ai_state_intern_model_state(compact->intern, parent);
+  check(model_state, "_ai_compact_action unpack failed");
+  ai_successor *successor_list = evaluator->successor_function(
+      model_state, evaluator->transition_function);
+  _ai_model_state_free(model_state, evaluator->model_state_data_free);
+  ai_successor *successor_next = NULL;
+  for (ai_successor *successor = successor_list; successor;
+       successor = successor_next) {
+    successor_next = successor->next;
+    successor->action->next = NULL;
+    evaluator->model_state_pack_function(successor->model_state, bytes);
+    // The cheapest action, should several reach the same state.
+    float error = successor->cost - cost;
+    error = error < 0 ? -error : error;
+    if ((memcmp(bytes, ai_state_intern_bytes(compact->intern, node),
+                evaluator->model_state_packed_size) == 0) &&
+        (!action || (error < best_error))) {
+      _ai_path_free(action, evaluator->action_data_free);
+      action = successor->action;
+      best_error = error;
+    } else {
+      _ai_path_free(successor->action, evaluator->action_data_free);
+    }
+    _ai_model_state_free(successor->model_state,
+                         evaluator->model_state_data_free);
+    free(successor);
+  }
+  return action;
+error:
+  return NULL;
+}
+
+// The path from the initial state to node.
+ai_path *_ai_compact_path(ai_search_compact *compact, uint32_t node,
+                          uint8_t *bytes) {
+  ai_path *path = NULL;
+  for (; compact->node_list[node].parent != AI_SEARCH_COMPACT_NONE;
+       node = compact->node_list[node].parent) {
+    ai_action *action = _ai_compact_action(
+        compact, compact->node_list[node].parent, node, bytes);
+    check(action, "_ai_compact_path action not found");
+    action->next = path;
+    path = action;
+  }
+  return path;
+error:
+  _ai_path_free(path, compact->model_state_evaluator->action_data_free);
+  return NULL;
+}
+
+// Reset the arrays for a new search. Returns 0, or -1 if out of memory.
+int _ai_compact_reset(ai_search_compact *compact) {
+  ai_state_intern_clear(compact->intern);
+  compact->open_count = 0;
+  if (!compact->open_list) {
+    compact->open_size = _AI_COMPACT_SIZE_MIN;
+    compact->open_list = (ai_search_compact_open *)malloc(
+        sizeof(ai_search_compact_open) * compact->open_size);
+    check(compact->open_list, "_ai_compact_reset malloc failed");
+  }
+  return _ai_compact_node_reserve(compact);
+error:
+  return -1;
+}
+
+// private - Compact A* search algorithm
+ai_path *
+_ai_search_compact_find_path_to_goal(ai_search_compact *compact,
+                                     ai_model_state *initial_model_state) {
+  ai_model_state_evaluator *evaluator = compact->model_state_evaluator;
+  ai_path *result_path = NULL;
+  uint8_t *bytes = NULL;
+  compact->fringe_expansion_count = 0;
+  compact->path_cost = 0;
+  compact->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+  bytes = (uint8_t *)malloc(evaluator->model_state_packed_size);
+  check(bytes && (_ai_compact_reset(compact) == 0),
+        "_ai_search_compact_find_path_to_goal malloc failed");
+  size_t hash = _ai_compact_hashed(compact)
+                    ? evaluator->model_state_hash_function(initial_model_state)
+                    : 0;
+  check(_ai_compact_reach(compact, AI_SEARCH_COMPACT_NONE, initial_model_state,
+                          hash, 0, bytes) == 0,
+        "_ai_search_compact_find_path_to_goal out of memory");
+  compact->status = AI_SEARCH_STATUS_RUNNING;
+
+  while (compact->status == AI_SEARCH_STATUS_RUNNING) {
+    if (compact->open_count == 0) {
+      compact->status = AI_SEARCH_STATUS_NOT_FOUND;
+      break;
+    }
+    if ((compact->fringe_expansion_max != 0) &&
+        (compact->fringe_expansion_count >= compact->fringe_expansion_max)) {
+      compact->status = AI_SEARCH_STATUS_EXPANSION_LIMIT;
+      break;
+    }
+    uint32_t node = _ai_compact_open_pop(compact);
+    ai_model_state *model_state =
+        ai_state_intern_model_state(compact->intern, node);
+    if (!model_state) {
+      compact->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+      break;
+    }
+    if (evaluator->is_goal_state_function(model_state)) {
+      compact->path_cost = compact->node_list[node].cost_so_far;
+      result_path = _ai_compact_path(compact, node, bytes);
+      compact->status = AI_SEARCH_STATUS_FOUND;
+    } else {
+      compact->fringe_expansion_count++;
+      if (_ai_compact_expand(compact, node, model_state, bytes) != 0) {
+        compact->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+      }
+    }
+    _ai_model_state_free(model_state, evaluator->model_state_data_free);
+  }
+
+error:
+  compact->node_count = compact->intern->count;
+  compact->memory_used =
+      ai_state_intern_memory_used(compact->intern) +
+      (size_t)compact->node_size * sizeof(ai_search_compact_node) +
+      (size_t)compact->open_size * sizeof(ai_search_compact_open);
+  free(bytes);
+  return result_path;
+}
+
+// ai_search_compact *compact = ai_search_compact_constructor(e);
+ai_search_compact *
+ai_search_compact_constructor(ai_model_state_evaluator *model_state_evaluator) {
+  ai_search_compact *compact =
+      (ai_search_compact *)calloc(1, sizeof(ai_search_compact));
+  check(compact, "ai_search_compact_constructor malloc failed");
+  compact->intern = ai_state_intern_constructor(model_state_evaluator);
+  check(compact->intern,
+        "ai_search_compact_constructor evaluator can not pack states");
+  compact->model_state_evaluator = model_state_evaluator;
+  compact->find_path_to_goal = _ai_search_compact_find_path_to_goal;
+  compact->fringe_expansion_count = 0;
+  compact->fringe_expansion_max = 0;
+  compact->status = AI_SEARCH_STATUS_IDLE;
+  return compact;
+error:
+  ai_search_compact_free(compact);
+  return NULL;
+}
+
+void ai_search_compact_free(ai_search_compact *compact) {
+  if (compact) {
+    ai_state_intern_free(compact->intern);
+    free(compact->node_list);
+    free(compact->open_list);
+    free(compact);
+  }
+}
@@ -0,0 +1,339 @@
+/*
+ * AI - D* Lite Search.
+ *
+ * http://en.wikipedia.org/wiki/D*
+ * Koenig and Likhachev, "D* Lite", AAAI 2002. This is the optimised version
+ * of the paper's Figure 4.
+ *
+ * g and rhs are searched backward from the goal, so rhs(s) is the least
+ * cost of an out edge of s plus g of its target. A node is consistent when
+ * g equals rhs, and only inconsistent nodes are in the priority queue.
+ * Changing an edge makes at most its source inconsistent, and the next
+ * search settles only the nodes whose g really changes.
+ *
+ * The priority queue is a binary heap indexed by node, so a node's key can
+ * be changed or removed in place.
+ */
+#include "ai_search_internal.h"
+#include <ai_search_dstar_lite.h>
+#include <logging.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+float _ai_dstar_lite_est_cost(ai_search_dstar_lite *dstar, uint32_t node) {
+  if (dstar->est_cost_function == NULL) {
+    return 0;
+  }
+  return dstar->est_cost_function(dstar->est_cost_data, dstar->start, node);
+}
+
+void _ai_dstar_lite_key(ai_search_dstar_lite *dstar, uint32_t node,
+                        float *key) {
+  float cost = dstar->g[node] < dstar->rhs[node] ? dstar->g[node]
+                                                 : dstar->rhs[node];
+  key[0] = cost + _ai_dstar_lite_est_cost(dstar, node) + dstar->key_modifier;
+  key[1] = cost;
+}
+
+int _ai_dstar_lite_key_less(const float *a, const float *b) {
+  return (a[0] < b[0]) || ((a[0] == b[0]) && (a[1] < b[1]));
+}
+
+// Heap. Entries are nodes, ordered by their keys.
+
+int _ai_dstar_lite_heap_less(ai_search_dstar_lite *dstar, uint32_t i,
+                             uint32_t j) {
+  return _ai_dstar_lite_key_less(&dstar->heap_key[2 * dstar->heap[i]],
+                                 &dstar->heap_key[2 * dstar->heap[j]]);
+}
+
+void _ai_dstar_lite_heap_swap(ai_search_dstar_lite *dstar, uint32_t i,
+                              uint32_t j) {
+  uint32_t node = dstar->heap[i];
+  dstar->heap[i] = dstar->heap[j];
+  dstar->heap[j] = node;
+  dstar->heap_index[dstar->heap[i]] = i;
+  dstar->heap_index[dstar->heap[j]] = j;
+}
+
+void _ai_dstar_lite_heap_sift(ai_search_dstar_lite *dstar, uint32_t i) {
+  while ((i > 0) && _ai_dstar_lite_heap_less(dstar, i, (i - 1) / 2)) {
+    _ai_dstar_lite_heap_swap(dstar, i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+  for (;;) {
+    uint32_t least = i;
+    uint32_t child = 2 * i + 1;
+    if ((child < dstar->heap_count) &&
+        _ai_dstar_lite_heap_less(dstar, child, least)) {
+      least = child;
+    }
+    if ((child + 1 < dstar->heap_count) &&
+        _ai_dstar_lite_heap_less(dstar, child + 1, least)) {
+      least = child + 1;
+    }
+    if (least == i) {
+      break;
+    }
+    _ai_dstar_lite_heap_swap(dstar, i, least);
+    i = least;
+  }
+}
+
+// Insert the node, or move it to its new key.
+void _ai_dstar_lite_heap_set(ai_search_dstar_lite *dstar, uint32_t node,
+                             const float *key) {
+  dstar->heap_key[2 * node] = key[0];
+  dstar->heap_key[2 * node + 1] = key[1];
+  uint32_t i = dstar->heap_index[node];
+  if (i == AI_GRAPH_NODE_NONE) {
+    i = dstar->heap_count++;
+    dstar->heap[i] = node;
+    dstar->heap_index[node] = i;
+  }
+  _ai_dstar_lite_heap_sift(dstar, i);
+}
+
+void _ai_dstar_lite_heap_remove(ai_search_dstar_lite *dstar, uint32_t node) {
+  uint32_t i = dstar->heap_index[node];
+  if (i == AI_GRAPH_NODE_NONE) {
+    return;
+  }
+  dstar->heap_count--;
+  if (i != dstar->heap_count) {
+    _ai_dstar_lite_heap_swap(dstar, i, dstar->heap_count);
+    dstar->heap_index[node] = AI_GRAPH_NODE_NONE;
+    _ai_dstar_lite_heap_sift(dstar, i);
+  } else {
+    dstar->heap_index[node] = AI_GRAPH_NODE_NONE;
+  }
+}
+
+// Least cost over the out edges of the node, of the edge plus g of its
+// target.
+float _ai_dstar_lite_rhs(ai_search_dstar_lite *dstar, uint32_t node) {
+  ai_graph *graph = dstar->graph;
+  float rhs = INFINITY;
+  for (uint32_t e = graph->edge_offset[node]; e < graph->edge_offset[node + 1];
+       e++) {
+    float cost = graph->edge_cost[e] + dstar->g[graph->edge_target[e]];
+    if (cost < rhs) {
+      rhs = cost;
+    }
+  }
+  return rhs;
+}
+
+// Queue the node if it is inconsistent, otherwise take it off the queue.
+void _ai_dstar_lite_update(ai_search_dstar_lite *dstar, uint32_t node) {
+  if (dstar->g[node] != dstar->rhs[node]) {
+    float key[2];
+    _ai_dstar_lite_key(dstar, node, key);
+    _ai_dstar_lite_heap_set(dstar, node, key);
+  } else {
+    _ai_dstar_lite_heap_remove(dstar, node);
+  }
+}
+
+void _ai_dstar_lite_compute(ai_search_dstar_lite *dstar) {
+  ai_graph *graph = dstar->graph;
+  uint32_t start = dstar->start;
+  float start_key[2];
+  dstar->fringe_expansion_last = 0;
+  for (;;) {
+    _ai_dstar_lite_key(dstar, start, start_key);
+    if (dstar->heap_count == 0) {
+      break;
+    }
+    uint32_t node = dstar->heap[0];
+    float *old_key = &dstar->heap_key[2 * node];
+    if (!_ai_dstar_lite_key_less(old_key, start_key) &&
+        (dstar->rhs[start] <= dstar->g[start])) {
+      break;
+    }
+    float new_key[2];
+    _ai_dstar_lite_key(dstar, node, new_key);
+    if (_ai_dstar_lite_key_less(old_key, new_key)) {
+      // Queued before the start moved.
+      _ai_dstar_lite_heap_set(dstar, node, new_key);
+      continue;
+    }
+    dstar->fringe_expansion_last++;
+    dstar->fringe_expansion_count++;
+    if (dstar->g[node] > dstar->rhs[node]) {
+      // Over consistent. Settle it, and offer it to its predecessors.
+      dstar->g[node] = dstar->rhs[node];
+      _ai_dstar_lite_heap_remove(dstar, node);
+      for (uint32_t r = graph->reverse_offset[node];
+           r < graph->reverse_offset[node + 1]; r++) {
+        uint32_t pred = graph->reverse_source[r];
+        float cost = graph->edge_cost[graph->reverse_edge[r]] + dstar->g[node];
+        if ((pred != dstar->goal) && (cost < dstar->rhs[pred])) {
+          dstar->rhs[pred] = cost;
+        }
+        _ai_dstar_lite_update(dstar, pred);
+      }
+    } else {
+      // Under consistent. Raise it, and recompute whoever depended on it.
+      float g_old = dstar->g[node];
+      dstar->g[node] = INFINITY;
+      for (uint32_t r = graph->reverse_offset[node];
+           r < graph->reverse_offset[node + 1]; r++) {
+        uint32_t pred = graph->reverse_source[r];
+        float cost = graph->edge_cost[graph->reverse_edge[r]] + g_old;
+        if ((pred != dstar->goal) && (dstar->rhs[pred] == cost)) {
+          dstar->rhs[pred] = _ai_dstar_lite_rhs(dstar, pred);
+        }
+        _ai_dstar_lite_update(dstar, pred);
+      }
+      if (node != dstar->goal) {
+        dstar->rhs[node] = _ai_dstar_lite_rhs(dstar, node);
+      }
+      _ai_dstar_lite_update(dstar, node);
+    }
+  }
+}
+
+// ai_path *path = ai_search_dstar_lite_find_path(dstar);
+ai_path *ai_search_dstar_lite_find_path(ai_search_dstar_lite *dstar) {
+  ai_graph *graph = dstar->graph;
+  ai_path *path = NULL;
+  ai_action *last = NULL;
+  dstar->status = AI_SEARCH_STATUS_RUNNING;
+  _ai_dstar_lite_compute(dstar);
+  dstar->path_cost = dstar->rhs[dstar->start];
+  if (dstar->path_cost == INFINITY) {
+    dstar->status = AI_SEARCH_STATUS_NOT_FOUND;
+    return NULL;
+  }
+
+  // Follow the cheapest out edge by g, from the start to the goal.
+  uint32_t node = dstar->start;
+  for (uint32_t step = 0; node != dstar->goal; step++) {
+    uint32_t best_edge = AI_GRAPH_NODE_NONE;
+    float best_cost = INFINITY;
+    for (uint32_t e = graph->edge_offset[node];
+         e < graph->edge_offset[node + 1]; e++) {
+      float cost = graph->edge_cost[e] + dstar->g[graph->edge_target[e]];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_edge = e;
+      }
+    }
+    check((best_edge != AI_GRAPH_NODE_NONE) && (step < graph->node_count),
+          "ai_search_dstar_lite_find_path no path from node %u", node);
+    node = graph->edge_target[best_edge];
+    ai_action *action =
+        ai_action_constructor(ai_graph_action_data_constructor(best_edge, node));
+    if (last) {
+      last->next = action;
+    } else {
+      path = action;
+    }
+    last = action;
+  }
+  dstar->status = AI_SEARCH_STATUS_FOUND;
+  return path;
+error:
+  _ai_path_free(path, ai_graph_action_data_free);
+  dstar->status = AI_SEARCH_STATUS_NOT_FOUND;
+  return NULL;
+}
+
+// ai_search_dstar_lite_move_start(dstar, next_node);
+void ai_search_dstar_lite_move_start(ai_search_dstar_lite *dstar,
+                                     uint32_t start) {
+  // Keys queued so far were estimated from the old start. Rather than
+  // re-key them, raise every later key by the most the estimate can have
+  // fallen.
+  dstar->key_modifier += _ai_dstar_lite_est_cost(dstar, start);
+  dstar->start = start;
+}
+
+// ai_search_notify_edge_changes(dstar, changes, change_count);
+int ai_search_notify_edge_changes(ai_search_dstar_lite *dstar,
+                                  const ai_graph_edge *changes,
+                                  int change_count) {
+  ai_graph *graph = dstar->graph;
+  int applied = 0;
+  for (int i = 0; i < change_count; i++) {
+    uint32_t source = changes[i].source;
+    uint32_t target = changes[i].target;
+    uint32_t e = ai_graph_edge_find(graph, source, target);
+    if (e == AI_GRAPH_NODE_NONE) {
+      continue;
+    }
+    float cost_old = graph->edge_cost[e];
+    float cost_new = changes[i].cost;
+    graph->edge_cost[e] = cost_new;
+    applied++;
+    if (source == dstar->goal) {
+      continue;
+    }
+    if (cost_new < cost_old) {
+      float cost = cost_new + dstar->g[target];
+      if (cost < dstar->rhs[source]) {
+        dstar->rhs[source] = cost;
+      }
+    } else if (dstar->rhs[source] == cost_old + dstar->g[target]) {
+      dstar->rhs[source] = _ai_dstar_lite_rhs(dstar, source);
+    }
+    _ai_dstar_lite_update(dstar, source);
+  }
+  return applied;
+}
+
+// ai_search_dstar_lite *dstar =
+//     ai_search_dstar_lite_constructor(graph, start, goal);
+ai_search_dstar_lite *ai_search_dstar_lite_constructor(ai_graph *graph,
+                                                       uint32_t start,
+                                                       uint32_t goal) {
+  ai_search_dstar_lite *dstar = NULL;
+  check(graph && (start < graph->node_count) && (goal < graph->node_count),
+        "ai_search_dstar_lite_constructor node out of range");
+  dstar = (ai_search_dstar_lite *)calloc(1, sizeof(ai_search_dstar_lite));
+  check(dstar, "ai_search_dstar_lite_constructor malloc failed");
+  uint32_t node_count = graph->node_count;
+  dstar->graph = graph;
+  dstar->start = start;
+  dstar->goal = goal;
+  dstar->est_cost_function = NULL;
+  dstar->est_cost_data = NULL;
+  dstar->path_cost = INFINITY;
+  dstar->status = AI_SEARCH_STATUS_IDLE;
+  dstar->g = (float *)malloc(sizeof(float) * node_count);
+  dstar->rhs = (float *)malloc(sizeof(float) * node_count);
+  dstar->heap = (uint32_t *)malloc(sizeof(uint32_t) * node_count);
+  dstar->heap_index = (uint32_t *)malloc(sizeof(uint32_t) * node_count);
+  dstar->heap_key = (float *)malloc(sizeof(float) * 2 * node_count);
+  check(dstar->g && dstar->rhs && dstar->heap && dstar->heap_index &&
+            dstar->heap_key,
+        "ai_search_dstar_lite_constructor malloc failed");
+  for (uint32_t v = 0; v < node_count; v++) {
+    dstar->g[v] = INFINITY;
+    dstar->rhs[v] = INFINITY;
+    dstar->heap_index[v] = AI_GRAPH_NODE_NONE;
+  }
+  dstar->rhs[goal] = 0;
+  // The estimate is set after construction, so the goal's first key is
+  // set when it is first searched.
+  float key[2] = {0, 0};
+  _ai_dstar_lite_heap_set(dstar, goal, key);
+  return dstar;
+error:
+  ai_search_dstar_lite_free(dstar);
+  return NULL;
+}
+
+void ai_search_dstar_lite_free(ai_search_dstar_lite *dstar) {
+  if (dstar) {
+    free(dstar->g);
+    free(dstar->rhs);
+    free(dstar->heap);
+    free(dstar->heap_index);
+    free(dstar->heap_key);
+    free(dstar);
+  }
+}
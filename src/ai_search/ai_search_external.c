@@ -0,0 +1,804 @@
+/*
+ * AI - External-memory A* Search.
+ *
+ * Each search has a directory of its own. A bucket's successors are first
+ * written as sorted runs, files r_<g>_<h>_<run>. Just before the bucket is
+ * expanded its runs are merged, at most _AI_EXTERNAL_MERGE_WAY at a time,
+ * into its layer, file l_<g>_<h>, dropping duplicates within the runs and
+ * states already in the earlier layers of the same h. Those layers are read
+ * alongside the runs, as many as fit in _AI_EXTERNAL_MERGE_WAY, and any more
+ * in further passes over the merged run. Layers are kept to the end of the
+ * search, for later merges and for the path.
+ *
+ * A record is the packed state, the packed parent, and the h of the
+ * parent's bucket, or _AI_EXTERNAL_H_NONE for the initial state. Runs and
+ * layers are sorted by packed state, compared as bytes, so that merges and
+ * the lookups of the path need only sequential reads or binary searches.
+ */
+#include "ai_search_internal.h"
+#include <ai_search_external.h>
+#include <logging.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define _AI_EXTERNAL_MERGE_WAY 16
+#define _AI_EXTERNAL_H_NONE UINT32_MAX
+#define _AI_EXTERNAL_FILE_BUFFER_SIZE (1 << 20)
+// Float error allowed for when an estimate is rounded up.
+#define _AI_EXTERNAL_EST_COST_TOLERANCE 1e-3f
+
+typedef struct _ai_external_bucket_struct {
+  uint32_t g;
+  uint32_t h;
+  int run_first; // Runs not yet merged are run_first to run_last - 1.
+  int run_last;
+  int buffered_count; // Records for the bucket still in the buffer.
+  int expanded;
+  uint64_t record_count; // Records of the layer, once merged.
+} _ai_external_bucket;
+
+// A record in the buffer, and the bucket it is for.
+typedef struct _ai_external_entry_struct {
+  uint32_t g;
+  uint32_t h;
+  size_t state_size;
+  uint8_t *record;
+} _ai_external_entry;
+
+// A file of records, read or written in order.
+typedef struct _ai_external_file_struct {
+  FILE *file;
+  char *io_buffer;
+  uint8_t *record; // The record last read.
+  int has_record;
+} _ai_external_file;
+
+// A search in progress.
+typedef struct _ai_external_search_struct {
+  ai_search_external *external;
+  ai_model_state_evaluator *model_state_evaluator;
+  size_t state_size;
+  size_t record_size;
+  char *path; // The search's own directory.
+  char *file_name;
+  size_t file_name_size;
+  _ai_external_bucket *bucket_list;
+  int bucket_count;
+  int bucket_list_size;
+  uint8_t *buffer;
+  _ai_external_entry *entry_list;
+  int entry_count;
+  int entry_max;
+} _ai_external_search;
+
+// The name of a run, or of the layer if run is -1.
+const char *_ai_external_file_name(_ai_external_search *search, uint32_t g,
+                                   uint32_t h, int run) {
+  if (run < 0) {
+    snprintf(search->file_name, search->file_name_size, "%s/l_%u_%u",
+             search->path, g, h);
+  } else {
+    snprintf(search->file_name, search->file_name_size, "%s/r_%u_%u_%d",
+             search->path, g, h, run);
+  }
+  return search->file_name;
+}
+
+// The bucket of g and h, made if create is true. Returns its index, or -1.
+int _ai_external_bucket_find(_ai_external_search *search, uint32_t g,
+                             uint32_t h, int create) {
+  for (int i = 0; i < search->bucket_count; i++) {
+    if ((search->bucket_list[i].g == g) && (search->bucket_list[i].h == h)) {
+      return i;
+    }
+  }
+  if (!create) {
+    return -1;
+  }
+  if (search->bucket_count == search->bucket_list_size) {
+    int size = search->bucket_list_size ? search->bucket_list_size * 2 : 64;
+    _ai_external_bucket *list = (_ai_external_bucket *)realloc(
+        search->bucket_list, sizeof(_ai_external_bucket) * size);
+    check(list, "_ai_external_bucket_find malloc failed");
+    search->bucket_list = list;
+    search->bucket_list_size = size;
+  }
+  _ai_external_bucket *bucket = &search->bucket_list[search->bucket_count];
+  memset(bucket, 0, sizeof(_ai_external_bucket));
+  bucket->g = g;
+  bucket->h = h;
+  return search->bucket_count++;
+error:
+  return -1;
+}
+
+int _ai_external_file_open(_ai_external_search *search,
+                           _ai_external_file *file, const char *file_name,
+                           const char *mode) {
+  memset(file, 0, sizeof(_ai_external_file));
+  file->io_buffer = (char *)malloc(_AI_EXTERNAL_FILE_BUFFER_SIZE);
+  file->record = (uint8_t *)malloc(search->record_size);
+  check(file->io_buffer && file->record,
+        "_ai_external_file_open malloc failed");
+  file->file = fopen(file_name, mode);
+  check(file->file, "_ai_external_file_open can not open %s", file_name);
+  setvbuf(file->file, file->io_buffer, _IOFBF, _AI_EXTERNAL_FILE_BUFFER_SIZE);
+  return 0;
+error:
+  free(file->io_buffer);
+  free(file->record);
+  memset(file, 0, sizeof(_ai_external_file));
+  return -1;
+}
+
+// Returns 0, or -1 if the file was not written in full.
+int _ai_external_file_close(_ai_external_file *file) {
+  int rc = 0;
+  if (file->file) {
+    rc = fclose(file->file) == 0 ? 0 : -1;
+  }
+  free(file->io_buffer);
+  free(file->record);
+  memset(file, 0, sizeof(_ai_external_file));
+  return rc;
+}
+
+// Read the next record, if there is one. Returns 0, or -1 on error.
+int _ai_external_file_next(_ai_external_search *search,
+                           _ai_external_file *file) {
+  size_t read = fread(file->record, search->record_size, 1, file->file);
+  file->has_record = read == 1;
+  if (file->has_record) {
+    search->external->bytes_read += search->record_size;
+    return 0;
+  }
+  check(!ferror(file->file), "_ai_external_file_next read failed");
+  return 0;
+error:
+  return -1;
+}
+
+int _ai_external_file_write(_ai_external_search *search,
+                            _ai_external_file *file, const uint8_t *record) {
+  check(fwrite(record, search->record_size, 1, file->file) == 1,
+        "_ai_external_file_write write failed");
+  search->external->bytes_written += search->record_size;
+  return 0;
+error:
+  return -1;
+}
+
+int _ai_external_entry_compare(const void *a, const void *b) {
+  const _ai_external_entry *ea = (const _ai_external_entry *)a;
+  const _ai_external_entry *eb = (const _ai_external_entry *)b;
+  if (ea->g != eb->g) {
+    return ea->g < eb->g ? -1 : 1;
+  }
+  if (ea->h != eb->h) {
+    return ea->h < eb->h ? -1 : 1;
+  }
+  return memcmp(ea->record, eb->record, ea->state_size);
+}
+
+// Write the buffer out as a sorted run for each bucket in it.
+int _ai_external_flush(_ai_external_search *search) {
+  _ai_external_file file = {0};
+  qsort(search->entry_list, search->entry_count, sizeof(_ai_external_entry),
+        _ai_external_entry_compare);
+  for (int i = 0; i < search->entry_count;) {
+    _ai_external_entry *entry = &search->entry_list[i];
+    int bucket_index = _ai_external_bucket_find(search, entry->g, entry->h, 0);
+    _ai_external_bucket *bucket = &search->bucket_list[bucket_index];
+    check(_ai_external_file_open(
+              search, &file,
+              _ai_external_file_name(search, bucket->g, bucket->h,
+                                     bucket->run_last),
+              "wb") == 0,
+          "_ai_external_flush can not write a run");
+    bucket->run_last++;
+    bucket->buffered_count = 0;
+    search->external->run_count++;
+    uint8_t *last = NULL;
+    for (; (i < search->entry_count) &&
+           (search->entry_list[i].g == bucket->g) &&
+           (search->entry_list[i].h == bucket->h);
+         i++) {
+      uint8_t *record = search->entry_list[i].record;
+      if (last && (memcmp(last, record, search->state_size) == 0)) {
+        search->external->duplicate_count++;
+        continue;
+      }
+      check(_ai_external_file_write(search, &file, record) == 0,
+            "_ai_external_flush write failed");
+      last = record;
+    }
+    check(_ai_external_file_close(&file) == 0,
+          "_ai_external_flush write failed");
+  }
+  search->entry_count = 0;
+  return 0;
+error:
+  _ai_external_file_close(&file);
+  return -1;
+}
+
+// Add a successor to the buffer, writing the buffer out first if it is full.
+int _ai_external_push(_ai_external_search *search, uint32_t g, uint32_t h,
+                      ai_model_state *model_state, const uint8_t *parent,
+                      uint32_t parent_h) {
+  if (search->entry_count == search->entry_max) {
+    check(_ai_external_flush(search) == 0, "_ai_external_push flush failed");
+  }
+  int bucket_index = _ai_external_bucket_find(search, g, h, 1);
+  check(bucket_index >= 0, "_ai_external_push out of memory");
+  uint8_t *record = search->buffer + search->entry_count * search->record_size;
+  search->model_state_evaluator->model_state_pack_function(model_state, record);
+  if (parent) {
+    memcpy(record + search->state_size, parent, search->state_size);
+  } else {
+    memset(record + search->state_size, 0, search->state_size);
+  }
+  memcpy(record + search->state_size * 2, &parent_h, sizeof(uint32_t));
+  _ai_external_entry *entry = &search->entry_list[search->entry_count++];
+  entry->g = g;
+  entry->h = h;
+  entry->state_size = search->state_size;
+  entry->record = record;
+  search->bucket_list[bucket_index].buffered_count++;
+  return 0;
+error:
+  return -1;
+}
+
+// Whether a layer is read to drop states from a bucket's layer.
+int _ai_external_layer_earlier(_ai_external_search *search,
+                               _ai_external_bucket *bucket,
+                               _ai_external_bucket *earlier) {
+  int locality = search->external->duplicate_locality;
+  return earlier->expanded && (earlier->h == bucket->h) &&
+         (earlier->g < bucket->g) &&
+         (!locality || (bucket->g - earlier->g <= (uint32_t)locality));
+}
+
+/*
+ * Merge the first count runs of a bucket, dropping duplicates and the
+ * states of layer_count of its earlier layers, from the layer_first'th,
+ * into a new run, or into the bucket's layer if layer is true. Returns the
+ * records written, or -1 on error.
+ */
+int64_t _ai_external_merge_runs(_ai_external_search *search, int bucket_index,
+                                int count, int layer_first, int layer_count,
+                                int layer) {
+  ai_search_external *external = search->external;
+  size_t state_size = search->state_size;
+  _ai_external_bucket bucket = search->bucket_list[bucket_index];
+  _ai_external_file *input_list = NULL;
+  _ai_external_file output = {0};
+  int input_count = 0;
+  int64_t written = 0;
+  input_list = (_ai_external_file *)calloc(count + layer_count + 1,
+                                           sizeof(_ai_external_file));
+  check(input_list, "_ai_external_merge_runs malloc failed");
+  for (; input_count < count; input_count++) {
+    _ai_external_file *input = &input_list[input_count];
+    check(_ai_external_file_open(
+              search, input,
+              _ai_external_file_name(search, bucket.g, bucket.h,
+                                     bucket.run_first + input_count),
+              "rb") == 0 &&
+              _ai_external_file_next(search, input) == 0,
+          "_ai_external_merge_runs can not read a run");
+  }
+  // The earlier layers follow the runs.
+  int run_count = input_count;
+  for (int i = 0, earlier_index = 0;
+       (i < search->bucket_count) && (input_count < count + layer_count);
+       i++) {
+    _ai_external_bucket *earlier = &search->bucket_list[i];
+    if (!_ai_external_layer_earlier(search, &bucket, earlier) ||
+        (earlier_index++ < layer_first)) {
+      continue;
+    }
+    _ai_external_file *input = &input_list[input_count++];
+    check(_ai_external_file_open(
+              search, input,
+              _ai_external_file_name(search, earlier->g, earlier->h, -1),
+              "rb") == 0 &&
+              _ai_external_file_next(search, input) == 0,
+          "_ai_external_merge_runs can not read a layer");
+  }
+  check(_ai_external_file_open(
+            search, &output,
+            _ai_external_file_name(search, bucket.g, bucket.h,
+                                   layer ? -1 : bucket.run_last),
+            "wb") == 0,
+        "_ai_external_merge_runs can not write");
+
+  for (;;) {
+    int least = -1;
+    for (int i = 0; i < run_count; i++) {
+      if (input_list[i].has_record &&
+          ((least < 0) || (memcmp(input_list[i].record,
+                                  input_list[least].record, state_size) < 0))) {
+        least = i;
+      }
+    }
+    if (least < 0) {
+      break;
+    }
+    // Keep the state, and move every run past it.
+    uint8_t *state = output.record;
+    memcpy(state, input_list[least].record, search->record_size);
+    for (int i = 0; i < run_count; i++) {
+      while (input_list[i].has_record &&
+             (memcmp(input_list[i].record, state, state_size) == 0)) {
+        external->duplicate_count += i != least;
+        check(_ai_external_file_next(search, &input_list[i]) == 0,
+              "_ai_external_merge_runs read failed");
+      }
+    }
+    int expanded = 0;
+    for (int i = run_count; (i < input_count) && !expanded; i++) {
+      while (input_list[i].has_record &&
+             (memcmp(input_list[i].record, state, state_size) < 0)) {
+        check(_ai_external_file_next(search, &input_list[i]) == 0,
+              "_ai_external_merge_runs read failed");
+      }
+      expanded = input_list[i].has_record &&
+                 (memcmp(input_list[i].record, state, state_size) == 0);
+    }
+    if (expanded) {
+      external->duplicate_count++;
+      continue;
+    }
+    check(_ai_external_file_write(search, &output, state) == 0,
+          "_ai_external_merge_runs write failed");
+    written++;
+  }
+  check(_ai_external_file_close(&output) == 0,
+        "_ai_external_merge_runs write failed");
+  for (int i = 0; i < input_count; i++) {
+    _ai_external_file_close(&input_list[i]);
+  }
+  free(input_list);
+  for (int i = 0; i < count; i++) {
+    unlink(_ai_external_file_name(search, bucket.g, bucket.h,
+                                  bucket.run_first + i));
+  }
+  _ai_external_bucket *merged = &search->bucket_list[bucket_index];
+  merged->run_first += count;
+  if (layer) {
+    merged->record_count = written;
+  } else {
+    merged->run_last++;
+    external->run_count++;
+  }
+  return written;
+error:
+  _ai_external_file_close(&output);
+  for (int i = 0; input_list && (i < input_count); i++) {
+    _ai_external_file_close(&input_list[i]);
+  }
+  free(input_list);
+  return -1;
+}
+
+// Merge every run of a bucket into its layer, at most
+// _AI_EXTERNAL_MERGE_WAY files at a time. Returns 0, or -1 on error.
+int _ai_external_merge(_ai_external_search *search, int bucket_index) {
+  _ai_external_bucket *bucket = &search->bucket_list[bucket_index];
+  if (bucket->buffered_count) {
+    check(_ai_external_flush(search) == 0, "_ai_external_merge flush failed");
+  }
+  while (bucket->run_last - bucket->run_first > _AI_EXTERNAL_MERGE_WAY) {
+    check(_ai_external_merge_runs(search, bucket_index, _AI_EXTERNAL_MERGE_WAY,
+                                  0, 0, 0) >= 0,
+          "_ai_external_merge merge failed");
+  }
+  int layer_total = 0;
+  for (int i = 0; i < search->bucket_count; i++) {
+    layer_total += _ai_external_layer_earlier(search, bucket,
+                                              &search->bucket_list[i]);
+  }
+  // Each pass drops the states of as many earlier layers as fit beside the
+  // runs, into one run, until the last pass writes the layer.
+  int layer_first = 0;
+  for (;;) {
+    int count = bucket->run_last - bucket->run_first;
+    int layer_count = layer_total - layer_first;
+    int layer = layer_count <= _AI_EXTERNAL_MERGE_WAY - count;
+    if (!layer) {
+      layer_count = _AI_EXTERNAL_MERGE_WAY - count;
+    }
+    check(_ai_external_merge_runs(search, bucket_index, count, layer_first,
+                                  layer_count, layer) >= 0,
+          "_ai_external_merge merge failed");
+    if (layer) {
+      break;
+    }
+    layer_first += layer_count;
+  }
+  return 0;
+error:
+  return -1;
+}
+
+// Whether a cost can be a bucket's difference in g.
+int _ai_external_cost_valid(float cost) {
+  return (cost >= 1) && (cost == floorf(cost)) && (cost < (float)UINT32_MAX);
+}
+
+// The estimate of a state, rounded up to a whole number, and raised to the
+// parent's estimate less the cost, if that is more.
+uint32_t _ai_external_est_cost(_ai_external_search *search,
+                               ai_model_state *model_state, uint32_t parent_h,
+                               uint32_t cost) {
+  ai_goal_est_cost_function goal_est_cost_function =
+      search->model_state_evaluator->goal_est_cost_function;
+  uint32_t h = 0;
+  if (goal_est_cost_function) {
+    float est_cost = goal_est_cost_function(model_state);
+    if (est_cost > _AI_EXTERNAL_EST_COST_TOLERANCE) {
+      h = (uint32_t)ceilf(est_cost - _AI_EXTERNAL_EST_COST_TOLERANCE);
+    }
+  }
+  if ((parent_h != _AI_EXTERNAL_H_NONE) && (parent_h > cost) &&
+      (parent_h - cost > h)) {
+    h = parent_h - cost;
+  }
+  return h;
+}
+
+/*
+ * Expand every state of a bucket's layer. Stops, with status FOUND, at the
+ * first Goal, which is copied to goal_record. Returns 0, or -1 on error with
+ * the status set.
+ */
+int _ai_external_expand(_ai_external_search *search, int bucket_index,
+                        uint8_t *goal_record) {
+  ai_search_external *external = search->external;
+  ai_model_state_evaluator *model_state_evaluator =
+      search->model_state_evaluator;
+  uint32_t g = search->bucket_list[bucket_index].g;
+  uint32_t h = search->bucket_list[bucket_index].h;
+  _ai_external_file file = {0};
+  if (_ai_external_file_open(search, &file,
+                             _ai_external_file_name(search, g, h, -1),
+                             "rb") != 0) {
+    external->status = AI_SEARCH_STATUS_IO_ERROR;
+    return -1;
+  }
+  int rc = 0;
+  while (rc == 0) {
+    if (_ai_external_file_next(search, &file) != 0) {
+      external->status = AI_SEARCH_STATUS_IO_ERROR;
+      rc = -1;
+      break;
+    }
+    if (!file.has_record) {
+      break;
+    }
+    if (external->fringe_expansion_max &&
+        (external->fringe_expansion_count >= external->fringe_expansion_max)) {
+      external->status = AI_SEARCH_STATUS_EXPANSION_LIMIT;
+      break;
+    }
+    ai_model_state *model_state = ai_model_state_constructor(
+        model_state_evaluator->model_state_unpack_function(file.record));
+    if (model_state_evaluator->is_goal_state_function(model_state)) {
+      _ai_model_state_free(model_state,
+                           model_state_evaluator->model_state_data_free);
+      memcpy(goal_record, file.record, search->record_size);
+      external->status = AI_SEARCH_STATUS_FOUND;
+      break;
+    }
+    external->fringe_expansion_count++;
+    ai_successor *successor_list = model_state_evaluator->successor_function(
+        model_state, model_state_evaluator->transition_function);
+    for (ai_successor *successor = successor_list; successor;) {
+      ai_successor *successor_next = successor->next;
+      if (rc == 0) {
+        if (!_ai_external_cost_valid(successor->cost)) {
+          log_error("ai_search_external cost not a whole number of at least 1");
+          external->status = AI_SEARCH_STATUS_CANCELLED;
+          rc = -1;
+        } else {
+          uint32_t cost = (uint32_t)successor->cost;
+          uint32_t successor_h = _ai_external_est_cost(
+              search, successor->model_state, h, cost);
+          if (_ai_external_push(search, g + cost, successor_h,
+                                successor->model_state, file.record, h) != 0) {
+            external->status = AI_SEARCH_STATUS_IO_ERROR;
+            rc = -1;
+          }
+        }
+      }
+      _ai_model_state_free(successor->model_state,
+                           model_state_evaluator->model_state_data_free);
+      successor->action->next = NULL;
+      _ai_path_free(successor->action, model_state_evaluator->action_data_free);
+      free(successor);
+      successor = successor_next;
+    }
+    _ai_model_state_free(model_state,
+                         model_state_evaluator->model_state_data_free);
+  }
+  _ai_external_file_close(&file);
+  return rc;
+}
+
+// Look a state up in a layer, by binary search. Returns 1 and the record if
+// found, 0 if not, or -1 on error.
+int _ai_external_layer_find(_ai_external_search *search, uint32_t g,
+                            uint32_t h, const uint8_t *state,
+                            uint8_t *record) {
+  int bucket_index = _ai_external_bucket_find(search, g, h, 0);
+  if ((bucket_index < 0) || !search->bucket_list[bucket_index].expanded) {
+    return 0;
+  }
+  FILE *file = fopen(_ai_external_file_name(search, g, h, -1), "rb");
+  check(file, "_ai_external_layer_find can not open a layer");
+  uint64_t low = 0;
+  uint64_t high = search->bucket_list[bucket_index].record_count;
+  while (low < high) {
+    uint64_t middle = low + (high - low) / 2;
+    if ((fseeko(file, (off_t)(middle * search->record_size), SEEK_SET) != 0) ||
+        (fread(record, search->record_size, 1, file) != 1)) {
+      fclose(file);
+      log_error("_ai_external_layer_find read failed");
+      return -1;
+    }
+    search->external->bytes_read += search->record_size;
+    int order = memcmp(record, state, search->state_size);
+    if (order == 0) {
+      fclose(file);
+      return 1;
+    } else if (order < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  fclose(file);
+  return 0;
+error:
+  return -1;
+}
+
+/*
+ * The path to the Goal record of bucket g. Each parent's successors are
+ * generated again to find the action to the child, and the parent's record,
+ * for its own parent, is looked up in its layer.
+ */
+ai_path *_ai_external_path(_ai_external_search *search, uint32_t g,
+                           const uint8_t *goal_record) {
+  ai_model_state_evaluator *model_state_evaluator =
+      search->model_state_evaluator;
+  size_t state_size = search->state_size;
+  ai_path *path = NULL;
+  uint8_t *record = (uint8_t *)malloc(search->record_size);
+  uint8_t *parent_record = (uint8_t *)malloc(search->record_size);
+  uint8_t *packed = (uint8_t *)malloc(state_size);
+  check(record && parent_record && packed, "_ai_external_path malloc failed");
+  memcpy(record, goal_record, search->record_size);
+  for (;;) {
+    uint32_t parent_h;
+    memcpy(&parent_h, record + state_size * 2, sizeof(uint32_t));
+    if (parent_h == _AI_EXTERNAL_H_NONE) {
+      break;
+    }
+    ai_model_state *parent = ai_model_state_constructor(
+        model_state_evaluator->model_state_unpack_function(record +
+                                                           state_size));
+    ai_successor *successor_list = model_state_evaluator->successor_function(
+        parent, model_state_evaluator->transition_function);
+    ai_action *found_action = NULL;
+    int rc = 0;
+    for (ai_successor *successor = successor_list; successor;) {
+      ai_successor *successor_next = successor->next;
+      if (!found_action && (rc == 0) &&
+          _ai_external_cost_valid(successor->cost) &&
+          ((uint32_t)successor->cost <= g)) {
+        model_state_evaluator->model_state_pack_function(successor->model_state,
+                                                         packed);
+        if (memcmp(packed, record, state_size) == 0) {
+          rc = _ai_external_layer_find(search, g - (uint32_t)successor->cost,
+                                       parent_h, record + state_size,
+                                       parent_record);
+          if (rc == 1) {
+            found_action = successor->action;
+            successor->action = NULL;
+            g -= (uint32_t)successor->cost;
+            rc = 0;
+          }
+        }
+      }
+      _ai_model_state_free(successor->model_state,
+                           model_state_evaluator->model_state_data_free);
+      if (successor->action) {
+        successor->action->next = NULL;
+        _ai_path_free(successor->action,
+                      model_state_evaluator->action_data_free);
+      }
+      free(successor);
+      successor = successor_next;
+    }
+    _ai_model_state_free(parent, model_state_evaluator->model_state_data_free);
+    check(found_action, "_ai_external_path parent not found");
+    found_action->next = path;
+    path = found_action;
+    uint8_t *swap = record;
+    record = parent_record;
+    parent_record = swap;
+  }
+  free(record);
+  free(parent_record);
+  free(packed);
+  return path;
+error:
+  free(record);
+  free(parent_record);
+  free(packed);
+  _ai_path_free(path, model_state_evaluator->action_data_free);
+  return NULL;
+}
+
+// The bucket to expand next, least f then least g, or -1 if none is left.
+int _ai_external_bucket_next(_ai_external_search *search) {
+  int next = -1;
+  for (int i = 0; i < search->bucket_count; i++) {
+    _ai_external_bucket *bucket = &search->bucket_list[i];
+    if (bucket->expanded ||
+        ((bucket->run_last == bucket->run_first) && !bucket->buffered_count)) {
+      continue;
+    }
+    if (next >= 0) {
+      _ai_external_bucket *best = &search->bucket_list[next];
+      uint64_t f = (uint64_t)bucket->g + bucket->h;
+      uint64_t best_f = (uint64_t)best->g + best->h;
+      if ((f > best_f) || ((f == best_f) && (bucket->g >= best->g))) {
+        continue;
+      }
+    }
+    next = i;
+  }
+  return next;
+}
+
+// Remove every file of the search, and its directory.
+void _ai_external_search_free(_ai_external_search *search) {
+  if (search->path) {
+    for (int i = 0; i < search->bucket_count; i++) {
+      _ai_external_bucket *bucket = &search->bucket_list[i];
+      for (int run = bucket->run_first; run < bucket->run_last; run++) {
+        unlink(_ai_external_file_name(search, bucket->g, bucket->h, run));
+      }
+      unlink(_ai_external_file_name(search, bucket->g, bucket->h, -1));
+    }
+    rmdir(search->path);
+  }
+  free(search->path);
+  free(search->file_name);
+  free(search->bucket_list);
+  free(search->buffer);
+  free(search->entry_list);
+}
+
+// private - External-memory A* search algorithm
+ai_path *
+_ai_search_external_find_path_to_goal(ai_search_external *external,
+                                      ai_model_state *initial_model_state) {
+  ai_path *result_path = NULL;
+  uint8_t *goal_record = NULL;
+  _ai_external_search search = {0};
+  search.external = external;
+  search.model_state_evaluator = external->model_state_evaluator;
+  search.state_size = external->model_state_evaluator->model_state_packed_size;
+  search.record_size = search.state_size * 2 + sizeof(uint32_t);
+  external->fringe_expansion_count = 0;
+  external->path_cost = 0;
+  external->duplicate_count = 0;
+  external->run_count = 0;
+  external->bytes_read = 0;
+  external->bytes_written = 0;
+  external->status = AI_SEARCH_STATUS_IO_ERROR;
+
+  search.entry_max = external->buffer_size /
+                     (search.record_size + sizeof(_ai_external_entry));
+  if (search.entry_max < 1) {
+    search.entry_max = 1;
+  }
+  search.buffer = (uint8_t *)malloc(search.record_size * search.entry_max);
+  search.entry_list = (_ai_external_entry *)malloc(
+      sizeof(_ai_external_entry) * search.entry_max);
+  goal_record = (uint8_t *)malloc(search.record_size);
+  size_t path_size = strlen(external->directory) + 32;
+  search.path = (char *)malloc(path_size);
+  search.file_name_size = path_size + 64;
+  search.file_name = (char *)malloc(search.file_name_size);
+  check(search.buffer && search.entry_list && goal_record && search.path &&
+            search.file_name,
+        "_ai_search_external_find_path_to_goal malloc failed");
+  snprintf(search.path, path_size, "%s/ai_external.XXXXXX",
+           external->directory);
+  if (!mkdtemp(search.path)) {
+    free(search.path);
+    search.path = NULL;
+  }
+  check(search.path, "_ai_search_external_find_path_to_goal can not make a "
+                     "directory in %s",
+        external->directory);
+
+  uint32_t h = _ai_external_est_cost(&search, initial_model_state,
+                                     _AI_EXTERNAL_H_NONE, 0);
+  check(_ai_external_push(&search, 0, h, initial_model_state, NULL,
+                          _AI_EXTERNAL_H_NONE) == 0,
+        "_ai_search_external_find_path_to_goal out of memory");
+  external->status = AI_SEARCH_STATUS_RUNNING;
+  uint32_t goal_g = 0;
+  while (external->status == AI_SEARCH_STATUS_RUNNING) {
+    int bucket_index = _ai_external_bucket_next(&search);
+    if (bucket_index < 0) {
+      external->status = AI_SEARCH_STATUS_NOT_FOUND;
+      break;
+    }
+    if (_ai_external_merge(&search, bucket_index) != 0) {
+      external->status = AI_SEARCH_STATUS_IO_ERROR;
+      break;
+    }
+    if (_ai_external_expand(&search, bucket_index, goal_record) != 0) {
+      break;
+    }
+    search.bucket_list[bucket_index].expanded = 1;
+    goal_g = search.bucket_list[bucket_index].g;
+  }
+  if (external->status == AI_SEARCH_STATUS_FOUND) {
+    external->path_cost = goal_g;
+    result_path = _ai_external_path(&search, goal_g, goal_record);
+    if (!result_path && (goal_g > 0)) {
+      external->status = AI_SEARCH_STATUS_IO_ERROR;
+    }
+  }
+
+error:
+  free(goal_record);
+  _ai_external_search_free(&search);
+  return result_path;
+}
+
+// ai_search_external *external = ai_search_external_constructor(e, "/tmp");
+ai_search_external *
+ai_search_external_constructor(ai_model_state_evaluator *model_state_evaluator,
+                               const char *directory) {
+  ai_search_external *external = NULL;
+  check(model_state_evaluator->model_state_packed_size &&
+            model_state_evaluator->model_state_pack_function &&
+            model_state_evaluator->model_state_unpack_function,
+        "ai_search_external_constructor evaluator can not pack states");
+  external = (ai_search_external *)calloc(1, sizeof(ai_search_external));
+  check(external, "ai_search_external_constructor malloc failed");
+  external->directory = strdup(directory);
+  check(external->directory, "ai_search_external_constructor malloc failed");
+  external->model_state_evaluator = model_state_evaluator;
+  external->find_path_to_goal = _ai_search_external_find_path_to_goal;
+  external->buffer_size = AI_SEARCH_EXTERNAL_BUFFER_SIZE;
+  external->duplicate_locality = 0;
+  external->fringe_expansion_max = 0;
+  external->status = AI_SEARCH_STATUS_IDLE;
+  return external;
+error:
+  free(external);
+  return NULL;
+}
+
+void ai_search_external_free(ai_search_external *external) {
+  if (external) {
+    free(external->directory);
+    free(external);
+  }
+}
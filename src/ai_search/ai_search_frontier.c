@@ -0,0 +1,500 @@
+/*
+ * AI - Frontier A* Search.
+ *
+ * The fringe is a binary min-heap on f, ties going to the greater g, and a
+ * hash table of the same nodes, chained through the nodes, so a successor
+ * already on the fringe is found and improved in place. A node is freed as
+ * soon as it is expanded. Before that it marks, in each successor it
+ * generates or finds on the fringe, the operator leading back to it.
+ *
+ * A relay is shared, counting references, by every node whose path crossed
+ * the middle through it, so only the first two states past the middle of a
+ * path are copied.
+ */
+#include "ai_search_internal.h"
+#include <ai_search_frontier.h>
+#include <logging.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define _AI_FRONTIER_BUCKET_COUNT_MIN 1024
+
+// The action on a node's path that first crossed the middle of the path cost.
+typedef struct _ai_frontier_relay_struct {
+  int reference_count;
+  ai_model_state *from; // Last state before the middle.
+  ai_action *action;
+  ai_model_state *to; // First state past the middle.
+  float from_cost_so_far;
+  float to_cost_so_far;
+} _ai_frontier_relay;
+
+typedef struct _ai_frontier_node_struct {
+  ai_model_state *model_state;
+  size_t hash;
+  float cost_so_far;
+  float est_total_cost;
+  uint32_t used_operators; // Operators leading back to expanded states.
+  int heap_index;
+  _ai_frontier_relay *relay; // NULL until the path crosses the middle.
+  struct _ai_frontier_node_struct *next; // In its hash bucket.
+} _ai_frontier_node;
+
+// One search, for the Goal or for a relay's state.
+typedef struct _ai_frontier_search_struct {
+  ai_search_frontier *frontier;
+  ai_model_state_evaluator *model_state_evaluator;
+  ai_model_state *target; // NULL when searching for a Goal.
+  float path_cost;        // Known cost of the path, or negative.
+  _ai_frontier_node **heap;
+  int heap_count;
+  int heap_size;
+  _ai_frontier_node **bucket_list;
+  size_t bucket_count; // A power of 2.
+  size_t node_count;
+} _ai_frontier_search;
+
+void _ai_frontier_relay_release(ai_model_state_evaluator *evaluator,
+                                _ai_frontier_relay *relay) {
+  if (relay && (--relay->reference_count == 0)) {
+    _ai_model_state_free(relay->from, evaluator->model_state_data_free);
+    _ai_path_free(relay->action, evaluator->action_data_free);
+    _ai_model_state_free(relay->to, evaluator->model_state_data_free);
+    free(relay);
+  }
+}
+
+_ai_frontier_relay *
+_ai_frontier_relay_constructor(ai_model_state_evaluator *evaluator,
+                               _ai_frontier_node *node, ai_action *action,
+                               ai_model_state *to, float to_cost_so_far) {
+  _ai_frontier_relay *relay =
+      (_ai_frontier_relay *)malloc(sizeof(_ai_frontier_relay));
+  check(relay, "_ai_frontier_relay_constructor malloc failed");
+  relay->reference_count = 1;
+  relay->from = _ai_model_state_duplicate(
+      node->model_state, evaluator->model_state_data_duplicator);
+  relay->action = ai_action_constructor(
+      evaluator->action_data_duplicator(action->data));
+  relay->to =
+      _ai_model_state_duplicate(to, evaluator->model_state_data_duplicator);
+  relay->from_cost_so_far = node->cost_so_far;
+  relay->to_cost_so_far = to_cost_so_far;
+  return relay;
+error:
+  return NULL;
+}
+
+void _ai_frontier_node_free(_ai_frontier_search *search,
+                            _ai_frontier_node *node) {
+  ai_model_state_evaluator *evaluator = search->model_state_evaluator;
+  _ai_model_state_free(node->model_state, evaluator->model_state_data_free);
+  _ai_frontier_relay_release(evaluator, node->relay);
+  free(node);
+}
+
+// True if node a is expanded before node b.
+int _ai_frontier_node_before(_ai_frontier_node *a, _ai_frontier_node *b) {
+  if (a->est_total_cost != b->est_total_cost) {
+    return a->est_total_cost < b->est_total_cost;
+  }
+  return a->cost_so_far > b->cost_so_far;
+}
+
+void _ai_frontier_heap_set(_ai_frontier_search *search, int index,
+                           _ai_frontier_node *node) {
+  search->heap[index] = node;
+  node->heap_index = index;
+}
+
+void _ai_frontier_heap_up(_ai_frontier_search *search, int index) {
+  _ai_frontier_node *node = search->heap[index];
+  while (index > 0) {
+    int parent = (index - 1) / 2;
+    if (!_ai_frontier_node_before(node, search->heap[parent])) {
+      break;
+    }
+    _ai_frontier_heap_set(search, index, search->heap[parent]);
+    index = parent;
+  }
+  _ai_frontier_heap_set(search, index, node);
+}
+
+void _ai_frontier_heap_down(_ai_frontier_search *search, int index) {
+  _ai_frontier_node *node = search->heap[index];
+  for (;;) {
+    int child = index * 2 + 1;
+    if (child >= search->heap_count) {
+      break;
+    }
+    if ((child + 1 < search->heap_count) &&
+        _ai_frontier_node_before(search->heap[child + 1],
+                                 search->heap[child])) {
+      child++;
+    }
+    if (!_ai_frontier_node_before(search->heap[child], node)) {
+      break;
+    }
+    _ai_frontier_heap_set(search, index, search->heap[child]);
+    index = child;
+  }
+  _ai_frontier_heap_set(search, index, node);
+}
+
+_ai_frontier_node *_ai_frontier_heap_pop(_ai_frontier_search *search) {
+  if (search->heap_count == 0) {
+    return NULL;
+  }
+  _ai_frontier_node *node = search->heap[0];
+  search->heap_count--;
+  if (search->heap_count > 0) {
+    _ai_frontier_heap_set(search, 0, search->heap[search->heap_count]);
+    _ai_frontier_heap_down(search, 0);
+  }
+  return node;
+}
+
+_ai_frontier_node *_ai_frontier_find(_ai_frontier_search *search,
+                                     ai_model_state *model_state,
+                                     size_t hash) {
+  ai_model_state_evaluator *evaluator = search->model_state_evaluator;
+  _ai_frontier_node *node =
+      search->bucket_list[hash & (search->bucket_count - 1)];
+  for (; node; node = node->next) {
+    if ((node->hash == hash) &&
+        evaluator->model_state_equal_function(node->model_state,
+                                              model_state)) {
+      return node;
+    }
+  }
+  return NULL;
+}
+
+void _ai_frontier_unlink(_ai_frontier_search *search,
+                         _ai_frontier_node *node) {
+  _ai_frontier_node **link =
+      &search->bucket_list[node->hash & (search->bucket_count - 1)];
+  while (*link != node) {
+    link = &(*link)->next;
+  }
+  *link = node->next;
+  search->node_count--;
+}
+
+// Adds a new node to the hash table and the heap. Returns 0, or -1 if out of
+// memory.
+int _ai_frontier_insert(_ai_frontier_search *search, _ai_frontier_node *node) {
+  if (search->node_count >= search->bucket_count) {
+    size_t bucket_count = search->bucket_count * 2;
+    _ai_frontier_node **bucket_list = (_ai_frontier_node **)calloc(
+        bucket_count, sizeof(_ai_frontier_node *));
+    check(bucket_list, "_ai_frontier_insert malloc failed");
+    for (size_t i = 0; i < search->bucket_count; i++) {
+      _ai_frontier_node *next = NULL;
+      for (_ai_frontier_node *n = search->bucket_list[i]; n; n = next) {
+        next = n->next;
+        n->next = bucket_list[n->hash & (bucket_count - 1)];
+        bucket_list[n->hash & (bucket_count - 1)] = n;
+      }
+    }
+    free(search->bucket_list);
+    search->bucket_list = bucket_list;
+    search->bucket_count = bucket_count;
+  }
+  if (search->heap_count == search->heap_size) {
+    int heap_size = search->heap_size * 2;
+    _ai_frontier_node **heap = (_ai_frontier_node **)realloc(
+        search->heap, sizeof(_ai_frontier_node *) * heap_size);
+    check(heap, "_ai_frontier_insert malloc failed");
+    search->heap = heap;
+    search->heap_size = heap_size;
+  }
+  size_t bucket = node->hash & (search->bucket_count - 1);
+  node->next = search->bucket_list[bucket];
+  search->bucket_list[bucket] = node;
+  search->node_count++;
+  if (search->node_count > search->frontier->node_count_max) {
+    search->frontier->node_count_max = search->node_count;
+  }
+  _ai_frontier_heap_set(search, search->heap_count++, node);
+  _ai_frontier_heap_up(search, node->heap_index);
+  return 0;
+error:
+  return -1;
+}
+
+int _ai_frontier_is_goal(_ai_frontier_search *search,
+                         ai_model_state *model_state) {
+  ai_model_state_evaluator *evaluator = search->model_state_evaluator;
+  if (search->target) {
+    return evaluator->model_state_equal_function(model_state, search->target);
+  }
+  return evaluator->is_goal_state_function(model_state);
+}
+
+float _ai_frontier_est_cost(_ai_frontier_search *search,
+                            ai_model_state *model_state) {
+  ai_model_state_evaluator *evaluator = search->model_state_evaluator;
+  if (search->target) {
+    if (evaluator->state_est_cost_function) {
+      return evaluator->state_est_cost_function(model_state, search->target);
+    }
+    return 0;
+  }
+  if (evaluator->goal_est_cost_function) {
+    return evaluator->goal_est_cost_function(model_state);
+  }
+  return 0;
+}
+
+// True if a path reaching a state at cost_so_far, with the estimate
+// est_cost, has crossed the middle. The middle of a path of unknown cost is
+// where the cost so far first reaches the estimate of the rest.
+int _ai_frontier_past_middle(_ai_frontier_search *search, float cost_so_far,
+                             float est_cost) {
+  if (search->path_cost >= 0) {
+    return cost_so_far * 2 >= search->path_cost;
+  }
+  return (cost_so_far > 0) && (cost_so_far >= est_cost);
+}
+
+// Generates the successors of node not marked as used, and adds them to the
+// fringe or improves them there. Returns 0, or -1 if out of memory.
+int _ai_frontier_expand(_ai_frontier_search *search, _ai_frontier_node *node) {
+  ai_search_frontier *frontier = search->frontier;
+  ai_model_state_evaluator *evaluator = search->model_state_evaluator;
+  int result = 0;
+  ai_successor *successor_list = evaluator->successor_function(
+      node->model_state, evaluator->transition_function);
+  ai_successor *successor_next = NULL;
+  for (ai_successor *successor = successor_list; successor;
+       successor = successor_next) {
+    successor_next = successor->next;
+    ai_model_state *model_state = successor->model_state;
+    ai_action *action = successor->action;
+    float cost_so_far = node->cost_so_far + successor->cost;
+    free(successor);
+    int used = (result == 0) &&
+               (node->used_operators &
+                ((uint32_t)1
+                 << frontier->operator_function(node->model_state, action)));
+    if ((result != 0) || used) {
+      _ai_model_state_free(model_state, evaluator->model_state_data_free);
+      _ai_path_free(action, evaluator->action_data_free);
+      continue;
+    }
+    uint32_t reverse_operator =
+        (uint32_t)1
+        << frontier->reverse_operator_function(node->model_state, action);
+    size_t hash = evaluator->model_state_hash_function(model_state);
+    _ai_frontier_node *old = _ai_frontier_find(search, model_state, hash);
+    if (old) {
+      old->used_operators |= reverse_operator;
+    }
+    if (old && (old->cost_so_far <= cost_so_far)) {
+      _ai_model_state_free(model_state, evaluator->model_state_data_free);
+      _ai_path_free(action, evaluator->action_data_free);
+      continue;
+    }
+    float est_cost = _ai_frontier_est_cost(search, model_state);
+    _ai_frontier_relay *relay = node->relay;
+    if (relay) {
+      relay->reference_count++;
+    } else if (_ai_frontier_past_middle(search, cost_so_far, est_cost)) {
+      relay = _ai_frontier_relay_constructor(evaluator, node, action,
+                                             model_state, cost_so_far);
+      if (!relay) {
+        result = -1;
+      }
+    }
+    _ai_path_free(action, evaluator->action_data_free);
+    if (old) {
+      _ai_model_state_free(model_state, evaluator->model_state_data_free);
+      _ai_frontier_relay_release(evaluator, old->relay);
+      old->relay = relay;
+      old->cost_so_far = cost_so_far;
+      old->est_total_cost = cost_so_far + est_cost;
+      _ai_frontier_heap_up(search, old->heap_index);
+      continue;
+    }
+    _ai_frontier_node *new_node =
+        (_ai_frontier_node *)malloc(sizeof(_ai_frontier_node));
+    if (!new_node) {
+      log_error("_ai_frontier_expand malloc failed");
+      _ai_model_state_free(model_state, evaluator->model_state_data_free);
+      _ai_frontier_relay_release(evaluator, relay);
+      result = -1;
+      continue;
+    }
+    new_node->model_state = model_state;
+    new_node->hash = hash;
+    new_node->cost_so_far = cost_so_far;
+    new_node->est_total_cost = cost_so_far + est_cost;
+    new_node->used_operators = reverse_operator;
+    new_node->relay = relay;
+    if (_ai_frontier_insert(search, new_node) != 0) {
+      _ai_frontier_node_free(search, new_node);
+      result = -1;
+    }
+  }
+  return result;
+}
+
+void _ai_frontier_search_free(_ai_frontier_search *search) {
+  for (int i = 0; i < search->heap_count; i++) {
+    _ai_frontier_node_free(search, search->heap[i]);
+  }
+  free(search->heap);
+  free(search->bucket_list);
+}
+
+// One search from initial_model_state to target, or to a Goal if target is
+// NULL. path_cost is the cost of the path if known, or negative. Returns the
+// status, with the relay of the path found, NULL if it has no actions, and
+// its cost.
+ai_search_status _ai_frontier_search_run(ai_search_frontier *frontier,
+                                         ai_model_state *initial_model_state,
+                                         ai_model_state *target,
+                                         float path_cost,
+                                         _ai_frontier_relay **relay,
+                                         float *cost) {
+  ai_model_state_evaluator *evaluator = frontier->model_state_evaluator;
+  ai_search_status status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+  _ai_frontier_node *node = NULL;
+  _ai_frontier_search search = {0};
+  search.frontier = frontier;
+  search.model_state_evaluator = evaluator;
+  search.target = target;
+  search.path_cost = path_cost;
+  search.heap_size = _AI_FRONTIER_BUCKET_COUNT_MIN;
+  search.heap = (_ai_frontier_node **)malloc(sizeof(_ai_frontier_node *) *
+                                             search.heap_size);
+  search.bucket_count = _AI_FRONTIER_BUCKET_COUNT_MIN;
+  search.bucket_list = (_ai_frontier_node **)calloc(
+      search.bucket_count, sizeof(_ai_frontier_node *));
+  check(search.heap && search.bucket_list,
+        "_ai_frontier_search_run malloc failed");
+  node = (_ai_frontier_node *)calloc(1, sizeof(_ai_frontier_node));
+  check(node, "_ai_frontier_search_run malloc failed");
+  node->model_state = _ai_model_state_duplicate(
+      initial_model_state, evaluator->model_state_data_duplicator);
+  node->hash = evaluator->model_state_hash_function(node->model_state);
+  node->est_total_cost = _ai_frontier_est_cost(&search, node->model_state);
+  if (_ai_frontier_insert(&search, node) != 0) {
+    _ai_frontier_node_free(&search, node);
+    goto error;
+  }
+  frontier->search_count++;
+
+  while ((node = _ai_frontier_heap_pop(&search)) != NULL) {
+    _ai_frontier_unlink(&search, node);
+    if (_ai_frontier_is_goal(&search, node->model_state)) {
+      *relay = node->relay;
+      node->relay = NULL;
+      *cost = node->cost_so_far;
+      _ai_frontier_node_free(&search, node);
+      status = AI_SEARCH_STATUS_FOUND;
+      goto error;
+    }
+    if ((frontier->fringe_expansion_max != 0) &&
+        (frontier->fringe_expansion_count >= frontier->fringe_expansion_max)) {
+      _ai_frontier_node_free(&search, node);
+      status = AI_SEARCH_STATUS_EXPANSION_LIMIT;
+      goto error;
+    }
+    frontier->fringe_expansion_count++;
+    int result = _ai_frontier_expand(&search, node);
+    _ai_frontier_node_free(&search, node);
+    if (result != 0) {
+      goto error;
+    }
+  }
+  status = AI_SEARCH_STATUS_NOT_FOUND;
+
+error:
+  _ai_frontier_search_free(&search);
+  return status;
+}
+
+// Appends to path the actions from initial_model_state to target, or to a
+// Goal if target is NULL, as _ai_frontier_search_run. Returns 0, or -1 with
+// the frontier's status set.
+int _ai_frontier_path(ai_search_frontier *frontier,
+                      ai_model_state *initial_model_state,
+                      ai_model_state *target, float path_cost,
+                      ai_path **path) {
+  ai_model_state_evaluator *evaluator = frontier->model_state_evaluator;
+  _ai_frontier_relay *relay = NULL;
+  float cost = 0;
+  ai_search_status status = _ai_frontier_search_run(
+      frontier, initial_model_state, target, path_cost, &relay, &cost);
+  if (status != AI_SEARCH_STATUS_FOUND) {
+    frontier->status = status;
+    return -1;
+  }
+  if (path_cost < 0) {
+    frontier->path_cost = cost;
+  }
+  int result = 0;
+  if (relay) {
+    result = _ai_frontier_path(frontier, initial_model_state, relay->from,
+                               relay->from_cost_so_far, path);
+    if (result == 0) {
+      void *action_data =
+          evaluator->action_data_duplicator(relay->action->data);
+      _ai_path_append_action(path, ai_action_constructor(action_data));
+      result = _ai_frontier_path(frontier, relay->to, target,
+                                 cost - relay->to_cost_so_far, path);
+    }
+    _ai_frontier_relay_release(evaluator, relay);
+  }
+  return result;
+}
+
+// private - Frontier A* search algorithm
+ai_path *
+_ai_search_frontier_find_path_to_goal(ai_search_frontier *frontier,
+                                      ai_model_state *initial_model_state) {
+  ai_model_state_evaluator *evaluator = frontier->model_state_evaluator;
+  ai_path *result_path = NULL;
+  frontier->fringe_expansion_count = 0;
+  frontier->path_cost = 0;
+  frontier->search_count = 0;
+  frontier->node_count_max = 0;
+  frontier->status = AI_SEARCH_STATUS_RUNNING;
+  if (_ai_frontier_path(frontier, initial_model_state, NULL, -1,
+                        &result_path) != 0) {
+    _ai_path_free(result_path, evaluator->action_data_free);
+    return NULL;
+  }
+  frontier->status = AI_SEARCH_STATUS_FOUND;
+  return result_path;
+}
+
+// ai_search_frontier *frontier =
+//     ai_search_frontier_constructor(e, my_operator, my_reverse_operator);
+ai_search_frontier *
+ai_search_frontier_constructor(ai_model_state_evaluator *model_state_evaluator,
+                               ai_operator_function operator_function,
+                               ai_operator_function reverse_operator_function) {
+  ai_search_frontier *frontier = NULL;
+  check(model_state_evaluator->model_state_hash_function &&
+            model_state_evaluator->model_state_equal_function,
+        "ai_search_frontier_constructor evaluator has no hash or equal "
+        "function");
+  check(operator_function && reverse_operator_function,
+        "ai_search_frontier_constructor no operator function");
+  frontier = (ai_search_frontier *)calloc(1, sizeof(ai_search_frontier));
+  check(frontier, "ai_search_frontier_constructor malloc failed");
+  frontier->model_state_evaluator = model_state_evaluator;
+  frontier->find_path_to_goal = _ai_search_frontier_find_path_to_goal;
+  frontier->operator_function = operator_function;
+  frontier->reverse_operator_function = reverse_operator_function;
+  frontier->fringe_expansion_max = 0;
+  frontier->status = AI_SEARCH_STATUS_IDLE;
+  return frontier;
+error:
+  return NULL;
+}
+
+void ai_search_frontier_free(ai_search_frontier *frontier) { free(frontier); }
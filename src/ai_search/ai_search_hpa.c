@@ -0,0 +1,752 @@
+/*
+ * AI - Hierarchical Path-Finding A* (HPA*).
+ *
+ * Each cluster holds the transitions across its right and lower borders, so
+ * every border is held once. The entrances of a cluster are the cells on its
+ * side of the transitions on all four of its borders.
+ *
+ * The abstract graph is an ai_graph built from every cluster's entrances,
+ * and is rebuilt in full after a change. Only the intra-cluster costs, which
+ * need a search per entrance, are kept for clusters that have not changed.
+ *
+ * During a query the start and goal are not added to the graph. The abstract
+ * evaluator gives them as two extra nodes, linked to the entrances of their
+ * clusters by costs found for that query.
+ */
+#include "ai_search_internal.h"
+#include <ai_search_hpa.h>
+#include <logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Openings of fewer cells than this get a single entrance in the middle.
+#define AI_HPA_OPENING_WIDE 6
+
+// The query, as seen by the abstract evaluator.
+typedef struct _ai_hpa_query_struct {
+  ai_search_hpa *hpa;
+  uint32_t start_node;
+  uint32_t goal_node;
+  int start_x, start_y, start_cluster;
+  int goal_x, goal_y, goal_cluster;
+  float *start_cost; // Per entrance of the start's cluster.
+  float *goal_cost;  // Per entrance of the goal's cluster.
+} _ai_hpa_query;
+
+// Abstract Model State data.
+typedef struct _ai_hpa_state_struct {
+  _ai_hpa_query *query;
+  uint32_t node;
+} _ai_hpa_state;
+
+int _ai_hpa_cluster_index(ai_search_hpa *hpa, int x, int y) {
+  return (y / hpa->cluster_size) * hpa->cluster_columns +
+         (x / hpa->cluster_size);
+}
+
+// Local searches.
+
+void _ai_hpa_local_query_init(ai_search_hpa *hpa, ai_grid_query *query,
+                              int cluster_index, int goal_x, int goal_y) {
+  ai_hpa_cluster *cluster = &hpa->cluster_list[cluster_index];
+  ai_grid_query_init(query, hpa->grid, goal_x, goal_y);
+  query->min_x = cluster->x;
+  query->min_y = cluster->y;
+  query->max_x = cluster->x + cluster->width;
+  query->max_y = cluster->y + cluster->height;
+}
+
+// The path between two cells, inside a cluster. found is false if there is
+// none.
+ai_path *_ai_hpa_local_path(ai_search_hpa *hpa, int cluster_index, int x0,
+                            int y0, int x1, int y1, int *found) {
+  ai_grid_query query;
+  _ai_hpa_local_query_init(hpa, &query, cluster_index, x1, y1);
+  ai_model_state *model_state = ai_grid_model_state_constructor(&query, x0, y0);
+  ai_search_astar *astar =
+      ai_search_astar_constructor(&ai_grid_model_state_evaluator);
+  ai_path *path = astar->find_path_to_goal(astar, model_state);
+  *found = (astar->status == AI_SEARCH_STATUS_FOUND);
+  hpa->fringe_expansion_count += astar->fringe_expansion_count;
+  ai_search_astar_free(astar);
+  _ai_model_state_free(model_state, ai_grid_data_free);
+  return path;
+}
+
+// The cost from a cell to each of a list of cells, inside a cluster, in a
+// single search. FLT_MAX where there is no path. Returns 0, or -1 if out of
+// memory, with every cost FLT_MAX.
+int _ai_hpa_local_costs(ai_search_hpa *hpa, int cluster_index, int x, int y,
+                        ai_grid_action *cell_list, int cell_count,
+                        float *costs) {
+  int result = -1;
+  if (cell_count == 0) {
+    return 0;
+  }
+  ai_grid_query query;
+  _ai_hpa_local_query_init(hpa, &query, cluster_index, x, y);
+  ai_model_state *model_state = ai_grid_model_state_constructor(&query, x, y);
+  ai_model_state **goal_list =
+      (ai_model_state **)malloc(sizeof(ai_model_state *) * cell_count);
+  ai_path **path_list = (ai_path **)malloc(sizeof(ai_path *) * cell_count);
+  ai_search_astar *astar =
+      ai_search_astar_constructor(&ai_grid_model_state_evaluator);
+  check(goal_list && path_list && astar, "_ai_hpa_local_costs malloc failed");
+  for (int i = 0; i < cell_count; i++) {
+    goal_list[i] =
+        ai_grid_model_state_constructor(&query, cell_list[i].x, cell_list[i].y);
+  }
+  ai_search_astar_find_paths_to_goals(astar, model_state, goal_list,
+                                      cell_count, path_list, costs);
+  hpa->fringe_expansion_count += astar->fringe_expansion_count;
+  for (int i = 0; i < cell_count; i++) {
+    _ai_path_free(path_list[i], ai_grid_data_free);
+    _ai_model_state_free(goal_list[i], ai_grid_data_free);
+  }
+  result = 0;
+  goto done;
+error:
+  for (int i = 0; i < cell_count; i++) {
+    costs[i] = FLT_MAX;
+  }
+done:
+  ai_search_astar_free(astar);
+  free(goal_list);
+  free(path_list);
+  _ai_model_state_free(model_state, ai_grid_data_free);
+  return result;
+}
+
+// Building clusters.
+
+// Find the transitions across one border. The border runs length cells from
+// (x, y) in steps of (step_x, step_y), and the facing cell is offset by
+// (across_x, across_y). Returns 0, or -1 if out of memory, with none.
+int _ai_hpa_border_transitions(ai_search_hpa *hpa, int x, int y, int step_x,
+                               int step_y, int across_x, int across_y,
+                               int length, ai_hpa_transition **list,
+                               int *count) {
+  ai_grid *grid = hpa->grid;
+  free(*list);
+  *list = NULL;
+  *count = 0;
+  // At most two per opening, and openings are separated by a blocked cell.
+  ai_hpa_transition *new_list =
+      (ai_hpa_transition *)malloc(sizeof(ai_hpa_transition) * (length + 1));
+  check(new_list, "_ai_hpa_border_transitions malloc failed");
+  int opening_start = -1;
+  for (int i = 0; i <= length; i++) {
+    int cx = x + i * step_x;
+    int cy = y + i * step_y;
+    int open = (i < length) && !ai_grid_blocked(grid, cx, cy) &&
+               !ai_grid_blocked(grid, cx + across_x, cy + across_y);
+    if (open && (opening_start < 0)) {
+      opening_start = i;
+    } else if (!open && (opening_start >= 0)) {
+      int opening_end = i - 1;
+      int at[2];
+      int at_count = 0;
+      if (opening_end - opening_start + 1 < AI_HPA_OPENING_WIDE) {
+        at[at_count++] = (opening_start + opening_end) / 2;
+      } else {
+        at[at_count++] = opening_start;
+        at[at_count++] = opening_end;
+      }
+      for (int j = 0; j < at_count; j++) {
+        ai_hpa_transition *transition = &new_list[(*count)++];
+        transition->x0 = x + at[j] * step_x;
+        transition->y0 = y + at[j] * step_y;
+        transition->x1 = transition->x0 + across_x;
+        transition->y1 = transition->y0 + across_y;
+      }
+      opening_start = -1;
+    }
+  }
+  *list = new_list;
+  return 0;
+error:
+  return -1;
+}
+
+// Returns 0, or -1 if out of memory.
+int _ai_hpa_cluster_transitions(ai_search_hpa *hpa, int cluster_index) {
+  ai_hpa_cluster *cluster = &hpa->cluster_list[cluster_index];
+  int column = cluster_index % hpa->cluster_columns;
+  int row = cluster_index / hpa->cluster_columns;
+  int result = 0;
+  if (column < hpa->cluster_columns - 1) {
+    result |= _ai_hpa_border_transitions(hpa, cluster->x + cluster->width - 1,
+                                         cluster->y, 0, 1, 1, 0,
+                                         cluster->height,
+                                         &cluster->transition_right,
+                                         &cluster->transition_right_count);
+  }
+  if (row < hpa->cluster_rows - 1) {
+    result |= _ai_hpa_border_transitions(hpa, cluster->x,
+                                         cluster->y + cluster->height - 1, 1,
+                                         0, 0, 1, cluster->width,
+                                         &cluster->transition_down,
+                                         &cluster->transition_down_count);
+  }
+  return result;
+}
+
+void _ai_hpa_entrance_add(ai_hpa_cluster *cluster, int x, int y) {
+  for (int i = 0; i < cluster->entrance_count; i++) {
+    if ((cluster->entrance_list[i].x == x) &&
+        (cluster->entrance_list[i].y == y)) {
+      return;
+    }
+  }
+  cluster->entrance_list[cluster->entrance_count].x = x;
+  cluster->entrance_list[cluster->entrance_count].y = y;
+  cluster->entrance_count++;
+}
+
+// Gather the entrances of a cluster, and find the cost between each pair.
+// Returns 0, or -1 if out of memory.
+int _ai_hpa_cluster_build(ai_search_hpa *hpa, int cluster_index) {
+  ai_hpa_cluster *cluster = &hpa->cluster_list[cluster_index];
+  int column = cluster_index % hpa->cluster_columns;
+  int row = cluster_index / hpa->cluster_columns;
+  ai_hpa_cluster *left = column ? cluster - 1 : NULL;
+  ai_hpa_cluster *up = row ? cluster - hpa->cluster_columns : NULL;
+
+  int entrance_max = cluster->transition_right_count +
+                     cluster->transition_down_count +
+                     (left ? left->transition_right_count : 0) +
+                     (up ? up->transition_down_count : 0);
+  free(cluster->entrance_list);
+  free(cluster->entrance_cost);
+  cluster->entrance_count = 0;
+  cluster->entrance_cost = NULL;
+  cluster->entrance_list =
+      (ai_grid_action *)malloc(sizeof(ai_grid_action) * (entrance_max + 1));
+  check(cluster->entrance_list, "_ai_hpa_cluster_build malloc failed");
+  for (int i = 0; i < cluster->transition_right_count; i++) {
+    _ai_hpa_entrance_add(cluster, cluster->transition_right[i].x0,
+                         cluster->transition_right[i].y0);
+  }
+  for (int i = 0; i < cluster->transition_down_count; i++) {
+    _ai_hpa_entrance_add(cluster, cluster->transition_down[i].x0,
+                         cluster->transition_down[i].y0);
+  }
+  for (int i = 0; left && (i < left->transition_right_count); i++) {
+    _ai_hpa_entrance_add(cluster, left->transition_right[i].x1,
+                         left->transition_right[i].y1);
+  }
+  for (int i = 0; up && (i < up->transition_down_count); i++) {
+    _ai_hpa_entrance_add(cluster, up->transition_down[i].x1,
+                         up->transition_down[i].y1);
+  }
+
+  int n = cluster->entrance_count;
+  cluster->entrance_cost = (float *)malloc(sizeof(float) * (n * n + 1));
+  check(cluster->entrance_cost, "_ai_hpa_cluster_build malloc failed");
+  // Paths are reversible, so search from each entrance to the later ones.
+  for (int i = 0; i < n; i++) {
+    float *costs = &cluster->entrance_cost[i * n];
+    costs[i] = 0;
+    int local = _ai_hpa_local_costs(hpa, cluster_index,
+                                    cluster->entrance_list[i].x,
+                                    cluster->entrance_list[i].y,
+                                    &cluster->entrance_list[i + 1], n - i - 1,
+                                    &costs[i + 1]);
+    check(local == 0, "_ai_hpa_cluster_build local costs failed");
+    for (int j = i + 1; j < n; j++) {
+      cluster->entrance_cost[j * n + i] = costs[j];
+    }
+  }
+  hpa->cluster_rebuild_count++;
+  return 0;
+error:
+  return -1;
+}
+
+// The abstract node of an entrance cell of a cluster.
+uint32_t _ai_hpa_entrance_node(ai_search_hpa *hpa, int cluster_index, int x,
+                               int y) {
+  ai_hpa_cluster *cluster = &hpa->cluster_list[cluster_index];
+  for (int i = 0; i < cluster->entrance_count; i++) {
+    if ((cluster->entrance_list[i].x == x) &&
+        (cluster->entrance_list[i].y == y)) {
+      return cluster->node_first + i;
+    }
+  }
+  return AI_GRAPH_NODE_NONE;
+}
+
+// Build the abstract graph from every cluster. Returns 0, or -1 if out of
+// memory, with no graph.
+int _ai_hpa_graph_build(ai_search_hpa *hpa) {
+  int cluster_count = hpa->cluster_columns * hpa->cluster_rows;
+  uint32_t node_count = 0;
+  uint32_t edge_max = 0;
+  for (int c = 0; c < cluster_count; c++) {
+    ai_hpa_cluster *cluster = &hpa->cluster_list[c];
+    cluster->node_first = node_count;
+    node_count += cluster->entrance_count;
+    edge_max += cluster->entrance_count * cluster->entrance_count +
+                2 * (cluster->transition_right_count +
+                     cluster->transition_down_count);
+  }
+  // The old graph's nodes are numbered from the old node_first, so it is
+  // freed whether or not the new one is built.
+  ai_graph_free(hpa->graph);
+  hpa->graph = NULL;
+  ai_graph *graph = NULL;
+  int *node_cluster = (int *)malloc(sizeof(int) * (node_count + 1));
+  ai_graph_edge *edges =
+      (ai_graph_edge *)malloc(sizeof(ai_graph_edge) * (edge_max + 1));
+  check(node_cluster && edges, "_ai_hpa_graph_build malloc failed");
+
+  uint32_t edge_count = 0;
+  for (int c = 0; c < cluster_count; c++) {
+    ai_hpa_cluster *cluster = &hpa->cluster_list[c];
+    int n = cluster->entrance_count;
+    for (int i = 0; i < n; i++) {
+      node_cluster[cluster->node_first + i] = c;
+      for (int j = 0; j < n; j++) {
+        float cost = cluster->entrance_cost[i * n + j];
+        if ((i != j) && (cost < FLT_MAX)) {
+          edges[edge_count++] = (ai_graph_edge){cluster->node_first + i,
+                                                cluster->node_first + j, cost};
+        }
+      }
+    }
+    for (int side = 0; side < 2; side++) {
+      ai_hpa_transition *list =
+          side ? cluster->transition_down : cluster->transition_right;
+      int count = side ? cluster->transition_down_count
+                       : cluster->transition_right_count;
+      int neighbour = side ? c + hpa->cluster_columns : c + 1;
+      for (int t = 0; t < count; t++) {
+        uint32_t a = _ai_hpa_entrance_node(hpa, c, list[t].x0, list[t].y0);
+        uint32_t b =
+            _ai_hpa_entrance_node(hpa, neighbour, list[t].x1, list[t].y1);
+        edges[edge_count++] = (ai_graph_edge){a, b, 1.f};
+        edges[edge_count++] = (ai_graph_edge){b, a, 1.f};
+      }
+    }
+  }
+  graph = ai_graph_constructor(node_count, edge_count, edges);
+  check(graph, "_ai_hpa_graph_build malloc failed");
+  free(edges);
+  free(hpa->node_cluster);
+  hpa->node_cluster = node_cluster;
+  hpa->graph = graph;
+  return 0;
+error:
+  free(node_cluster);
+  free(edges);
+  return -1;
+}
+
+// void ai_search_hpa_rebuild(hpa);
+void ai_search_hpa_rebuild(ai_search_hpa *hpa) {
+  int cluster_count = hpa->cluster_columns * hpa->cluster_rows;
+  int failed = 0;
+  hpa->cluster_rebuild_count = 0;
+  // A border is held by the left or upper cluster, and changes only when a
+  // cell on it changes, which marks the clusters on both sides.
+  for (int c = 0; c < cluster_count; c++) {
+    if (hpa->cluster_list[c].dirty &&
+        (_ai_hpa_cluster_transitions(hpa, c) != 0)) {
+      failed = 1;
+    }
+  }
+  // Clusters stay dirty until built against their new transitions.
+  for (int c = 0; !failed && (c < cluster_count); c++) {
+    if (hpa->cluster_list[c].dirty) {
+      if (_ai_hpa_cluster_build(hpa, c) != 0) {
+        failed = 1;
+      } else {
+        hpa->cluster_list[c].dirty = 0;
+      }
+    }
+  }
+  if (failed) {
+    // The old graph no longer matches the clusters.
+    ai_graph_free(hpa->graph);
+    hpa->graph = NULL;
+    hpa->dirty = 1;
+    return;
+  }
+  // Without a graph, the next query tries again.
+  hpa->dirty = (_ai_hpa_graph_build(hpa) != 0);
+}
+
+void _ai_hpa_cluster_dirty(ai_search_hpa *hpa, int column, int row) {
+  if ((column >= 0) && (row >= 0) && (column < hpa->cluster_columns) &&
+      (row < hpa->cluster_rows)) {
+    hpa->cluster_list[row * hpa->cluster_columns + column].dirty = 1;
+  }
+}
+
+// ai_search_hpa_cell_set(hpa, x, y, 1);
+void ai_search_hpa_cell_set(ai_search_hpa *hpa, int x, int y, int blocked) {
+  if ((x < 0) || (y < 0) || (x >= hpa->grid->width) ||
+      (y >= hpa->grid->height) ||
+      (ai_grid_blocked(hpa->grid, x, y) == !!blocked)) {
+    return;
+  }
+  ai_grid_blocked_set(hpa->grid, x, y, blocked);
+  int size = hpa->cluster_size;
+  int column = x / size;
+  int row = y / size;
+  _ai_hpa_cluster_dirty(hpa, column, row);
+  // A cell on a border changes the entrances on both sides.
+  if (x % size == 0) {
+    _ai_hpa_cluster_dirty(hpa, column - 1, row);
+  }
+  if (x % size == size - 1) {
+    _ai_hpa_cluster_dirty(hpa, column + 1, row);
+  }
+  if (y % size == 0) {
+    _ai_hpa_cluster_dirty(hpa, column, row - 1);
+  }
+  if (y % size == size - 1) {
+    _ai_hpa_cluster_dirty(hpa, column, row + 1);
+  }
+  hpa->dirty = 1;
+}
+
+// Abstract evaluator.
+
+void _ai_hpa_node_cell(_ai_hpa_query *query, uint32_t node, int *x, int *y) {
+  if (node == query->start_node) {
+    *x = query->start_x;
+    *y = query->start_y;
+  } else if (node == query->goal_node) {
+    *x = query->goal_x;
+    *y = query->goal_y;
+  } else {
+    ai_search_hpa *hpa = query->hpa;
+    ai_hpa_cluster *cluster = &hpa->cluster_list[hpa->node_cluster[node]];
+    *x = cluster->entrance_list[node - cluster->node_first].x;
+    *y = cluster->entrance_list[node - cluster->node_first].y;
+  }
+}
+
+ai_model_state *_ai_hpa_model_state_constructor(_ai_hpa_query *query,
+                                                uint32_t node) {
+  _ai_hpa_state *data = (_ai_hpa_state *)malloc(sizeof(_ai_hpa_state));
+  check(data, "_ai_hpa_model_state_constructor malloc failed");
+  data->query = query;
+  data->node = node;
+  return ai_model_state_constructor(data);
+error:
+  return NULL;
+}
+
+ai_successor *_ai_hpa_successor_add(ai_successor *head,
+                                    ai_model_state *model_state,
+                                    ai_transition_function transition_function,
+                                    uint32_t edge, uint32_t target,
+                                    float cost) {
+  ai_action *action =
+      ai_action_constructor(ai_graph_action_data_constructor(edge, target));
+  ai_successor *successor = ai_successor_constructor(
+      transition_function(model_state, action), action, cost);
+  successor->next = head;
+  return successor;
+}
+
+ai_successor *
+_ai_hpa_successor_function(ai_model_state *model_state,
+                           ai_transition_function transition_function) {
+  _ai_hpa_state *state = (_ai_hpa_state *)model_state->data;
+  _ai_hpa_query *query = state->query;
+  ai_search_hpa *hpa = query->hpa;
+  ai_graph *graph = hpa->graph;
+  ai_successor *head = NULL;
+  uint32_t node = state->node;
+  if (node == query->goal_node) {
+    return NULL;
+  }
+  if (node == query->start_node) {
+    ai_hpa_cluster *cluster = &hpa->cluster_list[query->start_cluster];
+    for (int i = 0; i < cluster->entrance_count; i++) {
+      if (query->start_cost[i] < FLT_MAX) {
+        head = _ai_hpa_successor_add(head, model_state, transition_function,
+                                     AI_GRAPH_NODE_NONE,
+                                     cluster->node_first + i,
+                                     query->start_cost[i]);
+      }
+    }
+    return head;
+  }
+  for (uint32_t e = graph->edge_offset[node]; e < graph->edge_offset[node + 1];
+       e++) {
+    head = _ai_hpa_successor_add(head, model_state, transition_function, e,
+                                 graph->edge_target[e], graph->edge_cost[e]);
+  }
+  if (hpa->node_cluster[node] == query->goal_cluster) {
+    ai_hpa_cluster *cluster = &hpa->cluster_list[query->goal_cluster];
+    float cost = query->goal_cost[node - cluster->node_first];
+    if (cost < FLT_MAX) {
+      head = _ai_hpa_successor_add(head, model_state, transition_function,
+                                   AI_GRAPH_NODE_NONE, query->goal_node, cost);
+    }
+  }
+  return head;
+}
+
+ai_model_state *_ai_hpa_transition_function(ai_model_state *model_state,
+                                            ai_action *action) {
+  _ai_hpa_state *state = (_ai_hpa_state *)model_state->data;
+  ai_graph_action *action_data = (ai_graph_action *)action->data;
+  return _ai_hpa_model_state_constructor(state->query, action_data->target);
+}
+
+int _ai_hpa_is_goal_state_function(ai_model_state *model_state) {
+  _ai_hpa_state *state = (_ai_hpa_state *)model_state->data;
+  return state->node == state->query->goal_node;
+}
+
+float _ai_hpa_goal_est_cost_function(ai_model_state *model_state) {
+  _ai_hpa_state *state = (_ai_hpa_state *)model_state->data;
+  int x, y;
+  _ai_hpa_node_cell(state->query, state->node, &x, &y);
+  return ai_grid_octile_distance(x, y, state->query->goal_x,
+                                 state->query->goal_y);
+}
+
+void *_ai_hpa_model_state_data_duplicator(void *data) {
+  _ai_hpa_state *new_data = (_ai_hpa_state *)malloc(sizeof(_ai_hpa_state));
+  check(new_data, "_ai_hpa_model_state_data_duplicator malloc failed");
+  memcpy(new_data, data, sizeof(_ai_hpa_state));
+error:
+  return new_data;
+}
+
+size_t _ai_hpa_model_state_hash_function(ai_model_state *model_state) {
+  return ((_ai_hpa_state *)model_state->data)->node;
+}
+
+int _ai_hpa_model_state_equal_function(ai_model_state *model_state_a,
+                                       ai_model_state *model_state_b) {
+  return ((_ai_hpa_state *)model_state_a->data)->node ==
+         ((_ai_hpa_state *)model_state_b->data)->node;
+}
+
+static ai_model_state_evaluator _ai_hpa_model_state_evaluator = {
+    .successor_function = _ai_hpa_successor_function,
+    .transition_function = _ai_hpa_transition_function,
+    .is_goal_state_function = _ai_hpa_is_goal_state_function,
+    .goal_est_cost_function = _ai_hpa_goal_est_cost_function,
+    .model_state_data_duplicator = _ai_hpa_model_state_data_duplicator,
+    .model_state_data_free = free,
+    .action_data_duplicator = ai_graph_action_data_duplicator,
+    .action_data_free = ai_graph_action_data_free,
+    .model_state_hash_function = _ai_hpa_model_state_hash_function,
+    .model_state_equal_function = _ai_hpa_model_state_equal_function,
+};
+
+// Queries.
+
+// Refine an abstract path into a path of cells.
+ai_path *_ai_hpa_refine(_ai_hpa_query *query, ai_path *abstract_path) {
+  ai_search_hpa *hpa = query->hpa;
+  ai_path *path = NULL;
+  ai_action *last = NULL;
+  uint32_t node = query->start_node;
+  int x = query->start_x;
+  int y = query->start_y;
+  for (ai_action *step = abstract_path; step; step = step->next) {
+    uint32_t target = ((ai_graph_action *)step->data)->target;
+    int target_x, target_y;
+    _ai_hpa_node_cell(query, target, &target_x, &target_y);
+    ai_path *segment = NULL;
+    if ((node != query->start_node) && (target != query->goal_node) &&
+        (hpa->node_cluster[node] != hpa->node_cluster[target])) {
+      // Across a border.
+      ai_grid_action *action_data =
+          (ai_grid_action *)malloc(sizeof(ai_grid_action));
+      check(action_data, "_ai_hpa_refine malloc failed");
+      action_data->x = target_x;
+      action_data->y = target_y;
+      segment = ai_action_constructor(action_data);
+    } else {
+      int found = 0;
+      int cluster_index = _ai_hpa_cluster_index(hpa, target_x, target_y);
+      segment = _ai_hpa_local_path(hpa, cluster_index, x, y, target_x,
+                                   target_y, &found);
+      check(found, "_ai_hpa_refine no path in cluster");
+    }
+    if (last) {
+      last->next = segment;
+    } else {
+      path = segment;
+    }
+    for (; segment; segment = segment->next) {
+      last = segment;
+    }
+    node = target;
+    x = target_x;
+    y = target_y;
+  }
+  return path;
+error:
+  _ai_path_free(path, ai_grid_data_free);
+  return NULL;
+}
+
+float _ai_hpa_path_cost(int x, int y, ai_path *path) {
+  float cost = 0;
+  for (; path; path = path->next) {
+    ai_grid_action *action_data = (ai_grid_action *)path->data;
+    cost += ai_grid_move_cost(x, y, action_data->x, action_data->y);
+    x = action_data->x;
+    y = action_data->y;
+  }
+  return cost;
+}
+
+// ai_path *path = ai_search_hpa_find_path(hpa, 0, 0, 99, 99);
+ai_path *ai_search_hpa_find_path(ai_search_hpa *hpa, int start_x, int start_y,
+                                 int goal_x, int goal_y) {
+  ai_grid *grid = hpa->grid;
+  ai_path *path = NULL;
+  _ai_hpa_query query = {.hpa = hpa};
+  if (hpa->dirty) {
+    ai_search_hpa_rebuild(hpa);
+  }
+  hpa->fringe_expansion_count = 0;
+  hpa->path_cost = FLT_MAX;
+  hpa->status = AI_SEARCH_STATUS_NOT_FOUND;
+  if (!hpa->graph) {
+    hpa->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+    return NULL;
+  }
+  if (ai_grid_blocked(grid, start_x, start_y) ||
+      ai_grid_blocked(grid, goal_x, goal_y)) {
+    return NULL;
+  }
+  if ((start_x == goal_x) && (start_y == goal_y)) {
+    hpa->path_cost = 0;
+    hpa->status = AI_SEARCH_STATUS_FOUND;
+    return NULL;
+  }
+  query.start_x = start_x;
+  query.start_y = start_y;
+  query.start_cluster = _ai_hpa_cluster_index(hpa, start_x, start_y);
+  query.goal_x = goal_x;
+  query.goal_y = goal_y;
+  query.goal_cluster = _ai_hpa_cluster_index(hpa, goal_x, goal_y);
+
+  // Within one cluster, try the direct path first.
+  if (query.start_cluster == query.goal_cluster) {
+    int found = 0;
+    path = _ai_hpa_local_path(hpa, query.start_cluster, start_x, start_y,
+                              goal_x, goal_y, &found);
+    if (found) {
+      goto done;
+    }
+  }
+
+  // Link the start and goal to the entrances of their clusters.
+  ai_hpa_cluster *start_cluster = &hpa->cluster_list[query.start_cluster];
+  ai_hpa_cluster *goal_cluster = &hpa->cluster_list[query.goal_cluster];
+  query.start_node = hpa->graph->node_count;
+  query.goal_node = hpa->graph->node_count + 1;
+  query.start_cost =
+      (float *)malloc(sizeof(float) * (start_cluster->entrance_count + 1));
+  query.goal_cost =
+      (float *)malloc(sizeof(float) * (goal_cluster->entrance_count + 1));
+  check(query.start_cost && query.goal_cost,
+        "ai_search_hpa_find_path malloc failed");
+  int local = _ai_hpa_local_costs(hpa, query.start_cluster, start_x, start_y,
+                                  start_cluster->entrance_list,
+                                  start_cluster->entrance_count,
+                                  query.start_cost);
+  local |= _ai_hpa_local_costs(hpa, query.goal_cluster, goal_x, goal_y,
+                               goal_cluster->entrance_list,
+                               goal_cluster->entrance_count, query.goal_cost);
+  check(local == 0, "ai_search_hpa_find_path local costs failed");
+
+  // Search the abstract graph, then refine.
+  ai_model_state *model_state =
+      _ai_hpa_model_state_constructor(&query, query.start_node);
+  ai_search_astar *astar =
+      ai_search_astar_constructor(&_ai_hpa_model_state_evaluator);
+  ai_path *abstract_path = astar->find_path_to_goal(astar, model_state);
+  int found = (astar->status == AI_SEARCH_STATUS_FOUND);
+  hpa->fringe_expansion_count += astar->fringe_expansion_count;
+  ai_search_astar_free(astar);
+  _ai_model_state_free(model_state, free);
+  if (found) {
+    path = _ai_hpa_refine(&query, abstract_path);
+    found = (path != NULL);
+  }
+  _ai_path_free(abstract_path, ai_graph_action_data_free);
+  if (!found) {
+    goto error;
+  }
+
+done:
+  hpa->path_cost = _ai_hpa_path_cost(start_x, start_y, path);
+  hpa->status = AI_SEARCH_STATUS_FOUND;
+  free(query.start_cost);
+  free(query.goal_cost);
+  return path;
+error:
+  free(query.start_cost);
+  free(query.goal_cost);
+  return NULL;
+}
+
+// ai_search_hpa *hpa = ai_search_hpa_constructor(grid, 16);
+ai_search_hpa *ai_search_hpa_constructor(ai_grid *grid, int cluster_size) {
+  ai_search_hpa *hpa = NULL;
+  check(grid && (cluster_size >= 2),
+        "ai_search_hpa_constructor cluster_size less than 2");
+  hpa = (ai_search_hpa *)calloc(1, sizeof(ai_search_hpa));
+  check(hpa, "ai_search_hpa_constructor malloc failed");
+  hpa->grid = grid;
+  hpa->cluster_size = cluster_size;
+  hpa->cluster_columns = (grid->width + cluster_size - 1) / cluster_size;
+  hpa->cluster_rows = (grid->height + cluster_size - 1) / cluster_size;
+  hpa->path_cost = FLT_MAX;
+  hpa->status = AI_SEARCH_STATUS_IDLE;
+  int cluster_count = hpa->cluster_columns * hpa->cluster_rows;
+  hpa->cluster_list =
+      (ai_hpa_cluster *)calloc(cluster_count, sizeof(ai_hpa_cluster));
+  check(hpa->cluster_list, "ai_search_hpa_constructor malloc failed");
+  for (int c = 0; c < cluster_count; c++) {
+    ai_hpa_cluster *cluster = &hpa->cluster_list[c];
+    cluster->x = (c % hpa->cluster_columns) * cluster_size;
+    cluster->y = (c / hpa->cluster_columns) * cluster_size;
+    cluster->width = grid->width - cluster->x < cluster_size
+                         ? grid->width - cluster->x
+                         : cluster_size;
+    cluster->height = grid->height - cluster->y < cluster_size
+                          ? grid->height - cluster->y
+                          : cluster_size;
+    cluster->dirty = 1;
+  }
+  ai_search_hpa_rebuild(hpa);
+  check(hpa->graph, "ai_search_hpa_constructor abstract graph failed");
+  return hpa;
+error:
+  ai_search_hpa_free(hpa);
+  return NULL;
+}
+
+void ai_search_hpa_free(ai_search_hpa *hpa) {
+  if (hpa) {
+    int cluster_count = hpa->cluster_columns * hpa->cluster_rows;
+    for (int c = 0; hpa->cluster_list && (c < cluster_count); c++) {
+      ai_hpa_cluster *cluster = &hpa->cluster_list[c];
+      free(cluster->transition_right);
+      free(cluster->transition_down);
+      free(cluster->entrance_list);
+      free(cluster->entrance_cost);
+    }
+    free(hpa->cluster_list);
+    ai_graph_free(hpa->graph);
+    free(hpa->node_cluster);
+    free(hpa);
+  }
+}
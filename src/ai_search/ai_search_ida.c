@@ -0,0 +1,198 @@
+/*
+ * AI - Iterative Deepening A* Search.
+ *
+ * Each depth-first search recurses once per depth, on the C stack. The
+ * Action taken at depth d is written at action_list + d * action_packed_size,
+ * so the path is read from the buffer once a Goal is reached. The buffers
+ * may move as they grow, so a depth's Action is found again by its offset
+ * after the search below it.
+ */
+#include "ai_search_internal.h"
+#include <ai_search_ida.h>
+#include <logging.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _AI_IDA_DEPTH_MIN 64
+
+// Make room in the buffers for depth. Returns 0, or -1 if out of memory.
+int _ai_ida_reserve(ai_search_ida *ida, int depth) {
+  ai_model_state_evaluator *evaluator = ida->model_state_evaluator;
+  if (depth < ida->depth_size) {
+    return 0;
+  }
+  int depth_size = ida->depth_size ? ida->depth_size : _AI_IDA_DEPTH_MIN;
+  while (depth_size <= depth) {
+    depth_size *= 2;
+  }
+  unsigned char *action_list = (unsigned char *)realloc(
+      ida->action_list, evaluator->action_packed_size * depth_size);
+  check(action_list, "_ai_ida_reserve malloc failed");
+  ida->action_list = action_list;
+  if (evaluator->model_state_pack_function) {
+    unsigned char *model_state_list = (unsigned char *)realloc(
+        ida->model_state_list, evaluator->model_state_packed_size * depth_size);
+    check(model_state_list, "_ai_ida_reserve malloc failed");
+    ida->model_state_list = model_state_list;
+  }
+  ida->depth_size = depth_size;
+  return 0;
+error:
+  return -1;
+}
+
+// True if the working state, packed at depth + 1, is the state at depth - 1.
+int _ai_ida_is_back(ai_search_ida *ida, int depth) {
+  ai_model_state_evaluator *evaluator = ida->model_state_evaluator;
+  size_t packed_size = evaluator->model_state_packed_size;
+  if (!evaluator->model_state_pack_function || (depth == 0)) {
+    return 0;
+  }
+  unsigned char *bytes = ida->model_state_list + (depth + 1) * packed_size;
+  evaluator->model_state_pack_function(ida->model_state, bytes);
+  return memcmp(bytes, ida->model_state_list + (depth - 1) * packed_size,
+                packed_size) == 0;
+}
+
+// Search below the working state, at depth and reached at cost_so_far.
+// Returns true if a Goal was reached, with the path in the action buffer.
+int _ai_ida_search(ai_search_ida *ida, int depth, float cost_so_far) {
+  ai_model_state_evaluator *evaluator = ida->model_state_evaluator;
+  ai_model_state *model_state = ida->model_state;
+  float est_total_cost =
+      cost_so_far + (evaluator->goal_est_cost_function
+                         ? evaluator->goal_est_cost_function(model_state)
+                         : 0);
+  if (est_total_cost > ida->bound) {
+    if (est_total_cost < ida->bound_next) {
+      ida->bound_next = est_total_cost;
+    }
+    return 0;
+  }
+  if (evaluator->is_goal_state_function(model_state)) {
+    ida->path_cost = cost_so_far;
+    ida->path_depth = depth;
+    return 1;
+  }
+  if ((ida->fringe_expansion_max != 0) &&
+      (ida->fringe_expansion_count >= ida->fringe_expansion_max)) {
+    ida->status = AI_SEARCH_STATUS_EXPANSION_LIMIT;
+    return 0;
+  }
+  if (_ai_ida_reserve(ida, depth + 1) != 0) {
+    ida->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+    return 0;
+  }
+  ida->fringe_expansion_count++;
+  if (depth > ida->depth_max) {
+    ida->depth_max = depth;
+  }
+  size_t action_offset = depth * evaluator->action_packed_size;
+  if (evaluator->model_state_pack_function) {
+    evaluator->model_state_pack_function(
+        model_state,
+        ida->model_state_list + depth * evaluator->model_state_packed_size);
+  }
+  ai_action action = {ida->action_list + action_offset, NULL};
+  for (int index = 0;
+       evaluator->action_next_function(model_state, index, action.data);
+       index++) {
+    float cost = evaluator->apply_action_function(model_state, &action);
+    int found = !_ai_ida_is_back(ida, depth) &&
+                _ai_ida_search(ida, depth + 1, cost_so_far + cost);
+    action.data = ida->action_list + action_offset;
+    evaluator->undo_action_function(model_state, &action);
+    if (found || (ida->status != AI_SEARCH_STATUS_RUNNING)) {
+      return found;
+    }
+  }
+  return 0;
+}
+
+// The path in the action buffer.
+ai_path *_ai_ida_path(ai_search_ida *ida) {
+  ai_model_state_evaluator *evaluator = ida->model_state_evaluator;
+  ai_path *path = NULL;
+  for (int depth = ida->path_depth - 1; depth >= 0; depth--) {
+    ai_action *action = ai_action_constructor(evaluator->action_data_duplicator(
+        ida->action_list + depth * evaluator->action_packed_size));
+    check(action, "_ai_ida_path malloc failed");
+    action->next = path;
+    path = action;
+  }
+  return path;
+error:
+  _ai_path_free(path, evaluator->action_data_free);
+  return NULL;
+}
+
+// private - Iterative Deepening A* search algorithm
+ai_path *_ai_search_ida_find_path_to_goal(ai_search_ida *ida,
+                                          ai_model_state *initial_model_state) {
+  ai_model_state_evaluator *evaluator = ida->model_state_evaluator;
+  ai_path *result_path = NULL;
+  ida->fringe_expansion_count = 0;
+  ida->path_cost = 0;
+  ida->iteration_count = 0;
+  ida->depth_max = 0;
+  ida->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+  ida->model_state = _ai_model_state_duplicate(
+      initial_model_state, evaluator->model_state_data_duplicator);
+  check(ida->model_state && (_ai_ida_reserve(ida, 1) == 0),
+        "_ai_search_ida_find_path_to_goal malloc failed");
+  ida->bound = evaluator->goal_est_cost_function
+                   ? evaluator->goal_est_cost_function(ida->model_state)
+                   : 0;
+  ida->status = AI_SEARCH_STATUS_RUNNING;
+
+  while (ida->status == AI_SEARCH_STATUS_RUNNING) {
+    ida->bound_next = INFINITY;
+    ida->iteration_count++;
+    if (_ai_ida_search(ida, 0, 0)) {
+      result_path = _ai_ida_path(ida);
+      ida->status = result_path || (ida->path_depth == 0)
+                        ? AI_SEARCH_STATUS_FOUND
+                        : AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+    } else if (ida->status == AI_SEARCH_STATUS_RUNNING) {
+      if (ida->bound_next == INFINITY) {
+        ida->status = AI_SEARCH_STATUS_NOT_FOUND;
+      }
+      ida->bound = ida->bound_next;
+    }
+  }
+
+error:
+  _ai_model_state_free(ida->model_state, evaluator->model_state_data_free);
+  ida->model_state = NULL;
+  return result_path;
+}
+
+// ai_search_ida *ida = ai_search_ida_constructor(model_state_evaluator);
+ai_search_ida *
+ai_search_ida_constructor(ai_model_state_evaluator *model_state_evaluator) {
+  ai_search_ida *ida = NULL;
+  check(model_state_evaluator->action_next_function &&
+            model_state_evaluator->apply_action_function &&
+            model_state_evaluator->undo_action_function &&
+            model_state_evaluator->action_packed_size,
+        "ai_search_ida_constructor evaluator can not change states in place");
+  ida = (ai_search_ida *)calloc(1, sizeof(ai_search_ida));
+  check(ida, "ai_search_ida_constructor malloc failed");
+  ida->model_state_evaluator = model_state_evaluator;
+  ida->find_path_to_goal = _ai_search_ida_find_path_to_goal;
+  ida->fringe_expansion_count = 0;
+  ida->fringe_expansion_max = 0;
+  ida->status = AI_SEARCH_STATUS_IDLE;
+  return ida;
+error:
+  return NULL;
+}
+
+void ai_search_ida_free(ai_search_ida *ida) {
+  if (ida) {
+    free(ida->action_list);
+    free(ida->model_state_list);
+    free(ida);
+  }
+}
@@ -0,0 +1,80 @@
+#ifndef _AI_SEARCH_INTERNAL_H_
+#define _AI_SEARCH_INTERNAL_H_
+
+/*
+ * Helpers shared by the search engines. Private to the ai_search library.
+ */
+#include <ai_search.h>
+#include <stdint.h>
+
+void _ai_path_append_action(ai_path **path, ai_action *action);
+
+ai_path *_ai_path_duplicate(ai_action_data_duplicator action_data_duplicator,
+                            ai_path *old);
+
+void _ai_path_free(ai_path *ptr, ai_action_data_free action_data_free);
+
+ai_model_state *_ai_model_state_duplicate(
+    ai_model_state *model_state,
+    ai_model_state_data_duplicator model_state_data_duplicator);
+
+void _ai_model_state_free(ai_model_state *model_state,
+                          ai_model_state_data_free model_state_data_free);
+
+// Account a new Fringe Element, or a Model State moved into the closed
+// table, against the search's memory.
+void _ai_search_astar_memory_charge(ai_search_astar *astar,
+                                    ai_fringe_element *fe);
+
+void _ai_search_astar_memory_charge_closed(ai_search_astar *astar,
+                                           ai_model_state *model_state);
+
+// Move the fringe from its list into its buckets, for a search with
+// fringe_bucket_width, after it was changed as a list.
+void _ai_search_astar_fringe_index(ai_search_astar *astar);
+
+// Move the fringe out of its buckets into its list, in order, so it can be
+// changed or walked as a list.
+void _ai_search_astar_fringe_unindex(ai_search_astar *astar);
+
+// The tie_break_key of a Fringe Element, for the search's tie_break.
+float _ai_search_astar_tie_break_key(ai_search_astar *astar,
+                                     ai_fringe_element *fe);
+
+// Free the Goals of a multi-goal search, and any paths not yet taken.
+void _ai_search_astar_goal_list_free(ai_search_astar *astar);
+
+// A binary min-heap of graph nodes, for Dijkstra searches over an ai_graph.
+// A node may be pushed more than once. Entries whose key is more than the
+// node's best distance are stale, and skipped by the caller when popped.
+typedef struct _ai_graph_heap_entry_struct {
+  float key;
+  uint32_t node;
+} _ai_graph_heap_entry;
+
+typedef struct _ai_graph_heap_struct {
+  _ai_graph_heap_entry *entry_list;
+  uint32_t count;
+  uint32_t size;
+} _ai_graph_heap;
+
+// Returns 0, or -1 if out of memory.
+int _ai_graph_heap_push(_ai_graph_heap *heap, float key, uint32_t node);
+
+// The entry with the least key. The heap must not be empty.
+_ai_graph_heap_entry _ai_graph_heap_pop(_ai_graph_heap *heap);
+
+void _ai_graph_heap_free(_ai_graph_heap *heap);
+
+struct ai_graph_struct;
+
+// Dijkstra from source, as ai_graph_distances. parent, if not NULL, is set
+// to the edge into each node on its cheapest path, AI_GRAPH_NODE_NONE at the
+// source and where there is no path. order, if not NULL, is set to the nodes
+// reached in the order settled, and order_count to their number.
+int _ai_graph_shortest_path_tree(struct ai_graph_struct *graph,
+                                 uint32_t source, int reverse, float *dist,
+                                 uint32_t *parent, uint32_t *order,
+                                 uint32_t *order_count);
+
+#endif // _AI_SEARCH_INTERNAL_H_
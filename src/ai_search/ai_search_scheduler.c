@@ -0,0 +1,309 @@
+/*
+ * AI - Cooperative scheduler for many concurrent stepwise searches.
+ *
+ * In-flight queries are held in a list sorted Earliest Deadline First.
+ * A slice pops the most urgent query, steps its search by one quantum of
+ * fringe expansions, then puts it back in the list, or completes it.
+ * The mutex is only held while the list and metrics are touched, never while
+ * a search is being stepped.
+ */
+#include <ai_search_scheduler.h>
+#include <logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Current monotonic time in seconds.
+double ai_search_scheduler_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// True if query a should run before query b.
+// Earliest deadline first, no deadline last, then priority, then submission.
+int _ai_search_query_before(ai_search_query *a, ai_search_query *b) {
+  if (a->deadline != b->deadline) {
+    if (a->deadline == 0) {
+      return 0;
+    }
+    if (b->deadline == 0) {
+      return 1;
+    }
+    return a->deadline < b->deadline;
+  }
+  if (a->priority != b->priority) {
+    return a->priority > b->priority;
+  }
+  return a->sequence < b->sequence;
+}
+
+// Add the query to the list, keeping the list Earliest Deadline First.
+void _ai_search_query_list_add_by_deadline(ai_search_query **query_list,
+                                           ai_search_query *query) {
+  ai_search_query *prev = NULL;
+  ai_search_query *current = *query_list;
+  while (current && !_ai_search_query_before(query, current)) {
+    prev = current;
+    current = current->next;
+  }
+  query->next = current;
+  if (prev) {
+    prev->next = query;
+  } else {
+    *query_list = query;
+  }
+}
+
+ai_search_query *_ai_search_query_list_pop(ai_search_query **query_list) {
+  ai_search_query *head = *query_list;
+  if (head) {
+    *query_list = head->next;
+    head->next = NULL;
+  }
+  return head;
+}
+
+// Record a completed query. Caller must hold the mutex.
+void _ai_search_scheduler_record(ai_search_scheduler *scheduler,
+                                 ai_search_query *query, double now) {
+  long index = scheduler->sample_count % AI_SEARCH_SCHEDULER_SAMPLE_MAX;
+  scheduler->queue_latency_samples[index] =
+      query->first_run_time - query->submit_time;
+  scheduler->completion_time_samples[index] = now - query->submit_time;
+  scheduler->sample_count++;
+  scheduler->completed_count++;
+  if ((query->deadline != 0) && (now > query->deadline)) {
+    scheduler->deadline_miss_count++;
+  }
+}
+
+// Hand the result of a finished query to its owner, and free the query.
+// A query still running when ended is marked cancelled by the search.
+void _ai_search_query_complete(ai_search_query *query) {
+  ai_path *path = ai_search_astar_end(query->astar);
+  if (query->on_complete) {
+    query->on_complete(query->astar, query->astar->status, path,
+                       query->user_data);
+  }
+  free(query);
+}
+
+// Run one quantum of the query. Called without the mutex held.
+void _ai_search_scheduler_run_query(ai_search_scheduler *scheduler,
+                                    ai_search_query *query) {
+  if (query->first_run_time == 0) {
+    query->first_run_time = ai_search_scheduler_now();
+  }
+  int priority = query->priority > 0 ? query->priority : 0;
+  int quantum = scheduler->expansion_quantum * (priority + 1);
+  ai_search_status status = ai_search_astar_step(query->astar, quantum);
+
+  if (status == AI_SEARCH_STATUS_RUNNING) {
+    pthread_mutex_lock(&scheduler->mutex);
+    _ai_search_query_list_add_by_deadline(&scheduler->query_list, query);
+    scheduler->running_count--;
+    pthread_cond_signal(&scheduler->work_available);
+    pthread_mutex_unlock(&scheduler->mutex);
+    return;
+  }
+
+  double now = ai_search_scheduler_now();
+  pthread_mutex_lock(&scheduler->mutex);
+  _ai_search_scheduler_record(scheduler, query, now);
+  pthread_mutex_unlock(&scheduler->mutex);
+
+  _ai_search_query_complete(query);
+
+  pthread_mutex_lock(&scheduler->mutex);
+  scheduler->running_count--;
+  if (!scheduler->query_list && !scheduler->running_count) {
+    pthread_cond_broadcast(&scheduler->all_complete);
+  }
+  pthread_mutex_unlock(&scheduler->mutex);
+}
+
+// Worker thread. Run slices until the scheduler is stopped.
+void *_ai_search_scheduler_worker(void *arg) {
+  ai_search_scheduler *scheduler = (ai_search_scheduler *)arg;
+  pthread_mutex_lock(&scheduler->mutex);
+  while (!scheduler->stopping) {
+    ai_search_query *query = _ai_search_query_list_pop(&scheduler->query_list);
+    if (!query) {
+      pthread_cond_wait(&scheduler->work_available, &scheduler->mutex);
+      continue;
+    }
+    scheduler->running_count++;
+    pthread_mutex_unlock(&scheduler->mutex);
+    _ai_search_scheduler_run_query(scheduler, query);
+    pthread_mutex_lock(&scheduler->mutex);
+  }
+  pthread_mutex_unlock(&scheduler->mutex);
+  return NULL;
+}
+
+// ai_search_scheduler *scheduler = ai_search_scheduler_constructor(4, 100);
+ai_search_scheduler *ai_search_scheduler_constructor(int worker_count,
+                                                     int expansion_quantum) {
+  ai_search_scheduler *scheduler = NULL;
+  check(worker_count >= 0,
+        "ai_search_scheduler_constructor worker_count negative");
+  check(expansion_quantum > 0,
+        "ai_search_scheduler_constructor expansion_quantum not positive");
+  scheduler = (ai_search_scheduler *)calloc(1, sizeof(ai_search_scheduler));
+  check(scheduler, "ai_search_scheduler_constructor malloc failed");
+  scheduler->expansion_quantum = expansion_quantum;
+  pthread_mutex_init(&scheduler->mutex, NULL);
+  pthread_cond_init(&scheduler->work_available, NULL);
+  pthread_cond_init(&scheduler->all_complete, NULL);
+  if (worker_count) {
+    scheduler->workers = (pthread_t *)malloc(sizeof(pthread_t) * worker_count);
+    check(scheduler->workers, "ai_search_scheduler_constructor malloc failed");
+  }
+  for (int i = 0; i < worker_count; i++) {
+    check(pthread_create(&scheduler->workers[i], NULL,
+                         _ai_search_scheduler_worker, scheduler) == 0,
+          "ai_search_scheduler_constructor pthread_create failed");
+    scheduler->worker_count++;
+  }
+  return scheduler;
+error:
+  ai_search_scheduler_free(scheduler);
+  return NULL;
+}
+
+int ai_search_scheduler_submit(ai_search_scheduler *scheduler,
+                               ai_search_astar *astar,
+                               ai_model_state *model_state, double deadline,
+                               int priority,
+                               ai_search_query_complete_function on_complete,
+                               void *user_data) {
+  check(scheduler, "ai_search_scheduler_submit scheduler was NULL");
+  check(astar, "ai_search_scheduler_submit astar was NULL");
+  ai_search_query *query = (ai_search_query *)calloc(1, sizeof(ai_search_query));
+  check(query, "ai_search_scheduler_submit malloc failed");
+  query->astar = astar;
+  query->deadline = deadline;
+  query->priority = priority;
+  query->on_complete = on_complete;
+  query->user_data = user_data;
+  query->submit_time = ai_search_scheduler_now();
+  ai_search_astar_begin(astar, model_state);
+
+  pthread_mutex_lock(&scheduler->mutex);
+  query->sequence = scheduler->sequence++;
+  scheduler->submitted_count++;
+  _ai_search_query_list_add_by_deadline(&scheduler->query_list, query);
+  pthread_cond_signal(&scheduler->work_available);
+  pthread_mutex_unlock(&scheduler->mutex);
+  return 0;
+error:
+  return -1;
+}
+
+int ai_search_scheduler_run_slice(ai_search_scheduler *scheduler) {
+  pthread_mutex_lock(&scheduler->mutex);
+  ai_search_query *query = _ai_search_query_list_pop(&scheduler->query_list);
+  if (query) {
+    scheduler->running_count++;
+  }
+  pthread_mutex_unlock(&scheduler->mutex);
+  if (!query) {
+    return 0;
+  }
+  _ai_search_scheduler_run_query(scheduler, query);
+  return 1;
+}
+
+void ai_search_scheduler_drain(ai_search_scheduler *scheduler) {
+  if (!scheduler->worker_count) {
+    while (ai_search_scheduler_run_slice(scheduler)) {
+    }
+    return;
+  }
+  pthread_mutex_lock(&scheduler->mutex);
+  while (scheduler->query_list || scheduler->running_count) {
+    pthread_cond_wait(&scheduler->all_complete, &scheduler->mutex);
+  }
+  pthread_mutex_unlock(&scheduler->mutex);
+}
+
+int _ai_search_latency_compare(const void *a, const void *b) {
+  double da = *(const double *)a;
+  double db = *(const double *)b;
+  return (da > db) - (da < db);
+}
+
+// Summarise samples. The samples are sorted in place.
+void _ai_search_latency_summarise(ai_search_latency *latency, double *samples,
+                                  long count) {
+  memset(latency, 0, sizeof(ai_search_latency));
+  if (count == 0) {
+    return;
+  }
+  qsort(samples, count, sizeof(double), _ai_search_latency_compare);
+  double total = 0;
+  for (long i = 0; i < count; i++) {
+    total += samples[i];
+  }
+  latency->count = count;
+  latency->mean = total / count;
+  latency->p50 = samples[(count - 1) * 50 / 100];
+  latency->p99 = samples[(count - 1) * 99 / 100];
+  latency->max = samples[count - 1];
+}
+
+void ai_search_scheduler_metrics_get(ai_search_scheduler *scheduler,
+                                     ai_search_scheduler_metrics *metrics) {
+  size_t samples_size = sizeof(double) * AI_SEARCH_SCHEDULER_SAMPLE_MAX;
+  double *queue_samples = (double *)malloc(samples_size);
+  double *completion_samples = (double *)malloc(samples_size);
+  check(queue_samples && completion_samples,
+        "ai_search_scheduler_metrics_get malloc failed");
+
+  pthread_mutex_lock(&scheduler->mutex);
+  long count = scheduler->sample_count < AI_SEARCH_SCHEDULER_SAMPLE_MAX
+                   ? scheduler->sample_count
+                   : AI_SEARCH_SCHEDULER_SAMPLE_MAX;
+  memcpy(queue_samples, scheduler->queue_latency_samples,
+         sizeof(double) * count);
+  memcpy(completion_samples, scheduler->completion_time_samples,
+         sizeof(double) * count);
+  metrics->submitted_count = scheduler->submitted_count;
+  metrics->completed_count = scheduler->completed_count;
+  metrics->deadline_miss_count = scheduler->deadline_miss_count;
+  metrics->in_flight_count =
+      (int)(scheduler->submitted_count - scheduler->completed_count);
+  pthread_mutex_unlock(&scheduler->mutex);
+
+  _ai_search_latency_summarise(&metrics->queue_latency, queue_samples, count);
+  _ai_search_latency_summarise(&metrics->completion_time, completion_samples,
+                               count);
+error:
+  free(queue_samples);
+  free(completion_samples);
+}
+
+void ai_search_scheduler_free(ai_search_scheduler *scheduler) {
+  if (!scheduler) {
+    return;
+  }
+  pthread_mutex_lock(&scheduler->mutex);
+  scheduler->stopping = 1;
+  pthread_cond_broadcast(&scheduler->work_available);
+  pthread_mutex_unlock(&scheduler->mutex);
+  for (int i = 0; i < scheduler->worker_count; i++) {
+    pthread_join(scheduler->workers[i], NULL);
+  }
+  // Workers have stopped, so nothing else touches the list now.
+  ai_search_query *query = NULL;
+  while ((query = _ai_search_query_list_pop(&scheduler->query_list)) != NULL) {
+    _ai_search_query_complete(query);
+  }
+  pthread_cond_destroy(&scheduler->all_complete);
+  pthread_cond_destroy(&scheduler->work_available);
+  pthread_mutex_destroy(&scheduler->mutex);
+  free(scheduler->workers);
+  free(scheduler);
+}
@@ -0,0 +1,434 @@
+/*
+ * AI - Simplified Memory-bounded A* (SMA*) Search.
+ *
+ * http://en.wikipedia.org/wiki/SMA*
+ *
+ * The search tree is held as nodes linked to their parents, each node holding
+ * one child slot per successor. Every node in memory is also kept in a flat
+ * node list. Open nodes are kept in a heap by least f, deepest first, to
+ * choose the best node to expand, and leaves in a heap by greatest f,
+ * shallowest first, to choose the worst leaf to forget when the node budget
+ * is full. A node is moved in its heaps whenever its f, or its children,
+ * change.
+ *
+ * A node is open while it is unexpanded, or while it has forgotten children.
+ * Expanding a node with forgotten children regenerates only the forgotten
+ * ones, matched by their position in the successor list.
+ */
+#include "ai_search_internal.h"
+#include <ai_search_sma.h>
+#include <logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _AI_SMA_HEAP_OPEN 0
+#define _AI_SMA_HEAP_LEAF 1
+
+// True if the node has successors that are not held in memory.
+int _ai_sma_node_is_open(ai_sma_node *node) {
+  return (node->children_size < 0) ||
+         (node->children_count < node->children_size);
+}
+
+// True if a is nearer the top of the heap than b. The open heap has the
+// lowest f on top, deepest first among equals. The leaf heap has the highest
+// f on top, shallowest first among equals.
+int _ai_sma_heap_before(int heap, ai_sma_node *a, ai_sma_node *b) {
+  if (a->est_total_cost != b->est_total_cost) {
+    return (heap == _AI_SMA_HEAP_OPEN)
+               ? (a->est_total_cost < b->est_total_cost)
+               : (a->est_total_cost > b->est_total_cost);
+  }
+  return (heap == _AI_SMA_HEAP_OPEN) ? (a->depth > b->depth)
+                                     : (a->depth < b->depth);
+}
+
+void _ai_sma_heap_place(ai_search_sma *sma, int heap, int index,
+                        ai_sma_node *node) {
+  sma->heap_list[heap][index] = node;
+  node->heap_index[heap] = index;
+}
+
+// Move the node at index up or down the heap to its place.
+void _ai_sma_heap_fix(ai_search_sma *sma, int heap, int index) {
+  ai_sma_node **list = sma->heap_list[heap];
+  int count = sma->heap_count[heap];
+  ai_sma_node *node = list[index];
+  while (index > 0) {
+    int parent = (index - 1) / 2;
+    if (!_ai_sma_heap_before(heap, node, list[parent])) {
+      break;
+    }
+    _ai_sma_heap_place(sma, heap, index, list[parent]);
+    index = parent;
+  }
+  for (;;) {
+    int child = 2 * index + 1;
+    if (child >= count) {
+      break;
+    }
+    if ((child + 1 < count) &&
+        _ai_sma_heap_before(heap, list[child + 1], list[child])) {
+      child++;
+    }
+    if (!_ai_sma_heap_before(heap, list[child], node)) {
+      break;
+    }
+    _ai_sma_heap_place(sma, heap, index, list[child]);
+    index = child;
+  }
+  _ai_sma_heap_place(sma, heap, index, node);
+}
+
+// Add the node to, or remove it from, the heap, or move it to its place.
+void _ai_sma_heap_update(ai_search_sma *sma, int heap, ai_sma_node *node,
+                         int member) {
+  int index = node->heap_index[heap];
+  if (member) {
+    if (index < 0) {
+      index = sma->heap_count[heap]++;
+      _ai_sma_heap_place(sma, heap, index, node);
+    }
+    _ai_sma_heap_fix(sma, heap, index);
+  } else if (index >= 0) {
+    ai_sma_node *last = sma->heap_list[heap][--sma->heap_count[heap]];
+    node->heap_index[heap] = -1;
+    if (last != node) {
+      _ai_sma_heap_place(sma, heap, index, last);
+      _ai_sma_heap_fix(sma, heap, index);
+    }
+  }
+}
+
+// Put the node in the heaps it belongs in, at its place by its f.
+void _ai_sma_node_heaps_update(ai_search_sma *sma, ai_sma_node *node) {
+  _ai_sma_heap_update(sma, _AI_SMA_HEAP_OPEN, node,
+                      _ai_sma_node_is_open(node));
+  _ai_sma_heap_update(sma, _AI_SMA_HEAP_LEAF, node,
+                      !node->children_count && node->parent);
+}
+
+// Add a new node to the search, and to its parent's child slot.
+ai_sma_node *_ai_sma_node_constructor(ai_search_sma *sma,
+                                      ai_model_state *model_state,
+                                      ai_action *action, ai_sma_node *parent,
+                                      int parent_slot, float cost_so_far,
+                                      float est_total_cost) {
+  ai_sma_node *node = (ai_sma_node *)malloc(sizeof(ai_sma_node));
+  check(node, "_ai_sma_node_constructor malloc failed");
+  if (sma->node_count == sma->node_list_size) {
+    int new_size = sma->node_list_size ? sma->node_list_size * 2 : 64;
+    ai_sma_node **new_list = (ai_sma_node **)realloc(
+        sma->node_list, sizeof(ai_sma_node *) * new_size);
+    check(new_list, "_ai_sma_node_constructor realloc failed");
+    sma->node_list = new_list;
+    for (int heap = 0; heap < 2; heap++) {
+      new_list = (ai_sma_node **)realloc(sma->heap_list[heap],
+                                         sizeof(ai_sma_node *) * new_size);
+      check(new_list, "_ai_sma_node_constructor realloc failed");
+      sma->heap_list[heap] = new_list;
+    }
+    sma->node_list_size = new_size;
+  }
+  node->model_state = model_state;
+  node->action = action;
+  node->parent = parent;
+  node->parent_slot = parent_slot;
+  node->depth = parent ? parent->depth + 1 : 0;
+  node->cost_so_far = cost_so_far;
+  node->est_total_cost = est_total_cost;
+  node->forgotten_est_total_cost = FLT_MAX;
+  node->children = NULL;
+  node->children_size = -1;
+  node->children_count = 0;
+  node->node_list_index = sma->node_count;
+  node->heap_index[_AI_SMA_HEAP_OPEN] = -1;
+  node->heap_index[_AI_SMA_HEAP_LEAF] = -1;
+  sma->node_list[sma->node_count++] = node;
+  if (sma->node_count > sma->node_peak_count) {
+    sma->node_peak_count = sma->node_count;
+  }
+  _ai_sma_node_heaps_update(sma, node);
+  if (parent) {
+    parent->children[parent_slot] = node;
+    parent->children_count++;
+    _ai_sma_node_heaps_update(sma, parent);
+  }
+  return node;
+error:
+  free(node);
+  return NULL;
+}
+
+// Free a node and its data. Does not touch the parent.
+void _ai_sma_node_free(ai_search_sma *sma, ai_sma_node *node) {
+  ai_model_state_evaluator *model_state_evaluator = sma->model_state_evaluator;
+  _ai_model_state_free(node->model_state,
+                       model_state_evaluator->model_state_data_free);
+  _ai_path_free(node->action, model_state_evaluator->action_data_free);
+  free(node->children);
+  free(node);
+}
+
+// Remove a node from the node list, by moving the last node into its place.
+void _ai_sma_node_list_remove(ai_search_sma *sma, ai_sma_node *node) {
+  ai_sma_node *last = sma->node_list[--sma->node_count];
+  sma->node_list[node->node_list_index] = last;
+  last->node_list_index = node->node_list_index;
+}
+
+// The open node with the lowest f. Deepest first among equals.
+ai_sma_node *_ai_sma_best_node(ai_search_sma *sma) {
+  return sma->heap_count[_AI_SMA_HEAP_OPEN]
+             ? sma->heap_list[_AI_SMA_HEAP_OPEN][0]
+             : NULL;
+}
+
+// The leaf with the highest f. Shallowest first among equals.
+// The root and the except node are never chosen.
+ai_sma_node *_ai_sma_worst_leaf(ai_search_sma *sma, ai_sma_node *except) {
+  int except_leaf = except->heap_index[_AI_SMA_HEAP_LEAF] >= 0;
+  if (except_leaf) {
+    _ai_sma_heap_update(sma, _AI_SMA_HEAP_LEAF, except, 0);
+  }
+  ai_sma_node *worst = sma->heap_count[_AI_SMA_HEAP_LEAF]
+                           ? sma->heap_list[_AI_SMA_HEAP_LEAF][0]
+                           : NULL;
+  if (except_leaf) {
+    _ai_sma_heap_update(sma, _AI_SMA_HEAP_LEAF, except, 1);
+  }
+  return worst;
+}
+
+// Set f of the node to the least f of its children, remembered or
+// forgotten, and carry any change up to its ancestors.
+void _ai_sma_backup(ai_search_sma *sma, ai_sma_node *node) {
+  while (node && (node->children_size >= 0)) {
+    float est_total_cost = node->forgotten_est_total_cost;
+    for (int i = 0; i < node->children_size; i++) {
+      ai_sma_node *child = node->children[i];
+      if (child && (child->est_total_cost < est_total_cost)) {
+        est_total_cost = child->est_total_cost;
+      }
+    }
+    if (est_total_cost == node->est_total_cost) {
+      break;
+    }
+    node->est_total_cost = est_total_cost;
+    _ai_sma_node_heaps_update(sma, node);
+    node = node->parent;
+  }
+}
+
+// Forget a leaf, backing its f up to the parent for later regeneration.
+void _ai_sma_forget(ai_search_sma *sma, ai_sma_node *leaf) {
+  ai_sma_node *parent = leaf->parent;
+  parent->children[leaf->parent_slot] = NULL;
+  parent->children_count--;
+  if (leaf->est_total_cost < parent->forgotten_est_total_cost) {
+    parent->forgotten_est_total_cost = leaf->est_total_cost;
+  }
+  _ai_sma_heap_update(sma, _AI_SMA_HEAP_OPEN, leaf, 0);
+  _ai_sma_heap_update(sma, _AI_SMA_HEAP_LEAF, leaf, 0);
+  _ai_sma_node_list_remove(sma, leaf);
+  _ai_sma_node_free(sma, leaf);
+  _ai_sma_node_heaps_update(sma, parent);
+  sma->node_forgotten_count++;
+}
+
+// Generate the successors of the node that are not held in memory, one at a
+// time, forgetting the worst leaf first whenever memory is full.
+void _ai_sma_expand(ai_search_sma *sma, ai_sma_node *node) {
+  ai_model_state_evaluator *model_state_evaluator = sma->model_state_evaluator;
+  ai_goal_est_cost_function goal_est_cost_function =
+      model_state_evaluator->goal_est_cost_function;
+
+  ai_successor *successor_list = model_state_evaluator->successor_function(
+      node->model_state, model_state_evaluator->transition_function);
+  if (node->children_size < 0) {
+    int count = 0;
+    for (ai_successor *s = successor_list; s; s = s->next) {
+      count++;
+    }
+    node->children =
+        count ? (ai_sma_node **)calloc(count, sizeof(ai_sma_node *)) : NULL;
+    if (count && !node->children) {
+      log_error("_ai_sma_expand calloc failed");
+      sma->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+    } else {
+      node->children_size = count;
+    }
+  }
+  // Children forgotten again while making room are remembered afresh.
+  node->forgotten_est_total_cost = FLT_MAX;
+
+  ai_successor *successor_next = NULL;
+  int slot = 0;
+  for (ai_successor *successor = successor_list; successor != NULL;
+       successor = successor_next, slot++) {
+    successor_next = successor->next;
+    ai_model_state *successor_model_state = successor->model_state;
+    ai_action *action = successor->action;
+    action->next = NULL;
+    if ((sma->status != AI_SEARCH_STATUS_RUNNING) ||
+        (slot >= node->children_size) || node->children[slot]) {
+      // Already held in memory, or out of memory.
+      _ai_model_state_free(successor_model_state,
+                           model_state_evaluator->model_state_data_free);
+      _ai_path_free(action, model_state_evaluator->action_data_free);
+      free(successor);
+      continue;
+    }
+    float cost_so_far = node->cost_so_far + successor->cost;
+    free(successor);
+
+    float est_total_cost = cost_so_far;
+    if (goal_est_cost_function != NULL) {
+      est_total_cost += goal_est_cost_function(successor_model_state);
+    }
+    // Path max. A child can be no better than its parent.
+    if (est_total_cost < node->est_total_cost) {
+      est_total_cost = node->est_total_cost;
+    }
+    // A path through a child at the deepest level that fits in memory can
+    // not be extended, so only a Goal is of any use there.
+    if ((node->depth + 2 >= sma->node_max) &&
+        !model_state_evaluator->is_goal_state_function(successor_model_state)) {
+      est_total_cost = FLT_MAX;
+    }
+    ai_sma_node *leaf = NULL;
+    while ((sma->node_count >= sma->node_max) &&
+           ((leaf = _ai_sma_worst_leaf(sma, node)) != NULL)) {
+      _ai_sma_forget(sma, leaf);
+    }
+    if (sma->node_count >= sma->node_max) {
+      // No room even so. The child is forgotten as soon as it is made.
+      if (est_total_cost < node->forgotten_est_total_cost) {
+        node->forgotten_est_total_cost = est_total_cost;
+      }
+      sma->node_forgotten_count++;
+    } else if (_ai_sma_node_constructor(sma, successor_model_state, action,
+                                        node, slot, cost_so_far,
+                                        est_total_cost)) {
+      continue;
+    } else {
+      sma->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+    }
+    _ai_model_state_free(successor_model_state,
+                         model_state_evaluator->model_state_data_free);
+    _ai_path_free(action, model_state_evaluator->action_data_free);
+  }
+  _ai_sma_node_heaps_update(sma, node);
+  _ai_sma_backup(sma, node);
+}
+
+// Build the path to the node from the actions of its ancestors.
+ai_path *_ai_sma_path(ai_search_sma *sma, ai_sma_node *node) {
+  ai_action_data_duplicator action_data_duplicator =
+      sma->model_state_evaluator->action_data_duplicator;
+  ai_path *path = NULL;
+  for (; node->parent; node = node->parent) {
+    ai_action *action =
+        ai_action_constructor(action_data_duplicator(node->action->data));
+    action->next = path;
+    path = action;
+  }
+  return path;
+}
+
+// Free every node still held.
+void _ai_sma_node_list_free(ai_search_sma *sma) {
+  for (int i = 0; i < sma->node_count; i++) {
+    _ai_sma_node_free(sma, sma->node_list[i]);
+  }
+  sma->node_count = 0;
+  sma->heap_count[_AI_SMA_HEAP_OPEN] = 0;
+  sma->heap_count[_AI_SMA_HEAP_LEAF] = 0;
+}
+
+// private - SMA* search algorithm
+ai_path *_ai_search_sma_find_path_to_goal(ai_search_sma *sma,
+                                          ai_model_state *initial_model_state) {
+  ai_model_state_evaluator *model_state_evaluator = sma->model_state_evaluator;
+  ai_path *result_path = NULL;
+
+  ai_model_state *dup_initial_model_state = _ai_model_state_duplicate(
+      initial_model_state, model_state_evaluator->model_state_data_duplicator);
+  float est_total_cost = 0;
+  if (model_state_evaluator->goal_est_cost_function != NULL) {
+    est_total_cost =
+        model_state_evaluator->goal_est_cost_function(dup_initial_model_state);
+  }
+  sma->node_forgotten_count = 0;
+  sma->node_peak_count = 0;
+  sma->status = AI_SEARCH_STATUS_RUNNING;
+  if (!_ai_sma_node_constructor(sma, dup_initial_model_state, NULL, NULL, 0,
+                                0, est_total_cost)) {
+    _ai_model_state_free(dup_initial_model_state,
+                         model_state_evaluator->model_state_data_free);
+    sma->status = AI_SEARCH_STATUS_MEMORY_EXCEEDED;
+  }
+
+  while (sma->status == AI_SEARCH_STATUS_RUNNING) {
+    ai_sma_node *node = _ai_sma_best_node(sma);
+    if (!node || (node->est_total_cost == FLT_MAX)) {
+      sma->status = AI_SEARCH_STATUS_NOT_FOUND;
+      break;
+    }
+    if ((sma->fringe_expansion_max != 0) &&
+        (sma->fringe_expansion_count >= sma->fringe_expansion_max)) {
+      sma->status = AI_SEARCH_STATUS_EXPANSION_LIMIT;
+      break;
+    }
+    sma->fringe_expansion_count++;
+
+    if (model_state_evaluator->is_goal_state_function(node->model_state)) {
+      result_path = _ai_sma_path(sma, node);
+      sma->status = AI_SEARCH_STATUS_FOUND;
+      break;
+    }
+    _ai_sma_expand(sma, node);
+  }
+  _ai_sma_node_list_free(sma);
+  return result_path;
+}
+
+// ai_search_sma *sma = ai_search_sma_constructor(model_state_evaluator, 1000);
+// ai_path *path = sma->find_path_to_goal(sma, model_state);
+ai_search_sma *
+ai_search_sma_constructor(ai_model_state_evaluator *model_state_evaluator,
+                          int node_max) {
+  ai_search_sma *sma = NULL;
+  check(node_max >= 2, "ai_search_sma_constructor node_max less than 2");
+  sma = (ai_search_sma *)malloc(sizeof(ai_search_sma));
+  check(sma, "ai_search_sma_constructor malloc failed");
+  sma->model_state_evaluator = model_state_evaluator;
+  sma->find_path_to_goal = _ai_search_sma_find_path_to_goal;
+  sma->node_max = node_max;
+  sma->fringe_expansion_count = 0;
+  sma->fringe_expansion_max = 0;
+  sma->node_forgotten_count = 0;
+  sma->node_peak_count = 0;
+  sma->status = AI_SEARCH_STATUS_IDLE;
+  sma->node_list = NULL;
+  sma->node_list_size = 0;
+  sma->node_count = 0;
+  for (int heap = 0; heap < 2; heap++) {
+    sma->heap_list[heap] = NULL;
+    sma->heap_count[heap] = 0;
+  }
+  return sma;
+error:
+  return NULL;
+}
+
+void ai_search_sma_free(ai_search_sma *sma) {
+  if (sma) {
+    _ai_sma_node_list_free(sma);
+    free(sma->node_list);
+    free(sma->heap_list[_AI_SMA_HEAP_OPEN]);
+    free(sma->heap_list[_AI_SMA_HEAP_LEAF]);
+    free(sma);
+  }
+}
@@ -0,0 +1,203 @@
+/*
+ * AI - State Intern Table.
+ *
+ * Open addressing with linear probing over ids, at most half full. A state's
+ * hash is FNV-1a of its packed bytes. Probing compares the kept hashes first,
+ * so packed bytes are only compared on a hash match.
+ */
+#include "ai_search_internal.h"
+#include <ai_state_intern.h>
+#include <logging.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _AI_STATE_INTERN_SIZE_MIN 1024
+// Most states, leaving AI_STATE_INTERN_NONE free.
+#define _AI_STATE_INTERN_MAX (AI_STATE_INTERN_NONE - 1)
+
+// ai_state_intern *intern = ai_state_intern_constructor(evaluator);
+ai_state_intern *
+ai_state_intern_constructor(ai_model_state_evaluator *model_state_evaluator) {
+  ai_state_intern *intern = NULL;
+  size_t packed_size = model_state_evaluator->model_state_packed_size;
+  check(packed_size && model_state_evaluator->model_state_pack_function &&
+            model_state_evaluator->model_state_unpack_function,
+        "ai_state_intern_constructor evaluator can not pack states");
+  intern = (ai_state_intern *)calloc(1, sizeof(ai_state_intern));
+  check(intern, "ai_state_intern_constructor malloc failed");
+  intern->model_state_evaluator = model_state_evaluator;
+  intern->size = _AI_STATE_INTERN_SIZE_MIN;
+  intern->model_state_list = (uint8_t *)malloc(packed_size * intern->size);
+  intern->hash_list = (size_t *)malloc(sizeof(size_t) * intern->size);
+  intern->table_size = _AI_STATE_INTERN_SIZE_MIN * 2;
+  intern->table = (uint32_t *)malloc(sizeof(uint32_t) * intern->table_size);
+  intern->scratch = (uint8_t *)malloc(packed_size);
+  check(intern->model_state_list && intern->hash_list && intern->table &&
+            intern->scratch,
+        "ai_state_intern_constructor malloc failed");
+  ai_state_intern_clear(intern);
+  return intern;
+error:
+  ai_state_intern_free(intern);
+  return NULL;
+}
+
+size_t ai_state_intern_hash(ai_state_intern *intern, const void *bytes) {
+  size_t packed_size = intern->model_state_evaluator->model_state_packed_size;
+  const uint8_t *byte = (const uint8_t *)bytes;
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < packed_size; i++) {
+    hash = (hash ^ byte[i]) * 1099511628211ull;
+  }
+  return (size_t)hash;
+}
+
+// The table slot holding the id of a packed state, or the empty slot where
+// it would go.
+size_t _ai_state_intern_slot(ai_state_intern *intern, const void *bytes,
+                             size_t hash) {
+  size_t packed_size = intern->model_state_evaluator->model_state_packed_size;
+  size_t mask = intern->table_size - 1;
+  for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+    uint32_t id = intern->table[slot];
+    if ((id == AI_STATE_INTERN_NONE) ||
+        ((intern->hash_list[id] == hash) &&
+         (memcmp(intern->model_state_list + (size_t)id * packed_size, bytes,
+                 packed_size) == 0))) {
+      return slot;
+    }
+  }
+}
+
+// Double the table. Returns 0, or -1 if out of memory.
+int _ai_state_intern_table_grow(ai_state_intern *intern) {
+  size_t table_size = intern->table_size * 2;
+  uint32_t *table = (uint32_t *)malloc(sizeof(uint32_t) * table_size);
+  check(table, "_ai_state_intern_table_grow malloc failed");
+  memset(table, 0xff, sizeof(uint32_t) * table_size);
+  free(intern->table);
+  intern->table = table;
+  intern->table_size = table_size;
+  size_t mask = table_size - 1;
+  for (uint32_t id = 0; id < intern->count; id++) {
+    size_t slot = intern->hash_list[id] & mask;
+    while (table[slot] != AI_STATE_INTERN_NONE) {
+      slot = (slot + 1) & mask;
+    }
+    table[slot] = id;
+  }
+  return 0;
+error:
+  return -1;
+}
+
+// Make room for one more state. Returns 0, or -1 if out of memory or of
+// ids.
+int _ai_state_intern_reserve(ai_state_intern *intern) {
+  size_t packed_size = intern->model_state_evaluator->model_state_packed_size;
+  check(intern->count < _AI_STATE_INTERN_MAX,
+        "_ai_state_intern_reserve too many states");
+  if (intern->count == intern->size) {
+    uint32_t size = intern->size > _AI_STATE_INTERN_MAX / 2
+                        ? _AI_STATE_INTERN_MAX
+                        : intern->size * 2;
+    uint8_t *model_state_list =
+        (uint8_t *)realloc(intern->model_state_list, packed_size * size);
+    check(model_state_list, "_ai_state_intern_reserve malloc failed");
+    intern->model_state_list = model_state_list;
+    size_t *hash_list =
+        (size_t *)realloc(intern->hash_list, sizeof(size_t) * size);
+    check(hash_list, "_ai_state_intern_reserve malloc failed");
+    intern->hash_list = hash_list;
+    intern->size = size;
+  }
+  if ((size_t)(intern->count + 1) * 2 > intern->table_size) {
+    return _ai_state_intern_table_grow(intern);
+  }
+  return 0;
+error:
+  return -1;
+}
+
+uint32_t ai_state_intern_find(ai_state_intern *intern, const void *bytes) {
+  size_t slot =
+      _ai_state_intern_slot(intern, bytes, ai_state_intern_hash(intern, bytes));
+  return intern->table[slot];
+}
+
+uint32_t ai_state_intern_add(ai_state_intern *intern, const void *bytes,
+                             int *added) {
+  return ai_state_intern_add_hashed(intern, bytes,
+                                    ai_state_intern_hash(intern, bytes), added);
+}
+
+uint32_t ai_state_intern_add_hashed(ai_state_intern *intern,
+                                    const void *bytes, size_t hash,
+                                    int *added) {
+  size_t packed_size = intern->model_state_evaluator->model_state_packed_size;
+  size_t slot = _ai_state_intern_slot(intern, bytes, hash);
+  *added = 0;
+  if (intern->table[slot] != AI_STATE_INTERN_NONE) {
+    return intern->table[slot];
+  }
+  size_t table_size = intern->table_size;
+  if (_ai_state_intern_reserve(intern) != 0) {
+    return AI_STATE_INTERN_NONE;
+  }
+  if (intern->table_size != table_size) {
+    slot = _ai_state_intern_slot(intern, bytes, hash);
+  }
+  uint32_t id = intern->count++;
+  memcpy(intern->model_state_list + (size_t)id * packed_size, bytes,
+         packed_size);
+  intern->hash_list[id] = hash;
+  intern->table[slot] = id;
+  *added = 1;
+  return id;
+}
+
+uint32_t ai_state_intern_add_model_state(ai_state_intern *intern,
+                                         ai_model_state *model_state,
+                                         int *added) {
+  intern->model_state_evaluator->model_state_pack_function(model_state,
+                                                           intern->scratch);
+  return ai_state_intern_add(intern, intern->scratch, added);
+}
+
+const void *ai_state_intern_bytes(ai_state_intern *intern, uint32_t id) {
+  return intern->model_state_list +
+         (size_t)id * intern->model_state_evaluator->model_state_packed_size;
+}
+
+size_t ai_state_intern_state_hash(ai_state_intern *intern, uint32_t id) {
+  return intern->hash_list[id];
+}
+
+ai_model_state *ai_state_intern_model_state(ai_state_intern *intern,
+                                            uint32_t id) {
+  void *data = intern->model_state_evaluator->model_state_unpack_function(
+      ai_state_intern_bytes(intern, id));
+  return data ? ai_model_state_constructor(data) : NULL;
+}
+
+size_t ai_state_intern_memory_used(ai_state_intern *intern) {
+  return (size_t)intern->size *
+             (intern->model_state_evaluator->model_state_packed_size +
+              sizeof(size_t)) +
+         intern->table_size * sizeof(uint32_t);
+}
+
+void ai_state_intern_clear(ai_state_intern *intern) {
+  memset(intern->table, 0xff, sizeof(uint32_t) * intern->table_size);
+  intern->count = 0;
+}
+
+void ai_state_intern_free(ai_state_intern *intern) {
+  if (intern) {
+    free(intern->model_state_list);
+    free(intern->hash_list);
+    free(intern->table);
+    free(intern->scratch);
+    free(intern);
+  }
+}
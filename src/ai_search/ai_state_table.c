@@ -0,0 +1,132 @@
+/*
+ * AI - State Table.
+ *
+ * Open addressing with linear probing. The hash of each Model State is kept
+ * in its entry, so probing and growing only call the equal function on a
+ * hash match, and never call the hash function again.
+ */
+#include "ai_search_internal.h"
+#include <ai_state_table.h>
+#include <logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AI_STATE_TABLE_INITIAL_SIZE 64
+
+// ai_state_table *table = ai_state_table_constructor(model_state_evaluator);
+ai_state_table *
+ai_state_table_constructor(ai_model_state_evaluator *model_state_evaluator) {
+  ai_state_table *table = NULL;
+  check(model_state_evaluator->model_state_hash_function &&
+            model_state_evaluator->model_state_equal_function,
+        "ai_state_table_constructor evaluator has no hash or equal function");
+  table = (ai_state_table *)malloc(sizeof(ai_state_table));
+  check(table, "ai_state_table_constructor malloc failed");
+  table->entries = (ai_state_table_entry *)calloc(
+      AI_STATE_TABLE_INITIAL_SIZE, sizeof(ai_state_table_entry));
+  check(table->entries, "ai_state_table_constructor malloc failed");
+  table->model_state_evaluator = model_state_evaluator;
+  table->size = AI_STATE_TABLE_INITIAL_SIZE;
+  table->count = 0;
+  return table;
+error:
+  free(table);
+  return NULL;
+}
+
+// The slot holding the Model State, or the empty slot where it would go.
+ai_state_table_entry *_ai_state_table_slot(ai_state_table *table,
+                                           ai_model_state *model_state,
+                                           size_t hash) {
+  ai_model_state_equal_function model_state_equal_function =
+      table->model_state_evaluator->model_state_equal_function;
+  size_t mask = table->size - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    ai_state_table_entry *entry = &table->entries[i];
+    if (!entry->model_state ||
+        ((entry->hash == hash) &&
+         model_state_equal_function(entry->model_state, model_state))) {
+      return entry;
+    }
+  }
+}
+
+// Double the slots, keeping the load factor at most one half.
+int _ai_state_table_grow(ai_state_table *table) {
+  size_t old_size = table->size;
+  ai_state_table_entry *old_entries = table->entries;
+  ai_state_table_entry *new_entries = (ai_state_table_entry *)calloc(
+      old_size * 2, sizeof(ai_state_table_entry));
+  check(new_entries, "_ai_state_table_grow malloc failed");
+  table->entries = new_entries;
+  table->size = old_size * 2;
+  size_t mask = table->size - 1;
+  for (size_t i = 0; i < old_size; i++) {
+    if (old_entries[i].model_state) {
+      size_t j = old_entries[i].hash & mask;
+      while (new_entries[j].model_state) {
+        j = (j + 1) & mask;
+      }
+      new_entries[j] = old_entries[i];
+    }
+  }
+  free(old_entries);
+  return 0;
+error:
+  return -1;
+}
+
+ai_state_table_entry *ai_state_table_find(ai_state_table *table,
+                                          ai_model_state *model_state) {
+  return ai_state_table_find_hashed(
+      table, model_state,
+      table->model_state_evaluator->model_state_hash_function(model_state));
+}
+
+ai_state_table_entry *ai_state_table_find_hashed(ai_state_table *table,
+                                                 ai_model_state *model_state,
+                                                 size_t hash) {
+  ai_state_table_entry *entry = _ai_state_table_slot(table, model_state, hash);
+  return entry->model_state ? entry : NULL;
+}
+
+ai_state_table_entry *ai_state_table_insert(ai_state_table *table,
+                                            ai_model_state *model_state,
+                                            float cost) {
+  return ai_state_table_insert_hashed(
+      table, model_state,
+      table->model_state_evaluator->model_state_hash_function(model_state),
+      cost);
+}
+
+ai_state_table_entry *ai_state_table_insert_hashed(ai_state_table *table,
+                                                   ai_model_state *model_state,
+                                                   size_t hash, float cost) {
+  if ((table->count + 1) * 2 > table->size) {
+    check(_ai_state_table_grow(table) == 0,
+          "ai_state_table_insert grow failed");
+  }
+  ai_state_table_entry *entry = _ai_state_table_slot(table, model_state, hash);
+  check(!entry->model_state, "ai_state_table_insert state already present");
+  entry->model_state = model_state;
+  entry->hash = hash;
+  entry->cost = cost;
+  table->count++;
+  return entry;
+error:
+  return NULL;
+}
+
+void ai_state_table_free(ai_state_table *table) {
+  if (table) {
+    ai_model_state_data_free model_state_data_free =
+        table->model_state_evaluator->model_state_data_free;
+    for (size_t i = 0; i < table->size; i++) {
+      _ai_model_state_free(table->entries[i].model_state,
+                           model_state_data_free);
+    }
+    free(table->entries);
+    free(table);
+  }
+}
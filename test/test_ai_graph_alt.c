@@ -0,0 +1,121 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// Custom
+#include <ai_graph.h>
+#include <ai_graph_alt.h>
+#include <minunit.h>
+#include "test_graph_fixture.h"
+
+void _ai_path_free(ai_path *ptr, ai_action_data_free action_data_free);
+
+// Optimal cost by A* with the query's estimate, and its expansion count.
+float my_astar_cost(ai_graph_query *query, uint32_t source,
+                    int *expansion_count) {
+  ai_model_state *model_state = ai_graph_model_state_constructor(query, source);
+  ai_search_astar *astar =
+      ai_search_astar_constructor(&ai_graph_model_state_evaluator);
+  ai_path *path = astar->find_path_to_goal(astar, model_state);
+  float cost = astar->status == AI_SEARCH_STATUS_FOUND
+                   ? my_path_cost(query->graph, source, query->goal, path)
+                   : INFINITY;
+  *expansion_count = astar->fringe_expansion_count;
+  _ai_path_free(path, ai_graph_action_data_free);
+  ai_search_astar_free(astar);
+  ai_graph_model_state_data_free(model_state->data);
+  free(model_state);
+  return cost;
+}
+
+char *my_alt_check(ai_graph_alt_selection selection) {
+  my_random_seed = 1;
+  ai_graph *graph = my_road_graph_constructor();
+  ai_graph_alt *alt = ai_graph_alt_constructor(graph, 8, selection);
+  mu_assert(alt && alt->landmark_count == 8,
+            "ai_graph_alt_constructor: built.");
+  for (int i = 0; i < alt->landmark_count; i++) {
+    for (int j = 0; j < i; j++) {
+      mu_assert(alt->landmark_list[i] != alt->landmark_list[j],
+                "ai_graph_alt_constructor: distinct landmarks.");
+    }
+  }
+
+  float *dist = (float *)malloc(sizeof(float) * NODE_COUNT);
+  int plain_total = 0;
+  int alt_total = 0;
+  for (uint32_t goal = 5; goal < NODE_COUNT - 1; goal += 61) {
+    ai_graph_distances(graph, goal, 1, dist);
+    for (uint32_t node = 0; node < NODE_COUNT; node++) {
+      mu_assert(ai_graph_alt_est_cost(alt, node, goal) <=
+                    dist[node] + 0.001f * dist[node],
+                "ai_graph_alt_est_cost: never over-estimates.");
+    }
+    ai_graph_query query;
+    ai_graph_query_init(&query, graph, goal);
+    for (uint32_t source = 0; source < NODE_COUNT - 1; source += 97) {
+      int plain_count = 0;
+      int alt_count = 0;
+      query.est_cost_function = NULL;
+      query.est_cost_data = NULL;
+      float plain_cost = my_astar_cost(&query, source, &plain_count);
+      query.est_cost_function = ai_graph_alt_est_cost;
+      query.est_cost_data = alt;
+      float alt_cost = my_astar_cost(&query, source, &alt_count);
+      mu_assert(my_cost_equal(plain_cost, dist[source]) &&
+                    my_cost_equal(alt_cost, dist[source]),
+                "ai_graph_alt_est_cost: optimal path.");
+      plain_total += plain_count;
+      alt_total += alt_count;
+    }
+  }
+  mu_assert(alt_total * 2 < plain_total,
+            "ai_graph_alt_est_cost: far fewer expansions.");
+
+  // No path to the node with no roads. Every bound is skipped.
+  mu_assert(ai_graph_alt_est_cost(alt, 3, NODE_COUNT - 1) >= 0,
+            "ai_graph_alt_est_cost: unreachable.");
+
+  free(dist);
+  ai_graph_alt_free(alt);
+  ai_graph_free(graph);
+  return NULL;
+}
+
+char *test_ai_graph_alt_farthest() {
+  return my_alt_check(AI_GRAPH_ALT_SELECTION_FARTHEST);
+}
+
+char *test_ai_graph_alt_avoid() {
+  return my_alt_check(AI_GRAPH_ALT_SELECTION_AVOID);
+}
+
+char *test_ai_graph_alt_small() {
+  // More landmarks than nodes.
+  ai_graph_edge edges[] = {{0, 1, 2.0f}, {1, 2, 1.5f}};
+  ai_graph *graph = ai_graph_constructor(3, 2, edges);
+  ai_graph_alt *alt =
+      ai_graph_alt_constructor(graph, 8, AI_GRAPH_ALT_SELECTION_AVOID);
+  mu_assert(alt && alt->landmark_count == 3,
+            "ai_graph_alt_constructor: cut to the nodes.");
+  mu_assert(ai_graph_alt_est_cost(alt, 0, 2) == 3.5f,
+            "ai_graph_alt_est_cost: exact at a landmark.");
+  mu_assert(ai_graph_alt_est_cost(alt, 2, 0) == 0,
+            "ai_graph_alt_est_cost: no path back.");
+  ai_graph_alt_free(alt);
+  ai_graph_free(graph);
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test_ai_graph_alt_farthest);
+  mu_run_test(test_ai_graph_alt_avoid);
+  mu_run_test(test_ai_graph_alt_small);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
@@ -0,0 +1,120 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// Custom
+#include <ai_graph.h>
+#include <ai_graph_arc_flags.h>
+#include <minunit.h>
+#include "test_graph_fixture.h"
+
+void _ai_path_free(ai_path *ptr, ai_action_data_free action_data_free);
+
+// Cost by A* with the successor filter, and its expansion count.
+float my_astar_cost(ai_graph_query *query, uint32_t source,
+                    ai_graph_arc_flags *arc_flags, int *expansion_count) {
+  ai_model_state *model_state = ai_graph_model_state_constructor(query, source);
+  ai_search_astar *astar =
+      ai_search_astar_constructor(&ai_graph_model_state_evaluator);
+  if (arc_flags) {
+    astar->successor_filter_function = ai_graph_arc_flags_successor_filter;
+    astar->successor_filter_data = arc_flags;
+  }
+  ai_path *path = astar->find_path_to_goal(astar, model_state);
+  float cost = astar->status == AI_SEARCH_STATUS_FOUND
+                   ? my_path_cost(query->graph, source, query->goal, path)
+                   : INFINITY;
+  *expansion_count = astar->fringe_expansion_count;
+  _ai_path_free(path, ai_graph_action_data_free);
+  ai_search_astar_free(astar);
+  ai_graph_model_state_data_free(model_state->data);
+  free(model_state);
+  return cost;
+}
+
+char *test_ai_graph_arc_flags_find_path() {
+  my_random_seed = 1;
+  ai_graph *graph = my_road_graph_constructor();
+  ai_graph_arc_flags *arc_flags =
+      ai_graph_arc_flags_constructor(graph, 16, NULL);
+  mu_assert(arc_flags && arc_flags->region_words == 1,
+            "ai_graph_arc_flags_constructor: built.");
+  int region_size[16] = {0};
+  for (uint32_t v = 0; v < NODE_COUNT; v++) {
+    mu_assert(arc_flags->node_region[v] < 16,
+              "ai_graph_arc_flags_constructor: region in range.");
+    region_size[arc_flags->node_region[v]]++;
+  }
+  for (int r = 0; r < 15; r++) {
+    mu_assert(region_size[r] == (NODE_COUNT + 15) / 16,
+              "ai_graph_arc_flags_constructor: regions of equal size.");
+  }
+
+  float *dist = (float *)malloc(sizeof(float) * NODE_COUNT);
+  int plain_total = 0;
+  int flag_total = 0;
+  for (uint32_t goal = 5; goal < NODE_COUNT - 1; goal += 53) {
+    ai_graph_distances(graph, goal, 1, dist);
+    ai_graph_query query;
+    ai_graph_query_init(&query, graph, goal);
+    for (uint32_t source = 0; source < NODE_COUNT - 1; source += 43) {
+      int plain_count = 0;
+      int flag_count = 0;
+      float plain_cost = my_astar_cost(&query, source, NULL, &plain_count);
+      float flag_cost = my_astar_cost(&query, source, arc_flags, &flag_count);
+      mu_assert(my_cost_equal(plain_cost, dist[source]) &&
+                    my_cost_equal(flag_cost, dist[source]),
+                "ai_graph_arc_flags_successor_filter: optimal path.");
+      plain_total += plain_count;
+      flag_total += flag_count;
+    }
+  }
+  mu_assert(flag_total * 2 < plain_total,
+            "ai_graph_arc_flags_successor_filter: far fewer expansions.");
+
+  free(dist);
+  ai_graph_arc_flags_free(arc_flags);
+  ai_graph_free(graph);
+  return NULL;
+}
+
+char *test_ai_graph_arc_flags_regions() {
+  // A line 0 -> 1 -> 2 -> 3 with a dear shortcut 0 -> 3, in two regions.
+  ai_graph_edge edges[] = {
+      {0, 1, 1.0f}, {1, 2, 1.0f}, {2, 3, 1.0f}, {0, 3, 5.0f}};
+  ai_graph *graph = ai_graph_constructor(4, 4, edges);
+  uint32_t node_region[] = {0, 0, 1, 1};
+  ai_graph_arc_flags *arc_flags =
+      ai_graph_arc_flags_constructor(graph, 2, node_region);
+  mu_assert(arc_flags, "ai_graph_arc_flags_constructor: given regions.");
+  uint32_t edge = ai_graph_edge_find(graph, 0, 1);
+  mu_assert(ai_graph_arc_flags_get(arc_flags, edge, 0) &&
+                ai_graph_arc_flags_get(arc_flags, edge, 1),
+            "ai_graph_arc_flags_get: within and toward a region.");
+  edge = ai_graph_edge_find(graph, 0, 3);
+  mu_assert(!ai_graph_arc_flags_get(arc_flags, edge, 1),
+            "ai_graph_arc_flags_get: dear edge not flagged.");
+  edge = ai_graph_edge_find(graph, 2, 3);
+  mu_assert(!ai_graph_arc_flags_get(arc_flags, edge, 0) &&
+                ai_graph_arc_flags_get(arc_flags, edge, 1),
+            "ai_graph_arc_flags_get: only toward its region.");
+  ai_graph_arc_flags_free(arc_flags);
+
+  uint32_t bad_region[] = {0, 0, 2, 1};
+  mu_assert(ai_graph_arc_flags_constructor(graph, 2, bad_region) == NULL,
+            "ai_graph_arc_flags_constructor: region out of range.");
+  ai_graph_free(graph);
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test_ai_graph_arc_flags_find_path);
+  mu_run_test(test_ai_graph_arc_flags_regions);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
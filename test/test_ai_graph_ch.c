@@ -0,0 +1,102 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// Custom
+#include <ai_graph.h>
+#include <ai_graph_ch.h>
+#include <minunit.h>
+#include "test_graph_fixture.h"
+
+void _ai_path_free(ai_path *ptr, ai_action_data_free action_data_free);
+
+char *test_ai_graph_ch_find_path() {
+  ai_graph *graph = my_road_graph_constructor();
+  ai_graph_ch *ch = ai_graph_ch_constructor(graph);
+  mu_assert(ch, "ai_graph_ch_constructor: built.");
+  float *dist = (float *)malloc(sizeof(float) * NODE_COUNT);
+  int expansion_total = 0;
+  int query_count = 0;
+  for (uint32_t source = 0; source < NODE_COUNT - 1; source += 37) {
+    ai_graph_distances(graph, source, 0, dist);
+    for (uint32_t target = 5; target < NODE_COUNT - 1; target += 23) {
+      ai_path *path = ai_graph_ch_find_path(ch, source, target);
+      mu_assert(ch->status == AI_SEARCH_STATUS_FOUND,
+                "ai_graph_ch_find_path: FOUND.");
+      mu_assert(my_cost_equal(ch->path_cost, dist[target]),
+                "ai_graph_ch_find_path: cost as Dijkstra.");
+      mu_assert(my_cost_equal(my_path_cost(graph, source, target, path),
+                              dist[target]),
+                "ai_graph_ch_find_path: path of original edges.");
+      mu_assert(my_cost_equal(ai_graph_ch_distance(ch, source, target),
+                              dist[target]),
+                "ai_graph_ch_distance: cost as Dijkstra.");
+      expansion_total += ch->fringe_expansion_count;
+      query_count++;
+      _ai_path_free(path, ai_graph_action_data_free);
+    }
+  }
+  mu_assert(expansion_total / query_count < NODE_COUNT / 4,
+            "ai_graph_ch_find_path: settles few nodes.");
+
+  ai_path *path = ai_graph_ch_find_path(ch, 3, 3);
+  mu_assert(!path && ch->status == AI_SEARCH_STATUS_FOUND &&
+                ch->path_cost == 0,
+            "ai_graph_ch_find_path: to itself.");
+  path = ai_graph_ch_find_path(ch, 3, NODE_COUNT - 1);
+  mu_assert(!path && ch->status == AI_SEARCH_STATUS_NOT_FOUND,
+            "ai_graph_ch_find_path: NOT_FOUND.");
+  mu_assert(ai_graph_ch_distance(ch, NODE_COUNT - 1, 3) == INFINITY,
+            "ai_graph_ch_distance: INFINITY.");
+
+  free(dist);
+  ai_graph_ch_free(ch);
+  ai_graph_free(graph);
+  return NULL;
+}
+
+char *test_ai_graph_ch_save() {
+  ai_graph *graph = my_road_graph_constructor();
+  ai_graph_ch *ch = ai_graph_ch_constructor(graph);
+  FILE *file = tmpfile();
+  mu_assert(ai_graph_ch_save(ch, file) == 0, "ai_graph_ch_save: saved.");
+  rewind(file);
+  ai_graph_ch *loaded = ai_graph_ch_load(file);
+  mu_assert(loaded, "ai_graph_ch_load: loaded.");
+  mu_assert(loaded->edge_count == ch->edge_count &&
+                loaded->shortcut_count == ch->shortcut_count,
+            "ai_graph_ch_load: same edges.");
+  for (uint32_t target = 1; target < NODE_COUNT - 1; target += 41) {
+    ai_path *path = ai_graph_ch_find_path(loaded, 0, target);
+    mu_assert(loaded->path_cost == ai_graph_ch_distance(ch, 0, target),
+              "ai_graph_ch_load: same cost.");
+    mu_assert(my_cost_equal(my_path_cost(graph, 0, target, path),
+                            loaded->path_cost),
+              "ai_graph_ch_load: same path.");
+    _ai_path_free(path, ai_graph_action_data_free);
+  }
+  ai_graph_ch_free(loaded);
+
+  // Not a saved hierarchy.
+  rewind(file);
+  fwrite("XXXX", 1, 4, file);
+  rewind(file);
+  mu_assert(ai_graph_ch_load(file) == NULL, "ai_graph_ch_load: bad magic.");
+  fclose(file);
+
+  ai_graph_ch_free(ch);
+  ai_graph_free(graph);
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test_ai_graph_ch_find_path);
+  mu_run_test(test_ai_graph_ch_save);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
@@ -0,0 +1,89 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// Custom
+#include <ai_graph.h>
+#include <ai_graph_hub_labels.h>
+#include <minunit.h>
+#include "test_graph_fixture.h"
+
+void _ai_path_free(ai_path *ptr, ai_action_data_free action_data_free);
+
+char *test_ai_graph_hub_labels_distance() {
+  ai_graph *graph = my_road_graph_constructor();
+  ai_graph_hub_labels *labels = ai_graph_hub_labels_constructor(graph);
+  mu_assert(labels, "ai_graph_hub_labels_constructor: built.");
+  // Far fewer entries than a full distance table.
+  mu_assert(ai_graph_hub_labels_size(labels) <
+                (size_t)NODE_COUNT * NODE_COUNT / 4,
+            "ai_graph_hub_labels_size: compact.");
+  for (uint32_t v = 0; v < NODE_COUNT; v++) {
+    for (uint32_t i = labels->out_offset[v] + 1; i < labels->out_offset[v + 1];
+         i++) {
+      mu_assert(labels->out_hub[i - 1] < labels->out_hub[i],
+                "ai_graph_hub_labels_constructor: sorted labels.");
+    }
+  }
+  float *dist = (float *)malloc(sizeof(float) * NODE_COUNT);
+  for (uint32_t source = 0; source < NODE_COUNT; source += 7) {
+    ai_graph_distances(graph, source, 0, dist);
+    for (uint32_t target = 0; target < NODE_COUNT; target++) {
+      float cost = ai_graph_hub_labels_distance(labels, source, target);
+      mu_assert((cost == dist[target]) || my_cost_equal(cost, dist[target]),
+                "ai_graph_hub_labels_distance: cost as Dijkstra.");
+    }
+  }
+  mu_assert(ai_graph_hub_labels_distance(labels, 3, 3) == 0,
+            "ai_graph_hub_labels_distance: to itself.");
+  mu_assert(ai_graph_hub_labels_distance(labels, NODE_COUNT - 1, 3) ==
+                INFINITY,
+            "ai_graph_hub_labels_distance: INFINITY.");
+  free(dist);
+  ai_graph_hub_labels_free(labels);
+  ai_graph_free(graph);
+  return NULL;
+}
+
+char *test_ai_graph_hub_labels_find_path() {
+  my_random_seed = 1;
+  ai_graph *graph = my_road_graph_constructor();
+  ai_graph_hub_labels *labels = ai_graph_hub_labels_constructor(graph);
+  float *dist = (float *)malloc(sizeof(float) * NODE_COUNT);
+  for (uint32_t source = 0; source < NODE_COUNT - 1; source += 37) {
+    ai_graph_distances(graph, source, 0, dist);
+    for (uint32_t target = 5; target < NODE_COUNT - 1; target += 23) {
+      ai_path *path = ai_graph_hub_labels_find_path(labels, source, target);
+      mu_assert(labels->status == AI_SEARCH_STATUS_FOUND,
+                "ai_graph_hub_labels_find_path: FOUND.");
+      mu_assert(my_cost_equal(labels->path_cost, dist[target]) &&
+                    my_cost_equal(my_path_cost(graph, source, target, path),
+                                  dist[target]),
+                "ai_graph_hub_labels_find_path: cheapest path.");
+      _ai_path_free(path, ai_graph_action_data_free);
+    }
+  }
+  ai_path *path = ai_graph_hub_labels_find_path(labels, 3, 3);
+  mu_assert(!path && labels->status == AI_SEARCH_STATUS_FOUND &&
+                labels->path_cost == 0,
+            "ai_graph_hub_labels_find_path: to itself.");
+  path = ai_graph_hub_labels_find_path(labels, 3, NODE_COUNT - 1);
+  mu_assert(!path && labels->status == AI_SEARCH_STATUS_NOT_FOUND,
+            "ai_graph_hub_labels_find_path: NOT_FOUND.");
+  free(dist);
+  ai_graph_hub_labels_free(labels);
+  ai_graph_free(graph);
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test_ai_graph_hub_labels_distance);
+  mu_run_test(test_ai_graph_hub_labels_find_path);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
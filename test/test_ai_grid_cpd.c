@@ -0,0 +1,218 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+// Custom
+#include <ai_grid.h>
+#include <ai_grid_cpd.h>
+#include <minunit.h>
+#include "test_random.h"
+
+void _ai_path_free(ai_path *ptr, ai_action_data_free action_data_free);
+
+#define GRID_SIZE 40
+
+/*
+ * A GRID_SIZE x GRID_SIZE grid with one cell in five blocked at random,
+ * and a walled pocket at (1, 1) that can not be reached.
+ */
+ai_grid *my_grid_constructor() {
+  my_random_seed = 1;
+  ai_grid *grid = ai_grid_constructor(GRID_SIZE, GRID_SIZE);
+  for (int y = 0; y < GRID_SIZE; y++) {
+    for (int x = 0; x < GRID_SIZE; x++) {
+      ai_grid_blocked_set(grid, x, y, (my_random() % 5) == 0);
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    ai_grid_blocked_set(grid, i, 2, 1);
+    ai_grid_blocked_set(grid, 2, i, 1);
+  }
+  ai_grid_blocked_set(grid, 1, 1, 0);
+  return grid;
+}
+
+// Cost of the path, or -1 if a move is not a legal move of the grid.
+float my_path_cost(ai_grid *grid, int x, int y, int goal_x, int goal_y,
+                   ai_path *path) {
+  float cost = 0;
+  for (; path; path = path->next) {
+    ai_grid_action *action_data = (ai_grid_action *)path->data;
+    int dx = action_data->x - x;
+    int dy = action_data->y - y;
+    if ((abs(dx) > 1) || (abs(dy) > 1) || (!dx && !dy) ||
+        ai_grid_blocked(grid, action_data->x, action_data->y) ||
+        (dx && dy && (ai_grid_blocked(grid, x + dx, y) ||
+                      ai_grid_blocked(grid, x, y + dy)))) {
+      return -1;
+    }
+    cost += ai_grid_move_cost(x, y, action_data->x, action_data->y);
+    x = action_data->x;
+    y = action_data->y;
+  }
+  return ((x == goal_x) && (y == goal_y)) ? cost : -1;
+}
+
+// Optimal cost by A* over the whole grid, or -1 if there is no path.
+float my_astar_cost(ai_grid *grid, int x, int y, int goal_x, int goal_y) {
+  ai_grid_query query;
+  ai_grid_query_init(&query, grid, goal_x, goal_y);
+  ai_model_state *model_state = ai_grid_model_state_constructor(&query, x, y);
+  ai_search_astar *astar =
+      ai_search_astar_constructor(&ai_grid_model_state_evaluator);
+  ai_path *path = astar->find_path_to_goal(astar, model_state);
+  float cost = astar->status == AI_SEARCH_STATUS_FOUND
+                   ? my_path_cost(grid, x, y, goal_x, goal_y, path)
+                   : -1;
+  _ai_path_free(path, ai_grid_data_free);
+  ai_search_astar_free(astar);
+  free(model_state->data);
+  free(model_state);
+  return cost;
+}
+
+int my_cost_equal(float a, float b) { return fabsf(a - b) < 0.001f; }
+
+// Compare queries of the database with A*, over a spread of cells.
+char *my_cpd_check(ai_grid_cpd *cpd, ai_grid *grid) {
+  int query_count = 0;
+  for (int i = 0; i < 80; i++) {
+    int x = my_random() % GRID_SIZE;
+    int y = my_random() % GRID_SIZE;
+    int goal_x = my_random() % GRID_SIZE;
+    int goal_y = my_random() % GRID_SIZE;
+    if (ai_grid_blocked(grid, x, y) || ai_grid_blocked(grid, goal_x, goal_y)) {
+      continue;
+    }
+    float astar_cost = my_astar_cost(grid, x, y, goal_x, goal_y);
+    ai_path *path = ai_grid_cpd_find_path(cpd, x, y, goal_x, goal_y);
+    if (astar_cost < 0) {
+      mu_assert(!path && cpd->status == AI_SEARCH_STATUS_NOT_FOUND,
+                "ai_grid_cpd_find_path: NOT_FOUND.");
+      continue;
+    }
+    mu_assert(cpd->status == AI_SEARCH_STATUS_FOUND,
+              "ai_grid_cpd_find_path: FOUND.");
+    mu_assert(my_cost_equal(cpd->path_cost, astar_cost) &&
+                  my_cost_equal(my_path_cost(grid, x, y, goal_x, goal_y, path),
+                                astar_cost),
+              "ai_grid_cpd_find_path: cheapest path.");
+    mu_assert(cpd->fringe_expansion_count == 0,
+              "ai_grid_cpd_find_path: no search.");
+    query_count++;
+    _ai_path_free(path, ai_grid_data_free);
+  }
+  mu_assert(query_count > 30, "ai_grid_cpd_find_path: most found.");
+  return NULL;
+}
+
+char *test_ai_grid_cpd_find_path() {
+  ai_grid *grid = my_grid_constructor();
+  ai_grid_cpd *cpd = ai_grid_cpd_constructor(grid);
+  mu_assert(cpd, "ai_grid_cpd_constructor: built.");
+  // Run-length encoding keeps far fewer entries than a full table.
+  mu_assert(cpd->run_count < cpd->node_count * cpd->node_count / 8,
+            "ai_grid_cpd_constructor: compressed.");
+  char *message = my_cpd_check(cpd, grid);
+  if (message) {
+    return message;
+  }
+  ai_path *path = ai_grid_cpd_find_path(cpd, 1, 1, 1, 1);
+  mu_assert(!path && cpd->status == AI_SEARCH_STATUS_FOUND &&
+                cpd->path_cost == 0,
+            "ai_grid_cpd_find_path: to itself.");
+  path = ai_grid_cpd_find_path(cpd, 1, 1, GRID_SIZE - 1, GRID_SIZE - 1);
+  mu_assert(!path && cpd->status == AI_SEARCH_STATUS_NOT_FOUND &&
+                cpd->fringe_expansion_count == 0,
+            "ai_grid_cpd_find_path: NOT_FOUND without a search.");
+  ai_grid_cpd_free(cpd);
+  ai_grid_free(grid);
+  return NULL;
+}
+
+char *test_ai_grid_cpd_load() {
+  ai_grid *grid = my_grid_constructor();
+  ai_grid_cpd *cpd = ai_grid_cpd_constructor(grid);
+  char file_name[] = "/tmp/test_ai_grid_cpd_XXXXXX";
+  int fd = mkstemp(file_name);
+  mu_assert(fd >= 0, "mkstemp: temporary file.");
+  FILE *file = fdopen(fd, "wb");
+  mu_assert(ai_grid_cpd_save(cpd, file) == 0, "ai_grid_cpd_save: saved.");
+  fclose(file);
+
+  ai_grid_cpd *loaded = ai_grid_cpd_load(file_name, grid);
+  mu_assert(loaded && loaded->block_mapped, "ai_grid_cpd_load: mapped.");
+  mu_assert(loaded->run_count == cpd->run_count &&
+                loaded->node_count == cpd->node_count,
+            "ai_grid_cpd_load: same tables.");
+  char *message = my_cpd_check(loaded, grid);
+  if (message) {
+    return message;
+  }
+  ai_grid_cpd_free(loaded);
+
+  // Built for another size of grid.
+  ai_grid *small = ai_grid_constructor(8, 8);
+  mu_assert(ai_grid_cpd_load(file_name, small) == NULL,
+            "ai_grid_cpd_load: wrong size.");
+  ai_grid_free(small);
+  // Not a saved database.
+  file = fopen(file_name, "r+b");
+  fwrite("XXXX", 1, 4, file);
+  fclose(file);
+  mu_assert(ai_grid_cpd_load(file_name, grid) == NULL,
+            "ai_grid_cpd_load: bad magic.");
+  unlink(file_name);
+
+  ai_grid_cpd_free(cpd);
+  ai_grid_free(grid);
+  return NULL;
+}
+
+char *test_ai_grid_cpd_cell_set() {
+  ai_grid *grid = ai_grid_constructor(GRID_SIZE, GRID_SIZE);
+  ai_grid_cpd *cpd = ai_grid_cpd_constructor(grid);
+  ai_path *path = ai_grid_cpd_find_path(cpd, 0, 20, 39, 20);
+  mu_assert(my_cost_equal(cpd->path_cost, 39) && cpd->lookup_count == 39,
+            "ai_grid_cpd_find_path: one lookup a move.");
+  _ai_path_free(path, ai_grid_data_free);
+
+  // Wall off the straight line, leaving a gap at the top.
+  for (int y = 1; y < GRID_SIZE; y++) {
+    ai_grid_cpd_cell_set(cpd, 20, y, 1);
+  }
+  mu_assert(cpd->region_invalid_count == 3,
+            "ai_grid_cpd_cell_set: regions invalid.");
+  path = ai_grid_cpd_find_path(cpd, 0, 20, 39, 20);
+  mu_assert(cpd->status == AI_SEARCH_STATUS_FOUND &&
+                cpd->fringe_expansion_count > 0,
+            "ai_grid_cpd_find_path: A* fallback.");
+  float cost = my_path_cost(grid, 0, 20, 39, 20, path);
+  mu_assert(my_cost_equal(cost, cpd->path_cost) &&
+                cost >= my_astar_cost(grid, 0, 20, 39, 20) - 0.001f,
+            "ai_grid_cpd_find_path: valid path around the wall.");
+  _ai_path_free(path, ai_grid_data_free);
+
+  // Close the gap.
+  ai_grid_cpd_cell_set(cpd, 20, 0, 1);
+  path = ai_grid_cpd_find_path(cpd, 0, 20, 39, 20);
+  mu_assert(!path && cpd->status == AI_SEARCH_STATUS_NOT_FOUND,
+            "ai_grid_cpd_find_path: walled off.");
+  ai_grid_cpd_free(cpd);
+  ai_grid_free(grid);
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test_ai_grid_cpd_find_path);
+  mu_run_test(test_ai_grid_cpd_load);
+  mu_run_test(test_ai_grid_cpd_cell_set);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// Custom
+#include <ai_grid.h>
+#include <minunit.h>
+#include "test_random.h"
+
+void _ai_path_free(ai_path *ptr, ai_action_data_free action_data_free);
+
+// Wider than two words of a row, so rows are read across word boundaries.
+#define GRID_WIDTH 150
+#define GRID_HEIGHT 40
+
+// A grid with one cell in four blocked at random.
+ai_grid *my_grid_constructor() {
+  my_random_seed = 1;
+  ai_grid *grid = ai_grid_constructor(GRID_WIDTH, GRID_HEIGHT);
+  for (int y = 0; y < GRID_HEIGHT; y++) {
+    for (int x = 0; x < GRID_WIDTH; x++) {
+      ai_grid_blocked_set(grid, x, y, (my_random() % 4) == 0);
+    }
+  }
+  return grid;
+}
+
+// True if the cell is free and inside the query's rectangle.
+int my_open(ai_grid_query *query, int x, int y) {
+  return (x >= query->min_x) && (y >= query->min_y) && (x < query->max_x) &&
+         (y < query->max_y) && !ai_grid_blocked(query->grid, x, y);
+}
+
+// The move mask, a cell at a time.
+unsigned my_move_mask(ai_grid_query *query, int x, int y) {
+  static const int dx[8] = {1, 0, -1, 0, 1, -1, -1, 1};
+  static const int dy[8] = {0, 1, 0, -1, 1, 1, -1, -1};
+  unsigned mask = 0;
+  for (int i = 0; i < 8; i++) {
+    if (my_open(query, x + dx[i], y + dy[i]) &&
+        (!dx[i] || !dy[i] ||
+         (my_open(query, x + dx[i], y) && my_open(query, x, y + dy[i])))) {
+      mask |= 1u << i;
+    }
+  }
+  return mask;
+}
+
+// Every kernel the CPU runs returns what ai_grid_octile_distance does, for
+// counts that do and do not fill their vectors.
+char *test_ai_grid_octile_distance_batch() {
+  int x[37];
+  int y[37];
+  float costs[37];
+  ai_grid_simd supported = ai_grid_simd_supported();
+  ai_grid_simd simd = ai_grid_simd_get();
+  mu_assert(simd == supported, "ai_grid_simd: best kernels by default.");
+  for (int level = AI_GRID_SIMD_SCALAR; level <= AI_GRID_SIMD_AVX2; level++) {
+    ai_grid_simd used = ai_grid_simd_set((ai_grid_simd)level);
+    mu_assert(used == (level < supported ? level : supported),
+              "ai_grid_simd_set: kernels the CPU runs.");
+    for (int count = 0; count <= 37; count++) {
+      int goal_x = my_random() % 2000 - 1000;
+      int goal_y = my_random() % 2000 - 1000;
+      for (int i = 0; i < count; i++) {
+        x[i] = my_random() % 2000 - 1000;
+        y[i] = my_random() % 2000 - 1000;
+      }
+      ai_grid_octile_distance_batch(x, y, count, goal_x, goal_y, costs);
+      for (int i = 0; i < count; i++) {
+        mu_assert(costs[i] == ai_grid_octile_distance(x[i], y[i], goal_x,
+                                                      goal_y),
+                  "ai_grid_octile_distance_batch: exact.");
+      }
+    }
+  }
+  ai_grid_simd_set(simd);
+  return NULL;
+}
+
+char *test_ai_grid_move_mask() {
+  ai_grid *grid = my_grid_constructor();
+  ai_grid_query query;
+  ai_grid_query_init(&query, grid, 0, 0);
+  for (int y = 0; y < GRID_HEIGHT; y++) {
+    for (int x = 0; x < GRID_WIDTH; x++) {
+      mu_assert(ai_grid_move_mask(&query, x, y) == my_move_mask(&query, x, y),
+                "ai_grid_move_mask: whole grid.");
+    }
+  }
+  // A rectangle inside the grid, with edges inside words.
+  query.min_x = 63;
+  query.min_y = 5;
+  query.max_x = 129;
+  query.max_y = 30;
+  for (int y = query.min_y; y < query.max_y; y++) {
+    for (int x = query.min_x; x < query.max_x; x++) {
+      mu_assert(ai_grid_move_mask(&query, x, y) == my_move_mask(&query, x, y),
+                "ai_grid_move_mask: rectangle.");
+    }
+  }
+  ai_grid_free(grid);
+
+  // A rectangle larger than the grid, with cells on and past its edges.
+  grid = ai_grid_constructor(8, 8);
+  for (int i = 0; i < 8; i++) {
+    ai_grid_blocked_set(grid, i, i, 1);
+  }
+  ai_grid_query_init(&query, grid, 0, 0);
+  query.min_x = -100;
+  query.min_y = -100;
+  query.max_x = 100;
+  query.max_y = 100;
+  for (int y = -2; y < 10; y++) {
+    for (int x = -2; x < 10; x++) {
+      mu_assert(ai_grid_move_mask(&query, x, y) == my_move_mask(&query, x, y),
+                "ai_grid_move_mask: larger than the grid.");
+    }
+  }
+  ai_grid_free(grid);
+  return NULL;
+}
+
+// Successors estimated by the kernels search as those estimated one at a
+// time.
+char *test_ai_grid_est_batch() {
+  ai_grid *grid = my_grid_constructor();
+  ai_model_state_evaluator single_evaluator = ai_grid_model_state_evaluator;
+  single_evaluator.goal_est_cost_batch_function = NULL;
+  ai_search_astar *single = ai_search_astar_constructor(&single_evaluator);
+  ai_search_astar *batch =
+      ai_search_astar_constructor(&ai_grid_model_state_evaluator);
+  int found_count = 0;
+  for (int i = 0; i < 30; i++) {
+    int x = my_random() % GRID_WIDTH;
+    int y = my_random() % GRID_HEIGHT;
+    ai_grid_query query;
+    ai_grid_query_init(&query, grid, my_random() % GRID_WIDTH,
+                       my_random() % GRID_HEIGHT);
+    ai_model_state *model_state = ai_grid_model_state_constructor(&query, x, y);
+    ai_path *single_path = single->find_path_to_goal(single, model_state);
+    ai_path *batch_path = batch->find_path_to_goal(batch, model_state);
+    mu_assert(batch->status == single->status &&
+                  batch->fringe_expansion_count ==
+                      single->fringe_expansion_count,
+              "ai_grid_est_batch: same search.");
+    ai_path *a = single_path;
+    ai_path *b = batch_path;
+    for (; a && b; a = a->next, b = b->next) {
+      mu_assert(memcmp(a->data, b->data, sizeof(ai_grid_action)) == 0,
+                "ai_grid_est_batch: same path.");
+    }
+    mu_assert(!a && !b, "ai_grid_est_batch: same length.");
+    found_count += batch->status == AI_SEARCH_STATUS_FOUND;
+    _ai_path_free(single_path, ai_grid_data_free);
+    _ai_path_free(batch_path, ai_grid_data_free);
+    ai_grid_data_free(model_state->data);
+    free(model_state);
+  }
+  mu_assert(found_count > 10, "ai_grid_est_batch: most found.");
+  ai_search_astar_free(single);
+  ai_search_astar_free(batch);
+  ai_grid_free(grid);
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test_ai_grid_octile_distance_batch);
+  mu_run_test(test_ai_grid_move_mask);
+  mu_run_test(test_ai_grid_est_batch);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
@@ -0,0 +1,255 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+// Custom
+#include <ai_pdb.h>
+#include <ai_search.h>
+#include <minunit.h>
+#include "test_puzzle_fixture.h"
+
+/*
+ * In the abstract 8-puzzle of a pattern, tiles outside the pattern are all
+ * MY_TILE_ANY, and moving one costs 0.
+ */
+#define MY_TILE_ANY 9
+#define MY_PATTERN_SIZE 4
+
+// The tiles of a pattern, as rank data.
+typedef struct my_pattern_struct {
+  int tile[MY_PATTERN_SIZE];
+} my_pattern;
+
+static my_pattern my_pattern_low = {{1, 2, 3, 4}};
+static my_pattern my_pattern_high = {{5, 6, 7, 8}};
+static ai_pdb *my_pdb_list[2];
+
+// Moves of the abstract puzzle, where moving MY_TILE_ANY costs 0.
+ai_successor *
+my_pattern_successor_function(ai_model_state *model_state,
+                              ai_transition_function transition_function) {
+  my_puzzle *data = (my_puzzle *)model_state->data;
+  int blank = 0;
+  while (data->cell[blank]) {
+    blank++;
+  }
+  ai_successor *head = my_successor_function(model_state, transition_function);
+  for (ai_successor *successor = head; successor; successor = successor->next) {
+    // The tile moved is now where the blank was.
+    my_puzzle *successor_data = (my_puzzle *)successor->model_state->data;
+    if (successor_data->cell[blank] == MY_TILE_ANY) {
+      successor->cost = 0.f;
+    }
+  }
+  return head;
+}
+
+// Moves that cost half as much, which a database can not hold.
+ai_successor *
+my_half_successor_function(ai_model_state *model_state,
+                           ai_transition_function transition_function) {
+  ai_successor *head = my_successor_function(model_state, transition_function);
+  for (ai_successor *successor = head; successor; successor = successor->next) {
+    successor->cost = 0.5f;
+  }
+  return head;
+}
+
+float my_no_est_cost_function(ai_model_state *model_state) { return 0; }
+
+float my_pdb_est_cost_function(ai_model_state *model_state) {
+  return ai_pdb_additive_est_cost(my_pdb_list, 2, model_state);
+}
+
+// Where the pattern's tiles are, as a number in base 9.
+uint64_t my_rank_function(void *rank_data, ai_model_state *model_state) {
+  my_pattern *pattern = (my_pattern *)rank_data;
+  my_puzzle *data = (my_puzzle *)model_state->data;
+  uint64_t rank = 0;
+  for (int i = MY_PATTERN_SIZE - 1; i >= 0; i--) {
+    int cell = 0;
+    while (data->cell[cell] != pattern->tile[i]) {
+      cell++;
+    }
+    rank = rank * 9 + cell;
+  }
+  return rank;
+}
+
+static ai_model_state_evaluator my_evaluator = {
+    .successor_function = my_pattern_successor_function,
+    .transition_function = my_transition_function,
+    .is_goal_state_function = my_is_goal_state_function,
+    .goal_est_cost_function = my_no_est_cost_function,
+    .model_state_data_duplicator = my_data_duplicator,
+    .model_state_data_free = my_data_free,
+    .action_data_duplicator = my_action_data_duplicator,
+    .action_data_free = my_data_free,
+    .model_state_hash_function = my_hash_function,
+    .model_state_equal_function = my_equal_function,
+};
+
+// The Goal, with the tiles outside the pattern made MY_TILE_ANY.
+ai_model_state *my_goal_constructor(my_pattern *pattern) {
+  my_puzzle *data = (my_puzzle *)malloc(sizeof(my_puzzle));
+  for (int i = 0; i < 9; i++) {
+    data->cell[i] = i ? MY_TILE_ANY : 0;
+  }
+  for (int i = 0; pattern && (i < MY_PATTERN_SIZE); i++) {
+    data->cell[pattern->tile[i]] = pattern->tile[i];
+  }
+  if (!pattern) {
+    for (int i = 0; i < 9; i++) {
+      data->cell[i] = i;
+    }
+  }
+  return ai_model_state_constructor(data);
+}
+
+ai_pdb *my_pdb_constructor(my_pattern *pattern, int bits) {
+  ai_model_state *goal = my_goal_constructor(pattern);
+  ai_pdb *pdb = ai_pdb_constructor(&my_evaluator, &goal, 1, 9 * 9 * 9 * 9,
+                                   bits, my_rank_function, pattern);
+  my_data_free(goal->data);
+  free(goal);
+  return pdb;
+}
+
+// Cost of the path found, and the expansions it took.
+float my_counted_astar_cost(ai_model_state *model_state,
+                            int *expansion_count) {
+  ai_search_astar *astar = ai_search_astar_constructor(&my_evaluator);
+  ai_path *path = astar->find_path_to_goal(astar, model_state);
+  float cost = -1;
+  if (astar->status == AI_SEARCH_STATUS_FOUND) {
+    cost = 0;
+    for (ai_path *action = path; action; action = action->next) {
+      cost++;
+    }
+  }
+  *expansion_count = astar->fringe_expansion_count;
+  _ai_path_free(path, my_data_free);
+  ai_search_astar_free(astar);
+  return cost;
+}
+
+char *test_ai_pdb_constructor() {
+  my_pdb_list[0] = my_pdb_constructor(&my_pattern_low, 4);
+  my_pdb_list[1] = my_pdb_constructor(&my_pattern_high, 4);
+  ai_pdb *pdb_8 = my_pdb_constructor(&my_pattern_low, 8);
+  mu_assert(my_pdb_list[0] && my_pdb_list[1] && pdb_8,
+            "ai_pdb_constructor: built.");
+  mu_assert(my_pdb_list[0]->value_max == 15 && pdb_8->value_max == 255,
+            "ai_pdb_constructor: packed.");
+  ai_model_state *goal = my_goal_constructor(NULL);
+  mu_assert(my_pdb_est_cost_function(goal) == 0,
+            "ai_pdb_additive_est_cost: 0 at the Goal.");
+  // The same distances, where 4 bits can hold them.
+  uint64_t reached = 0;
+  for (uint64_t rank = 0; rank < pdb_8->state_count; rank++) {
+    unsigned value = ai_pdb_value(pdb_8, rank);
+    mu_assert(ai_pdb_value(my_pdb_list[0], rank) == (value < 15 ? value : 15),
+              "ai_pdb_value: 4 and 8 bits agree.");
+    reached += value != 255;
+  }
+  // Ranks with two tiles on one cell are never reached.
+  mu_assert(reached == 9 * 8 * 7 * 6, "ai_pdb_constructor: every pattern.");
+  my_data_free(goal->data);
+  free(goal);
+  ai_pdb_free(pdb_8);
+
+  mu_assert(ai_pdb_constructor(&my_evaluator, NULL, 0, 10, 5, my_rank_function,
+                               NULL) == NULL,
+            "ai_pdb_constructor: bits not 4 or 8.");
+  ai_model_state_evaluator half_evaluator = my_evaluator;
+  half_evaluator.successor_function = my_half_successor_function;
+  goal = my_goal_constructor(&my_pattern_low);
+  mu_assert(ai_pdb_constructor(&half_evaluator, &goal, 1, 9 * 9 * 9 * 9, 4,
+                               my_rank_function, &my_pattern_low) == NULL,
+            "ai_pdb_constructor: cost not a whole number.");
+  my_data_free(goal->data);
+  free(goal);
+  return NULL;
+}
+
+char *test_ai_pdb_est_cost() {
+  int plain_total = 0;
+  int pdb_total = 0;
+  for (int i = 0; i < 10; i++) {
+    ai_model_state *model_state = my_scramble(14 + i);
+    int plain_count = 0;
+    int pdb_count = 0;
+    my_evaluator.goal_est_cost_function = my_no_est_cost_function;
+    float plain_cost = my_counted_astar_cost(model_state, &plain_count);
+    my_evaluator.goal_est_cost_function = my_pdb_est_cost_function;
+    float pdb_cost = my_counted_astar_cost(model_state, &pdb_count);
+    mu_assert(my_pdb_est_cost_function(model_state) <= plain_cost,
+              "ai_pdb_additive_est_cost: never over-estimates.");
+    mu_assert(pdb_cost == plain_cost, "ai_pdb_est_cost: optimal path.");
+    plain_total += plain_count;
+    pdb_total += pdb_count;
+    my_data_free(model_state->data);
+    free(model_state);
+  }
+  my_evaluator.goal_est_cost_function = my_no_est_cost_function;
+  mu_assert(pdb_total * 5 < plain_total,
+            "ai_pdb_est_cost: far fewer expansions.");
+  return NULL;
+}
+
+char *test_ai_pdb_load() {
+  char file_name[] = "/tmp/test_ai_pdb_XXXXXX";
+  int fd = mkstemp(file_name);
+  mu_assert(fd >= 0, "mkstemp: temporary file.");
+  FILE *file = fdopen(fd, "wb");
+  mu_assert(ai_pdb_save(my_pdb_list[0], file) == 0, "ai_pdb_save: saved.");
+  fclose(file);
+  ai_pdb *loaded = ai_pdb_load(file_name, my_rank_function, &my_pattern_low);
+  mu_assert(loaded && loaded->block_mapped && loaded->bits == 4 &&
+                loaded->state_count == my_pdb_list[0]->state_count,
+            "ai_pdb_load: mapped.");
+  for (uint64_t rank = 0; rank < loaded->state_count; rank++) {
+    mu_assert(ai_pdb_value(loaded, rank) == ai_pdb_value(my_pdb_list[0], rank),
+              "ai_pdb_load: same table.");
+  }
+  ai_pdb_free(loaded);
+
+  // Not a saved database.
+  file = fopen(file_name, "r+b");
+  fwrite("XXXX", 1, 4, file);
+  fclose(file);
+  mu_assert(ai_pdb_load(file_name, my_rank_function, NULL) == NULL,
+            "ai_pdb_load: bad magic.");
+
+  // A header alone, with a state count whose table size wraps to 0.
+  struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t bits;
+    uint32_t reserved;
+    uint64_t state_count;
+  } header = {{'A', 'I', 'P', 'D'}, 1, 4, 0, UINT64_MAX};
+  file = fopen(file_name, "wb");
+  fwrite(&header, sizeof(header), 1, file);
+  fclose(file);
+  mu_assert(ai_pdb_load(file_name, my_rank_function, NULL) == NULL,
+            "ai_pdb_load: state count too large.");
+  unlink(file_name);
+  ai_pdb_free(my_pdb_list[0]);
+  ai_pdb_free(my_pdb_list[1]);
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test_ai_pdb_constructor);
+  mu_run_test(test_ai_pdb_est_cost);
+  mu_run_test(test_ai_pdb_load);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
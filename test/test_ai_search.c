@@ -273,6 +273,54 @@ char *test__ai_fringe_element_list_pop() {
   return NULL;
 }
 
+/*
+ * Test _ai_fringe_element_list_prune.
+ */
+int _ai_fringe_element_list_prune(ai_fringe_element **fringe_element_list,
+                                  size_t memory_budget, size_t *memory_kept,
+                                  ai_model_state_data_free model_state_data_free,
+                                  ai_action_data_free action_data_free);
+char *test__ai_fringe_element_list_prune() {
+
+  // Setup
+  ai_fringe_element *list = NULL;
+  ai_fringe_element *node1 =
+      ai_fringe_element_constructor(NULL, NULL, 0.0f, 1.0f);
+  ai_fringe_element *node2 =
+      ai_fringe_element_constructor(NULL, NULL, 0.0f, 2.0f);
+  ai_fringe_element *node3 =
+      ai_fringe_element_constructor(NULL, NULL, 0.0f, 3.0f);
+  node1->memory_size = node2->memory_size = node3->memory_size = 100;
+  _ai_fringe_element_list_add_by_total_cost(&list, node1);
+  _ai_fringe_element_list_add_by_total_cost(&list, node2);
+  _ai_fringe_element_list_add_by_total_cost(&list, node3);
+  size_t kept = 0;
+
+  // Run 1 - room for two
+  int pruned = _ai_fringe_element_list_prune(&list, 250, &kept, NULL, NULL);
+
+  // Test 1
+  mu_assert(pruned == 1, "_ai_fringe_element_list_prune: test1 : pruned 1.");
+  mu_assert(kept == 200, "_ai_fringe_element_list_prune: test1 : kept 200.");
+  mu_assert(list == node1, "_ai_fringe_element_list_prune: test1 : node1.");
+  mu_assert(list->next == node2,
+            "_ai_fringe_element_list_prune: test1 : node2.");
+  mu_assert(list->next->next == NULL,
+            "_ai_fringe_element_list_prune: test1 : node3 gone.");
+
+  // Run 2 - room for none, the head is kept regardless
+  pruned = _ai_fringe_element_list_prune(&list, 10, &kept, NULL, NULL);
+
+  // Test 2
+  mu_assert(pruned == 1, "_ai_fringe_element_list_prune: test2 : pruned 1.");
+  mu_assert(kept == 100, "_ai_fringe_element_list_prune: test2 : kept 100.");
+  mu_assert(list == node1, "_ai_fringe_element_list_prune: test2 : node1.");
+  mu_assert(list->next == NULL,
+            "_ai_fringe_element_list_prune: test2 : node2 gone.");
+  free(node1);
+  return NULL;
+}
+
 /*
  * Test ai_search_astar_constructor.
  */
@@ -289,6 +337,12 @@ char *test_ai_search_astar_constructor() {
             "ai_search_astar_constructor: fringe_expansion_count.");
   mu_assert(astar->fringe_expansion_max == 0,
             "ai_search_astar_constructor: fringe_expansion_max.");
+  mu_assert(astar->memory_budget == 0,
+            "ai_search_astar_constructor: memory_budget.");
+  mu_assert(astar->memory_policy == AI_SEARCH_MEMORY_POLICY_ABORT,
+            "ai_search_astar_constructor: memory_policy.");
+  mu_assert(astar->status == AI_SEARCH_STATUS_IDLE,
+            "ai_search_astar_constructor: status.");
 
   return NULL;
 }
@@ -307,6 +361,7 @@ char *all_tests() {
   mu_run_test(test_ai_fringe_element_constructor);
   mu_run_test(test__ai_fringe_element_list_add_by_total_cost);
   mu_run_test(test__ai_fringe_element_list_pop);
+  mu_run_test(test__ai_fringe_element_list_prune);
   mu_run_test(test_ai_search_astar_constructor);
   return NULL;
 }
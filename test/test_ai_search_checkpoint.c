@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+// Custom
+#include <ai_search.h>
+#include <minunit.h>
+#include "test_puzzle_fixture.h"
+
+static char my_file_name[] = "/tmp/test_ai_search_checkpoint_XXXXXX";
+
+// An action of the 8-puzzle packs into an int.
+void my_action_pack_function(ai_action *action, void *bytes) {
+  memcpy(bytes, action->data, sizeof(int));
+}
+
+void *my_action_unpack_function(const void *bytes) {
+  return my_action_data_duplicator((void *)bytes);
+}
+
+static ai_model_state_evaluator my_evaluator = {
+    .successor_function = my_successor_function,
+    .transition_function = my_transition_function,
+    .is_goal_state_function = my_is_goal_state_function,
+    .goal_est_cost_function = my_goal_est_cost_function,
+    .model_state_data_duplicator = my_data_duplicator,
+    .model_state_data_free = my_data_free,
+    .action_data_duplicator = my_action_data_duplicator,
+    .action_data_free = my_data_free,
+    .model_state_hash_function = my_hash_function,
+    .model_state_equal_function = my_equal_function,
+    .model_state_packed_size = sizeof(my_puzzle),
+    .model_state_pack_function = my_pack_function,
+    .model_state_unpack_function = my_unpack_function,
+    .action_packed_size = sizeof(int),
+    .action_pack_function = my_action_pack_function,
+    .action_unpack_function = my_action_unpack_function,
+};
+
+// Whether two paths take the same actions.
+int my_path_equal(ai_path *path_a, ai_path *path_b) {
+  for (; path_a && path_b; path_a = path_a->next, path_b = path_b->next) {
+    if (*(int *)path_a->data != *(int *)path_b->data) {
+      return 0;
+    }
+  }
+  return !path_a && !path_b;
+}
+
+char *test_ai_search_astar_checkpoint_resume() {
+  int fd = mkstemp(my_file_name);
+  mu_assert(fd >= 0, "mkstemp: temporary file.");
+  close(fd);
+  ai_model_state_evaluator open_evaluator = my_evaluator;
+  open_evaluator.model_state_hash_function = NULL;
+  open_evaluator.model_state_equal_function = NULL;
+  ai_model_state_evaluator *evaluator_list[2] = {&my_evaluator,
+                                                 &open_evaluator};
+  for (int e = 0; e < 2; e++) {
+    ai_model_state *model_state = my_scramble(e ? 16 : 60);
+    ai_search_astar *astar = ai_search_astar_constructor(evaluator_list[e]);
+    ai_search_astar_begin(astar, model_state);
+    mu_assert(ai_search_astar_step(astar, 5) == AI_SEARCH_STATUS_RUNNING,
+              "ai_search_astar_step: part way.");
+    mu_assert(ai_search_astar_checkpoint(astar, my_file_name) == 0 &&
+                  astar->checkpoint_count == 1,
+              "ai_search_astar_checkpoint: saved.");
+    ai_search_astar_step(astar, 0);
+    ai_path *path = ai_search_astar_end(astar);
+    mu_assert(astar->status == AI_SEARCH_STATUS_FOUND,
+              "ai_search_astar: found.");
+
+    ai_search_astar *resumed = ai_search_astar_constructor(evaluator_list[e]);
+    mu_assert(ai_search_resume(resumed, my_file_name) == 0,
+              "ai_search_resume: loaded.");
+    mu_assert(resumed->status == AI_SEARCH_STATUS_RUNNING &&
+                  resumed->fringe_expansion_count == 5,
+              "ai_search_resume: where it was.");
+    mu_assert((resumed->closed != NULL) == (e == 0),
+              "ai_search_resume: closed table.");
+    ai_search_astar_step(resumed, 0);
+    ai_path *resumed_path = ai_search_astar_end(resumed);
+    mu_assert(resumed->status == AI_SEARCH_STATUS_FOUND &&
+                  my_path_equal(path, resumed_path),
+              "ai_search_resume: same path.");
+    mu_assert(resumed->fringe_expansion_count ==
+                  astar->fringe_expansion_count,
+              "ai_search_resume: same expansions.");
+    mu_assert(resumed->memory_peak == astar->memory_peak,
+              "ai_search_resume: same memory.");
+    _ai_path_free(path, my_data_free);
+    _ai_path_free(resumed_path, my_data_free);
+    ai_search_astar_free(astar);
+    ai_search_astar_free(resumed);
+    my_data_free(model_state->data);
+    free(model_state);
+  }
+  return NULL;
+}
+
+char *test_ai_search_astar_checkpoint_interval() {
+  my_random_seed = 3;
+  ai_model_state *model_state = my_scramble(60);
+  ai_search_astar *astar = ai_search_astar_constructor(&my_evaluator);
+  ai_path *path = astar->find_path_to_goal(astar, model_state);
+  int expansion_count = astar->fringe_expansion_count;
+  ai_search_astar_free(astar);
+
+  // Run to a limit, as if stopped, checkpointing as it goes.
+  astar = ai_search_astar_constructor(&my_evaluator);
+  astar->checkpoint_file_name = my_file_name;
+  astar->checkpoint_interval = 25;
+  astar->fringe_expansion_max = expansion_count / 2;
+  ai_search_astar_begin(astar, model_state);
+  mu_assert(ai_search_astar_step(astar, 0) ==
+                AI_SEARCH_STATUS_EXPANSION_LIMIT,
+            "ai_search_astar_step: stopped.");
+  mu_assert(astar->checkpoint_count == expansion_count / 2 / 25,
+            "ai_search_astar_step: checkpoints.");
+  ai_search_astar_free(astar);
+
+  // The settings of the resuming search apply.
+  astar = ai_search_astar_constructor(&my_evaluator);
+  mu_assert(ai_search_resume(astar, my_file_name) == 0 &&
+                astar->fringe_expansion_count ==
+                    expansion_count / 2 / 25 * 25,
+            "ai_search_resume: last checkpoint.");
+  ai_search_astar_step(astar, 0);
+  ai_path *resumed_path = ai_search_astar_end(astar);
+  mu_assert(astar->status == AI_SEARCH_STATUS_FOUND &&
+                my_path_equal(path, resumed_path) &&
+                astar->fringe_expansion_count == expansion_count,
+            "ai_search_resume: same search.");
+  _ai_path_free(path, my_data_free);
+  _ai_path_free(resumed_path, my_data_free);
+  ai_search_astar_free(astar);
+  my_data_free(model_state->data);
+  free(model_state);
+  return NULL;
+}
+
+// Checkpoints of a bucket fringe, saved as it goes, leave it as it was, and
+// resume into a bucket fringe.
+char *test_ai_search_astar_checkpoint_bucket() {
+  my_random_seed = 5;
+  ai_model_state *model_state = my_scramble(60);
+  ai_search_astar *astar = ai_search_astar_constructor(&my_evaluator);
+  astar->tie_break = AI_SEARCH_TIE_BREAK_HIGH_G;
+  ai_path *path = astar->find_path_to_goal(astar, model_state);
+  int expansion_count = astar->fringe_expansion_count;
+  ai_search_astar_free(astar);
+
+  astar = ai_search_astar_constructor(&my_evaluator);
+  astar->tie_break = AI_SEARCH_TIE_BREAK_HIGH_G;
+  astar->fringe_bucket_width = 1;
+  astar->checkpoint_file_name = my_file_name;
+  astar->checkpoint_interval = 25;
+  ai_path *bucket_path = astar->find_path_to_goal(astar, model_state);
+  mu_assert(astar->status == AI_SEARCH_STATUS_FOUND &&
+                my_path_equal(path, bucket_path) &&
+                astar->fringe_expansion_count == expansion_count &&
+                astar->checkpoint_count == expansion_count / 25,
+            "ai_search_astar_checkpoint: bucket fringe unchanged.");
+  ai_search_astar_free(astar);
+
+  astar = ai_search_astar_constructor(&my_evaluator);
+  astar->tie_break = AI_SEARCH_TIE_BREAK_HIGH_G;
+  astar->fringe_bucket_width = 1;
+  mu_assert(ai_search_resume(astar, my_file_name) == 0,
+            "ai_search_resume: bucket fringe loaded.");
+  ai_search_astar_step(astar, 0);
+  ai_path *resumed_path = ai_search_astar_end(astar);
+  mu_assert(astar->status == AI_SEARCH_STATUS_FOUND &&
+                my_path_equal(path, resumed_path) &&
+                astar->fringe_expansion_count == expansion_count,
+            "ai_search_resume: bucket fringe, same search.");
+  _ai_path_free(path, my_data_free);
+  _ai_path_free(bucket_path, my_data_free);
+  _ai_path_free(resumed_path, my_data_free);
+  ai_search_astar_free(astar);
+  my_data_free(model_state->data);
+  free(model_state);
+  return NULL;
+}
+
+char *test_ai_search_astar_checkpoint_multi_goal() {
+  ai_model_state *model_state = my_scramble(30);
+  ai_model_state *goal_list[3] = {my_scramble(5), my_scramble(20),
+                                  my_scramble(35)};
+  ai_path *paths[3];
+  float costs[3];
+  ai_search_astar *astar = ai_search_astar_constructor(&my_evaluator);
+  ai_search_astar_find_paths_to_goals(astar, model_state, goal_list, 3, paths,
+                                      costs);
+  ai_search_astar_free(astar);
+
+  astar = ai_search_astar_constructor(&my_evaluator);
+  ai_search_astar_begin_multi_goal(astar, model_state, goal_list, 3);
+  mu_assert(ai_search_astar_step(astar, 200) == AI_SEARCH_STATUS_RUNNING,
+            "ai_search_astar_step: multi-goal part way.");
+  mu_assert(ai_search_astar_checkpoint(astar, my_file_name) == 0,
+            "ai_search_astar_checkpoint: multi-goal saved.");
+  ai_search_astar_free(astar);
+  astar = ai_search_astar_constructor(&my_evaluator);
+  mu_assert(ai_search_resume(astar, my_file_name) == 0,
+            "ai_search_resume: multi-goal loaded.");
+  ai_search_astar_step(astar, 0);
+  ai_search_astar_end(astar);
+  for (int i = 0; i < 3; i++) {
+    ai_path *path;
+    float cost;
+    mu_assert(ai_search_astar_take_goal_path(astar, i, &path, &cost) == 0 &&
+                  cost == costs[i] && my_path_equal(path, paths[i]),
+              "ai_search_resume: same Goal paths.");
+    _ai_path_free(path, my_data_free);
+    _ai_path_free(paths[i], my_data_free);
+    my_data_free(goal_list[i]->data);
+    free(goal_list[i]);
+  }
+  ai_search_astar_free(astar);
+  my_data_free(model_state->data);
+  free(model_state);
+  return NULL;
+}
+
+char *test_ai_search_resume_error() {
+  ai_search_astar *astar = ai_search_astar_constructor(&my_evaluator);
+  // A search of another evaluator.
+  ai_model_state_evaluator open_evaluator = my_evaluator;
+  open_evaluator.model_state_hash_function = NULL;
+  mu_assert(ai_search_resume(astar, my_file_name) == 0,
+            "ai_search_resume: loaded.");
+  ai_search_astar *open = ai_search_astar_constructor(&open_evaluator);
+  mu_assert(ai_search_resume(open, my_file_name) == -1 &&
+                open->status == AI_SEARCH_STATUS_IDLE,
+            "ai_search_resume: another evaluator.");
+  ai_search_astar_free(open);
+
+  // Actions that can not be packed.
+  open_evaluator = my_evaluator;
+  open_evaluator.action_pack_function = NULL;
+  open = ai_search_astar_constructor(&open_evaluator);
+  mu_assert(ai_search_astar_checkpoint(open, my_file_name) == -1,
+            "ai_search_astar_checkpoint: actions must pack.");
+  ai_search_astar_free(open);
+
+  // Not a checkpoint.
+  FILE *file = fopen(my_file_name, "r+b");
+  fwrite("XXXX", 1, 4, file);
+  fclose(file);
+  mu_assert(ai_search_resume(astar, my_file_name) == -1 &&
+                astar->status == AI_SEARCH_STATUS_IDLE &&
+                astar->fringe_list == NULL && astar->closed == NULL,
+            "ai_search_resume: bad magic.");
+  mu_assert(ai_search_resume(astar, "/nonexistent/checkpoint") == -1,
+            "ai_search_resume: no file.");
+  ai_search_astar_free(astar);
+  unlink(my_file_name);
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test_ai_search_astar_checkpoint_resume);
+  mu_run_test(test_ai_search_astar_checkpoint_interval);
+  mu_run_test(test_ai_search_astar_checkpoint_bucket);
+  mu_run_test(test_ai_search_astar_checkpoint_multi_goal);
+  mu_run_test(test_ai_search_resume_error);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
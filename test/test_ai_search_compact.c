@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// Custom
+#include <ai_search.h>
+#include <ai_search_compact.h>
+#include <ai_state_intern.h>
+#include <minunit.h>
+#include "test_ring_fixture.h"
+
+static ai_model_state_evaluator my_evaluator = {
+    .successor_function = my_successor_function,
+    .transition_function = my_transition_function,
+    .is_goal_state_function = my_is_goal_state_function,
+    .goal_est_cost_function = my_goal_est_cost_function,
+    .model_state_data_duplicator = my_data_duplicator,
+    .model_state_data_free = my_data_free,
+    .action_data_duplicator = my_action_data_duplicator,
+    .action_data_free = my_data_free,
+    .model_state_hash_function = my_hash_function,
+    .model_state_equal_function = my_equal_function,
+    .model_state_packed_size = sizeof(my_puzzle),
+    .model_state_pack_function = my_pack_function,
+    .model_state_unpack_function = my_unpack_function,
+};
+
+/*
+ * A Zobrist hash of the puzzle: a random word for each tile in each cell,
+ * XORed together, so a move updates the hash with four words.
+ */
+static size_t my_zobrist[9][9];
+static int my_hash_count = 0;
+
+void my_zobrist_init() {
+  for (int cell = 0; cell < 9; cell++) {
+    for (int tile = 0; tile < 9; tile++) {
+      my_zobrist[cell][tile] = ((size_t)my_random() << 45) ^
+                               ((size_t)my_random() << 30) ^
+                               ((size_t)my_random() << 15) ^ my_random();
+    }
+  }
+}
+
+size_t my_zobrist_hash_function(ai_model_state *model_state) {
+  my_puzzle *data = (my_puzzle *)model_state->data;
+  size_t hash = 0;
+  my_hash_count++;
+  for (int i = 0; i < 9; i++) {
+    hash ^= my_zobrist[i][data->cell[i]];
+  }
+  return hash;
+}
+
+// The tile in cell to swaps with the blank.
+size_t my_zobrist_hash_update_function(size_t hash,
+                                       ai_model_state *model_state,
+                                       ai_action *action) {
+  my_puzzle *data = (my_puzzle *)model_state->data;
+  int to = *(int *)action->data;
+  int blank = 0;
+  while (data->cell[blank]) {
+    blank++;
+  }
+  int tile = data->cell[to];
+  return hash ^ my_zobrist[blank][0] ^ my_zobrist[blank][tile] ^
+         my_zobrist[to][tile] ^ my_zobrist[to][0];
+}
+
+// Each state is held once, by id, across growth of the table.
+char *test_ai_state_intern() {
+  ai_model_state_evaluator unpacked_evaluator = my_evaluator;
+  unpacked_evaluator.model_state_pack_function = NULL;
+  mu_assert(ai_state_intern_constructor(&unpacked_evaluator) == NULL,
+            "ai_state_intern_constructor: states must pack.");
+  ai_state_intern *intern = ai_state_intern_constructor(&my_evaluator);
+  int added = 0;
+  for (int i = 0; i < 5000; i++) {
+    ai_model_state *model_state = my_scramble(i % 40);
+    uint32_t id = ai_state_intern_add_model_state(intern, model_state, &added);
+    mu_assert(id != AI_STATE_INTERN_NONE &&
+                  ai_state_intern_find(intern, model_state->data) == id,
+              "ai_state_intern: found by its bytes.");
+    mu_assert(!added || (id == intern->count - 1),
+              "ai_state_intern: ids in order of arrival.");
+    ai_model_state *unpacked = ai_state_intern_model_state(intern, id);
+    mu_assert(memcmp(unpacked->data, model_state->data, sizeof(my_puzzle)) ==
+                  0,
+              "ai_state_intern: unpacked.");
+    my_data_free(unpacked->data);
+    free(unpacked);
+    my_data_free(model_state->data);
+    free(model_state);
+  }
+  mu_assert(intern->count > 1024 && intern->count < 5000,
+            "ai_state_intern: duplicates held once.");
+
+  // Adding a held state again adds nothing.
+  uint32_t count = intern->count;
+  mu_assert(ai_state_intern_add(intern, ai_state_intern_bytes(intern, 7),
+                                &added) == 7 &&
+                !added && intern->count == count,
+            "ai_state_intern: held once.");
+  my_puzzle goal = {{0, 1, 2, 3, 4, 5, 6, 7, 8}};
+  size_t memory_used = ai_state_intern_memory_used(intern);
+  ai_state_intern_clear(intern);
+  mu_assert(intern->count == 0 &&
+                ai_state_intern_find(intern, &goal) == AI_STATE_INTERN_NONE &&
+                ai_state_intern_memory_used(intern) == memory_used,
+            "ai_state_intern: cleared, memory kept.");
+  ai_state_intern_free(intern);
+  return NULL;
+}
+
+char *test_ai_search_compact_constructor() {
+  ai_model_state_evaluator unpacked_evaluator = my_evaluator;
+  unpacked_evaluator.model_state_unpack_function = NULL;
+  mu_assert(ai_search_compact_constructor(&unpacked_evaluator) == NULL,
+            "ai_search_compact_constructor: states must pack.");
+  ai_search_compact *compact = ai_search_compact_constructor(&my_evaluator);
+  mu_assert(compact && (compact->fringe_expansion_max == 0) &&
+                (compact->status == AI_SEARCH_STATUS_IDLE),
+            "ai_search_compact_constructor: defaults.");
+  ai_search_compact_free(compact);
+  return NULL;
+}
+
+char *test_ai_search_compact_find_path() {
+  ai_search_compact *compact = ai_search_compact_constructor(&my_evaluator);
+  size_t memory_used = 0;
+  for (int i = 0; i < 8; i++) {
+    ai_model_state *model_state = my_scramble(30 + i * 5);
+    float astar_cost = my_astar_cost(&my_evaluator, model_state);
+    ai_path *path = compact->find_path_to_goal(compact, model_state);
+    mu_assert(compact->status == AI_SEARCH_STATUS_FOUND,
+              "ai_search_compact: found.");
+    mu_assert(compact->path_cost == astar_cost, "ai_search_compact: optimal.");
+    mu_assert(my_path_cost(&my_evaluator, model_state, path) == astar_cost,
+              "ai_search_compact: path to the Goal.");
+    mu_assert(compact->node_count > (uint32_t)compact->fringe_expansion_count,
+              "ai_search_compact: states counted.");
+    // 16 bytes of node and 9 of state, with room in the arrays to grow.
+    mu_assert(compact->memory_used >= compact->node_count * 25 &&
+                  compact->memory_used < compact->node_count * 25 * 8 + 65536,
+              "ai_search_compact: memory used.");
+    memory_used = compact->memory_used > memory_used ? compact->memory_used
+                                                     : memory_used;
+    _ai_path_free(path, my_data_free);
+    my_data_free(model_state->data);
+    free(model_state);
+  }
+
+  // The arrays are kept, so an easy search after a hard one uses no more.
+  ai_model_state *model_state = my_scramble(4);
+  ai_path *path = compact->find_path_to_goal(compact, model_state);
+  mu_assert(compact->status == AI_SEARCH_STATUS_FOUND &&
+                compact->memory_used == memory_used,
+            "ai_search_compact: arrays kept.");
+  _ai_path_free(path, my_data_free);
+  my_data_free(model_state->data);
+  free(model_state);
+  ai_search_compact_free(compact);
+  return NULL;
+}
+
+// Costs that differ, so that states are reached again more cheaply.
+char *test_ai_search_compact_directed() {
+  ai_search_compact *compact =
+      ai_search_compact_constructor(&my_ring_evaluator);
+  for (int node = 1; node < MY_RING_SIZE; node += 17) {
+    ai_model_state *model_state =
+        ai_model_state_constructor(my_action_data_duplicator(&node));
+    float astar_cost = my_astar_cost(&my_ring_evaluator, model_state);
+    ai_path *path = compact->find_path_to_goal(compact, model_state);
+    mu_assert(compact->status == AI_SEARCH_STATUS_FOUND &&
+                  compact->path_cost == astar_cost,
+              "ai_search_compact: optimal when directed.");
+    mu_assert(my_path_cost(&my_ring_evaluator, model_state, path) ==
+                  astar_cost,
+              "ai_search_compact: directed path.");
+    _ai_path_free(path, my_data_free);
+    my_data_free(model_state->data);
+    free(model_state);
+  }
+  ai_search_compact_free(compact);
+  return NULL;
+}
+
+// With a hash update function only the initial state is hashed whole.
+char *test_ai_search_compact_hash_update() {
+  my_zobrist_init();
+  ai_model_state_evaluator zobrist_evaluator = my_evaluator;
+  zobrist_evaluator.model_state_hash_function = my_zobrist_hash_function;
+  zobrist_evaluator.model_state_hash_update_function =
+      my_zobrist_hash_update_function;
+  ai_search_compact *compact = ai_search_compact_constructor(&my_evaluator);
+  ai_search_compact *zobrist =
+      ai_search_compact_constructor(&zobrist_evaluator);
+  ai_search_astar *astar = ai_search_astar_constructor(&zobrist_evaluator);
+  for (int i = 0; i < 6; i++) {
+    ai_model_state *model_state = my_scramble(30 + i * 5);
+    float astar_cost = my_astar_cost(&my_evaluator, model_state);
+    ai_path *path = compact->find_path_to_goal(compact, model_state);
+    _ai_path_free(path, my_data_free);
+
+    my_hash_count = 0;
+    path = zobrist->find_path_to_goal(zobrist, model_state);
+    mu_assert(zobrist->status == AI_SEARCH_STATUS_FOUND &&
+                  zobrist->path_cost == astar_cost &&
+                  my_path_cost(&my_evaluator, model_state, path) ==
+                      astar_cost,
+              "ai_search_compact: optimal with hash update.");
+    mu_assert(zobrist->node_count == compact->node_count &&
+                  zobrist->fringe_expansion_count ==
+                      compact->fringe_expansion_count,
+              "ai_search_compact: same search with hash update.");
+    mu_assert(my_hash_count == 1,
+              "ai_search_compact: initial state hashed whole.");
+    _ai_path_free(path, my_data_free);
+
+    my_hash_count = 0;
+    path = astar->find_path_to_goal(astar, model_state);
+    mu_assert(astar->status == AI_SEARCH_STATUS_FOUND &&
+                  my_path_cost(&my_evaluator, model_state, path) ==
+                      astar_cost,
+              "ai_search_astar: optimal with hash update.");
+    mu_assert(my_hash_count == 1,
+              "ai_search_astar: initial state hashed whole.");
+    _ai_path_free(path, my_data_free);
+    my_data_free(model_state->data);
+    free(model_state);
+  }
+  ai_search_astar_free(astar);
+  ai_search_compact_free(zobrist);
+  ai_search_compact_free(compact);
+  return NULL;
+}
+
+char *test_ai_search_compact_status() {
+  ai_search_compact *compact = ai_search_compact_constructor(&my_evaluator);
+  ai_model_state *model_state = my_scramble(0);
+  ai_path *path = compact->find_path_to_goal(compact, model_state);
+  mu_assert(!path && compact->status == AI_SEARCH_STATUS_FOUND &&
+                compact->path_cost == 0,
+            "ai_search_compact: at the Goal.");
+
+  // Swapping two tiles leaves half the states, without the Goal.
+  my_puzzle *data = (my_puzzle *)model_state->data;
+  data->cell[1] = 2;
+  data->cell[2] = 1;
+  path = compact->find_path_to_goal(compact, model_state);
+  mu_assert(!path && compact->status == AI_SEARCH_STATUS_NOT_FOUND &&
+                compact->node_count == 181440,
+            "ai_search_compact: NOT_FOUND.");
+
+  // Stopped part way.
+  compact->fringe_expansion_max = 10;
+  path = compact->find_path_to_goal(compact, model_state);
+  mu_assert(!path && compact->status == AI_SEARCH_STATUS_EXPANSION_LIMIT &&
+                compact->fringe_expansion_count == 10,
+            "ai_search_compact: expansion limit.");
+  my_data_free(model_state->data);
+  free(model_state);
+  ai_search_compact_free(compact);
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test_ai_state_intern);
+  mu_run_test(test_ai_search_compact_constructor);
+  mu_run_test(test_ai_search_compact_find_path);
+  mu_run_test(test_ai_search_compact_directed);
+  mu_run_test(test_ai_search_compact_hash_update);
+  mu_run_test(test_ai_search_compact_status);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
@@ -14,6 +14,9 @@
  */
 
 #include <ai_search.h>
+#include <ai_search_beam.h>
+#include <ai_search_sma.h>
+#include <ai_state_table.h>
 #include <math.h>
 #include <minunit.h>
 #include <stdio.h>
@@ -224,7 +227,9 @@ int my_is_goal_state_function(ai_model_state *model_state) {
  * It must NEVER over estimate the cost.
  * In this implementation the straight line distance is used.
  */
+static int my_goal_est_cost_count = 0;
 float my_goal_est_cost_function(ai_model_state *model_state) {
+  my_goal_est_cost_count++;
   my_model_state_data *data = (my_model_state_data *)(model_state->data);
   char *node_name = data->node_name;
   my_node_data_set *node_data =
@@ -235,6 +240,8 @@ float my_goal_est_cost_function(ai_model_state *model_state) {
   return node_data->heuristic;
 }
 
+void _ai_path_free(ai_path *ptr, ai_action_data_free action_data_free);
+
 // Setup
 static ai_model_state_evaluator evaluator = {
     .successor_function = my_successor_function,
@@ -247,6 +254,57 @@ static ai_model_state_evaluator evaluator = {
     .action_data_free = my_action_data_free,
 };
 
+// Hash the node name of the Model State.
+size_t my_model_state_hash_function(ai_model_state *model_state) {
+  size_t hash = 5381;
+  for (char *c = ((my_model_state_data *)model_state->data)->node_name; *c;
+       c++) {
+    hash = hash * 33 + *c;
+  }
+  return hash;
+}
+
+// Model States are equal if at the same node.
+int my_model_state_equal_function(ai_model_state *model_state_a,
+                                  ai_model_state *model_state_b) {
+  return strcmp(((my_model_state_data *)model_state_a->data)->node_name,
+                ((my_model_state_data *)model_state_b->data)->node_name) == 0;
+}
+
+// The estimated cost between two nodes. Only distances to G are known.
+float my_state_est_cost_function(ai_model_state *model_state,
+                                 ai_model_state *goal_model_state) {
+  my_model_state_data *goal_data =
+      (my_model_state_data *)(goal_model_state->data);
+  if (strcmp(goal_data->node_name, "G") != 0) {
+    return 0.0f;
+  }
+  return my_goal_est_cost_function(model_state);
+}
+
+// As evaluator, but each state is expanded at most once.
+static ai_model_state_evaluator closed_evaluator = {
+    .successor_function = my_successor_function,
+    .transition_function = my_transition_function,
+    .is_goal_state_function = my_is_goal_state_function,
+    .goal_est_cost_function = my_goal_est_cost_function,
+    .model_state_data_duplicator = my_model_state_data_duplicator,
+    .model_state_data_free = my_model_state_data_free,
+    .action_data_duplicator = my_action_data_duplicator,
+    .action_data_free = my_action_data_free,
+    .model_state_hash_function = my_model_state_hash_function,
+    .model_state_equal_function = my_model_state_equal_function,
+    .state_est_cost_function = my_state_est_cost_function,
+};
+
+// The distance to the node in the search's closed table, or -1.
+float _my_distance(ai_search_astar *astar, char *node_name) {
+  my_model_state_data data = {.node_name = node_name};
+  ai_model_state model_state = {.data = &data};
+  ai_state_table_entry *entry = ai_state_table_find(astar->closed, &model_state);
+  return entry ? entry->cost : -1.0f;
+}
+
 /*
  * Demo AStar search.
  * Already at a Goal. Returned Path contains no actions.
@@ -316,6 +374,261 @@ char *test_ai_search_demo_multi(void) {
   return NULL;
 }
 
+/*
+ * Demo SMA* search.
+ * With room for the whole tree, and with barely room for the optimal path,
+ * the optimal path S->A->D->G is found.
+ */
+char *test_ai_search_sma_demo_multi(void) {
+
+  // Setup
+  static my_model_state_data model_state_data = {
+      .node_name = "S",
+  };
+  ai_model_state *model_state = ai_model_state_constructor(&model_state_data);
+  int node_max_list[] = {100, 5};
+  for (int i = 0; i < 2; i++) {
+    ai_search_sma *sma = ai_search_sma_constructor(&evaluator, node_max_list[i]);
+    // Run
+    ai_path *path = sma->find_path_to_goal(sma, model_state);
+    // Test
+    mu_assert(sma->status == AI_SEARCH_STATUS_FOUND,
+              "ai_search_sma_demo_multi: FOUND.");
+    mu_assert(path != NULL, "ai_search_sma_demo_multi: action[0] NOT NULL.");
+    mu_assert(strcmp(((my_action_data *)path->data)->node_name, "A") == 0,
+              "ai_search_sma_demo_multi: action[0] = A.");
+    path = path->next;
+    mu_assert(path != NULL, "ai_search_sma_demo_multi: action[1] NOT NULL.");
+    mu_assert(strcmp(((my_action_data *)path->data)->node_name, "D") == 0,
+              "ai_search_sma_demo_multi: action[1] = D.");
+    path = path->next;
+    mu_assert(path != NULL, "ai_search_sma_demo_multi: action[2] NOT NULL.");
+    mu_assert(strcmp(((my_action_data *)path->data)->node_name, "G") == 0,
+              "ai_search_sma_demo_multi: action[2] = G.");
+    mu_assert(path->next == NULL, "ai_search_sma_demo_multi: action[3] NULL.");
+    mu_assert(sma->node_peak_count <= node_max_list[i],
+              "ai_search_sma_demo_multi: never more than node_max nodes.");
+    if (node_max_list[i] == 5) {
+      mu_assert(sma->node_forgotten_count > 0,
+                "ai_search_sma_demo_multi: small budget forgot nodes.");
+    }
+    ai_search_sma_free(sma);
+  }
+
+  // Not enough room for the optimal path. The best path that fits is found.
+  ai_search_sma *sma = ai_search_sma_constructor(&evaluator, 3);
+  ai_path *path = sma->find_path_to_goal(sma, model_state);
+  mu_assert(path != NULL, "ai_search_sma_demo_multi: (3) action[0] NOT NULL.");
+  mu_assert(strcmp(((my_action_data *)path->data)->node_name, "B") == 0,
+            "ai_search_sma_demo_multi: (3) action[0] = B.");
+  mu_assert(path->next != NULL,
+            "ai_search_sma_demo_multi: (3) action[1] NOT NULL.");
+  mu_assert(strcmp(((my_action_data *)path->next->data)->node_name, "G") == 0,
+            "ai_search_sma_demo_multi: (3) action[1] = G.");
+  mu_assert(path->next->next == NULL,
+            "ai_search_sma_demo_multi: (3) action[2] NULL.");
+  ai_search_sma_free(sma);
+
+  // No path fits at all.
+  sma = ai_search_sma_constructor(&evaluator, 2);
+  path = sma->find_path_to_goal(sma, model_state);
+  mu_assert(path == NULL, "ai_search_sma_demo_multi: (2) path NULL.");
+  mu_assert(sma->status == AI_SEARCH_STATUS_NOT_FOUND,
+            "ai_search_sma_demo_multi: (2) NOT_FOUND.");
+  ai_search_sma_free(sma);
+  return NULL;
+}
+
+/*
+ * Demo Dijkstra search, carrying on past the Goal.
+ * No heuristic calls, and the exact distance to every node.
+ */
+char *test_ai_search_demo_dijkstra(void) {
+
+  // Setup
+  static my_model_state_data model_state_data = {
+      .node_name = "S",
+  };
+  ai_model_state *model_state = ai_model_state_constructor(&model_state_data);
+  ai_search_astar *astar = ai_search_astar_constructor(&closed_evaluator);
+  astar->search_mode = AI_SEARCH_MODE_DIJKSTRA;
+  astar->continue_past_goal = 1;
+  my_goal_est_cost_count = 0;
+  // Run
+  ai_path *path = astar->find_path_to_goal(astar, model_state);
+  // Test
+  mu_assert(astar->status == AI_SEARCH_STATUS_FOUND,
+            "ai_search_demo_dijkstra: FOUND.");
+  mu_assert(my_goal_est_cost_count == 0,
+            "ai_search_demo_dijkstra: no heuristic calls.");
+  mu_assert(path != NULL, "ai_search_demo_dijkstra: path NOT NULL.");
+  mu_assert(strcmp(((my_action_data *)path->data)->node_name, "A") == 0,
+            "ai_search_demo_dijkstra: action[0] = A.");
+  mu_assert(astar->closed->count == 6,
+            "ai_search_demo_dijkstra: every node reached.");
+  mu_assert(_my_distance(astar, "S") == 0.0f,
+            "ai_search_demo_dijkstra: distance S.");
+  mu_assert(_my_distance(astar, "A") == 2.0f,
+            "ai_search_demo_dijkstra: distance A.");
+  mu_assert(_my_distance(astar, "B") == 1.0f,
+            "ai_search_demo_dijkstra: distance B.");
+  mu_assert(_my_distance(astar, "C") == 5.0f,
+            "ai_search_demo_dijkstra: distance C.");
+  mu_assert(_my_distance(astar, "D") == 3.0f,
+            "ai_search_demo_dijkstra: distance D.");
+  mu_assert(_my_distance(astar, "G") == 7.0f,
+            "ai_search_demo_dijkstra: distance G.");
+  _ai_path_free(path, my_action_data_free);
+  ai_search_astar_free(astar);
+  return NULL;
+}
+
+/*
+ * Demo Greedy Best-First search.
+ * Follows the heuristic S->A->C->G, which is not the cheapest path.
+ */
+char *test_ai_search_demo_greedy(void) {
+
+  // Setup
+  static my_model_state_data model_state_data = {
+      .node_name = "S",
+  };
+  ai_model_state *model_state = ai_model_state_constructor(&model_state_data);
+  ai_search_astar *astar = ai_search_astar_constructor(&closed_evaluator);
+  astar->search_mode = AI_SEARCH_MODE_GREEDY;
+  // Run
+  ai_path *path = astar->find_path_to_goal(astar, model_state);
+  // Test
+  char *expected[] = {"A", "C", "G"};
+  ai_path *ptr = path;
+  for (int i = 0; i < 3; i++) {
+    mu_assert(ptr != NULL, "ai_search_demo_greedy: action NOT NULL.");
+    mu_assert(strcmp(((my_action_data *)ptr->data)->node_name, expected[i]) ==
+                  0,
+              "ai_search_demo_greedy: action node.");
+    ptr = ptr->next;
+  }
+  mu_assert(ptr == NULL, "ai_search_demo_greedy: action[3] NULL.");
+  mu_assert(astar->fringe_expansion_count == 4,
+            "ai_search_demo_greedy: expansions.");
+  _ai_path_free(path, my_action_data_free);
+  ai_search_astar_free(astar);
+  return NULL;
+}
+
+// True if the path visits exactly the nodes listed.
+int _my_path_is(ai_path *path, char *node_names[], int count) {
+  for (int i = 0; i < count; i++, path = path->next) {
+    if (!path ||
+        strcmp(((my_action_data *)path->data)->node_name, node_names[i])) {
+      return 0;
+    }
+  }
+  return path == NULL;
+}
+
+/*
+ * Demo multi-goal search.
+ * Paths to C, D, G and the initial state S in one pass. Z is not reachable.
+ */
+char *test_ai_search_demo_multi_goal(void) {
+
+  // Setup
+  static my_model_state_data model_state_data = {.node_name = "S"};
+  static my_model_state_data goal_data[] = {
+      {.node_name = "C"}, {.node_name = "D"}, {.node_name = "G"},
+      {.node_name = "S"}, {.node_name = "Z"},
+  };
+  ai_model_state *model_state = ai_model_state_constructor(&model_state_data);
+  ai_model_state *goals[5];
+  for (int i = 0; i < 5; i++) {
+    goals[i] = ai_model_state_constructor(&goal_data[i]);
+  }
+  ai_search_astar *astar = ai_search_astar_constructor(&closed_evaluator);
+  ai_path *paths[5];
+  float costs[5];
+
+  // Run
+  int reached =
+      ai_search_astar_find_paths_to_goals(astar, model_state, goals, 5, paths, costs);
+
+  // Test
+  mu_assert(reached == 4, "ai_search_demo_multi_goal: 4 reached.");
+  mu_assert(astar->status == AI_SEARCH_STATUS_NOT_FOUND,
+            "ai_search_demo_multi_goal: not all reached.");
+  mu_assert(costs[0] == 5.0f, "ai_search_demo_multi_goal: C cost.");
+  mu_assert(_my_path_is(paths[0], (char *[]){"A", "C"}, 2),
+            "ai_search_demo_multi_goal: C path.");
+  mu_assert(costs[1] == 3.0f, "ai_search_demo_multi_goal: D cost.");
+  mu_assert(_my_path_is(paths[1], (char *[]){"A", "D"}, 2),
+            "ai_search_demo_multi_goal: D path.");
+  mu_assert(costs[2] == 7.0f, "ai_search_demo_multi_goal: G cost.");
+  mu_assert(_my_path_is(paths[2], (char *[]){"A", "D", "G"}, 3),
+            "ai_search_demo_multi_goal: G path.");
+  mu_assert(costs[3] == 0.0f, "ai_search_demo_multi_goal: S cost.");
+  mu_assert(paths[3] == NULL, "ai_search_demo_multi_goal: S path empty.");
+  mu_assert(costs[4] == FLT_MAX, "ai_search_demo_multi_goal: Z cost.");
+  mu_assert(paths[4] == NULL, "ai_search_demo_multi_goal: Z no path.");
+  for (int i = 0; i < 5; i++) {
+    _ai_path_free(paths[i], my_action_data_free);
+  }
+
+  // Stop as soon as every Goal is reached.
+  reached = ai_search_astar_find_paths_to_goals(astar, model_state, goals, 2,
+                                                paths, costs);
+  mu_assert(reached == 2, "ai_search_demo_multi_goal: (2) 2 reached.");
+  mu_assert(astar->status == AI_SEARCH_STATUS_FOUND,
+            "ai_search_demo_multi_goal: (2) FOUND.");
+  mu_assert(astar->closed->count < 6,
+            "ai_search_demo_multi_goal: (2) stopped early.");
+  for (int i = 0; i < 2; i++) {
+    _ai_path_free(paths[i], my_action_data_free);
+  }
+
+  // The same Goal given twice is reached twice.
+  ai_model_state *twice[3] = {goals[1], goals[0], goals[1]};
+  reached = ai_search_astar_find_paths_to_goals(astar, model_state, twice, 3,
+                                                paths, costs);
+  mu_assert(reached == 3, "ai_search_demo_multi_goal: (twice) 3 reached.");
+  mu_assert(astar->status == AI_SEARCH_STATUS_FOUND,
+            "ai_search_demo_multi_goal: (twice) FOUND.");
+  mu_assert(costs[0] == 3.0f && costs[2] == 3.0f,
+            "ai_search_demo_multi_goal: (twice) D cost.");
+  mu_assert(_my_path_is(paths[0], (char *[]){"A", "D"}, 2) &&
+                _my_path_is(paths[2], (char *[]){"A", "D"}, 2),
+            "ai_search_demo_multi_goal: (twice) D path.");
+  for (int i = 0; i < 3; i++) {
+    _ai_path_free(paths[i], my_action_data_free);
+  }
+  ai_search_astar_free(astar);
+  return NULL;
+}
+
+/*
+ * Demo Beam search.
+ * A beam of one follows the lowest est_total_cost at each depth, S->B->D->G,
+ * which is not the cheapest path.
+ */
+char *test_ai_search_beam_demo_multi(void) {
+
+  // Setup
+  static my_model_state_data model_state_data = {.node_name = "S"};
+  ai_model_state *model_state = ai_model_state_constructor(&model_state_data);
+  ai_search_beam *beam = ai_search_beam_constructor(&evaluator, 1);
+  // Run
+  ai_path *path = beam->find_path_to_goal(beam, model_state);
+  // Test
+  mu_assert(beam->status == AI_SEARCH_STATUS_FOUND,
+            "ai_search_beam_demo_multi: FOUND.");
+  mu_assert(_my_path_is(path, (char *[]){"B", "D", "G"}, 3),
+            "ai_search_beam_demo_multi: path.");
+  mu_assert(beam->node_held_count == 4,
+            "ai_search_beam_demo_multi: one node per depth.");
+  _ai_path_free(path, my_action_data_free);
+  ai_search_beam_free(beam);
+  return NULL;
+}
+
 /*
  * Run the test suite.
  */
@@ -323,6 +636,11 @@ char *all_tests() {
   mu_suite_start();
   mu_run_test(test_ai_search_demo_at_goal);
   mu_run_test(test_ai_search_demo_multi);
+  mu_run_test(test_ai_search_sma_demo_multi);
+  mu_run_test(test_ai_search_demo_dijkstra);
+  mu_run_test(test_ai_search_demo_greedy);
+  mu_run_test(test_ai_search_demo_multi_goal);
+  mu_run_test(test_ai_search_beam_demo_multi);
   return NULL;
 }
 
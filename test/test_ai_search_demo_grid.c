@@ -14,6 +14,8 @@
  */
 
 #include <ai_search.h>
+#include <ai_search_beam.h>
+#include <ai_search_sma.h>
 #include <math.h>
 #include <minunit.h>
 #include <stdio.h>
@@ -149,6 +151,8 @@ float my_goal_est_cost_function(ai_model_state *model_state) {
               fabs(data->agent_y - data->goal_y));
 }
 
+void _ai_path_free(ai_path *ptr, ai_action_data_free action_data_free);
+
 // Setup
 static ai_model_state_evaluator evaluator = {
     .successor_function = my_successor_function,
@@ -227,6 +231,205 @@ char *test_ai_search_demo_straight(void) {
   return NULL;
 }
 
+/*
+ * Demo AStar search, run stepwise.
+ * One expansion at a time, then to completion. Same path as straight.
+ */
+char *test_ai_search_demo_stepwise(void) {
+
+  // Setup
+  static my_model_state_data model_state_data = {
+      .agent_x = 3,
+      .agent_y = 4,
+      .goal_x = 3,
+      .goal_y = 6,
+  };
+  ai_model_state *model_state = ai_model_state_constructor(&model_state_data);
+  ai_search_astar *astar = ai_search_astar_constructor(&evaluator);
+  mu_assert(astar->status == AI_SEARCH_STATUS_IDLE,
+            "ai_search_demo_stepwise: status IDLE.");
+  // Run
+  ai_search_astar_begin(astar, model_state);
+  mu_assert(ai_search_astar_step(astar, 1) == AI_SEARCH_STATUS_RUNNING,
+            "ai_search_demo_stepwise: step 1 RUNNING.");
+  mu_assert(astar->fringe_expansion_count == 1,
+            "ai_search_demo_stepwise: one expansion.");
+  mu_assert(ai_search_astar_step(astar, 0) == AI_SEARCH_STATUS_FOUND,
+            "ai_search_demo_stepwise: step to completion FOUND.");
+  ai_path *path = ai_search_astar_end(astar);
+  // Test
+  mu_assert(path != NULL, "ai_search_demo_stepwise: path NOT NULL.");
+  mu_assert(path->next != NULL, "ai_search_demo_stepwise: action[1] NOT NULL.");
+  mu_assert(path->next->next == NULL, "ai_search_demo_stepwise: action[2] NULL.");
+  mu_assert(astar->status == AI_SEARCH_STATUS_FOUND,
+            "ai_search_demo_stepwise: status kept after end.");
+  _ai_path_free(path, my_action_data_free);
+
+  // Cancel part way.
+  ai_search_astar_begin(astar, model_state);
+  ai_search_astar_step(astar, 1);
+  path = ai_search_astar_end(astar);
+  mu_assert(path == NULL, "ai_search_demo_stepwise: cancelled path NULL.");
+  mu_assert(astar->status == AI_SEARCH_STATUS_CANCELLED,
+            "ai_search_demo_stepwise: status CANCELLED.");
+  ai_search_astar_free(astar);
+  return NULL;
+}
+
+size_t my_model_state_data_size(void *data) {
+  return sizeof(my_model_state_data);
+}
+
+size_t my_action_data_size(void *data) { return sizeof(my_action_data); }
+
+// As evaluator, but with the data sizes needed for memory accounting.
+static ai_model_state_evaluator sized_evaluator = {
+    .successor_function = my_successor_function,
+    .transition_function = my_transition_function,
+    .is_goal_state_function = my_is_goal_state_function,
+    .goal_est_cost_function = my_goal_est_cost_function,
+    .model_state_data_duplicator = my_model_state_data_duplicator,
+    .model_state_data_free = my_model_state_data_free,
+    .action_data_duplicator = my_action_data_duplicator,
+    .action_data_free = my_action_data_free,
+    .model_state_data_size = my_model_state_data_size,
+    .action_data_size = my_action_data_size,
+};
+
+/*
+ * Demo AStar search, with a memory budget too small for the fringe.
+ * The ABORT policy stops the search. The PRUNE policy still finds the path.
+ */
+char *test_ai_search_demo_memory_budget(void) {
+
+  // Setup
+  static my_model_state_data model_state_data = {
+      .agent_x = 0,
+      .agent_y = 0,
+      .goal_x = 0,
+      .goal_y = 8,
+  };
+  ai_model_state *model_state = ai_model_state_constructor(&model_state_data);
+  ai_search_astar *astar = ai_search_astar_constructor(&sized_evaluator);
+
+  // Unlimited
+  ai_path *path = astar->find_path_to_goal(astar, model_state);
+  mu_assert(astar->status == AI_SEARCH_STATUS_FOUND,
+            "ai_search_demo_memory_budget: unlimited FOUND.");
+  mu_assert(astar->memory_peak > 0,
+            "ai_search_demo_memory_budget: unlimited memory_peak.");
+  mu_assert(astar->memory_used == 0,
+            "ai_search_demo_memory_budget: memory_used released.");
+  size_t unlimited_peak = astar->memory_peak;
+  _ai_path_free(path, my_action_data_free);
+
+  // Abort
+  astar->memory_budget = unlimited_peak / 4;
+  astar->memory_policy = AI_SEARCH_MEMORY_POLICY_ABORT;
+  path = astar->find_path_to_goal(astar, model_state);
+  mu_assert(astar->status == AI_SEARCH_STATUS_MEMORY_EXCEEDED,
+            "ai_search_demo_memory_budget: abort MEMORY_EXCEEDED.");
+  mu_assert(path == NULL, "ai_search_demo_memory_budget: abort path NULL.");
+
+  // Prune
+  astar->memory_policy = AI_SEARCH_MEMORY_POLICY_PRUNE;
+  path = astar->find_path_to_goal(astar, model_state);
+  mu_assert(astar->status == AI_SEARCH_STATUS_FOUND,
+            "ai_search_demo_memory_budget: prune FOUND.");
+  mu_assert(astar->fringe_pruned_count > 0,
+            "ai_search_demo_memory_budget: prune discarded elements.");
+  mu_assert(astar->memory_peak < unlimited_peak,
+            "ai_search_demo_memory_budget: prune peak below unlimited.");
+  int path_length = 0;
+  for (ai_path *ptr = path; ptr; ptr = ptr->next) {
+    path_length++;
+  }
+  mu_assert(path_length == 8, "ai_search_demo_memory_budget: prune length.");
+  _ai_path_free(path, my_action_data_free);
+  ai_search_astar_free(astar);
+  return NULL;
+}
+
+/*
+ * Demo Beam search.
+ * Two nodes per depth reach a Goal eight steps away, holding at most two
+ * nodes per depth.
+ */
+char *test_ai_search_beam_demo(void) {
+
+  // Setup
+  static my_model_state_data model_state_data = {
+      .agent_x = 0,
+      .agent_y = 0,
+      .goal_x = 0,
+      .goal_y = 8,
+  };
+  ai_model_state *model_state = ai_model_state_constructor(&model_state_data);
+  ai_search_beam *beam = ai_search_beam_constructor(&evaluator, 2);
+  // Run
+  ai_path *path = beam->find_path_to_goal(beam, model_state);
+  // Test
+  mu_assert(beam->status == AI_SEARCH_STATUS_FOUND,
+            "ai_search_beam_demo: FOUND.");
+  mu_assert(beam->depth == 8, "ai_search_beam_demo: depth.");
+  mu_assert(beam->node_held_count <= 2 * 8 + 1,
+            "ai_search_beam_demo: nodes held.");
+  int path_length = 0;
+  for (ai_path *ptr = path; ptr; ptr = ptr->next) {
+    path_length++;
+  }
+  mu_assert(path_length == 8, "ai_search_beam_demo: path length.");
+  _ai_path_free(path, my_action_data_free);
+
+  // Too shallow to reach the Goal.
+  beam->depth_max = 4;
+  path = beam->find_path_to_goal(beam, model_state);
+  mu_assert(path == NULL, "ai_search_beam_demo: depth_max path NULL.");
+  mu_assert(beam->status == AI_SEARCH_STATUS_NOT_FOUND,
+            "ai_search_beam_demo: depth_max NOT_FOUND.");
+  ai_search_beam_free(beam);
+  return NULL;
+}
+
+/*
+ * Demo SMA* search.
+ * The Goal six steps away is reached by a shortest path, with memory for all
+ * the nodes searched, and for only a few of them.
+ */
+char *test_ai_search_sma_demo(void) {
+
+  // Setup
+  static my_model_state_data model_state_data = {
+      .agent_x = 0,
+      .agent_y = 0,
+      .goal_x = 2,
+      .goal_y = 4,
+  };
+  ai_model_state *model_state = ai_model_state_constructor(&model_state_data);
+  int node_max_list[] = {100000, 20};
+  for (int i = 0; i < 2; i++) {
+    ai_search_sma *sma =
+        ai_search_sma_constructor(&evaluator, node_max_list[i]);
+    // Run
+    ai_path *path = sma->find_path_to_goal(sma, model_state);
+    // Test
+    mu_assert(sma->status == AI_SEARCH_STATUS_FOUND,
+              "ai_search_sma_demo: FOUND.");
+    int path_length = 0;
+    for (ai_path *ptr = path; ptr; ptr = ptr->next) {
+      path_length++;
+    }
+    mu_assert(path_length == 6, "ai_search_sma_demo: path length.");
+    mu_assert((i == 0) == (sma->node_forgotten_count == 0),
+              "ai_search_sma_demo: forgot nodes only when short of memory.");
+    mu_assert(sma->node_peak_count <= node_max_list[i],
+              "ai_search_sma_demo: never more than node_max nodes.");
+    _ai_path_free(path, my_action_data_free);
+    ai_search_sma_free(sma);
+  }
+  return NULL;
+}
+
 /*
  * Run the test suite.
  */
@@ -234,6 +437,10 @@ char *all_tests() {
   mu_suite_start();
   mu_run_test(test_ai_search_demo_at_goal);
   mu_run_test(test_ai_search_demo_straight);
+  mu_run_test(test_ai_search_demo_stepwise);
+  mu_run_test(test_ai_search_demo_memory_budget);
+  mu_run_test(test_ai_search_beam_demo);
+  mu_run_test(test_ai_search_sma_demo);
   return NULL;
 }
 
@@ -0,0 +1,233 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// Custom
+#include <ai_graph.h>
+#include <ai_search_dstar_lite.h>
+#include <minunit.h>
+
+/*
+ * A 4 connected grid of GRID_SIZE x GRID_SIZE cells, as an ai_graph.
+ * Node id is y * GRID_SIZE + x. Every move costs 1.
+ */
+#define GRID_SIZE 10
+
+void _ai_path_free(ai_path *ptr, ai_action_data_free action_data_free);
+
+ai_graph *my_grid_graph_constructor() {
+  ai_graph_edge edges[GRID_SIZE * GRID_SIZE * 4];
+  uint32_t edge_count = 0;
+  for (int y = 0; y < GRID_SIZE; y++) {
+    for (int x = 0; x < GRID_SIZE; x++) {
+      uint32_t node = y * GRID_SIZE + x;
+      if (x > 0) {
+        edges[edge_count++] = (ai_graph_edge){node, node - 1, 1.f};
+      }
+      if (x < GRID_SIZE - 1) {
+        edges[edge_count++] = (ai_graph_edge){node, node + 1, 1.f};
+      }
+      if (y > 0) {
+        edges[edge_count++] = (ai_graph_edge){node, node - GRID_SIZE, 1.f};
+      }
+      if (y < GRID_SIZE - 1) {
+        edges[edge_count++] = (ai_graph_edge){node, node + GRID_SIZE, 1.f};
+      }
+    }
+  }
+  return ai_graph_constructor(GRID_SIZE * GRID_SIZE, edge_count, edges);
+}
+
+// Manhattan distance.
+float my_est_cost_function(void *est_cost_data, uint32_t from_node,
+                           uint32_t to_node) {
+  (void)est_cost_data;
+  return (float)(abs((int)(from_node % GRID_SIZE) - (int)(to_node % GRID_SIZE)) +
+                 abs((int)(from_node / GRID_SIZE) - (int)(to_node / GRID_SIZE)));
+}
+
+// Set the cost of every edge into the node. Returns the number of changes.
+int my_cell_changes(ai_graph *graph, uint32_t node, float cost,
+                    ai_graph_edge *changes) {
+  int change_count = 0;
+  for (uint32_t r = graph->reverse_offset[node];
+       r < graph->reverse_offset[node + 1]; r++) {
+    changes[change_count++] =
+        (ai_graph_edge){graph->reverse_source[r], node, cost};
+  }
+  return change_count;
+}
+
+// Sum of the path's edge costs, checking it runs from start to goal.
+float my_path_cost(ai_graph *graph, uint32_t start, uint32_t goal,
+                   ai_path *path) {
+  float cost = 0;
+  uint32_t node = start;
+  for (ai_action *action = path; action; action = action->next) {
+    ai_graph_action *data = (ai_graph_action *)action->data;
+    if (ai_graph_edge_find(graph, node, data->target) == AI_GRAPH_NODE_NONE) {
+      return -1;
+    }
+    cost += graph->edge_cost[data->edge];
+    node = data->target;
+  }
+  return node == goal ? cost : -1;
+}
+
+// Cost by a fresh planner, and its expansion count.
+float my_fresh_cost(ai_graph *graph, uint32_t start, uint32_t goal,
+                    int *expansion_count) {
+  ai_search_dstar_lite *dstar =
+      ai_search_dstar_lite_constructor(graph, start, goal);
+  dstar->est_cost_function = my_est_cost_function;
+  ai_path *path = ai_search_dstar_lite_find_path(dstar);
+  float cost = path ? dstar->path_cost : INFINITY;
+  *expansion_count = dstar->fringe_expansion_last;
+  _ai_path_free(path, ai_graph_action_data_free);
+  ai_search_dstar_lite_free(dstar);
+  return cost;
+}
+
+char *test_ai_graph_constructor() {
+  ai_graph_edge edges[] = {{2, 0, 3.f}, {0, 1, 1.f}, {0, 2, 2.f}, {1, 2, 4.f}};
+  ai_graph *graph = ai_graph_constructor(3, 4, edges);
+  mu_assert(graph, "ai_graph_constructor: built.");
+  mu_assert(graph->edge_offset[0] == 0 && graph->edge_offset[1] == 2 &&
+                graph->edge_offset[2] == 3 && graph->edge_offset[3] == 4,
+            "ai_graph_constructor: out edge offsets.");
+  // Given order is kept within a node.
+  mu_assert(graph->edge_target[0] == 1 && graph->edge_target[1] == 2,
+            "ai_graph_constructor: out edge order.");
+  mu_assert(graph->reverse_offset[2] == 2 && graph->reverse_offset[3] == 4,
+            "ai_graph_constructor: in edge offsets.");
+  uint32_t e = ai_graph_edge_find(graph, 1, 2);
+  mu_assert(e == 2 && graph->edge_cost[e] == 4.f,
+            "ai_graph_edge_find: found.");
+  mu_assert(ai_graph_edge_find(graph, 1, 0) == AI_GRAPH_NODE_NONE,
+            "ai_graph_edge_find: not found.");
+  for (uint32_t r = 0; r < graph->edge_count; r++) {
+    uint32_t edge = graph->reverse_edge[r];
+    mu_assert(ai_graph_edge_find(graph, graph->reverse_source[r],
+                                 graph->edge_target[edge]) != AI_GRAPH_NODE_NONE,
+              "ai_graph_constructor: in edge matches out edge.");
+  }
+  ai_graph_free(graph);
+
+  ai_graph_edge bad_edges[] = {{0, 3, 1.f}};
+  mu_assert(ai_graph_constructor(3, 1, bad_edges) == NULL,
+            "ai_graph_constructor: node out of range.");
+  return NULL;
+}
+
+char *test_ai_search_dstar_lite_find_path() {
+  ai_graph *graph = my_grid_graph_constructor();
+  uint32_t start = 0;
+  uint32_t goal = GRID_SIZE * GRID_SIZE - 1;
+  ai_search_dstar_lite *dstar =
+      ai_search_dstar_lite_constructor(graph, start, goal);
+  dstar->est_cost_function = my_est_cost_function;
+
+  ai_path *path = ai_search_dstar_lite_find_path(dstar);
+  mu_assert(dstar->status == AI_SEARCH_STATUS_FOUND,
+            "ai_search_dstar_lite_find_path: FOUND.");
+  mu_assert(dstar->path_cost == 18.f, "ai_search_dstar_lite_find_path: cost.");
+  mu_assert(my_path_cost(graph, start, goal, path) == 18.f,
+            "ai_search_dstar_lite_find_path: path.");
+  _ai_path_free(path, ai_graph_action_data_free);
+
+  // Nothing changed, so nothing is searched again.
+  path = ai_search_dstar_lite_find_path(dstar);
+  mu_assert(dstar->fringe_expansion_last == 0,
+            "ai_search_dstar_lite_find_path: no work when unchanged.");
+  _ai_path_free(path, ai_graph_action_data_free);
+
+  ai_search_dstar_lite_free(dstar);
+  ai_graph_free(graph);
+  return NULL;
+}
+
+char *test_ai_search_notify_edge_changes() {
+  ai_graph *graph = my_grid_graph_constructor();
+  uint32_t start = 0;
+  uint32_t goal = GRID_SIZE * GRID_SIZE - 1;
+  ai_search_dstar_lite *dstar =
+      ai_search_dstar_lite_constructor(graph, start, goal);
+  dstar->est_cost_function = my_est_cost_function;
+  ai_path *path = ai_search_dstar_lite_find_path(dstar);
+  _ai_path_free(path, ai_graph_action_data_free);
+
+  // A wall across x = 5, with a gap at the top.
+  ai_graph_edge changes[GRID_SIZE * 4];
+  for (int y = 0; y < GRID_SIZE - 1; y++) {
+    int change_count =
+        my_cell_changes(graph, y * GRID_SIZE + 5, INFINITY, changes);
+    mu_assert(ai_search_notify_edge_changes(dstar, changes, change_count) ==
+                  change_count,
+              "ai_search_notify_edge_changes: applied.");
+  }
+  path = ai_search_dstar_lite_find_path(dstar);
+  int expansion_count = 0;
+  float fresh_cost = my_fresh_cost(graph, start, goal, &expansion_count);
+  mu_assert(dstar->status == AI_SEARCH_STATUS_FOUND,
+            "ai_search_notify_edge_changes: wall FOUND.");
+  mu_assert(dstar->path_cost == fresh_cost,
+            "ai_search_notify_edge_changes: wall cost as fresh search.");
+  mu_assert(my_path_cost(graph, start, goal, path) == fresh_cost,
+            "ai_search_notify_edge_changes: wall path.");
+  _ai_path_free(path, ai_graph_action_data_free);
+
+  // The agent moves up to the gap, then one cell next to it is blocked.
+  ai_search_dstar_lite_move_start(dstar, (GRID_SIZE - 1) * GRID_SIZE + 3);
+  int change_count = my_cell_changes(
+      graph, (GRID_SIZE - 2) * GRID_SIZE + 7, INFINITY, changes);
+  ai_search_notify_edge_changes(dstar, changes, change_count);
+  path = ai_search_dstar_lite_find_path(dstar);
+  fresh_cost = my_fresh_cost(graph, dstar->start, goal, &expansion_count);
+  mu_assert(dstar->path_cost == fresh_cost,
+            "ai_search_notify_edge_changes: moved cost as fresh search.");
+  mu_assert(my_path_cost(graph, dstar->start, goal, path) == fresh_cost,
+            "ai_search_notify_edge_changes: moved path.");
+  mu_assert(dstar->fringe_expansion_last < expansion_count,
+            "ai_search_notify_edge_changes: less work than fresh search.");
+  _ai_path_free(path, ai_graph_action_data_free);
+
+  // Close the gap, then open it again.
+  change_count = my_cell_changes(graph, (GRID_SIZE - 1) * GRID_SIZE + 5,
+                                 INFINITY, changes);
+  ai_search_notify_edge_changes(dstar, changes, change_count);
+  path = ai_search_dstar_lite_find_path(dstar);
+  mu_assert(!path && dstar->status == AI_SEARCH_STATUS_NOT_FOUND,
+            "ai_search_notify_edge_changes: closed NOT_FOUND.");
+  change_count =
+      my_cell_changes(graph, (GRID_SIZE - 1) * GRID_SIZE + 5, 1.f, changes);
+  ai_search_notify_edge_changes(dstar, changes, change_count);
+  path = ai_search_dstar_lite_find_path(dstar);
+  fresh_cost = my_fresh_cost(graph, dstar->start, goal, &expansion_count);
+  mu_assert(dstar->status == AI_SEARCH_STATUS_FOUND,
+            "ai_search_notify_edge_changes: reopened FOUND.");
+  mu_assert(dstar->path_cost == fresh_cost,
+            "ai_search_notify_edge_changes: reopened cost as fresh search.");
+  _ai_path_free(path, ai_graph_action_data_free);
+
+  // Unknown edges are skipped.
+  ai_graph_edge unknown = {0, goal, 1.f};
+  mu_assert(ai_search_notify_edge_changes(dstar, &unknown, 1) == 0,
+            "ai_search_notify_edge_changes: unknown edge skipped.");
+
+  ai_search_dstar_lite_free(dstar);
+  ai_graph_free(graph);
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test_ai_graph_constructor);
+  mu_run_test(test_ai_search_dstar_lite_find_path);
+  mu_run_test(test_ai_search_notify_edge_changes);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+// Custom
+#include <ai_search.h>
+#include <ai_search_external.h>
+#include <minunit.h>
+#include "test_ring_fixture.h"
+
+static char my_directory[] = "/tmp/test_ai_search_external_XXXXXX";
+
+static ai_model_state_evaluator my_evaluator = {
+    .successor_function = my_successor_function,
+    .transition_function = my_transition_function,
+    .is_goal_state_function = my_is_goal_state_function,
+    .goal_est_cost_function = my_goal_est_cost_function,
+    .model_state_data_duplicator = my_data_duplicator,
+    .model_state_data_free = my_data_free,
+    .action_data_duplicator = my_action_data_duplicator,
+    .action_data_free = my_data_free,
+    .model_state_hash_function = my_hash_function,
+    .model_state_equal_function = my_equal_function,
+    .model_state_packed_size = sizeof(my_puzzle),
+    .model_state_pack_function = my_pack_function,
+    .model_state_unpack_function = my_unpack_function,
+};
+
+// Moves that cost half as much, which are not whole numbers.
+ai_successor *
+my_ring_half_successor_function(ai_model_state *model_state,
+                                ai_transition_function transition_function) {
+  ai_successor *head =
+      my_ring_successor_function(model_state, transition_function);
+  for (ai_successor *successor = head; successor; successor = successor->next) {
+    successor->cost /= 2;
+  }
+  return head;
+}
+
+char *test_ai_search_external_constructor() {
+  mu_assert(mkdtemp(my_directory), "mkdtemp: temporary directory.");
+  ai_model_state_evaluator unpacked_evaluator = my_evaluator;
+  unpacked_evaluator.model_state_pack_function = NULL;
+  mu_assert(ai_search_external_constructor(&unpacked_evaluator,
+                                           my_directory) == NULL,
+            "ai_search_external_constructor: states must pack.");
+  ai_search_external *external =
+      ai_search_external_constructor(&my_evaluator, my_directory);
+  mu_assert(external && (external->buffer_size ==
+                         AI_SEARCH_EXTERNAL_BUFFER_SIZE) &&
+                (external->duplicate_locality == 0) &&
+                (external->status == AI_SEARCH_STATUS_IDLE),
+            "ai_search_external_constructor: defaults.");
+  ai_search_external_free(external);
+  return NULL;
+}
+
+char *test_ai_search_external_find_path() {
+  ai_search_external *external =
+      ai_search_external_constructor(&my_evaluator, my_directory);
+  ai_search_external *small =
+      ai_search_external_constructor(&my_evaluator, my_directory);
+  // Room for a few dozen successors, so that buckets take many runs.
+  small->buffer_size = 1024;
+  small->duplicate_locality = 2;
+  uint64_t small_run_total = 0;
+  uint64_t run_total = 0;
+  uint64_t duplicate_total = 0;
+  for (int i = 0; i < 8; i++) {
+    ai_model_state *model_state = my_scramble(30 + i * 5);
+    float astar_cost = my_astar_cost(&my_evaluator, model_state);
+    ai_path *path = external->find_path_to_goal(external, model_state);
+    mu_assert(external->status == AI_SEARCH_STATUS_FOUND,
+              "ai_search_external: found.");
+    mu_assert(external->path_cost == astar_cost,
+              "ai_search_external: optimal.");
+    mu_assert(my_path_cost(&my_evaluator, model_state, path) == astar_cost,
+              "ai_search_external: path to the Goal.");
+    _ai_path_free(path, my_data_free);
+
+    path = small->find_path_to_goal(small, model_state);
+    mu_assert(small->status == AI_SEARCH_STATUS_FOUND &&
+                  small->path_cost == astar_cost,
+              "ai_search_external: optimal from small runs.");
+    mu_assert(my_path_cost(&my_evaluator, model_state, path) == astar_cost,
+              "ai_search_external: path from small runs.");
+    mu_assert(small->fringe_expansion_count ==
+                  external->fringe_expansion_count,
+              "ai_search_external: locality 2 drops every duplicate.");
+    mu_assert(small->bytes_written > 0 && small->bytes_read > 0,
+              "ai_search_external: bytes counted.");
+    small_run_total += small->run_count;
+    run_total += external->run_count;
+    duplicate_total += small->duplicate_count;
+    _ai_path_free(path, my_data_free);
+    my_data_free(model_state->data);
+    free(model_state);
+  }
+  mu_assert(small_run_total > run_total, "ai_search_external: more runs.");
+  mu_assert(duplicate_total > 0, "ai_search_external: duplicates dropped.");
+
+  // Stopped part way.
+  ai_model_state *model_state = my_scramble(40);
+  small->fringe_expansion_max = 10;
+  mu_assert(small->find_path_to_goal(small, model_state) == NULL &&
+                small->status == AI_SEARCH_STATUS_EXPANSION_LIMIT &&
+                small->fringe_expansion_count == 10,
+            "ai_search_external: expansion limit.");
+  my_data_free(model_state->data);
+  free(model_state);
+  ai_search_external_free(external);
+  ai_search_external_free(small);
+  return NULL;
+}
+
+char *test_ai_search_external_directed() {
+  ai_search_external *external =
+      ai_search_external_constructor(&my_ring_evaluator, my_directory);
+  external->buffer_size = 256;
+  for (int node = 1; node < MY_RING_SIZE; node += 17) {
+    ai_model_state *model_state =
+        ai_model_state_constructor(my_action_data_duplicator(&node));
+    float astar_cost = my_astar_cost(&my_ring_evaluator, model_state);
+    ai_path *path = external->find_path_to_goal(external, model_state);
+    mu_assert(external->status == AI_SEARCH_STATUS_FOUND &&
+                  external->path_cost == astar_cost,
+              "ai_search_external: optimal when directed.");
+    mu_assert(my_path_cost(&my_ring_evaluator, model_state, path) ==
+                  astar_cost,
+              "ai_search_external: directed path.");
+    // Every earlier layer is read, in passes as there are too many to open
+    // at once, so no node is expanded twice.
+    mu_assert(external->fringe_expansion_count <= MY_RING_SIZE,
+              "ai_search_external: earlier layers all read.");
+    _ai_path_free(path, my_data_free);
+    my_data_free(model_state->data);
+    free(model_state);
+  }
+  ai_search_external_free(external);
+  return NULL;
+}
+
+char *test_ai_search_external_error() {
+  ai_model_state *model_state = my_scramble(10);
+  ai_search_external *external =
+      ai_search_external_constructor(&my_evaluator, "/nonexistent/directory");
+  mu_assert(external->find_path_to_goal(external, model_state) == NULL &&
+                external->status == AI_SEARCH_STATUS_IO_ERROR,
+            "ai_search_external: no directory.");
+  ai_search_external_free(external);
+  my_data_free(model_state->data);
+  free(model_state);
+
+  int node = 5;
+  model_state = ai_model_state_constructor(my_action_data_duplicator(&node));
+  ai_model_state_evaluator half_evaluator = my_ring_evaluator;
+  half_evaluator.successor_function = my_ring_half_successor_function;
+  external = ai_search_external_constructor(&half_evaluator, my_directory);
+  mu_assert(external->find_path_to_goal(external, model_state) == NULL &&
+                external->status == AI_SEARCH_STATUS_CANCELLED,
+            "ai_search_external: cost not a whole number.");
+  ai_search_external_free(external);
+  my_data_free(model_state->data);
+  free(model_state);
+
+  // Every file is removed when a search ends.
+  mu_assert(rmdir(my_directory) == 0, "ai_search_external: files removed.");
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test_ai_search_external_constructor);
+  mu_run_test(test_ai_search_external_find_path);
+  mu_run_test(test_ai_search_external_directed);
+  mu_run_test(test_ai_search_external_error);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
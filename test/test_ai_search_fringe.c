@@ -0,0 +1,367 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// Custom
+#include <ai_grid.h>
+#include <ai_search.h>
+#include <minunit.h>
+#include "test_puzzle_fixture.h"
+
+#define GRID_SIZE 64
+
+// Every move of the 8-puzzle costs 1, and the estimate is a whole number.
+static ai_model_state_evaluator my_evaluator = {
+    .successor_function = my_successor_function,
+    .transition_function = my_transition_function,
+    .is_goal_state_function = my_is_goal_state_function,
+    .goal_est_cost_function = my_goal_est_cost_function,
+    .model_state_data_duplicator = my_data_duplicator,
+    .model_state_data_free = my_data_free,
+    .action_data_duplicator = my_action_data_duplicator,
+    .action_data_free = my_data_free,
+    .model_state_hash_function = my_hash_function,
+    .model_state_equal_function = my_equal_function,
+};
+
+// The estimates of many states at once, counting the calls.
+static int my_est_batch_count = 0;
+static int my_est_count = 0;
+
+void my_goal_est_cost_batch_function(ai_model_state **model_states, int count,
+                                     float *goal_est_costs) {
+  my_est_batch_count++;
+  for (int i = 0; i < count; i++) {
+    goal_est_costs[i] = my_goal_est_cost_function(model_states[i]);
+  }
+}
+
+float my_counted_goal_est_cost_function(ai_model_state *model_state) {
+  my_est_count++;
+  return my_goal_est_cost_function(model_state);
+}
+
+// True if the paths have the same actions.
+int my_path_equal(ai_path *a, ai_path *b) {
+  for (; a && b; a = a->next, b = b->next) {
+    if (*(int *)a->data != *(int *)b->data) {
+      return 0;
+    }
+  }
+  return a == b;
+}
+
+/*
+ * A GRID_SIZE x GRID_SIZE grid with one cell in five blocked at random.
+ * Diagonal moves cost AI_GRID_DIAGONAL_COST, which is not a whole number.
+ */
+ai_grid *my_grid_constructor() {
+  my_random_seed = 1;
+  ai_grid *grid = ai_grid_constructor(GRID_SIZE, GRID_SIZE);
+  for (int y = 0; y < GRID_SIZE; y++) {
+    for (int x = 0; x < GRID_SIZE; x++) {
+      ai_grid_blocked_set(grid, x, y, (my_random() % 5) == 0);
+    }
+  }
+  return grid;
+}
+
+// The cost of a search of the grid, or -1 if no path was found.
+float my_grid_cost(ai_search_astar *astar, ai_grid *grid, int x, int y,
+                   int goal_x, int goal_y) {
+  ai_grid_query query;
+  ai_grid_query_init(&query, grid, goal_x, goal_y);
+  ai_model_state *model_state = ai_grid_model_state_constructor(&query, x, y);
+  ai_path *path = astar->find_path_to_goal(astar, model_state);
+  float cost = astar->status == AI_SEARCH_STATUS_FOUND ? 0 : -1;
+  for (ai_path *action = path; action; action = action->next) {
+    ai_grid_action *action_data = (ai_grid_action *)action->data;
+    cost += ai_grid_move_cost(x, y, action_data->x, action_data->y);
+    x = action_data->x;
+    y = action_data->y;
+  }
+  _ai_path_free(path, ai_grid_data_free);
+  free(model_state->data);
+  free(model_state);
+  return cost;
+}
+
+// Whole costs with a width of 1 expand exactly as the sorted fringe does.
+char *test_ai_search_fringe_bucket_exact() {
+  ai_search_astar *sorted = ai_search_astar_constructor(&my_evaluator);
+  ai_search_astar *bucket = ai_search_astar_constructor(&my_evaluator);
+  mu_assert(bucket->fringe_bucket_width == 0,
+            "ai_search_astar_constructor: sorted fringe by default.");
+  bucket->fringe_bucket_width = 1;
+  for (int i = 0; i < 8; i++) {
+    ai_model_state *model_state = my_scramble(30 + i * 5);
+    ai_path *sorted_path = sorted->find_path_to_goal(sorted, model_state);
+    ai_path *bucket_path = bucket->find_path_to_goal(bucket, model_state);
+    mu_assert(bucket->status == AI_SEARCH_STATUS_FOUND,
+              "ai_search_fringe_bucket: found.");
+    mu_assert(my_path_equal(sorted_path, bucket_path),
+              "ai_search_fringe_bucket: same path.");
+    mu_assert(bucket->fringe_expansion_count == sorted->fringe_expansion_count,
+              "ai_search_fringe_bucket: same expansions.");
+    _ai_path_free(sorted_path, my_data_free);
+    _ai_path_free(bucket_path, my_data_free);
+    my_data_free(model_state->data);
+    free(model_state);
+  }
+  mu_assert(bucket->fringe_bucket_count > 0,
+            "ai_search_fringe_bucket: index built.");
+  ai_search_astar_free(sorted);
+  ai_search_astar_free(bucket);
+  return NULL;
+}
+
+// Costs that are not whole numbers are rounded down to the width.
+char *test_ai_search_fringe_bucket_quantised() {
+  ai_grid *grid = my_grid_constructor();
+  ai_search_astar *sorted =
+      ai_search_astar_constructor(&ai_grid_model_state_evaluator);
+  ai_search_astar *bucket =
+      ai_search_astar_constructor(&ai_grid_model_state_evaluator);
+  ai_search_astar *fine =
+      ai_search_astar_constructor(&ai_grid_model_state_evaluator);
+  bucket->fringe_bucket_width = 1;
+  fine->fringe_bucket_width = 0.01f;
+  int query_count = 0;
+  for (int i = 0; i < 40; i++) {
+    int x = my_random() % GRID_SIZE;
+    int y = my_random() % GRID_SIZE;
+    int goal_x = my_random() % GRID_SIZE;
+    int goal_y = my_random() % GRID_SIZE;
+    if (ai_grid_blocked(grid, x, y) || ai_grid_blocked(grid, goal_x, goal_y)) {
+      continue;
+    }
+    float cost = my_grid_cost(sorted, grid, x, y, goal_x, goal_y);
+    float bucket_cost = my_grid_cost(bucket, grid, x, y, goal_x, goal_y);
+    float fine_cost = my_grid_cost(fine, grid, x, y, goal_x, goal_y);
+    if (cost < 0) {
+      mu_assert(bucket_cost < 0 && fine_cost < 0,
+                "ai_search_fringe_bucket: NOT_FOUND.");
+      continue;
+    }
+    mu_assert(bucket_cost > cost - 0.001f && bucket_cost < cost * 1.05f + 1,
+              "ai_search_fringe_bucket: near the least cost.");
+    mu_assert(fine_cost > cost - 0.001f && fine_cost < cost + 0.1f,
+              "ai_search_fringe_bucket: nearer with a finer width.");
+    query_count++;
+  }
+  mu_assert(query_count > 20, "ai_search_fringe_bucket: most found.");
+  ai_search_astar_free(sorted);
+  ai_search_astar_free(bucket);
+  ai_search_astar_free(fine);
+  ai_grid_free(grid);
+  return NULL;
+}
+
+// A multi-goal search sorts its fringe again as each Goal is reached.
+char *test_ai_search_fringe_bucket_multi_goal() {
+  ai_grid *grid = ai_grid_constructor(GRID_SIZE, GRID_SIZE);
+  for (int y = 8; y < GRID_SIZE; y++) {
+    ai_grid_blocked_set(grid, GRID_SIZE / 2, y, 1);
+  }
+  ai_grid_query query;
+  ai_grid_query_init(&query, grid, 0, 0);
+  ai_model_state *model_state = ai_grid_model_state_constructor(&query, 2, 40);
+  ai_model_state *goal_list[3] = {
+      ai_grid_model_state_constructor(&query, 60, 60),
+      ai_grid_model_state_constructor(&query, 10, 10),
+      ai_grid_model_state_constructor(&query, 40, 2)};
+  ai_search_astar *sorted =
+      ai_search_astar_constructor(&ai_grid_model_state_evaluator);
+  ai_search_astar *bucket =
+      ai_search_astar_constructor(&ai_grid_model_state_evaluator);
+  bucket->fringe_bucket_width = 0.01f;
+  ai_path *paths[3];
+  float costs[3];
+  float bucket_costs[3];
+  mu_assert(ai_search_astar_find_paths_to_goals(sorted, model_state,
+                                                goal_list, 3, paths,
+                                                costs) == 3,
+            "ai_search_fringe_bucket: sorted multi-goal.");
+  for (int i = 0; i < 3; i++) {
+    _ai_path_free(paths[i], ai_grid_data_free);
+  }
+  mu_assert(ai_search_astar_find_paths_to_goals(bucket, model_state,
+                                                goal_list, 3, paths,
+                                                bucket_costs) == 3,
+            "ai_search_fringe_bucket: multi-goal.");
+  for (int i = 0; i < 3; i++) {
+    mu_assert(fabsf(bucket_costs[i] - costs[i]) < 0.1f,
+              "ai_search_fringe_bucket: multi-goal costs.");
+    _ai_path_free(paths[i], ai_grid_data_free);
+    free(goal_list[i]->data);
+    free(goal_list[i]);
+  }
+  free(model_state->data);
+  free(model_state);
+  ai_search_astar_free(sorted);
+  ai_search_astar_free(bucket);
+  ai_grid_free(grid);
+  return NULL;
+}
+
+// Every tie-break policy finds a cheapest path, and the bucket fringe
+// expands in the same order as the sorted fringe for each.
+char *test_ai_search_fringe_tie_break() {
+  ai_search_tie_break tie_break_list[4] = {
+      AI_SEARCH_TIE_BREAK_FIFO, AI_SEARCH_TIE_BREAK_LIFO,
+      AI_SEARCH_TIE_BREAK_HIGH_G, AI_SEARCH_TIE_BREAK_RANDOM};
+  int expansion_total[4] = {0};
+  ai_search_astar *sorted = ai_search_astar_constructor(&my_evaluator);
+  ai_search_astar *bucket = ai_search_astar_constructor(&my_evaluator);
+  mu_assert(sorted->tie_break == AI_SEARCH_TIE_BREAK_FIFO,
+            "ai_search_astar_constructor: FIFO by default.");
+  bucket->fringe_bucket_width = 1;
+  my_random_seed = 7;
+  for (int i = 0; i < 8; i++) {
+    ai_model_state *model_state = my_scramble(30 + i * 5);
+    int length = -1;
+    for (int t = 0; t < 4; t++) {
+      sorted->tie_break = tie_break_list[t];
+      bucket->tie_break = tie_break_list[t];
+      int sorted_count = sorted->fringe_expansion_count;
+      ai_path *sorted_path = sorted->find_path_to_goal(sorted, model_state);
+      ai_path *bucket_path = bucket->find_path_to_goal(bucket, model_state);
+      int sorted_length = 0;
+      for (ai_path *action = sorted_path; action; action = action->next) {
+        sorted_length++;
+      }
+      if (length < 0) {
+        length = sorted_length;
+      }
+      mu_assert(sorted->status == AI_SEARCH_STATUS_FOUND &&
+                    sorted_length == length,
+                "ai_search_fringe_tie_break: cheapest path.");
+      mu_assert(my_path_equal(sorted_path, bucket_path) &&
+                    bucket->fringe_expansion_count ==
+                        sorted->fringe_expansion_count,
+                "ai_search_fringe_tie_break: bucket fringe order.");
+      expansion_total[t] += sorted->fringe_expansion_count - sorted_count;
+      _ai_path_free(sorted_path, my_data_free);
+      _ai_path_free(bucket_path, my_data_free);
+    }
+    my_data_free(model_state->data);
+    free(model_state);
+  }
+  mu_assert(expansion_total[2] < expansion_total[0],
+            "ai_search_fringe_tie_break: HIGH_G expands fewer.");
+  ai_search_astar_free(sorted);
+  ai_search_astar_free(bucket);
+  return NULL;
+}
+
+// On an open map many states have the same f as the cheapest path. Taking
+// the greatest g first follows one path to the Goal, where FIFO expands
+// most of the plateau. A fine bucket width makes f values that differ only
+// by the rounding of diagonal costs equal.
+char *test_ai_search_fringe_tie_break_open() {
+  ai_grid *grid = ai_grid_constructor(GRID_SIZE, GRID_SIZE);
+  ai_search_astar *astar =
+      ai_search_astar_constructor(&ai_grid_model_state_evaluator);
+  astar->fringe_bucket_width = 0.001f;
+  int expansion_count[4];
+  float cost[4];
+  for (int t = 0; t < 4; t++) {
+    astar->tie_break = (ai_search_tie_break)t;
+    int count = astar->fringe_expansion_count;
+    cost[t] = my_grid_cost(astar, grid, 0, 0, GRID_SIZE - 1, 40);
+    expansion_count[t] = astar->fringe_expansion_count - count;
+    mu_assert(fabsf(cost[t] - cost[0]) < 0.001f,
+              "ai_search_fringe_tie_break: cheapest path on an open map.");
+  }
+  mu_assert(expansion_count[AI_SEARCH_TIE_BREAK_HIGH_G] * 4 <
+                expansion_count[AI_SEARCH_TIE_BREAK_FIFO],
+            "ai_search_fringe_tie_break: HIGH_G crosses the plateau.");
+  ai_search_astar_free(astar);
+  ai_grid_free(grid);
+  return NULL;
+}
+
+// Successors estimated together expand in the same order as those estimated
+// one at a time, with one call per expansion.
+char *test_ai_search_fringe_est_batch() {
+  ai_model_state_evaluator batch_evaluator = my_evaluator;
+  batch_evaluator.goal_est_cost_function = my_counted_goal_est_cost_function;
+  batch_evaluator.goal_est_cost_batch_function =
+      my_goal_est_cost_batch_function;
+  ai_search_mode search_mode_list[2] = {AI_SEARCH_MODE_ASTAR,
+                                        AI_SEARCH_MODE_GREEDY};
+  ai_search_astar *single = ai_search_astar_constructor(&my_evaluator);
+  ai_search_astar *batch = ai_search_astar_constructor(&batch_evaluator);
+  my_random_seed = 11;
+  for (int i = 0; i < 6; i++) {
+    ai_model_state *model_state = my_scramble(30 + i * 5);
+    for (int m = 0; m < 2; m++) {
+      single->search_mode = search_mode_list[m];
+      batch->search_mode = search_mode_list[m];
+      ai_path *single_path = single->find_path_to_goal(single, model_state);
+      my_est_count = 0;
+      my_est_batch_count = 0;
+      int batch_count = batch->fringe_expansion_count;
+      ai_path *batch_path = batch->find_path_to_goal(batch, model_state);
+      batch_count = batch->fringe_expansion_count - batch_count;
+      mu_assert(batch->status == AI_SEARCH_STATUS_FOUND &&
+                    my_path_equal(single_path, batch_path) &&
+                    batch->fringe_expansion_count ==
+                        single->fringe_expansion_count,
+                "ai_search_fringe_est_batch: same search.");
+      mu_assert(my_est_count == 0 && my_est_batch_count > 0 &&
+                    my_est_batch_count <= batch_count,
+                "ai_search_fringe_est_batch: one call per expansion.");
+      _ai_path_free(single_path, my_data_free);
+      _ai_path_free(batch_path, my_data_free);
+    }
+    my_data_free(model_state->data);
+    free(model_state);
+  }
+  ai_search_astar_free(single);
+  ai_search_astar_free(batch);
+  return NULL;
+}
+
+// Past the Goal, the 8-puzzle's cycles would keep the fringe full forever
+// without a closed table, so the search is not begun.
+char *test_ai_search_fringe_continue_past_goal_open() {
+  ai_model_state_evaluator open_evaluator = my_evaluator;
+  open_evaluator.model_state_hash_function = NULL;
+  open_evaluator.model_state_equal_function = NULL;
+  ai_search_astar *astar = ai_search_astar_constructor(&open_evaluator);
+  astar->continue_past_goal = 1;
+  my_random_seed = 5;
+  ai_model_state *model_state = my_scramble(10);
+  int expansion_count = astar->fringe_expansion_count;
+  ai_path *path = astar->find_path_to_goal(astar, model_state);
+  mu_assert(path == NULL && astar->status == AI_SEARCH_STATUS_IDLE &&
+                astar->fringe_expansion_count == expansion_count,
+            "ai_search_astar_begin: continue_past_goal needs closed.");
+  astar->continue_past_goal = 0;
+  path = astar->find_path_to_goal(astar, model_state);
+  mu_assert(astar->status == AI_SEARCH_STATUS_FOUND,
+            "ai_search_astar_begin: found without continue_past_goal.");
+  _ai_path_free(path, my_data_free);
+  my_data_free(model_state->data);
+  free(model_state);
+  ai_search_astar_free(astar);
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test_ai_search_fringe_bucket_exact);
+  mu_run_test(test_ai_search_fringe_bucket_quantised);
+  mu_run_test(test_ai_search_fringe_bucket_multi_goal);
+  mu_run_test(test_ai_search_fringe_tie_break);
+  mu_run_test(test_ai_search_fringe_tie_break_open);
+  mu_run_test(test_ai_search_fringe_est_batch);
+  mu_run_test(test_ai_search_fringe_continue_past_goal_open);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
@@ -0,0 +1,202 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// Custom
+#include <ai_grid.h>
+#include <ai_search_frontier.h>
+#include <ai_state_table.h>
+#include <minunit.h>
+#include "test_random.h"
+
+void _ai_path_free(ai_path *ptr, ai_action_data_free action_data_free);
+
+#define GRID_SIZE 64
+
+/*
+ * A GRID_SIZE x GRID_SIZE grid with one cell in five blocked at random,
+ * and a walled pocket at (1, 1) that can not be reached.
+ */
+ai_grid *my_grid_constructor() {
+  my_random_seed = 1;
+  ai_grid *grid = ai_grid_constructor(GRID_SIZE, GRID_SIZE);
+  for (int y = 0; y < GRID_SIZE; y++) {
+    for (int x = 0; x < GRID_SIZE; x++) {
+      ai_grid_blocked_set(grid, x, y, (my_random() % 5) == 0);
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    ai_grid_blocked_set(grid, i, 2, 1);
+    ai_grid_blocked_set(grid, 2, i, 1);
+  }
+  ai_grid_blocked_set(grid, 1, 1, 0);
+  return grid;
+}
+
+// The operator of a move is its direction, (dx + 1) * 3 + dy + 1.
+int my_operator_function(ai_model_state *model_state, ai_action *action) {
+  ai_grid_state *state = (ai_grid_state *)model_state->data;
+  ai_grid_action *action_data = (ai_grid_action *)action->data;
+  return (action_data->x - state->x + 1) * 3 + action_data->y - state->y + 1;
+}
+
+// The opposite direction.
+int my_reverse_operator_function(ai_model_state *model_state,
+                                 ai_action *action) {
+  return 8 - my_operator_function(model_state, action);
+}
+
+// Cost of the path, or -1 if a move is not a legal move of the grid.
+float my_path_cost(ai_grid *grid, int x, int y, int goal_x, int goal_y,
+                   ai_path *path) {
+  float cost = 0;
+  for (; path; path = path->next) {
+    ai_grid_action *action_data = (ai_grid_action *)path->data;
+    int dx = action_data->x - x;
+    int dy = action_data->y - y;
+    if ((abs(dx) > 1) || (abs(dy) > 1) || (!dx && !dy) ||
+        ai_grid_blocked(grid, action_data->x, action_data->y) ||
+        (dx && dy && (ai_grid_blocked(grid, x + dx, y) ||
+                      ai_grid_blocked(grid, x, y + dy)))) {
+      return -1;
+    }
+    cost += ai_grid_move_cost(x, y, action_data->x, action_data->y);
+    x = action_data->x;
+    y = action_data->y;
+  }
+  return ((x == goal_x) && (y == goal_y)) ? cost : -1;
+}
+
+int my_cost_equal(float a, float b) { return fabsf(a - b) < 0.001f; }
+
+char *test_ai_search_frontier_constructor() {
+  ai_model_state_evaluator unhashed_evaluator = ai_grid_model_state_evaluator;
+  unhashed_evaluator.model_state_hash_function = NULL;
+  mu_assert(ai_search_frontier_constructor(&unhashed_evaluator,
+                                           my_operator_function,
+                                           my_reverse_operator_function) ==
+                NULL,
+            "ai_search_frontier_constructor: hash function required.");
+  mu_assert(ai_search_frontier_constructor(&ai_grid_model_state_evaluator,
+                                           my_operator_function, NULL) == NULL,
+            "ai_search_frontier_constructor: operators required.");
+  ai_search_frontier *frontier = ai_search_frontier_constructor(
+      &ai_grid_model_state_evaluator, my_operator_function,
+      my_reverse_operator_function);
+  mu_assert(frontier && (frontier->fringe_expansion_max == 0) &&
+                (frontier->status == AI_SEARCH_STATUS_IDLE),
+            "ai_search_frontier_constructor: defaults.");
+  ai_search_frontier_free(frontier);
+  return NULL;
+}
+
+// Compare with A* over a spread of cells. Frontier search holds far fewer
+// states than A* keeps closed.
+char *test_ai_search_frontier_find_path() {
+  ai_grid *grid = my_grid_constructor();
+  ai_search_frontier *frontier = ai_search_frontier_constructor(
+      &ai_grid_model_state_evaluator, my_operator_function,
+      my_reverse_operator_function);
+  ai_search_astar *astar =
+      ai_search_astar_constructor(&ai_grid_model_state_evaluator);
+  size_t node_total = 0;
+  size_t closed_total = 0;
+  int query_count = 0;
+  for (int i = 0; i < 40; i++) {
+    int x = my_random() % GRID_SIZE;
+    int y = my_random() % GRID_SIZE;
+    int goal_x = my_random() % GRID_SIZE;
+    int goal_y = my_random() % GRID_SIZE;
+    if (ai_grid_blocked(grid, x, y) || ai_grid_blocked(grid, goal_x, goal_y)) {
+      continue;
+    }
+    ai_grid_query query;
+    ai_grid_query_init(&query, grid, goal_x, goal_y);
+    ai_model_state *model_state =
+        ai_grid_model_state_constructor(&query, x, y);
+    ai_path *path = astar->find_path_to_goal(astar, model_state);
+    float astar_cost = astar->status == AI_SEARCH_STATUS_FOUND
+                           ? my_path_cost(grid, x, y, goal_x, goal_y, path)
+                           : -1;
+    _ai_path_free(path, ai_grid_data_free);
+    path = frontier->find_path_to_goal(frontier, model_state);
+    if (astar_cost < 0) {
+      mu_assert(!path && frontier->status == AI_SEARCH_STATUS_NOT_FOUND,
+                "ai_search_frontier: NOT_FOUND.");
+    } else {
+      mu_assert(frontier->status == AI_SEARCH_STATUS_FOUND,
+                "ai_search_frontier: FOUND.");
+      mu_assert(my_cost_equal(frontier->path_cost, astar_cost) &&
+                    my_cost_equal(my_path_cost(grid, x, y, goal_x, goal_y,
+                                               path),
+                                  astar_cost),
+                "ai_search_frontier: cheapest path.");
+      mu_assert(path == NULL || frontier->search_count > 1,
+                "ai_search_frontier: path recovered by searches.");
+      node_total += frontier->node_count_max;
+      closed_total += astar->closed->count;
+      query_count++;
+    }
+    _ai_path_free(path, ai_grid_data_free);
+    free(model_state->data);
+    free(model_state);
+  }
+  mu_assert(query_count > 20, "ai_search_frontier: most found.");
+  mu_assert(node_total * 2 < closed_total,
+            "ai_search_frontier: fewer states held than A*.");
+  ai_search_astar_free(astar);
+  ai_search_frontier_free(frontier);
+  ai_grid_free(grid);
+  return NULL;
+}
+
+char *test_ai_search_frontier_status() {
+  ai_grid *grid = my_grid_constructor();
+  ai_search_frontier *frontier = ai_search_frontier_constructor(
+      &ai_grid_model_state_evaluator, my_operator_function,
+      my_reverse_operator_function);
+  ai_grid_query query;
+  ai_grid_query_init(&query, grid, 1, 1);
+  ai_model_state *model_state = ai_grid_model_state_constructor(&query, 1, 1);
+  ai_path *path = frontier->find_path_to_goal(frontier, model_state);
+  mu_assert(!path && frontier->status == AI_SEARCH_STATUS_FOUND &&
+                frontier->path_cost == 0,
+            "ai_search_frontier: at the Goal.");
+  free(model_state->data);
+  free(model_state);
+
+  // The pocket can not be reached.
+  model_state =
+      ai_grid_model_state_constructor(&query, GRID_SIZE - 1, GRID_SIZE - 1);
+  ai_grid_blocked_set(grid, GRID_SIZE - 1, GRID_SIZE - 1, 0);
+  path = frontier->find_path_to_goal(frontier, model_state);
+  mu_assert(!path && frontier->status == AI_SEARCH_STATUS_NOT_FOUND,
+            "ai_search_frontier: NOT_FOUND.");
+
+  // Stopped part way.
+  ai_grid_query_init(&query, grid, 3, 3);
+  ai_grid_blocked_set(grid, 3, 3, 0);
+  frontier->fringe_expansion_max = 10;
+  path = frontier->find_path_to_goal(frontier, model_state);
+  mu_assert(!path && frontier->status == AI_SEARCH_STATUS_EXPANSION_LIMIT &&
+                frontier->fringe_expansion_count == 10,
+            "ai_search_frontier: expansion limit.");
+  free(model_state->data);
+  free(model_state);
+  ai_search_frontier_free(frontier);
+  ai_grid_free(grid);
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test_ai_search_frontier_constructor);
+  mu_run_test(test_ai_search_frontier_find_path);
+  mu_run_test(test_ai_search_frontier_status);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
@@ -0,0 +1,183 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// Custom
+#include <ai_grid.h>
+#include <ai_search_hpa.h>
+#include <minunit.h>
+
+void _ai_path_free(ai_path *ptr, ai_action_data_free action_data_free);
+
+/*
+ * A 64 x 64 grid of rooms. Walls run every 16 cells across and down, with
+ * doors in them.
+ */
+ai_grid *my_rooms_grid_constructor() {
+  ai_grid *grid = ai_grid_constructor(64, 64);
+  for (int i = 0; i < 64; i++) {
+    for (int wall = 15; wall < 64; wall += 16) {
+      if ((i % 16) != 7) {
+        ai_grid_blocked_set(grid, wall, i, 1);
+        ai_grid_blocked_set(grid, i, wall, 1);
+      }
+    }
+  }
+  return grid;
+}
+
+// Cost of the path, or -1 if a move is not a legal move of the grid.
+float my_path_cost(ai_grid *grid, int x, int y, int goal_x, int goal_y,
+                   ai_path *path) {
+  float cost = 0;
+  for (; path; path = path->next) {
+    ai_grid_action *action_data = (ai_grid_action *)path->data;
+    int dx = action_data->x - x;
+    int dy = action_data->y - y;
+    if ((abs(dx) > 1) || (abs(dy) > 1) || (!dx && !dy) ||
+        ai_grid_blocked(grid, action_data->x, action_data->y) ||
+        (dx && dy && (ai_grid_blocked(grid, x + dx, y) ||
+                      ai_grid_blocked(grid, x, y + dy)))) {
+      return -1;
+    }
+    cost += ai_grid_move_cost(x, y, action_data->x, action_data->y);
+    x = action_data->x;
+    y = action_data->y;
+  }
+  return ((x == goal_x) && (y == goal_y)) ? cost : -1;
+}
+
+// Optimal cost by A* over the whole grid, and its expansion count.
+float my_astar_cost(ai_grid *grid, int x, int y, int goal_x, int goal_y,
+                    int *expansion_count) {
+  ai_grid_query query;
+  ai_grid_query_init(&query, grid, goal_x, goal_y);
+  ai_model_state *model_state = ai_grid_model_state_constructor(&query, x, y);
+  ai_search_astar *astar =
+      ai_search_astar_constructor(&ai_grid_model_state_evaluator);
+  ai_path *path = astar->find_path_to_goal(astar, model_state);
+  float cost = astar->status == AI_SEARCH_STATUS_FOUND
+                   ? my_path_cost(grid, x, y, goal_x, goal_y, path)
+                   : -1;
+  *expansion_count = astar->fringe_expansion_count;
+  _ai_path_free(path, ai_grid_data_free);
+  ai_search_astar_free(astar);
+  free(model_state->data);
+  free(model_state);
+  return cost;
+}
+
+char *test_ai_grid() {
+  ai_grid *grid = ai_grid_constructor(100, 3);
+  mu_assert(grid->row_words == 2, "ai_grid_constructor: row words.");
+  ai_grid_blocked_set(grid, 70, 1, 1);
+  mu_assert(ai_grid_blocked(grid, 70, 1), "ai_grid_blocked: set.");
+  mu_assert(!ai_grid_blocked(grid, 6, 1) && !ai_grid_blocked(grid, 70, 0),
+            "ai_grid_blocked: others free.");
+  mu_assert(ai_grid_blocked(grid, -1, 0) && ai_grid_blocked(grid, 100, 0),
+            "ai_grid_blocked: off the grid.");
+  ai_grid_blocked_set(grid, 70, 1, 0);
+  mu_assert(!ai_grid_blocked(grid, 70, 1), "ai_grid_blocked: cleared.");
+  mu_assert(ai_grid_octile_distance(0, 0, 3, 1) == 2 + AI_GRID_DIAGONAL_COST,
+            "ai_grid_octile_distance: octile.");
+
+  // Corners may not be cut.
+  ai_grid_blocked_set(grid, 1, 0, 1);
+  int expansion_count = 0;
+  float cost = my_astar_cost(grid, 0, 0, 1, 1, &expansion_count);
+  mu_assert(cost == 2.f, "ai_grid_model_state_evaluator: no corner cutting.");
+  ai_grid_free(grid);
+  return NULL;
+}
+
+char *test_ai_search_hpa_find_path() {
+  ai_grid *grid = my_rooms_grid_constructor();
+  ai_search_hpa *hpa = ai_search_hpa_constructor(grid, 8);
+  mu_assert(hpa, "ai_search_hpa_constructor: built.");
+  mu_assert(hpa->cluster_rebuild_count == 64,
+            "ai_search_hpa_constructor: every cluster built.");
+
+  int expansion_count = 0;
+  float optimal = my_astar_cost(grid, 1, 1, 62, 60, &expansion_count);
+  ai_path *path = ai_search_hpa_find_path(hpa, 1, 1, 62, 60);
+  mu_assert(hpa->status == AI_SEARCH_STATUS_FOUND,
+            "ai_search_hpa_find_path: FOUND.");
+  float cost = my_path_cost(grid, 1, 1, 62, 60, path);
+  mu_assert(cost == hpa->path_cost, "ai_search_hpa_find_path: legal path.");
+  mu_assert((cost >= optimal - 0.001f) && (cost <= optimal * 1.1f),
+            "ai_search_hpa_find_path: near optimal.");
+  mu_assert(hpa->fringe_expansion_count < expansion_count,
+            "ai_search_hpa_find_path: fewer expansions than A*.");
+  _ai_path_free(path, ai_grid_data_free);
+
+  // Within one cluster.
+  path = ai_search_hpa_find_path(hpa, 1, 1, 5, 3);
+  mu_assert(my_path_cost(grid, 1, 1, 5, 3, path) ==
+                2 + 2 * AI_GRID_DIAGONAL_COST,
+            "ai_search_hpa_find_path: within a cluster.");
+  _ai_path_free(path, ai_grid_data_free);
+
+  // Blocked goal.
+  path = ai_search_hpa_find_path(hpa, 1, 1, 15, 1);
+  mu_assert(!path && hpa->status == AI_SEARCH_STATUS_NOT_FOUND,
+            "ai_search_hpa_find_path: blocked goal NOT_FOUND.");
+
+  ai_search_hpa_free(hpa);
+  ai_grid_free(grid);
+  return NULL;
+}
+
+char *test_ai_search_hpa_cell_set() {
+  ai_grid *grid = my_rooms_grid_constructor();
+  ai_search_hpa *hpa = ai_search_hpa_constructor(grid, 8);
+
+  // Close the door at (15, 7). The cell is at the corner of its cluster, so
+  // it and the neighbours across its right and lower borders are built again.
+  ai_search_hpa_cell_set(hpa, 15, 7, 1);
+  ai_path *path = ai_search_hpa_find_path(hpa, 1, 1, 20, 1);
+  mu_assert(hpa->cluster_rebuild_count == 3,
+            "ai_search_hpa_cell_set: three clusters rebuilt.");
+  float cost = my_path_cost(grid, 1, 1, 20, 1, path);
+  mu_assert(cost > 0, "ai_search_hpa_cell_set: legal path.");
+  _ai_path_free(path, ai_grid_data_free);
+
+  // The same as a search built from scratch on the changed grid.
+  ai_search_hpa *fresh = ai_search_hpa_constructor(grid, 8);
+  path = ai_search_hpa_find_path(fresh, 1, 1, 20, 1);
+  mu_assert(fresh->graph->node_count == hpa->graph->node_count &&
+                fresh->graph->edge_count == hpa->graph->edge_count,
+            "ai_search_hpa_cell_set: graph as built from scratch.");
+  mu_assert(fresh->path_cost == cost,
+            "ai_search_hpa_cell_set: cost as built from scratch.");
+  _ai_path_free(path, ai_grid_data_free);
+  ai_search_hpa_free(fresh);
+
+  // A cell inside a cluster rebuilds just that cluster.
+  ai_search_hpa_cell_set(hpa, 3, 3, 1);
+  ai_search_hpa_rebuild(hpa);
+  mu_assert(hpa->cluster_rebuild_count == 1,
+            "ai_search_hpa_cell_set: one cluster rebuilt.");
+
+  // Close every door out of the first room.
+  ai_search_hpa_cell_set(hpa, 7, 15, 1);
+  path = ai_search_hpa_find_path(hpa, 1, 1, 20, 1);
+  mu_assert(!path && hpa->status == AI_SEARCH_STATUS_NOT_FOUND,
+            "ai_search_hpa_cell_set: shut in NOT_FOUND.");
+
+  ai_search_hpa_free(hpa);
+  ai_grid_free(grid);
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test_ai_grid);
+  mu_run_test(test_ai_search_hpa_find_path);
+  mu_run_test(test_ai_search_hpa_cell_set);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
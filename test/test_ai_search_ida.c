@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// Custom
+#include <ai_search.h>
+#include <ai_search_ida.h>
+#include <minunit.h>
+#include "test_puzzle_fixture.h"
+
+/*
+ * Moves of the 8-puzzle are made in place on a state, keeping where the
+ * blank was so that they can be undone.
+ */
+static int my_blank_list[256];
+static int my_blank_count = 0;
+
+// The index-th cell the blank can move to.
+int my_action_next_function(ai_model_state *model_state, int index,
+                            void *action_data) {
+  static const int dx[4] = {1, -1, 0, 0};
+  static const int dy[4] = {0, 0, 1, -1};
+  my_puzzle *data = (my_puzzle *)model_state->data;
+  int blank = 0;
+  while (data->cell[blank]) {
+    blank++;
+  }
+  for (int i = 0; i < 4; i++) {
+    int x = blank % 3 + dx[i];
+    int y = blank / 3 + dy[i];
+    if ((x < 0) || (y < 0) || (x > 2) || (y > 2)) {
+      continue;
+    }
+    if (index-- == 0) {
+      *(int *)action_data = y * 3 + x;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// The blank and the tile in the action's cell swap, so undoing an action
+// is moving the blank back to where it was.
+float my_apply_action_function(ai_model_state *model_state,
+                               ai_action *action) {
+  my_puzzle *data = (my_puzzle *)model_state->data;
+  int to = *(int *)action->data;
+  int blank = 0;
+  while (data->cell[blank]) {
+    blank++;
+  }
+  data->cell[blank] = data->cell[to];
+  data->cell[to] = 0;
+  my_blank_list[my_blank_count++] = blank;
+  return 1.f;
+}
+
+void my_undo_action_function(ai_model_state *model_state, ai_action *action) {
+  my_puzzle *data = (my_puzzle *)model_state->data;
+  int to = *(int *)action->data;
+  int blank = my_blank_list[--my_blank_count];
+  data->cell[to] = data->cell[blank];
+  data->cell[blank] = 0;
+}
+
+static ai_model_state_evaluator my_evaluator = {
+    .successor_function = my_successor_function,
+    .transition_function = my_transition_function,
+    .is_goal_state_function = my_is_goal_state_function,
+    .goal_est_cost_function = my_goal_est_cost_function,
+    .model_state_data_duplicator = my_data_duplicator,
+    .model_state_data_free = my_data_free,
+    .action_data_duplicator = my_action_data_duplicator,
+    .action_data_free = my_data_free,
+    .model_state_hash_function = my_hash_function,
+    .model_state_equal_function = my_equal_function,
+    .model_state_packed_size = sizeof(my_puzzle),
+    .model_state_pack_function = my_pack_function,
+    .model_state_unpack_function = my_unpack_function,
+    .action_packed_size = sizeof(int),
+    .action_next_function = my_action_next_function,
+    .apply_action_function = my_apply_action_function,
+    .undo_action_function = my_undo_action_function,
+};
+
+char *test_ai_search_ida_constructor() {
+  ai_model_state_evaluator copying_evaluator = my_evaluator;
+  copying_evaluator.undo_action_function = NULL;
+  mu_assert(ai_search_ida_constructor(&copying_evaluator) == NULL,
+            "ai_search_ida_constructor: undo required.");
+  ai_search_ida *ida = ai_search_ida_constructor(&my_evaluator);
+  mu_assert(ida && (ida->fringe_expansion_max == 0) &&
+                (ida->status == AI_SEARCH_STATUS_IDLE),
+            "ai_search_ida_constructor: defaults.");
+  ai_search_ida_free(ida);
+  return NULL;
+}
+
+// Compare with A*. The only Model State copied is the working state.
+char *test_ai_search_ida_find_path() {
+  ai_search_ida *ida = ai_search_ida_constructor(&my_evaluator);
+  for (int i = 0; i < 8; i++) {
+    ai_model_state *model_state = my_scramble(30 + i * 5);
+    float astar_cost = my_astar_cost(&my_evaluator, model_state);
+    my_state_copy_count = 0;
+    ai_path *path = ida->find_path_to_goal(ida, model_state);
+    mu_assert(ida->status == AI_SEARCH_STATUS_FOUND &&
+                  ida->path_cost == astar_cost,
+              "ai_search_ida: optimal.");
+    mu_assert(my_state_copy_count == 1 && my_blank_count == 0,
+              "ai_search_ida: one working state, every move undone.");
+    mu_assert(my_path_cost(&my_evaluator, model_state, path) == astar_cost,
+              "ai_search_ida: path to the Goal.");
+    mu_assert(ida->iteration_count >= 1 && ida->depth_max < astar_cost,
+              "ai_search_ida: iterations counted.");
+    _ai_path_free(path, my_data_free);
+    my_data_free(model_state->data);
+    free(model_state);
+  }
+  ai_search_ida_free(ida);
+  return NULL;
+}
+
+char *test_ai_search_ida_status() {
+  ai_search_ida *ida = ai_search_ida_constructor(&my_evaluator);
+  ai_model_state *model_state = my_scramble(0);
+  ai_path *path = ida->find_path_to_goal(ida, model_state);
+  mu_assert(!path && ida->status == AI_SEARCH_STATUS_FOUND &&
+                ida->path_cost == 0 && ida->iteration_count == 1,
+            "ai_search_ida: at the Goal.");
+  my_data_free(model_state->data);
+  free(model_state);
+
+  // Stopped part way, well short of the Goal.
+  model_state = my_scramble(40);
+  while (my_goal_est_cost_function(model_state) < 12) {
+    my_data_free(model_state->data);
+    free(model_state);
+    model_state = my_scramble(40);
+  }
+  ida->fringe_expansion_max = 10;
+  path = ida->find_path_to_goal(ida, model_state);
+  mu_assert(!path && ida->status == AI_SEARCH_STATUS_EXPANSION_LIMIT &&
+                ida->fringe_expansion_count == 10 && my_blank_count == 0,
+            "ai_search_ida: expansion limit.");
+  my_data_free(model_state->data);
+  free(model_state);
+  ai_search_ida_free(ida);
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test_ai_search_ida_constructor);
+  mu_run_test(test_ai_search_ida_find_path);
+  mu_run_test(test_ai_search_ida_status);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
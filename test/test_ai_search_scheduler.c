@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// Custom
+#include <ai_search.h>
+#include <ai_search_scheduler.h>
+#include <minunit.h>
+
+/*
+ * A minimal Model State for driving the scheduler.
+ * The Agent walks along a line of integers towards the Goal.
+ */
+typedef struct my_model_state_data_struct {
+  int agent;
+  int goal;
+} my_model_state_data;
+
+void *my_model_state_data_duplicator(void *data) {
+  my_model_state_data *new_data =
+      (my_model_state_data *)malloc(sizeof(my_model_state_data));
+  memcpy(new_data, data, sizeof(my_model_state_data));
+  return new_data;
+}
+
+void my_data_free(void *data) { free(data); }
+
+void *my_action_data_duplicator(void *data) {
+  int *new_data = (int *)malloc(sizeof(int));
+  *new_data = *(int *)data;
+  return new_data;
+}
+
+ai_model_state *my_transition_function(ai_model_state *model_state,
+                                       ai_action *action) {
+  my_model_state_data *new_data =
+      (my_model_state_data *)my_model_state_data_duplicator(model_state->data);
+  new_data->agent += *(int *)action->data;
+  return ai_model_state_constructor(new_data);
+}
+
+ai_successor *
+my_successor_function(ai_model_state *model_state,
+                      ai_transition_function transition_function) {
+  ai_successor *head = NULL;
+  for (int step = -1; step <= 1; step += 2) {
+    int *action_data = (int *)malloc(sizeof(int));
+    *action_data = step;
+    ai_action *action = ai_action_constructor(action_data);
+    ai_successor *successor = ai_successor_constructor(
+        transition_function(model_state, action), action, 1.f);
+    successor->next = head;
+    head = successor;
+  }
+  return head;
+}
+
+int my_is_goal_state_function(ai_model_state *model_state) {
+  my_model_state_data *data = (my_model_state_data *)model_state->data;
+  return data->agent == data->goal;
+}
+
+float my_goal_est_cost_function(ai_model_state *model_state) {
+  my_model_state_data *data = (my_model_state_data *)model_state->data;
+  return (float)abs(data->goal - data->agent);
+}
+
+static ai_model_state_evaluator evaluator = {
+    .successor_function = my_successor_function,
+    .transition_function = my_transition_function,
+    .is_goal_state_function = my_is_goal_state_function,
+    .goal_est_cost_function = my_goal_est_cost_function,
+    .model_state_data_duplicator = my_model_state_data_duplicator,
+    .model_state_data_free = my_data_free,
+    .action_data_duplicator = my_action_data_duplicator,
+    .action_data_free = my_data_free,
+};
+
+void _ai_path_free(ai_path *ptr, ai_action_data_free action_data_free);
+
+// Completion callback. Records the path length in the user data.
+typedef struct my_result_struct {
+  ai_search_status status;
+  int path_length;
+  int completed;
+  int order;
+} my_result;
+
+static int completion_order = 0;
+
+void my_on_complete(ai_search_astar *astar, ai_search_status status,
+                    ai_path *path, void *user_data) {
+  my_result *result = (my_result *)user_data;
+  result->status = status;
+  result->path_length = 0;
+  for (ai_path *ptr = path; ptr; ptr = ptr->next) {
+    result->path_length++;
+  }
+  result->completed++;
+  result->order = __sync_fetch_and_add(&completion_order, 1);
+  _ai_path_free(path, my_data_free);
+}
+
+/*
+ * Test _ai_search_query_list_add_by_deadline.
+ * Earliest deadline first, no deadline last, then priority.
+ */
+void _ai_search_query_list_add_by_deadline(ai_search_query **query_list,
+                                           ai_search_query *query);
+char *test__ai_search_query_list_add_by_deadline() {
+
+  // Setup
+  ai_search_query none = {.deadline = 0, .priority = 5, .sequence = 0};
+  ai_search_query late = {.deadline = 2.0, .priority = 0, .sequence = 1};
+  ai_search_query early = {.deadline = 1.0, .priority = 0, .sequence = 2};
+  ai_search_query early_urgent = {.deadline = 1.0, .priority = 1,
+                                  .sequence = 3};
+  ai_search_query *list = NULL;
+
+  // Run
+  _ai_search_query_list_add_by_deadline(&list, &none);
+  _ai_search_query_list_add_by_deadline(&list, &late);
+  _ai_search_query_list_add_by_deadline(&list, &early);
+  _ai_search_query_list_add_by_deadline(&list, &early_urgent);
+
+  // Test
+  mu_assert(list == &early_urgent,
+            "_ai_search_query_list_add_by_deadline: [0] early_urgent.");
+  mu_assert(list->next == &early,
+            "_ai_search_query_list_add_by_deadline: [1] early.");
+  mu_assert(list->next->next == &late,
+            "_ai_search_query_list_add_by_deadline: [2] late.");
+  mu_assert(list->next->next->next == &none,
+            "_ai_search_query_list_add_by_deadline: [3] none.");
+  mu_assert(list->next->next->next->next == NULL,
+            "_ai_search_query_list_add_by_deadline: [4] NULL.");
+  return NULL;
+}
+
+/*
+ * No workers. The caller drives the scheduler.
+ * A short query with an earlier deadline completes before a long one.
+ */
+char *test_ai_search_scheduler_run_slice() {
+
+  // Setup
+  ai_search_scheduler *scheduler = ai_search_scheduler_constructor(0, 2);
+  mu_assert(scheduler != NULL, "ai_search_scheduler_run_slice: scheduler.");
+  my_model_state_data long_data = {.agent = 0, .goal = 40};
+  my_model_state_data short_data = {.agent = 0, .goal = 3};
+  ai_model_state *long_state = ai_model_state_constructor(&long_data);
+  ai_model_state *short_state = ai_model_state_constructor(&short_data);
+  ai_search_astar *long_astar = ai_search_astar_constructor(&evaluator);
+  ai_search_astar *short_astar = ai_search_astar_constructor(&evaluator);
+  my_result long_result = {0}, short_result = {0};
+  double now = ai_search_scheduler_now();
+  completion_order = 0;
+
+  // Run
+  ai_search_scheduler_submit(scheduler, long_astar, long_state, now + 10.0, 0,
+                             my_on_complete, &long_result);
+  ai_search_scheduler_submit(scheduler, short_astar, short_state, now + 5.0, 0,
+                             my_on_complete, &short_result);
+  mu_assert(ai_search_scheduler_run_slice(scheduler) == 1,
+            "ai_search_scheduler_run_slice: first slice ran.");
+  mu_assert(short_astar->fringe_expansion_count == 2,
+            "ai_search_scheduler_run_slice: earliest deadline ran first.");
+  mu_assert(long_astar->fringe_expansion_count == 0,
+            "ai_search_scheduler_run_slice: later deadline waited.");
+  ai_search_scheduler_drain(scheduler);
+
+  // Test
+  mu_assert(short_result.completed == 1,
+            "ai_search_scheduler_run_slice: short completed once.");
+  mu_assert(long_result.completed == 1,
+            "ai_search_scheduler_run_slice: long completed once.");
+  mu_assert(short_result.status == AI_SEARCH_STATUS_FOUND,
+            "ai_search_scheduler_run_slice: short FOUND.");
+  mu_assert(short_result.path_length == 3,
+            "ai_search_scheduler_run_slice: short path length.");
+  mu_assert(long_result.path_length == 40,
+            "ai_search_scheduler_run_slice: long path length.");
+  mu_assert(short_result.order < long_result.order,
+            "ai_search_scheduler_run_slice: short completed first.");
+  mu_assert(ai_search_scheduler_run_slice(scheduler) == 0,
+            "ai_search_scheduler_run_slice: nothing left to run.");
+
+  ai_search_scheduler_metrics metrics;
+  ai_search_scheduler_metrics_get(scheduler, &metrics);
+  mu_assert(metrics.submitted_count == 2,
+            "ai_search_scheduler_run_slice: metrics submitted.");
+  mu_assert(metrics.completed_count == 2,
+            "ai_search_scheduler_run_slice: metrics completed.");
+  mu_assert(metrics.in_flight_count == 0,
+            "ai_search_scheduler_run_slice: metrics in flight.");
+  mu_assert(metrics.completion_time.count == 2,
+            "ai_search_scheduler_run_slice: metrics completion samples.");
+  mu_assert(metrics.completion_time.max >= metrics.completion_time.p50,
+            "ai_search_scheduler_run_slice: metrics max >= p50.");
+
+  ai_search_scheduler_free(scheduler);
+  ai_search_astar_free(long_astar);
+  ai_search_astar_free(short_astar);
+  free(long_state);
+  free(short_state);
+  return NULL;
+}
+
+/*
+ * Many queries on several worker threads.
+ */
+#define MY_QUERY_COUNT 64
+char *test_ai_search_scheduler_workers() {
+
+  // Setup
+  ai_search_scheduler *scheduler = ai_search_scheduler_constructor(4, 8);
+  mu_assert(scheduler != NULL, "ai_search_scheduler_workers: scheduler.");
+  my_model_state_data data[MY_QUERY_COUNT];
+  ai_model_state *states[MY_QUERY_COUNT];
+  ai_search_astar *astars[MY_QUERY_COUNT];
+  my_result results[MY_QUERY_COUNT];
+  memset(results, 0, sizeof(results));
+  double now = ai_search_scheduler_now();
+
+  // Run
+  for (int i = 0; i < MY_QUERY_COUNT; i++) {
+    data[i].agent = i;
+    data[i].goal = i * 2 % 17;
+    states[i] = ai_model_state_constructor(&data[i]);
+    astars[i] = ai_search_astar_constructor(&evaluator);
+    ai_search_scheduler_submit(scheduler, astars[i], states[i],
+                               (i % 2) ? now + 1.0 : 0, i % 3, my_on_complete,
+                               &results[i]);
+  }
+  ai_search_scheduler_drain(scheduler);
+
+  // Test
+  for (int i = 0; i < MY_QUERY_COUNT; i++) {
+    mu_assert(results[i].completed == 1,
+              "ai_search_scheduler_workers: completed once.");
+    mu_assert(results[i].status == AI_SEARCH_STATUS_FOUND,
+              "ai_search_scheduler_workers: FOUND.");
+    mu_assert(results[i].path_length == abs(data[i].goal - data[i].agent),
+              "ai_search_scheduler_workers: path length.");
+  }
+  ai_search_scheduler_metrics metrics;
+  ai_search_scheduler_metrics_get(scheduler, &metrics);
+  mu_assert(metrics.completed_count == MY_QUERY_COUNT,
+            "ai_search_scheduler_workers: metrics completed.");
+  mu_assert(metrics.queue_latency.count == MY_QUERY_COUNT,
+            "ai_search_scheduler_workers: metrics queue samples.");
+  mu_assert(metrics.queue_latency.p99 <= metrics.queue_latency.max,
+            "ai_search_scheduler_workers: metrics p99 <= max.");
+
+  ai_search_scheduler_free(scheduler);
+  for (int i = 0; i < MY_QUERY_COUNT; i++) {
+    ai_search_astar_free(astars[i]);
+    free(states[i]);
+  }
+  return NULL;
+}
+
+/*
+ * Queries still in flight when the scheduler is freed are cancelled.
+ */
+char *test_ai_search_scheduler_free_cancels() {
+
+  // Setup
+  ai_search_scheduler *scheduler = ai_search_scheduler_constructor(0, 1);
+  my_model_state_data model_state_data = {.agent = 0, .goal = 10};
+  ai_model_state *model_state = ai_model_state_constructor(&model_state_data);
+  ai_search_astar *astar = ai_search_astar_constructor(&evaluator);
+  my_result result = {0};
+
+  // Run
+  ai_search_scheduler_submit(scheduler, astar, model_state, 0, 0,
+                             my_on_complete, &result);
+  ai_search_scheduler_run_slice(scheduler);
+  ai_search_scheduler_free(scheduler);
+
+  // Test
+  mu_assert(result.completed == 1,
+            "ai_search_scheduler_free_cancels: completed once.");
+  mu_assert(result.status == AI_SEARCH_STATUS_CANCELLED,
+            "ai_search_scheduler_free_cancels: CANCELLED.");
+  mu_assert(result.path_length == 0,
+            "ai_search_scheduler_free_cancels: no path.");
+  ai_search_astar_free(astar);
+  free(model_state);
+  return NULL;
+}
+
+/*
+ * Run the test suite.
+ */
+char *all_tests() {
+  mu_suite_start();
+  mu_run_test(test__ai_search_query_list_add_by_deadline);
+  mu_run_test(test_ai_search_scheduler_run_slice);
+  mu_run_test(test_ai_search_scheduler_workers);
+  mu_run_test(test_ai_search_scheduler_free_cancels);
+  return NULL;
+}
+
+RUN_TESTS(all_tests);
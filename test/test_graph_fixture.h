@@ -0,0 +1,73 @@
+#ifndef _TEST_GRAPH_FIXTURE_H_
+#define _TEST_GRAPH_FIXTURE_H_
+
+#include "test_random.h"
+#include <ai_graph.h>
+#include <math.h>
+#include <stdlib.h>
+
+/*
+ * A road-like test graph. A GRID_SIZE x GRID_SIZE grid of junctions with a
+ * random cost each way, some random long roads, and one node with no roads.
+ * Shared by the graph tests. Included by one source file of each test
+ * program.
+ */
+#define GRID_SIZE 24
+#define NODE_COUNT (GRID_SIZE * GRID_SIZE + 1)
+
+ai_graph *my_road_graph_constructor() {
+  int edge_max = GRID_SIZE * GRID_SIZE * 4 + 100;
+  ai_graph_edge *edges =
+      (ai_graph_edge *)malloc(sizeof(ai_graph_edge) * edge_max);
+  uint32_t edge_count = 0;
+  for (int y = 0; y < GRID_SIZE; y++) {
+    for (int x = 0; x < GRID_SIZE; x++) {
+      uint32_t node = y * GRID_SIZE + x;
+      if (x < GRID_SIZE - 1) {
+        edges[edge_count++] =
+            (ai_graph_edge){node, node + 1, 1.f + my_random() % 10};
+        edges[edge_count++] =
+            (ai_graph_edge){node + 1, node, 1.f + my_random() % 10};
+      }
+      if (y < GRID_SIZE - 1) {
+        edges[edge_count++] =
+            (ai_graph_edge){node, node + GRID_SIZE, 1.f + my_random() % 10};
+        edges[edge_count++] =
+            (ai_graph_edge){node + GRID_SIZE, node, 1.f + my_random() % 10};
+      }
+    }
+  }
+  for (int i = 0; i < 100; i++) {
+    edges[edge_count++] =
+        (ai_graph_edge){my_random() % (GRID_SIZE * GRID_SIZE),
+                        my_random() % (GRID_SIZE * GRID_SIZE),
+                        20.f + my_random() % 20};
+  }
+  ai_graph *graph = ai_graph_constructor(NODE_COUNT, edge_count, edges);
+  free(edges);
+  return graph;
+}
+
+int my_cost_equal(float a, float b) {
+  return fabsf(a - b) <= 0.001f * (b > 1 ? b : 1);
+}
+
+// Sum of the path's edge costs, checking it runs from source to target.
+float my_path_cost(ai_graph *graph, uint32_t source, uint32_t target,
+                   ai_path *path) {
+  float cost = 0;
+  uint32_t node = source;
+  for (ai_action *action = path; action; action = action->next) {
+    ai_graph_action *data = (ai_graph_action *)action->data;
+    if ((data->edge < graph->edge_offset[node]) ||
+        (data->edge >= graph->edge_offset[node + 1]) ||
+        (graph->edge_target[data->edge] != data->target)) {
+      return -1;
+    }
+    cost += graph->edge_cost[data->edge];
+    node = data->target;
+  }
+  return node == target ? cost : -1;
+}
+
+#endif // _TEST_GRAPH_FIXTURE_H_
@@ -0,0 +1,222 @@
+#ifndef _TEST_PUZZLE_FIXTURE_H_
+#define _TEST_PUZZLE_FIXTURE_H_
+
+#include "test_random.h"
+#include <ai_search.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The 8-puzzle. Tiles 1 to 8 and the blank, 0, on a 3 x 3 board. The Goal
+ * has the blank in the top left and the tiles in order after it. A state
+ * packs into its 9 cells. An action is the cell the blank moves to, as an
+ * int.
+ *
+ * Shared by the search tests, which each make their own evaluator from
+ * these functions. Included by one source file of each test program.
+ */
+typedef struct my_puzzle_struct {
+  unsigned char cell[9];
+} my_puzzle;
+
+void _ai_path_free(ai_path *ptr, ai_action_data_free action_data_free);
+
+// States copied, for the tests that count them.
+static int my_state_copy_count = 0;
+
+void *my_data_duplicator(void *data) {
+  my_state_copy_count++;
+  my_puzzle *new_data = (my_puzzle *)malloc(sizeof(my_puzzle));
+  memcpy(new_data, data, sizeof(my_puzzle));
+  return new_data;
+}
+
+void my_data_free(void *data) { free(data); }
+
+// The action is the cell the blank moves to.
+ai_model_state *my_transition_function(ai_model_state *model_state,
+                                       ai_action *action) {
+  my_puzzle *new_data = (my_puzzle *)my_data_duplicator(model_state->data);
+  int to = *(int *)action->data;
+  int blank = 0;
+  while (new_data->cell[blank]) {
+    blank++;
+  }
+  new_data->cell[blank] = new_data->cell[to];
+  new_data->cell[to] = 0;
+  return ai_model_state_constructor(new_data);
+}
+
+ai_successor *
+my_successor_function(ai_model_state *model_state,
+                      ai_transition_function transition_function) {
+  static const int dx[4] = {1, -1, 0, 0};
+  static const int dy[4] = {0, 0, 1, -1};
+  my_puzzle *data = (my_puzzle *)model_state->data;
+  int blank = 0;
+  while (data->cell[blank]) {
+    blank++;
+  }
+  ai_successor *head = NULL;
+  for (int i = 0; i < 4; i++) {
+    int x = blank % 3 + dx[i];
+    int y = blank / 3 + dy[i];
+    if ((x < 0) || (y < 0) || (x > 2) || (y > 2)) {
+      continue;
+    }
+    int *action_data = (int *)malloc(sizeof(int));
+    *action_data = y * 3 + x;
+    ai_action *action = ai_action_constructor(action_data);
+    ai_successor *successor = ai_successor_constructor(
+        transition_function(model_state, action), action, 1.f);
+    successor->next = head;
+    head = successor;
+  }
+  return head;
+}
+
+int my_is_goal_state_function(ai_model_state *model_state) {
+  my_puzzle *data = (my_puzzle *)model_state->data;
+  for (int i = 0; i < 9; i++) {
+    if (data->cell[i] != i) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Manhattan distance of the tiles from their cells.
+float my_goal_est_cost_function(ai_model_state *model_state) {
+  my_puzzle *data = (my_puzzle *)model_state->data;
+  int cost = 0;
+  for (int i = 0; i < 9; i++) {
+    int tile = data->cell[i];
+    if (tile) {
+      cost += abs(i % 3 - tile % 3) + abs(i / 3 - tile / 3);
+    }
+  }
+  return (float)cost;
+}
+
+void *my_action_data_duplicator(void *data) {
+  int *new_data = (int *)malloc(sizeof(int));
+  *new_data = *(int *)data;
+  return new_data;
+}
+
+size_t my_hash_function(ai_model_state *model_state) {
+  my_puzzle *data = (my_puzzle *)model_state->data;
+  size_t hash = 0;
+  for (int i = 0; i < 9; i++) {
+    hash = hash * 31 + data->cell[i];
+  }
+  return hash;
+}
+
+int my_equal_function(ai_model_state *model_state_a,
+                      ai_model_state *model_state_b) {
+  return memcmp(model_state_a->data, model_state_b->data, sizeof(my_puzzle)) ==
+         0;
+}
+
+void my_pack_function(ai_model_state *model_state, void *bytes) {
+  memcpy(bytes, model_state->data, sizeof(my_puzzle));
+}
+
+void *my_unpack_function(const void *bytes) {
+  return my_data_duplicator((void *)bytes);
+}
+
+// A puzzle a random walk away from the Goal.
+ai_model_state *my_scramble(int move_count) {
+  my_puzzle *data = (my_puzzle *)malloc(sizeof(my_puzzle));
+  for (int i = 0; i < 9; i++) {
+    data->cell[i] = i;
+  }
+  ai_model_state *model_state = ai_model_state_constructor(data);
+  for (int i = 0; i < move_count; i++) {
+    ai_successor *successor_list =
+        my_successor_function(model_state, my_transition_function);
+    int count = 0;
+    for (ai_successor *s = successor_list; s; s = s->next) {
+      count++;
+    }
+    int pick = my_random() % count;
+    for (ai_successor *s = successor_list; s;) {
+      ai_successor *next = s->next;
+      if (pick-- == 0) {
+        my_data_free(model_state->data);
+        free(model_state);
+        model_state = s->model_state;
+      } else {
+        my_data_free(s->model_state->data);
+        free(s->model_state);
+      }
+      s->action->next = NULL;
+      _ai_path_free(s->action, my_data_free);
+      free(s);
+      s = next;
+    }
+  }
+  return model_state;
+}
+
+// The cost of following a path from a state, or -1 if it does not end at a
+// Goal.
+float my_path_cost(ai_model_state_evaluator *evaluator,
+                   ai_model_state *model_state, ai_path *path) {
+  ai_model_state *state = ai_model_state_constructor(
+      evaluator->model_state_data_duplicator(model_state->data));
+  float cost = 0;
+  for (ai_path *action = path; action && (cost >= 0); action = action->next) {
+    ai_successor *successor_list =
+        evaluator->successor_function(state, evaluator->transition_function);
+    ai_model_state *next_state = NULL;
+    for (ai_successor *s = successor_list; s;) {
+      ai_successor *next = s->next;
+      ai_model_state *target =
+          evaluator->transition_function(state, action);
+      if (!next_state && evaluator->model_state_equal_function(
+                             s->model_state, target)) {
+        next_state = s->model_state;
+        cost += s->cost;
+      } else {
+        my_data_free(s->model_state->data);
+        free(s->model_state);
+      }
+      my_data_free(target->data);
+      free(target);
+      s->action->next = NULL;
+      _ai_path_free(s->action, my_data_free);
+      free(s);
+      s = next;
+    }
+    my_data_free(state->data);
+    free(state);
+    state = next_state;
+    if (!state) {
+      return -1;
+    }
+  }
+  if (!evaluator->is_goal_state_function(state)) {
+    cost = -1;
+  }
+  my_data_free(state->data);
+  free(state);
+  return cost;
+}
+
+// The cost of the path A* finds.
+float my_astar_cost(ai_model_state_evaluator *evaluator,
+                    ai_model_state *model_state) {
+  ai_search_astar *astar = ai_search_astar_constructor(evaluator);
+  ai_path *path = astar->find_path_to_goal(astar, model_state);
+  float cost = astar->status == AI_SEARCH_STATUS_FOUND
+                   ? my_path_cost(evaluator, model_state, path)
+                   : -1;
+  _ai_path_free(path, my_data_free);
+  ai_search_astar_free(astar);
+  return cost;
+}
+
+#endif // _TEST_PUZZLE_FIXTURE_H_
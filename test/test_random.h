@@ -0,0 +1,16 @@
+#ifndef _TEST_RANDOM_H_
+#define _TEST_RANDOM_H_
+
+/*
+ * Shared by the tests. Included by one source file of each test program.
+ */
+
+static unsigned int my_random_seed = 1;
+
+// A small deterministic generator, so runs are repeatable.
+unsigned int my_random() {
+  my_random_seed = my_random_seed * 1103515245u + 12345u;
+  return (my_random_seed >> 16) & 0x7fff;
+}
+
+#endif // _TEST_RANDOM_H_
@@ -0,0 +1,85 @@
+#ifndef _TEST_RING_FIXTURE_H_
+#define _TEST_RING_FIXTURE_H_
+
+#include "test_puzzle_fixture.h"
+
+/*
+ * A directed ring of MY_RING_SIZE nodes. Each node has an edge to the next
+ * node, costing 1 to 3, and a chord further on, costing 4. The Goal is node
+ * 0, and there is no estimate. A state and an action are the node, as an
+ * int.
+ *
+ * Shared by the search tests. Included by one source file of each test
+ * program.
+ */
+#define MY_RING_SIZE 200
+
+int my_ring_node(ai_model_state *model_state) {
+  return *(int *)model_state->data;
+}
+
+ai_model_state *my_ring_transition_function(ai_model_state *model_state,
+                                            ai_action *action) {
+  return ai_model_state_constructor(my_action_data_duplicator(action->data));
+}
+
+ai_successor *
+my_ring_successor_function(ai_model_state *model_state,
+                           ai_transition_function transition_function) {
+  int node = my_ring_node(model_state);
+  int target[2] = {(node + 1) % MY_RING_SIZE, (node * 7 + 3) % MY_RING_SIZE};
+  float cost[2] = {1.f + node % 3, 4.f};
+  ai_successor *head = NULL;
+  for (int i = 0; i < 2; i++) {
+    ai_action *action =
+        ai_action_constructor(my_action_data_duplicator(&target[i]));
+    ai_successor *successor = ai_successor_constructor(
+        transition_function(model_state, action), action, cost[i]);
+    successor->next = head;
+    head = successor;
+  }
+  return head;
+}
+
+int my_ring_is_goal_state_function(ai_model_state *model_state) {
+  return my_ring_node(model_state) == 0;
+}
+
+float my_ring_goal_est_cost_function(ai_model_state *model_state) {
+  return 0;
+}
+
+size_t my_ring_hash_function(ai_model_state *model_state) {
+  return my_ring_node(model_state);
+}
+
+int my_ring_equal_function(ai_model_state *model_state_a,
+                           ai_model_state *model_state_b) {
+  return my_ring_node(model_state_a) == my_ring_node(model_state_b);
+}
+
+void my_ring_pack_function(ai_model_state *model_state, void *bytes) {
+  memcpy(bytes, model_state->data, sizeof(int));
+}
+
+void *my_ring_unpack_function(const void *bytes) {
+  return my_action_data_duplicator((void *)bytes);
+}
+
+static ai_model_state_evaluator my_ring_evaluator = {
+    .successor_function = my_ring_successor_function,
+    .transition_function = my_ring_transition_function,
+    .is_goal_state_function = my_ring_is_goal_state_function,
+    .goal_est_cost_function = my_ring_goal_est_cost_function,
+    .model_state_data_duplicator = my_action_data_duplicator,
+    .model_state_data_free = my_data_free,
+    .action_data_duplicator = my_action_data_duplicator,
+    .action_data_free = my_data_free,
+    .model_state_hash_function = my_ring_hash_function,
+    .model_state_equal_function = my_ring_equal_function,
+    .model_state_packed_size = sizeof(int),
+    .model_state_pack_function = my_ring_pack_function,
+    .model_state_unpack_function = my_ring_unpack_function,
+};
+
+#endif // _TEST_RING_FIXTURE_H_